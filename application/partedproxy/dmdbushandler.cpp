@@ -25,11 +25,18 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "dmdbushandler.h"
+#include "topologyimage.h"
 
 #include <QObject>
 #include <QDBusError>
 #include <QDBusPendingCallWatcher>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
 DMDbusHandler *DMDbusHandler::m_staticHandeler = nullptr;
 
 DMDbusHandler *DMDbusHandler::instance(QObject *parent)
@@ -71,6 +78,7 @@ DMDbusHandler::DMDbusHandler(QObject *parent)
     qDBusRegisterMetaType<PVInfo>();
     qDBusRegisterMetaType<LVMInfo>();
     qDBusRegisterMetaType<QVector<QString>>();
+    qDBusRegisterMetaType<QVector<qlonglong>>();
     qDBusRegisterMetaType<QList<PVData>>();
     qDBusRegisterMetaType<QList<LVAction>>();
 
@@ -81,6 +89,7 @@ DMDbusHandler::DMDbusHandler(QObject *parent)
     qDBusRegisterMetaType<LUKSInfoMap>();
     qDBusRegisterMetaType<LUKSMap>();
     qDBusRegisterMetaType<WipeAction>();
+    qDBusRegisterMetaType<TopologyDelta>();
 
     m_dbus = new DMDBusInterface("com.deepin.diskmanager", "/com/deepin/diskmanager",
                                  QDBusConnection::systemBus(), this);
@@ -98,15 +107,15 @@ void DMDbusHandler::initConnection()
 {
     connect(m_dbus, &DMDBusInterface::MessageReport, this, &DMDbusHandler::onMessageReport);
     //  connect(m_dbus, &DMDBusInterface::sigUpdateDeviceInfo, this, &DMDbusHandler::sigUpdateDeviceInfo);
-    connect(m_dbus, &DMDBusInterface::updateDeviceInfo, this, &DMDbusHandler::onUpdateDeviceInfo);
-    connect(m_dbus, &DMDBusInterface::updateLUKSInfo, this, &DMDbusHandler::onUpdateLUKSInfo);
+    connect(m_dbus, &DMDBusInterface::updateTopologyDelta, this, &DMDbusHandler::onUpdateTopologyDelta);
+    connect(m_dbus, &DMDBusInterface::updateTopologyImage, this, &DMDbusHandler::onUpdateTopologyImage);
     connect(m_dbus, &DMDBusInterface::unmountPartition, this, &DMDbusHandler::onUnmountPartition);
     connect(m_dbus, &DMDBusInterface::deletePartition, this, &DMDbusHandler::onDeletePartition);
     connect(m_dbus, &DMDBusInterface::hidePartitionInfo, this, &DMDbusHandler::onHidePartition);
     connect(m_dbus, &DMDBusInterface::showPartitionInfo, this, &DMDbusHandler::onShowPartition);
     connect(m_dbus, &DMDBusInterface::createTableMessage, this, &DMDbusHandler::onCreatePartitionTable);
     connect(m_dbus, &DMDBusInterface::usbUpdated, this, &DMDbusHandler::onUpdateUsb);
-    connect(m_dbus, &DMDBusInterface::checkBadBlocksCountInfo, this, &DMDbusHandler::checkBadBlocksCountInfo);
+    connect(m_dbus, &DMDBusInterface::checkBadBlocksProgress, this, &DMDbusHandler::checkBadBlocksProgress);
     connect(m_dbus, &DMDBusInterface::fixBadBlocksInfo, this, &DMDbusHandler::repairBadBlocksInfo);
     connect(m_dbus, &DMDBusInterface::checkBadBlocksFinished, this, &DMDbusHandler::checkBadBlocksFinished);
     connect(m_dbus, &DMDBusInterface::fixBadBlocksFinished, this, &DMDbusHandler::fixBadBlocksFinished);
@@ -199,6 +208,7 @@ void DMDbusHandler::onSetCurSelect(const QString &devicePath, const QString &par
 void DMDbusHandler::startService()
 {
     m_dbus->Start();
+    m_dbus->setTopologyImageEnabled(m_topologyImageEnabled);
 }
 
 void DMDbusHandler::Quit()
@@ -229,10 +239,28 @@ void DMDbusHandler::getDeviceInfo()
 {
     emit showSpinerWindow(true, tr("Initializing data..."));
 
-    m_dbus->getalldevice();
+    resyncTopology();
     qDebug() << __FUNCTION__ << "-------";
 }
 
+void DMDbusHandler::resyncTopology()
+{
+    if (m_topologyResyncing) {
+        return;
+    }
+
+    //服务启动时可能仍在探测设备 异步等待 避免阻塞界面
+    m_topologyResyncing = true;
+    if (m_topologyImageEnabled) {
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_dbus->getTopologyImage(), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, &DMDbusHandler::onTopologyImageResynced);
+        return;
+    }
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_dbus->getTopology(), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &DMDbusHandler::onTopologyResynced);
+}
+
 const DeviceInfoMap &DMDbusHandler::probDeviceInfo() const
 {
     return m_deviceMap;
@@ -415,11 +443,145 @@ void DMDbusHandler::onUpdateLUKSInfo(const LUKSMap &infomap)
     m_curLUKSInfoMap = infomap;
 }
 
+void DMDbusHandler::onUpdateTopologyDelta(const TopologyDelta &delta)
+{
+    //增量是广播信号 开启镜像后同一增量会另外以镜像收到
+    if (m_topologyImageEnabled) {
+        return;
+    }
+
+    handleTopologyDelta(delta);
+}
+
+void DMDbusHandler::handleTopologyDelta(const TopologyDelta &delta)
+{
+    //正在全量同步 之后的增量以同步结果的版本号为基准
+    if (m_topologyResyncing) {
+        return;
+    }
+
+    if (!delta.m_fullSync && delta.m_baseGeneration != m_topologyGeneration) {
+        qDebug() << __FUNCTION__ << "topology generation mismatch, local:" << m_topologyGeneration
+                 << "base:" << delta.m_baseGeneration << "resync";
+        resyncTopology();
+        return;
+    }
+
+    applyTopologyDelta(delta);
+}
+
+void DMDbusHandler::onTopologyResynced(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<TopologyDelta> reply = *watcher;
+    watcher->deleteLater();
+    m_topologyResyncing = false;
+
+    if (reply.isError()) {
+        qDebug() << reply.error().message();
+        emit showSpinerWindow(false, "");
+        return;
+    }
+
+    applyTopologyDelta(reply.value());
+}
+
+void DMDbusHandler::onUpdateTopologyImage(const QDBusUnixFileDescriptor &image)
+{
+    TopologyDelta delta;
+    if (!readTopologyImage(image, delta)) {
+        disableTopologyImage();
+        return;
+    }
+
+    handleTopologyDelta(delta);
+}
+
+void DMDbusHandler::onTopologyImageResynced(QDBusPendingCallWatcher *watcher)
+{
+    QDBusPendingReply<QDBusUnixFileDescriptor> reply = *watcher;
+    watcher->deleteLater();
+    m_topologyResyncing = false;
+
+    TopologyDelta delta;
+    if (reply.isError() || !readTopologyImage(reply.value(), delta)) {
+        qDebug() << __FUNCTION__ << reply.error().message();
+        disableTopologyImage();
+        return;
+    }
+
+    applyTopologyDelta(delta);
+}
+
+bool DMDbusHandler::readTopologyImage(const QDBusUnixFileDescriptor &image, TopologyDelta &delta)
+{
+    if (!image.isValid()) {
+        return false;
+    }
+
+    //只映射已密封的memfd 防止映射期间被截断导致SIGBUS
+    int fd = image.fileDescriptor();
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK) || !(seals & F_SEAL_WRITE)) {
+        qDebug() << __FUNCTION__ << "topology image is not sealed";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return false;
+    }
+
+    void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        qDebug() << __FUNCTION__ << "mmap failed:" << strerror(errno);
+        return false;
+    }
+
+    bool ok = TopologyImage::decode(static_cast<const char *>(data), st.st_size, delta);
+    munmap(data, static_cast<size_t>(st.st_size));
+    if (!ok) {
+        qDebug() << __FUNCTION__ << "invalid topology image";
+    }
+
+    return ok;
+}
+
+void DMDbusHandler::disableTopologyImage()
+{
+    qDebug() << __FUNCTION__ << "fall back to dbus topology";
+    m_topologyImageEnabled = false;
+    m_dbus->setTopologyImageEnabled(false);
+    m_topologyResyncing = false;
+    resyncTopology();
+}
+
+void DMDbusHandler::applyTopologyDelta(const TopologyDelta &delta)
+{
+    DeviceInfoMap deviceMap = m_deviceMap;
+    LVMInfo lvmInfo = m_lvmInfo;
+    LUKSMap luksInfo = m_curLUKSInfoMap;
+    delta.apply(deviceMap, lvmInfo, luksInfo);
+    m_topologyGeneration = delta.m_generation;
+    m_topologyStale = delta.m_stale;
+    if (m_topologyStale) {
+        qDebug() << __FUNCTION__ << "showing cached topology until the service finishes probing";
+    }
+
+    //与原全量信号顺序一致 先更新luks信息 再更新设备信息并通知界面
+    onUpdateLUKSInfo(luksInfo);
+    onUpdateDeviceInfo(deviceMap, lvmInfo);
+}
+
 QMap<QString, QString> DMDbusHandler::getIsExistUnallocated()
 {
     return m_isExistUnallocated;
 }
 
+bool DMDbusHandler::isTopologyStale() const
+{
+    return m_topologyStale;
+}
+
 QStringList DMDbusHandler::getDeviceNameList()
 {
     return m_deviceNameList;
@@ -516,6 +678,30 @@ void DMDbusHandler::checkBadSectors(const QString &devicePath, int blockStart, i
 
 }
 
+bool DMDbusHandler::resumeCheckBadSectors(const QString &devicePath)
+{
+    QDBusPendingReply<bool> reply = m_dbus->onResumeCheckBadBlocks(devicePath);
+    reply.waitForFinished();
+    if (reply.isError()) {
+        qDebug() << reply.error().message();
+        return false;
+    }
+
+    return reply.value();
+}
+
+QStringList DMDbusHandler::getBadSectorsLatency()
+{
+    QDBusPendingReply<QStringList> reply = m_dbus->getBadBlocksLatency();
+    reply.waitForFinished();
+    if (reply.isError()) {
+        qDebug() << reply.error().message();
+        return QStringList();
+    }
+
+    return reply.value();
+}
+
 void DMDbusHandler::repairBadBlocks(const QString &devicePath, QStringList badBlocksList, int repairSize, int flag)
 {
     m_dbus->onFixBadBlocks(devicePath, badBlocksList, repairSize, flag);
@@ -79,6 +79,11 @@ public:
      */
     void getDeviceInfo();
 
+    /**
+     * @brief 向服务请求全量拓扑 本地拓扑版本号过期时调用
+     */
+    void resyncTopology();
+
     /**
      * @brief 获取所有设备信息
      */
@@ -188,6 +193,12 @@ public:
      */
     QMap<QString, QString> getIsExistUnallocated();
 
+    /**
+     * @brief 当前拓扑是否为服务启动时的缓存拓扑 服务探测完成前不允许执行磁盘操作
+     * @return true为缓存拓扑false为已探测拓扑
+     */
+    bool isTopologyStale() const;
+
     /**
      * @brief 获取所有的磁盘名称
      * @return 返回磁盘名称列表
@@ -205,6 +216,19 @@ public:
      */
     void checkBadSectors(const QString &devicePath, int blockStart, int blockEnd, int checkNumber, int checkSize, int flag);
 
+    /**
+     * @brief 从服务端保存的检查点继续坏道检测
+     * @param devicePath 磁盘路径
+     * @return true开始检测false检查点不存在或已全部检测
+     */
+    bool resumeCheckBadSectors(const QString &devicePath);
+
+    /**
+     * @brief 获取最近一次坏道检测的读取耗时统计
+     * @return 第一行为整个设备的统计 其后每个区域一行 获取失败时为空
+     */
+    QStringList getBadSectorsLatency();
+
     /**
      * @brief 坏道修复
      * @param devicePath 磁盘路径
@@ -458,6 +482,31 @@ private:
      */
     void initConnection();
 
+    /**
+     * @brief 合并拓扑增量到本地数据并通知界面刷新
+     * @param delta：拓扑增量
+     */
+    void applyTopologyDelta(const TopologyDelta &delta);
+
+    /**
+     * @brief 处理收到的拓扑增量 版本号连续时合并增量 否则重新全量同步
+     * @param delta：拓扑增量
+     */
+    void handleTopologyDelta(const TopologyDelta &delta);
+
+    /**
+     * @brief 映射memfd并解析拓扑镜像 只接受已密封的memfd
+     * @param image：拓扑镜像描述符
+     * @param delta：拓扑增量
+     * @return true成功false失败
+     */
+    bool readTopologyImage(const QDBusUnixFileDescriptor &image, TopologyDelta &delta);
+
+    /**
+     * @brief 拓扑镜像不可用时退回QDBusArgument增量并重新全量同步
+     */
+    void disableTopologyImage();
+
 signals:
     void showSpinerWindow(bool, const QString &title = "");
     void updateDeviceInfo();
@@ -468,7 +517,7 @@ signals:
     void unmountPartitionMessage(const QString &unmountMessage);
     void createPartitionTableMessage(const bool &flag);
     void updateUsb();
-    void checkBadBlocksCountInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+    void checkBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
 //    void checkBadBlocksDeviceStatusError();
     void repairBadBlocksInfo(const QString &cylinderNumber, const QString &cylinderStatus, const QString &cylinderTimeConsuming);
     void checkBadBlocksFinished();
@@ -514,6 +563,30 @@ private slots:
      */
     void onUpdateLUKSInfo(const LUKSMap &infomap);
 
+    /**
+     * @brief 拓扑增量信号响应的槽函数 使用二进制镜像接收拓扑时忽略
+     * @param delta：拓扑增量
+     */
+    void onUpdateTopologyDelta(const TopologyDelta &delta);
+
+    /**
+     * @brief 全量拓扑请求返回的槽函数
+     * @param watcher：异步调用结果
+     */
+    void onTopologyResynced(QDBusPendingCallWatcher *watcher);
+
+    /**
+     * @brief 拓扑镜像信号响应的槽函数 解析后按增量处理
+     * @param image：拓扑镜像描述符
+     */
+    void onUpdateTopologyImage(const QDBusUnixFileDescriptor &image);
+
+    /**
+     * @brief 全量拓扑镜像请求返回的槽函数
+     * @param watcher：异步调用结果
+     */
+    void onTopologyImageResynced(QDBusPendingCallWatcher *watcher);
+
     /**
      * @brief 接收卸载分区返回执行结果的槽函数
      * @param unmountMessage 执行结果
@@ -576,6 +649,10 @@ private:
     LUKSMap m_curLUKSInfoMap;
     CRYPT_CIPHER_Support m_cryptSupport;
     QMap<QString, QString> m_isAllEncryption;
+    quint64 m_topologyGeneration = 0;   //本地拓扑版本号 0表示尚未同步
+    bool m_topologyResyncing = false;   //是否正在全量同步
+    bool m_topologyImageEnabled = false; //是否通过memfd接收二进制拓扑镜像
+    bool m_topologyStale = false;       //当前拓扑是否为服务缓存的拓扑
 };
 
 #endif // DMDBUSHANDLER_H
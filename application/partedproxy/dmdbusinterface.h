@@ -29,6 +29,7 @@
 #define DMDBUSINTERFACE_H
 
 #include "deviceinfo.h"
+#include "topologydelta.h"
 
 #include <QtCore/QObject>
 #include <QtCore/QByteArray>
@@ -122,6 +123,35 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("getalldevice"), argumentList);
     }
 
+    /**
+     * @brief 获取全量拓扑 本地版本号过期时重新同步
+     */
+    inline QDBusPendingReply<TopologyDelta> getTopology()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("getTopology"), argumentList);
+    }
+
+    /**
+     * @brief 获取全量拓扑的二进制镜像 本地版本号过期时重新同步
+     */
+    inline QDBusPendingReply<QDBusUnixFileDescriptor> getTopologyImage()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("getTopologyImage"), argumentList);
+    }
+
+    /**
+     * @brief 设置拓扑下发方式
+     * @param enable true通过memfd接收二进制镜像 false接收QDBusArgument增量
+     */
+    inline QDBusPendingReply<> setTopologyImageEnabled(bool enable)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(enable);
+        return asyncCallWithArgumentList(QStringLiteral("setTopologyImageEnabled"), argumentList);
+    }
+
     /**
      * @brief 设置当前选择分区
      * @param info 分区信息
@@ -325,6 +355,26 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("onCheckBadBlocksTime"), argumentList);
     }
 
+    /**
+     * @brief 从检查点继续坏道检测
+     * @param devicePath 磁盘路径
+     */
+    inline QDBusPendingReply<bool> onResumeCheckBadBlocks(const QString &devicePath)
+    {
+        QList<QVariant> argumentList;
+        argumentList << QVariant::fromValue(devicePath);
+        return asyncCallWithArgumentList(QStringLiteral("onResumeCheckBadBlocks"), argumentList);
+    }
+
+    /**
+     * @brief 获取最近一次坏道检测的读取耗时统计
+     */
+    inline QDBusPendingReply<QStringList> getBadBlocksLatency()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("getBadBlocksLatency"), argumentList);
+    }
+
     /**
      * @brief 坏道修复
      * @param devicePath 磁盘路径
@@ -492,11 +542,13 @@ Q_SIGNALS: // SIGNALS
     Q_SCRIPTABLE void MessageReport(const QString &msg);
     Q_SCRIPTABLE void updateDeviceInfo(const DeviceInfoMap &infomap, const LVMInfo &lvmInfo);
     Q_SCRIPTABLE void updateLUKSInfo(const LUKSMap &infomap);
+    Q_SCRIPTABLE void updateTopologyDelta(const TopologyDelta &delta);
+    Q_SCRIPTABLE void updateTopologyImage(const QDBusUnixFileDescriptor &image);
     Q_SCRIPTABLE void deletePartition(const QString &deleteMessage);
     Q_SCRIPTABLE void hidePartitionInfo(const QString &hideMessage);
     Q_SCRIPTABLE void showPartitionInfo(const QString &showMessage);
     Q_SCRIPTABLE void usbUpdated();
-    Q_SCRIPTABLE void checkBadBlocksCountInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+    Q_SCRIPTABLE void checkBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
     Q_SCRIPTABLE void checkBadBlocksDeviceStatusError();
     Q_SCRIPTABLE void fixBadBlocksInfo(const QString &cylinderNumber, const QString &cylinderStatus, const QString &cylinderTimeConsuming);
     Q_SCRIPTABLE void checkBadBlocksFinished();
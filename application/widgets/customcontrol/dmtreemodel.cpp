@@ -0,0 +1,233 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "dmtreemodel.h"
+#include "partedproxy/dmdbushandler.h"
+
+#include <QSet>
+
+/**
+ * @brief 比较节点数据是否相同 不比较图标
+ */
+static bool isSameData(const DiskInfoData &a, const DiskInfoData &b)
+{
+    return a.m_diskPath == b.m_diskPath
+           && a.m_diskSize == b.m_diskSize
+           && a.m_partitionPath == b.m_partitionPath
+           && a.m_partitionSize == b.m_partitionSize
+           && a.m_used == b.m_used
+           && a.m_unused == b.m_unused
+           && a.m_fstype == b.m_fstype
+           && a.m_sysLabel == b.m_sysLabel
+           && a.m_mountpoints == b.m_mountpoints
+           && a.m_sectorsUnallocated == b.m_sectorsUnallocated
+           && a.m_start == b.m_start
+           && a.m_end == b.m_end
+           && a.m_level == b.m_level
+           && a.m_flag == b.m_flag
+           && a.m_vgFlag == b.m_vgFlag
+           && a.m_luksFlag == b.m_luksFlag;
+}
+
+DmTreeModel::Node::~Node()
+{
+    qDeleteAll(m_children);
+}
+
+DmTreeModel::DmTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_root(new Node)
+{
+}
+
+DmTreeModel::~DmTreeModel()
+{
+    delete m_root;
+}
+
+void DmTreeModel::update(const QVector<DmTreeNode> &nodes)
+{
+    updateChildren(m_root, QModelIndex(), nodes);
+}
+
+void DmTreeModel::updateChildren(Node *parent, const QModelIndex &parentIndex, const QVector<DmTreeNode> &nodes)
+{
+    //删除新列表中不存在的节点 节点在不同父节点之间移动时同样先删除再插入
+    QSet<QString> ids;
+    foreach (const DmTreeNode &node, nodes) {
+        ids.insert(node.m_id);
+    }
+
+    for (int i = parent->m_children.size() - 1; i >= 0; i--) {
+        Node *child = parent->m_children.at(i);
+        if (ids.contains(child->m_id)) {
+            continue;
+        }
+
+        beginRemoveRows(parentIndex, i, i);
+        parent->m_children.removeAt(i);
+        QList<Node *> removed {child};
+        while (!removed.isEmpty()) {
+            Node *node = removed.takeLast();
+            m_nodes.remove(node->m_id);
+            removed += node->m_children;
+        }
+        delete child;
+        endRemoveRows();
+    }
+
+    //按新顺序逐个匹配 已有节点移动到目标位置并比较数据 不存在则插入
+    for (int i = 0; i < nodes.size(); i++) {
+        const DmTreeNode &node = nodes.at(i);
+        int row = -1;
+        for (int k = i; k < parent->m_children.size(); k++) {
+            if (parent->m_children.at(k)->m_id == node.m_id) {
+                row = k;
+                break;
+            }
+        }
+
+        if (row < 0) {
+            beginInsertRows(parentIndex, i, i);
+            parent->m_children.insert(i, createNode(node, parent));
+            endInsertRows();
+            continue;
+        }
+
+        if (row != i) {
+            beginMoveRows(parentIndex, row, row, parentIndex, i);
+            parent->m_children.move(row, i);
+            endMoveRows();
+        }
+
+        Node *child = parent->m_children.at(i);
+        QModelIndex childIndex = index(i, 0, parentIndex);
+        if (!isSameData(child->m_data, node.m_data)) {
+            child->m_data = node.m_data;
+            emit dataChanged(childIndex, childIndex);
+        }
+
+        updateChildren(child, childIndex, node.m_children);
+    }
+}
+
+DmTreeModel::Node *DmTreeModel::createNode(const DmTreeNode &node, Node *parent)
+{
+    Node *item = new Node;
+    item->m_id = node.m_id;
+    item->m_data = node.m_data;
+    item->m_parent = parent;
+    m_nodes.insert(item->m_id, item);
+    foreach (const DmTreeNode &child, node.m_children) {
+        item->m_children.append(createNode(child, item));
+    }
+
+    return item;
+}
+
+QModelIndex DmTreeModel::indexById(const QString &id) const
+{
+    Node *node = m_nodes.value(id);
+    return node ? indexOfNode(node) : QModelIndex();
+}
+
+QModelIndex DmTreeModel::indexOfNode(Node *node) const
+{
+    if (node == nullptr || node == m_root) {
+        return QModelIndex();
+    }
+
+    return createIndex(node->m_parent->m_children.indexOf(node), 0, node);
+}
+
+DmTreeModel::Node *DmTreeModel::nodeOfIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return m_root;
+    }
+
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex DmTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    Node *parentNode = nodeOfIndex(parent);
+    if (column != 0 || row < 0 || row >= parentNode->m_children.size()) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, parentNode->m_children.at(row));
+}
+
+QModelIndex DmTreeModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid()) {
+        return QModelIndex();
+    }
+
+    return indexOfNode(nodeOfIndex(child)->m_parent);
+}
+
+int DmTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+
+    return nodeOfIndex(parent)->m_children.size();
+}
+
+int DmTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+QVariant DmTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    const Node *node = nodeOfIndex(index);
+    const DiskInfoData &data = node->m_data;
+    bool isLeaf = (data.m_level == DMDbusHandler::PARTITION || data.m_level == DMDbusHandler::LOGICALVOLUME);
+    switch (role) {
+    case DataRole:
+        return QVariant::fromValue(data);
+    case IdRole:
+        return node->m_id;
+    case Qt::DisplayRole:
+        return isLeaf ? QVariant(data.m_diskPath) : QVariant();
+    case Qt::AccessibleDescriptionRole:
+        return isLeaf ? data.m_partitionPath : data.m_diskPath;
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags DmTreeModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
@@ -0,0 +1,125 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DMTREEMODEL_H
+#define DMTREEMODEL_H
+
+#include "dmtreeviewdelegate.h"
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
+
+/**
+ * @struct DmTreeNode
+ * @brief 设备树节点描述 刷新时由设备信息生成 交给DmTreeModel比较后更新
+ */
+struct DmTreeNode {
+    QString m_id;                       //稳定标识 同一设备、分区、vg、lv在多次刷新之间保持不变
+    DiskInfoData m_data;                //节点数据
+    QVector<DmTreeNode> m_children;     //子节点
+};
+
+/**
+ * @class DmTreeModel
+ * @brief 设备树模型 以稳定标识比较新旧节点 只对变化的节点发送插入、删除、移动及dataChanged
+ *        视图的选中项、展开状态及滚动位置随持久索引保留
+ */
+class DmTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum {
+        DataRole = Qt::UserRole + 1,    //节点数据 DiskInfoData
+        IdRole                          //节点稳定标识
+    };
+
+    explicit DmTreeModel(QObject *parent = nullptr);
+    ~DmTreeModel() override;
+
+    /**
+     * @brief 用新的节点列表更新模型
+     * @param nodes 根节点列表
+     */
+    void update(const QVector<DmTreeNode> &nodes);
+
+    /**
+     * @brief 按稳定标识查找节点
+     * @param id 节点标识
+     * @return 节点索引 不存在时无效
+     */
+    QModelIndex indexById(const QString &id) const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+    /**
+     * @struct Node
+     * @brief 模型内部节点
+     */
+    struct Node {
+        ~Node();
+        QString m_id;
+        DiskInfoData m_data;
+        Node *m_parent = nullptr;
+        QList<Node *> m_children;
+    };
+
+    /**
+     * @brief 比较并更新某个节点的子节点
+     * @param parent 父节点
+     * @param parentIndex 父节点索引
+     * @param nodes 新的子节点列表
+     */
+    void updateChildren(Node *parent, const QModelIndex &parentIndex, const QVector<DmTreeNode> &nodes);
+
+    /**
+     * @brief 由节点描述创建节点及其全部子节点
+     * @param node 节点描述
+     * @param parent 父节点
+     * @return 新节点
+     */
+    Node *createNode(const DmTreeNode &node, Node *parent);
+
+    /**
+     * @brief 获取节点索引
+     * @param node 节点
+     * @return 节点索引 根节点返回无效索引
+     */
+    QModelIndex indexOfNode(Node *node) const;
+
+    /**
+     * @brief 从索引获取节点
+     * @param index 索引
+     * @return 节点 无效索引返回根节点
+     */
+    Node *nodeOfIndex(const QModelIndex &index) const;
+
+private:
+    Node *m_root = nullptr;             //不可见的根节点
+    QHash<QString, Node *> m_nodes;     //全部节点 key:稳定标识
+};
+
+#endif // DMTREEMODEL_H
@@ -50,40 +50,9 @@ void DmTreeview::initUI()
     /* setAttribute(Qt::WA_TranslucentBackground)*/; //背景透明
 }
 
-QStandardItem * DmTreeview::addItem(QStandardItem *item, const DiskInfoData &data, int flag)
-{
-    if (data.m_level == DMDbusHandler::DISK || data.m_level == DMDbusHandler::VOLUMEGROUP) {
-        QStandardItem *standardItem = new QStandardItem();
-        standardItem->setAccessibleDescription(data.m_diskPath);
-        standardItem->setData(QVariant::fromValue(data), Qt::UserRole + 1);
-        item->appendRow(standardItem);
-        return standardItem;
-    } else {
-        QStandardItem *standardItem = new QStandardItem(data.m_diskPath);
-        standardItem->setAccessibleDescription(data.m_partitionPath);
-        standardItem->setData(QVariant::fromValue((data)), Qt::UserRole + 1);
-        item->appendRow(standardItem);
-        if (flag == 0) {
-            setExpanded(m_model->index(0, 0), true);
-        }
-
-        return standardItem;
-    }
-}
-
-QStandardItem *DmTreeview::addTopItem(const DiskInfoData &data)
-{
-    QStandardItem *item = new QStandardItem;
-    item->setAccessibleDescription(data.m_diskPath);
-    item->setData(QVariant::fromValue(data), Qt::UserRole + 1);
-    m_model->appendRow(item);
-    return item;
-}
-
 void DmTreeview::initModel()
 {
-    m_model = new QStandardItemModel(this);
-    m_sortViewFilter = new QSortFilterProxyModel(this);
+    m_model = new DmTreeModel(this);
     setModel(m_model);
 }
 
@@ -93,31 +62,72 @@ void DmTreeview::initDelegate()
     setItemDelegate(m_delegate);
 }
 
-QStandardItem *DmTreeview::getCurItem()//获取当前ｉｔｅｍ
+void DmTreeview::updateData(const QVector<DmTreeNode> &nodes)
 {
-    QModelIndex index = currentIndex();
+    //记录当前节点 当前节点被删除时选中原父节点下相同位置的节点
+    QModelIndex current = currentIndex();
+    QString curId = current.data(DmTreeModel::IdRole).toString();
+    QString parentId = current.parent().data(DmTreeModel::IdRole).toString();
+    int row = current.row();
+
+    m_updating = true;
+    m_model->update(nodes);
+    m_updating = false;
+
+    if (curId.isEmpty()) {
+        setDefaultdmItem();
+        return;
+    }
+
+    QModelIndex index = m_model->indexById(curId);
     if (!index.isValid()) {
-        return nullptr;
+        QModelIndex parentIndex = m_model->indexById(parentId);
+        int count = m_model->rowCount(parentIndex);
+        if (parentIndex.isValid() && count > 0) {
+            index = m_model->index(qMin(row, count - 1), 0, parentIndex);
+        } else if (currentIndex().isValid()) {
+            index = currentIndex();
+        }
+    }
+
+    if (!index.isValid()) {
+        setDefaultdmItem();
+        return;
+    }
+
+    if (index == currentIndex()) {
+        //节点未变化时同样通知当前节点 节点数据可能已改变
+        notifyCurrent(index);
     } else {
-        return m_model->itemFromIndex(index);
+        selectIndex(index);
     }
 }
 
-QStandardItem *DmTreeview::getItemByIndex(const QModelIndex &index)
+void DmTreeview::selectIndex(const QModelIndex &index)
 {
-    if (index.isValid()) {
-        return m_model->itemFromIndex(index);
+    for (QModelIndex parentIndex = index.parent(); parentIndex.isValid(); parentIndex = parentIndex.parent()) {
+        setExpanded(parentIndex, true);
     }
-    return nullptr;
+
+    setCurrentIndex(index);
 }
 
 void DmTreeview::currentChanged(const QModelIndex &current, const QModelIndex &previous)
 {
     Q_UNUSED(previous);
-    DiskInfoData data = current.data(Qt::UserRole + 1).value<DiskInfoData>();
+    if (m_updating) {
+        return;
+    }
+
+    notifyCurrent(current);
+}
+
+void DmTreeview::notifyCurrent(const QModelIndex &current)
+{
+    DiskInfoData data = current.data(DmTreeModel::DataRole).value<DiskInfoData>();
     qDebug() << data.m_diskPath << data.m_diskSize << data.m_partitionSize << data.m_partitionPath << data.m_level << data.m_used << data.m_unused << data.m_start << data.m_end << data.m_fstype << data.m_mountpoints << data.m_sysLabel;
 
-    if (data.m_level == DMDbusHandler::OTHER) {
+    if (!current.isValid() || data.m_level == DMDbusHandler::OTHER) {
         return;
     }
 
@@ -143,147 +153,37 @@ void DmTreeview::mousePressEvent(QMouseEvent *event)
     }
 }
 
-void DmTreeview::addItem(DmDiskinfoBox *infoBox, int flag, QStandardItem *purItem)//增加节点
+QModelIndex DmTreeview::setDefaultdmItem()//设置默认选中节点
 {
-    QStandardItem *item = nullptr;
-    DiskInfoData data;
-    data.m_diskSize = infoBox->m_diskSize;
-    data.m_diskPath = infoBox->m_diskPath;
-    data.m_partitionSize = infoBox->m_partitionSize;
-    data.m_partitionPath = infoBox->m_partitionPath;
-    data.m_used = infoBox->m_used;
-    data.m_unused = infoBox->m_unused;
-    data.m_start = infoBox->m_start;
-    data.m_end = infoBox->m_end;
-    data.m_sectorsUnallocated = infoBox->m_sectorsUnallocated;
-    data.m_fstype = infoBox->m_fstype;
-    data.m_sysLabel = infoBox->m_syslabel;
-    data.m_mountpoints = infoBox->m_mountpoints;
-    data.m_flag = infoBox->m_flag;
-    data.m_vgFlag = infoBox->m_vgFlag;
-    data.m_luksFlag = infoBox->m_luksFlag;
-
-    if ((infoBox->m_level <= 0) && !isGroup) {
-        data.m_level = DMDbusHandler::DISK;
-        item = addTopItem(data);
-        foreach (auto sub, infoBox->m_childs) {
-            addSubItem(sub, item, flag);
-        }
-    } else if(infoBox->m_level == DMDbusHandler::OTHER) {
-        data.m_level = DMDbusHandler::OTHER;
-        item = addTopItem(data);
-        m_lstStandardItem << item;
-        foreach (auto sub, infoBox->m_childs) {
-            addSubItem(sub, item, flag);
-        }
-    }else {
-        if (purItem == nullptr) {
-            purItem = getCurItem();
+    //按顺序查找第一个有分区的磁盘 选中其第一个分区
+    QList<QModelIndex> lstIndex;
+    for (int i = 0; i < m_model->rowCount(); i++) {
+        lstIndex << m_model->index(i, 0);
+    }
 
-            if (purItem == nullptr) {
-                return;
-            }
+    while (!lstIndex.isEmpty()) {
+        QModelIndex index = lstIndex.takeFirst();
+        DiskInfoData data = index.data(DmTreeModel::DataRole).value<DiskInfoData>();
+        if (data.m_level == DMDbusHandler::DISK && m_model->rowCount(index) > 0) {
+            selectIndex(m_model->index(0, 0, index));
+            return index;
         }
 
-        if (infoBox->m_level <= 0) {
-
-            QVariant var = purItem->index().data(Qt::UserRole + 1);
-            DiskInfoData parent_data = var.value<DiskInfoData>();
-            data.m_level = DMDbusHandler::DISK;
-
-            item = addItem(purItem, data, flag);
-            foreach (auto sub, infoBox->m_childs) {
-                addSubItem(sub, item, flag);
-            }
-        } else if (infoBox->m_level == DMDbusHandler::VOLUMEGROUP) {
-            QVariant var = purItem->index().data(Qt::UserRole + 1);
-            DiskInfoData parent_data = var.value<DiskInfoData>();
-            data.m_level = DMDbusHandler::VOLUMEGROUP;
-
-            item = addItem(purItem, data, flag);
-            foreach (auto sub, infoBox->m_childs) {
-                addSubItem(sub, item, flag);
-            }
-        } else {
-            QVariant var = purItem->index().data(Qt::UserRole + 1);
-            DiskInfoData parent_data = var.value<DiskInfoData>();
-            data.m_level = parent_data.m_level + 1;
-            addItem(purItem, data, flag);
+        for (int i = 0; i < m_model->rowCount(index); i++) {
+            lstIndex << m_model->index(i, 0, index);
         }
     }
-}
-
-void DmTreeview::clearData()
-{
-    m_lstStandardItem.clear();
-}
-
-void DmTreeview::addTopItem(DmDiskinfoBox *mailBox, int flag)
-{
-    if (mailBox->m_level == DMDbusHandler::OTHER) {
-        isGroup = true;
-        addItem(mailBox, flag);
-    } else {
-        isGroup = false;
-        mailBox->m_level = 0;
-        addItem(mailBox, flag);
-    }
-}
 
-void DmTreeview::addSubItem(DmDiskinfoBox *mailBox, QStandardItem *curItem, int flag)
-{
-    if (mailBox->m_level < 1) {
-        mailBox->m_level = 0;
-    }
-
-    addItem(mailBox, flag, curItem);
-}
-
-QModelIndex DmTreeview::setDefaultdmItem()//设置默认选中节点
-{
-    //QModelIndex index = m_pSortViewFilter->index(0, 0, getRootItemIndex());
-    setCurrentIndex(model()->index(0, 0).child(0, 0));
-    setExpanded(model()->index(0, 0), true);
-
-    return model()->index(0, 0);
+    return QModelIndex();
 }
 
 void DmTreeview::setRefreshItem(int devicenum, int num)//设置刷新后默认选择操作分区
 {
-    if (-1 == devicenum) {
-        setCurrentIndex(m_model->item(num)->index());
-        setExpanded(m_model->item(num)->index(), true);
-    } else {
-        setCurrentIndex(model()->index(devicenum, 0).child(num, 0));
-        setExpanded(model()->index(devicenum, 0), true);
-    }
-}
-
-void DmTreeview::setRefreshItem(int devicenum, int num, int groupNum)
-{
-    if (!m_lstStandardItem.isEmpty()) {
-        for (int i = 0; i < m_lstStandardItem.count(); i++) {
-            QStandardItem *item = m_lstStandardItem.at(i);
-            for (int j = 0; j < item->rowCount(); j++) {
-                QStandardItem *child = item->child(j);
-                if (-1 == groupNum) {
-                    if (i == devicenum && j == num) {
-                        setCurrentIndex(child->index());
-                        setExpanded(item->index(), true);
-                        return;
-                    }
-                } else {
-                    for (int k = 0; k < child->rowCount(); k++) {
-                        if (i == groupNum && j == devicenum && k == num) {
-                            QStandardItem *childItem = child->child(k);
-                            setCurrentIndex(childItem->index());
-                            setExpanded(child->index(), true);
-                            setExpanded(item->index(), true);
-                            return;
-                        }
-                    }
-                }
-            }
+    QModelIndex index = (-1 == devicenum) ? m_model->index(num, 0) : m_model->index(num, 0, m_model->index(devicenum, 0));
+    if (index.isValid()) {
+        selectIndex(index);
+        if (-1 == devicenum) {
+            setExpanded(index, true);
         }
     }
 }
@@ -302,18 +202,3 @@ int DmTreeview::getCurrentGroupNum()
 {
     return m_groupNum;
 }
-
-QStandardItem *DmTreeview::getRootItem()//获取根节点
-{
-    return m_model->item(0);
-}
-
-QModelIndex DmTreeview::getRootItemIndex()
-{
-    return m_sortViewFilter->mapFromSource(getRootItem()->index());
-}
-
-void DmTreeview::sort()
-{
-    m_sortViewFilter->sort(0, Qt::DescendingOrder);
-}
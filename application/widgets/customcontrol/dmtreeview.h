@@ -28,16 +28,14 @@
 #define DMTREEVIEW_H
 
 #include "dmtreeviewdelegate.h"
-#include "dmdiskinfobox.h"
+#include "dmtreemodel.h"
 #include "partitionwidget.h"
 
 #include <DTreeView>
 
-#include <QStandardItemModel>
 #include <QWidget>
 #include <QModelIndex>
 #include <QMouseEvent>
-#include <QSortFilterProxyModel>
 
 DWIDGET_USE_NAMESPACE
 
@@ -53,53 +51,14 @@ public:
     explicit DmTreeview(QWidget *parent = nullptr);
 
     /**
-     * @brief 排序
+     * @brief 用新的设备树节点更新模型 只插入、删除或刷新变化的节点 更新后恢复之前的选中项
+     * @param nodes 根节点列表
     */
-    void sort();
+    void updateData(const QVector<DmTreeNode> &nodes);
 
     /**
-     * @brief 添加子节点
-     * @param item 节点指针
-     * @param data 节点数据
-     * @param flag 是否展开根节点标志
-    */
-    QStandardItem * addItem(QStandardItem *item, const DiskInfoData &data, int flag);
-
-    /**
-     * @brief 获取指向与给定索引关联的QStandardItem的指针
-     * @param index 索引值
-     * @return 返回QStandardItem指针
-    */
-    QStandardItem *getItemByIndex(const QModelIndex &index);
-
-    /**
-     * @brief 添加根节点
-     * @param data 节点数据
-     * @return 返回QStandardItem指针
-    */
-    QStandardItem *addTopItem(const DiskInfoData &data);
-
-    /**
-     * @brief 获取当前节点
-     * @return 返回QStandardItem指针
-    */
-    QStandardItem *getCurItem();
-
-    /**
-     * @brief 获取根节点
-     * @return 返回QStandardItem指针
-    */
-    QStandardItem *getRootItem();
-
-    /**
-     * @brief 获取根节点索引值
-     * @return 返回索引值
-    */
-    QModelIndex getRootItemIndex();
-
-    /**
-     * @brief 设置默认选中节点
-     * @return 返回节点索引值
+     * @brief 设置默认选中节点 选中第一个有分区的磁盘的第一个分区
+     * @return 返回选中节点索引值
     */
     QModelIndex setDefaultdmItem();
 
@@ -110,14 +69,6 @@ public:
     */
     void setRefreshItem(int devicenum, int num);
 
-    /**
-     * @brief 设置刷新后默认选择操作分区
-     * @param devicenum 设备树索引
-     * @param num 设备树子节点索引
-     * @param groupNum 组索引（设备组或逻辑卷组）
-    */
-    void setRefreshItem(int devicenum, int num, int groupNum);
-
     /**
      * @brief 获取当前选中分区索引值
      * @return 当前选中分区索引值
@@ -136,35 +87,7 @@ public:
     */
     int getCurrentGroupNum();
 
-    /**
-     * @brief 添加子节点
-     * @param infoBox 节点数据
-     * @param flag 是否展开根节点标志
-     * @param purItem 节点指针
-    */
-    void addItem(DmDiskinfoBox *infoBox, int flag, QStandardItem *purItem = nullptr);
-
-    /**
-     * @brief 添加根节点
-     * @param mailbox 节点数据
-     * @param flag 是否展开根节点标志
-    */
-    void addTopItem(DmDiskinfoBox *mailBox, int flag);
-
-    /**
-     * @brief 添加节点
-     * @param mailbox 节点数据
-     * @param curItem 节点指针
-     * @param flag 是否展开根节点标志
-    */
-    void addSubItem(DmDiskinfoBox *mailBox, QStandardItem *curItem, int flag);
-
-    /**
-     * @brief 清除根节点数据
-    */
-    void clearData();
-
-    QStandardItemModel *m_model {nullptr};
+    DmTreeModel *m_model {nullptr};
 
 signals:
     void selectItem(const QModelIndex &index);
@@ -189,15 +112,25 @@ private:
     */
     void initDelegate();
 
+    /**
+     * @brief 选中节点并展开其全部父节点
+     * @param index 节点索引
+    */
+    void selectIndex(const QModelIndex &index);
+
+    /**
+     * @brief 记录当前节点位置并发送选中信号
+     * @param current 当前节点索引
+    */
+    void notifyCurrent(const QModelIndex &current);
+
 private:
     QAbstractItemDelegate *m_delegate {nullptr};
-    QSortFilterProxyModel *m_sortViewFilter {nullptr};
     QString m_diskSize;
     int m_curNum = 0;
     int m_diskNum = 0;
     int m_groupNum = 0;
-    bool isGroup = false;
-    QList<QStandardItem *> m_lstStandardItem;
+    bool m_updating = false;    //模型更新中 不发送选中信号
 
 protected:
 
@@ -134,7 +134,7 @@ void DmTreeviewDelegate::paint(QPainter *painter, const QStyleOptionViewItem &op
     QIcon directionIcon;
     int pixmapWidth = 8; // 伸缩按钮宽
     int pixmapHeight = 8; // 伸缩按钮高
-    if (treeView->getItemByIndex(index) && treeView->getItemByIndex(index)->hasChildren()) {
+    if (index.model()->hasChildren(index)) {
         if ((option.state & QStyle::State_Selected) && (data.m_level == DMDbusHandler::DISK || data.m_level == DMDbusHandler::VOLUMEGROUP)) {
             if (treeView->isExpanded(index)) {
                 directionIcon = Common::getIcon("arrow_check");
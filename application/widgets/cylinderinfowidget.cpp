@@ -37,6 +37,10 @@
 #include <QDebug>
 #include <QTime>
 
+#include <cmath>
+
+static const qint64 SlowLatency = 500; // 慢读取阈值 单位ms 读取成功但超过此耗时的柱面以慢读取颜色显示
+
 CylinderInfoWidget::CylinderInfoWidget(int cylNumber, QWidget *parent)
     : DFrame(parent)
     , m_cylNumber(cylNumber)
@@ -58,16 +62,19 @@ void CylinderInfoWidget::initUI()
     m_excellentColor = "#6097FF";
     m_damagedColor = "#E23C3C";
     m_unknownColor = "#777990";
+    m_slowColor = "#FF9D00";
     if (DGuiApplicationHelper::instance()->themeType() == DGuiApplicationHelper::DarkType) {
         m_initColor = "rgba(255,255,255,0.05)";
         m_excellentColor = "#2B6AE3";
         m_damagedColor = "#C41E1E";
         m_unknownColor = "#909090";
+        m_slowColor = "#D98200";
     } else if (DGuiApplicationHelper::instance()->themeType() == DGuiApplicationHelper::LightType) {
         m_initColor = "rgba(0,0,0,0.03)";
         m_excellentColor = "#6097FF";
         m_damagedColor = "#E23C3C";
         m_unknownColor = "#777990";
+        m_slowColor = "#FF9D00";
     }
 
     for (int i = 0; i < initCount; i ++) {
@@ -171,8 +178,11 @@ void CylinderInfoWidget::initConnections()
 
 void CylinderInfoWidget::againVerify(int cylNumber)
 {
+    m_checkData.clear();
     m_curCheckCount = 0;
     m_badSectorsCount = 0;
+    m_latency.clear();
+    m_medianLatency = 0;
     m_scrollBar->hide();
     m_isChanged = false;
     m_startCylinder = m_settings->value("SettingData/BlockStart").toInt();
@@ -211,8 +221,11 @@ void CylinderInfoWidget::againVerify(int cylNumber)
 
 void CylinderInfoWidget::reset(int cylNumber)
 {
+    m_checkData.clear();
     m_curCheckCount = 0;
     m_badSectorsCount = 0;
+    m_latency.clear();
+    m_medianLatency = 0;
     m_scrollBar->hide();
     m_isChanged = false;
 
@@ -256,11 +269,19 @@ void CylinderInfoWidget::setChecked(bool isCheck)
     m_isCheck = isCheck;
 }
 
+void CylinderInfoWidget::setMedianLatency(qint64 usecs)
+{
+    m_medianLatency = usecs;
+}
+
 void CylinderInfoWidget::setCylinderNumber(int cylNumber)
 {
     m_cylNumber = cylNumber;
+    m_checkData.clear();
     m_curCheckCount = 0;
     m_badSectorsCount = 0;
+    m_latency.clear();
+    m_medianLatency = 0;
     m_scrollBar->hide();
     m_isChanged = false;
     m_startCylinder = m_settings->value("SettingData/BlockStart").toInt();
@@ -329,14 +350,11 @@ void CylinderInfoWidget::setCurCheckBadBlocksInfo(const QString &LBANumber, cons
 
     if (cylinderStatus == "bad") {
         ++m_badSectorsCount;
+    } else if (cylinderStatus == "good") {
+        m_latency.add(cylinderTimeConsuming.toLongLong() * 1000);
     }
 
-    if (m_checkData.count() >= 360) {
-        m_checkData.removeFirst();
-        m_cylNumberData.removeFirst();
-    }
-    m_cylNumberData << cylinderNumber;
-    m_checkData << QString("%1,%2,%3,%4,%5,0").arg(LBANumber).arg(cylinderNumber).arg(cylinderTimeConsuming).arg(cylinderStatus).arg(cylinderErrorInfo);
+    m_checkData.insert(cylinderNumber.toInt(), QString("%1,%2,%3,%4,%5,0").arg(LBANumber).arg(cylinderNumber).arg(cylinderTimeConsuming).arg(cylinderStatus).arg(cylinderErrorInfo));
 
     if (m_isChanged) {
         return;
@@ -367,8 +385,8 @@ void CylinderInfoWidget::setCurCheckBadBlocksInfo(const QString &LBANumber, cons
                 QList<QObject *> lstCylinderWidget = m_widget->children();
                 int start = (rowCount - 15) * 24 + m_startCylinder;
                 for (int i = start; i < start + 360; i ++) {
-                    if (-1 != m_cylNumberData.indexOf(QString("%1").arg(i))) {
-                        QString value = m_checkData.at(m_cylNumberData.indexOf(QString("%1").arg(i)));
+                    QString value = m_checkData.value(i);
+                    if (!value.isEmpty()) {
                         QStringList lst = value.split(",");
                         updateCylinderInfo((i - start) % 360, lst.at(0), lst.at(1), lst.at(2), lst.at(3), lst.at(4), lst.at(5));
                     } else {
@@ -404,7 +422,7 @@ void CylinderInfoWidget::updateCylinderInfo(int number, const QString &LBANumber
 
     } else {
         if (cylinderStatus == "good") {
-            cylinderWidget->setStyleSheet(QString("background:%1;border:0px").arg(m_excellentColor));
+            cylinderWidget->setStyleSheet(QString("background:%1;border:0px").arg(heatColor(cylinderTimeConsuming)));
         } else if (cylinderStatus == "bad") {
             cylinderWidget->setStyleSheet(QString("background:%1;border:0px").arg(m_damagedColor));
         } else {
@@ -423,8 +441,38 @@ void CylinderInfoWidget::updateCylinderInfo(int number, const QString &LBANumber
     }
 }
 
+QString CylinderInfoWidget::heatColor(const QString &cylinderTimeConsuming) const
+{
+    double time = cylinderTimeConsuming.toDouble();
+    //优先使用服务端整个设备的统计 界面只收到已显示柱面的耗时
+    qint64 median = m_medianLatency > 0 ? m_medianLatency : m_latency.percentile(0.5);
+    double fast = qMax(1.0, 2.0 * median / 1000.0);
+    if (time >= SlowLatency) {
+        return m_slowColor;
+    }
+    if (time <= fast || fast >= SlowLatency) {
+        return m_excellentColor;
+    }
+
+    //中位数2倍到慢读取阈值之间按对数刻度插值
+    double ratio = std::log(time / fast) / std::log(SlowLatency / fast);
+    QColor from(m_excellentColor);
+    QColor to(m_slowColor);
+    QColor color = QColor::fromRgbF(from.redF() + (to.redF() - from.redF()) * ratio,
+                                    from.greenF() + (to.greenF() - from.greenF()) * ratio,
+                                    from.blueF() + (to.blueF() - from.blueF()) * ratio);
+    return color.name();
+}
+
 void CylinderInfoWidget::setCurRepairBadBlocksInfo(const QString &cylinderNumber)
 {
+    QStringList lstCheckData = m_checkData.value(cylinderNumber.toInt()).split(",");
+    if (lstCheckData.count() == 6) {
+        lstCheckData.replace(3, "good");
+        lstCheckData.replace(5, "1");
+        m_checkData.insert(cylinderNumber.toInt(), lstCheckData.join(","));
+    }
+
     QList<QObject *> lstCylinderWidget = m_widget->children();
 
     if (lstCylinderWidget.count() < 2) {
@@ -446,10 +494,8 @@ void CylinderInfoWidget::setCurRepairBadBlocksInfo(const QString &cylinderNumber
 
         if (mapInfo["number"].toInt() == cylinderNumber.toInt()) {
             cylinderWidget->setStyleSheet(QString("background:%1;border:0px").arg(m_excellentColor));
-            QString curCheckData = m_settings->value(QString("CheckData/%1").arg(cylinderNumber)).toString();
-            QStringList lstCheckData = curCheckData.split(",");
-            mapInfo["status"] = lstCheckData.at(3);
-            mapInfo["repair"] = lstCheckData.at(5);
+            mapInfo["status"] = "good";
+            mapInfo["repair"] = "1";
             cylinderWidget->setUserData(mapInfo);
             break;
         }
@@ -521,7 +567,7 @@ void CylinderInfoWidget::onScrollBarValueChanged(int value)
     QList<QObject *> lstCylinderWidget = m_widget->children();
     int start = value * 24 + startCylinder;
     for (int i = start; i < start + 360; i ++) {
-        QString value = m_settings->value(QString("CheckData/%1").arg(i)).toString();
+        QString value = m_checkData.value(i);
         if (!value.isEmpty()) {
             if (((i - start) % 360 + 1) > (lstCylinderWidget.count() - 1)) {
                 CylinderWidget *cylinderWidget = new CylinderWidget;
@@ -31,8 +31,11 @@
 #include <DArrowRectangle>
 #include <DScrollBar>
 
+#include "latencyhistogram.h"
+
 #include <QWidget>
 #include <QSettings>
+#include <QMap>
 
 DWIDGET_USE_NAMESPACE
 DCORE_USE_NAMESPACE
@@ -79,7 +82,7 @@ public:
     void reset(int cylNumber);
 
     /**
-     * @brief 当前修复坏道信息
+     * @brief 当前修复坏道信息 将柱面记录为已修复
      * @param cylinderNumber 柱面号
      */
     void setCurRepairBadBlocksInfo(const QString &cylinderNumber);
@@ -90,6 +93,12 @@ public:
      */
     void setChecked(bool isCheck);
 
+    /**
+     * @brief 设置服务端统计的整个设备读取耗时中位数 热力图以此为基准
+     * @param usecs 耗时中位数 单位us 小于等于0时使用界面收到的柱面耗时统计
+     */
+    void setMedianLatency(qint64 usecs);
+
 signals:
     /**
      * @brief 检测完成信号
@@ -145,6 +154,14 @@ private:
      */
     void updateCylinderInfo(int number, const QString &LBANumber, const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo, const QString &repair);
 
+    /**
+     * @brief 获取正常柱面的热力图颜色 耗时不超过设备读取耗时中位数2倍时为正常颜色
+     *        超过后按对数刻度向慢读取颜色过渡 达到慢读取阈值时为慢读取颜色
+     * @param cylinderTimeConsuming 柱面耗时 单位ms
+     * @return 颜色
+     */
+    QString heatColor(const QString &cylinderTimeConsuming) const;
+
 private:
     int m_cylNumber;
     QWidget *m_widget;
@@ -160,13 +177,15 @@ private:
     QString m_excellentColor;
     QString m_damagedColor;
     QString m_unknownColor;
+    QString m_slowColor;
+    LatencyHistogram m_latency; // 本次检测正常柱面的耗时分布 单位us
+    qint64 m_medianLatency = 0; // 服务端统计的设备读取耗时中位数 单位us
     int m_curCheckCount;
     int m_badSectorsCount;
     QSettings *m_settings;
     bool m_isChanged = false;
     bool m_isCheck = false;
-    QStringList m_checkData;
-    QStringList m_cylNumberData;
+    QMap<int, QString> m_checkData; // 本次检测各柱面的检测信息 key:柱面号 value:LBA,柱面号,耗时,状态,错误信息,是否已修复
     int m_startCylinder;
     int m_endCylinder;
 };
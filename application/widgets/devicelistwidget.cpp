@@ -25,7 +25,6 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "devicelistwidget.h"
-#include "customcontrol/dmdiskinfobox.h"
 #include "diskinfodisplaydialog.h"
 #include "diskhealthdetectiondialog.h"
 #include "messagebox.h"
@@ -96,11 +95,11 @@ void DeviceListWidget::treeMenu(const QPoint &pos)
     QModelIndex curIndex = m_treeView->indexAt(pos);      //当前点击的元素的index
     QModelIndex index = curIndex.sibling(curIndex.row(),0); //该行的第1列元素的index
 
-    if (!index.isValid()) {
+    if (!index.isValid() || DMDbusHandler::instance()->isTopologyStale()) {
         return;
     }
 
-    m_curDiskInfoData = m_treeView->getCurItem()->data().value<DiskInfoData>();
+    m_curDiskInfoData = m_treeView->currentIndex().data(DmTreeModel::DataRole).value<DiskInfoData>();
     if (m_curDiskInfoData.m_level == DMDbusHandler::DISK) {
         QMenu *menu = new QMenu(this);
         menu->setObjectName("treeMenu");
@@ -806,305 +805,161 @@ void DeviceListWidget::setCurVGName(const QString &vgName)
     m_curChooseVGName = vgName;
 }
 
-void DeviceListWidget::onUpdateDeviceInfo()
+/**
+ * @brief 生成设备树节点数据
+ */
+static DiskInfoData treeNodeData(int level, const QString &diskPath, const QString &diskSize = "", int vgFlag = 0, int luksFlag = 0,
+                                 const QString &partitionPath = "", const QString &partitionSize = "", const QString &used = "", const QString &unused = "",
+                                 Sector sectorsUnallocated = 0, Sector start = 0, Sector end = 0, const QString &fstype = "",
+                                 const QString &mountpoints = "", const QString &systemLabel = "", int flag = 0)
 {
-    //更新DmTreeview  lx
-    //设置当前选项
-
-    auto handler = DMDbusHandler::instance();
-    m_num = handler->getCurPartititonInfo().m_partitionNumber;
-    m_deviceNum = m_treeView->getCurrentTopNum();
-    m_devicePath = handler->getCurPartititonInfo().m_devicePath;
-    m_treeView->m_model->clear();
-    m_treeView->clearData();
-    DeviceInfoMap infoMap = DMDbusHandler::instance()->probDeviceInfo();
-    QMap<int, int> countMap;
-    int deviceCount = 0;
-
-    LVMInfo lvmInfo = DMDbusHandler::instance()->probLVMInfo();
-    QMap<QString, VGInfo> mapVGInfo = lvmInfo.m_vgInfo;
-    QMap<int, int> countVGMap;
-    int vgCount = 0;
-
-    if (0 != mapVGInfo.count()) {
-        auto lvmInfoBox = new DmDiskinfoBox(DMDbusHandler::OTHER, this, tr("Volume Groups"), "");
-        for (auto vgInfo = mapVGInfo.begin(); vgInfo != mapVGInfo.end(); vgInfo++) {
-            VGInfo vgInformation = vgInfo.value();
-
-            if (vgInformation.m_vgName.isEmpty()) {
-                continue;
-            }
-            qDebug() << vgInformation.m_vgName << Utils::LVMFormatSize(vgInformation.m_peCount * vgInformation.m_PESize)
-                     << vgInformation.m_peCount << vgInformation.m_PESize
-                     << Utils::LVMFormatSize(vgInformation.m_peCount * vgInformation.m_PESize + vgInformation.m_PESize) << vgInformation.m_vgSize;
-            QString vgSize = vgInformation.m_vgSize;
-            if (vgSize.contains("1024")) {
-                vgSize = Utils::LVMFormatSize(vgInformation.m_peCount * vgInformation.m_PESize + vgInformation.m_PESize);
-            }
-            auto vgInfoBox = new DmDiskinfoBox(DMDbusHandler::VOLUMEGROUP, this, vgInformation.m_vgName, vgSize,
-                                               0, vgInformation.m_luksFlag, vgInformation.m_vgName);
-            int lvCount = 0;
-
-            for (auto lvInfo = vgInformation.m_lvlist.begin(); lvInfo != vgInformation.m_lvlist.end(); lvInfo++) {
-                QString used = Utils::LVMFormatSize(lvInfo->m_fsUsed);
-                QString unused = Utils::LVMFormatSize(lvInfo->m_fsUnused);
-                if (lvInfo->m_lvName.isEmpty() && lvInfo->m_lvUuid.isEmpty()) {
-                    unused = Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize);
-                    lvInfo->m_lvName = "unallocated";
-                }
-
-                FSType fstype = static_cast<FSType>(lvInfo->m_lvFsType);
-                QString fstypeName = Utils::fileSystemTypeToString(fstype);
-
-                QString mountPoints;
-                for (int i = 0; i < lvInfo->m_mountPoints.size(); i++) {
-                    mountPoints += lvInfo->m_mountPoints[i];
-                }
-                qDebug() << lvInfo->m_lvName << Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize)
-                         << Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize + lvInfo->m_LESize)
-                         << lvInfo->m_lvLECount << lvInfo->m_LESize << lvInfo->m_lvSize;
-                QString lvSize = lvInfo->m_lvSize;
-                if (lvSize.contains("1024")) {
-                    lvSize = Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize + lvInfo->m_LESize);
-                }
-                auto lvInfoBox = new DmDiskinfoBox(DMDbusHandler::LOGICALVOLUME, this, lvInfo->m_vgName, "", 0, lvInfo->m_luksFlag,
-                                                   lvInfo->m_lvPath, lvSize, used, unused, 0, 0, 0, fstypeName,
-                                                   mountPoints, lvInfo->m_lvName, 0);
-
-                vgInfoBox->m_childs.append(lvInfoBox);
-
-                lvCount ++;
-            }
-            lvmInfoBox->m_childs.append(vgInfoBox);
+    DiskInfoData data;
+    data.m_diskPath = diskPath;
+    data.m_diskSize = diskSize;
+    data.m_partitionPath = partitionPath;
+    data.m_partitionSize = partitionSize;
+    data.m_used = used;
+    data.m_unused = unused;
+    data.m_fstype = fstype;
+    data.m_sysLabel = systemLabel;
+    data.m_mountpoints = mountpoints;
+    data.m_sectorsUnallocated = sectorsUnallocated;
+    data.m_start = start;
+    data.m_end = end;
+    data.m_level = level;
+    data.m_flag = flag;
+    data.m_vgFlag = vgFlag;
+    data.m_luksFlag = luksFlag;
+    return data;
+}
 
-            countVGMap[vgCount] = lvCount;
-            vgCount ++;
+DmTreeNode DeviceListWidget::createDiskNode(const DeviceInfo &info)
+{
+    DmTreeNode diskNode;
+    diskNode.m_id = "disk:" + info.m_path;
+    diskNode.m_data = treeNodeData(DMDbusHandler::DISK, info.m_path, Utils::formatSize(info.m_length, info.m_sectorSize),
+                                   info.m_vgFlag, info.m_luksFlag, info.m_path);
+
+    for (auto it = info.m_partition.begin(); it != info.m_partition.end(); it++) {
+        QString partitionSize = Utils::formatSize(it->m_sectorEnd - it->m_sectorStart + 1, it->m_sectorSize);
+        QString partitionPath = it->m_path;
+        if ("unallocated" != partitionPath) {
+            partitionPath = partitionPath.remove(0, 5);
         }
 
-        auto infoBox = new DmDiskinfoBox(DMDbusHandler::OTHER, this, tr("Disks"), "");
-        for (auto devInfo = infoMap.begin(); devInfo != infoMap.end(); devInfo++) {
-            DeviceInfo info = devInfo.value();
-
-            if (info.m_path.isEmpty() || info.m_path.contains("/dev/mapper")) {
-                continue;
-            }
-
-            QString diskSize = Utils::formatSize(info.m_length, info.m_sectorSize);
-            auto diskinfoBox = new DmDiskinfoBox(DMDbusHandler::DISK, this, info.m_path, diskSize,
-                                                 info.m_vgFlag, info.m_luksFlag, info.m_path);
-            int partitionCount = 0;
-
-            for (auto it = info.m_partition.begin(); it != info.m_partition.end(); it++) {
-                QString partitionSize = Utils::formatSize(it->m_sectorEnd - it->m_sectorStart + 1, it->m_sectorSize);
-                QString partitionPath = it->m_path;
-                if ("unallocated" != partitionPath) {
-                    partitionPath = partitionPath.remove(0, 5);
-                }
-
-                QString used = Utils::formatSize(it->m_sectorsUsed, it->m_sectorSize);
-                QString unused = Utils::formatSize(it->m_sectorsUnused, it->m_sectorSize);
-
-                FSType fstype = static_cast<FSType>(it->m_fileSystemType);
-                QString fstypeName = Utils::fileSystemTypeToString(fstype);
-                QString mountpoints;
-
-                for (int i = 0; i < it->m_mountPoints.size(); i++) {
-                    mountpoints += it->m_mountPoints[i];
-                }
+        QString used = Utils::formatSize(it->m_sectorsUsed, it->m_sectorSize);
+        QString unused = Utils::formatSize(it->m_sectorsUnused, it->m_sectorSize);
 
-                QString fileSystemLabel = it->m_fileSystemLabel;
-                auto childDiskinfoBox = new DmDiskinfoBox(DMDbusHandler::PARTITION, this, it->m_devicePath, "", it->m_vgFlag, it->m_luksFlag,
-                                                          partitionPath, partitionSize, used, unused,
-                                                          it->m_sectorsUnallocated, it->m_sectorStart, it->m_sectorEnd, fstypeName,
-                                                          mountpoints, fileSystemLabel, it->m_flag);
-                diskinfoBox->m_childs.append(childDiskinfoBox);
+        FSType fstype = static_cast<FSType>(it->m_fileSystemType);
+        QString fstypeName = Utils::fileSystemTypeToString(fstype);
+        QString mountpoints;
 
-                partitionCount ++;
-            }
-            infoBox->m_childs.append(diskinfoBox);
-
-            countMap[deviceCount] = partitionCount;
-            deviceCount ++;
+        for (int i = 0; i < it->m_mountPoints.size(); i++) {
+            mountpoints += it->m_mountPoints[i];
         }
-        m_treeView->addTopItem(lvmInfoBox, m_addItem);
-        m_treeView->addTopItem(infoBox, m_addItem);
 
-        QStringList deviceNameList = DMDbusHandler::instance()->getDeviceNameList();
-        if (DMDbusHandler::DISK == DMDbusHandler::instance()->getCurLevel() ||
-                DMDbusHandler::PARTITION == DMDbusHandler::instance()->getCurLevel()) {
-            if (deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath()) == -1) {
-                m_flag = 0;
-            } else {
-                m_deviceNum = deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath());
-            }
-        } else {
-            QStringList vgNameList = DMDbusHandler::instance()->getVGNameList();
-            if (vgNameList.indexOf(DMDbusHandler::instance()->getCurVGName()) == -1) {
-                m_flag = 0;
-            } else {
-                m_deviceNum = vgNameList.indexOf(DMDbusHandler::instance()->getCurVGName());
-            }
-        }
+        //分区以路径作为标识 格式化后uuid会变化 未分配空间以起始扇区区分
+        DmTreeNode partitionNode;
+        partitionNode.m_id = ("unallocated" == it->m_path) ? QString("partition:%1:unallocated:%2").arg(info.m_path).arg(it->m_sectorStart)
+                                                           : "partition:" + it->m_path;
+        partitionNode.m_data = treeNodeData(DMDbusHandler::PARTITION, it->m_devicePath, "", it->m_vgFlag, it->m_luksFlag,
+                                            partitionPath, partitionSize, used, unused,
+                                            it->m_sectorsUnallocated, it->m_sectorStart, it->m_sectorEnd, fstypeName,
+                                            mountpoints, it->m_fileSystemLabel, it->m_flag);
+        diskNode.m_children.append(partitionNode);
+    }
 
-        m_addItem = 1;
+    return diskNode;
+}
 
-        if (m_flag == 0) {
-            for (int i = 0; i < deviceNameList.count(); i++) {
-                if (countMap.value(i) != 0) {
-                    m_treeView->setRefreshItem(i, 0, 1);
-                    m_vgIsShow = true;
-                    break;
-                }
-            }
+DmTreeNode DeviceListWidget::createVGNode(const VGInfo &vgInfo)
+{
+    qDebug() << vgInfo.m_vgName << Utils::LVMFormatSize(vgInfo.m_peCount * vgInfo.m_PESize)
+             << vgInfo.m_peCount << vgInfo.m_PESize
+             << Utils::LVMFormatSize(vgInfo.m_peCount * vgInfo.m_PESize + vgInfo.m_PESize) << vgInfo.m_vgSize;
+    QString vgSize = vgInfo.m_vgSize;
+    if (vgSize.contains("1024")) {
+        vgSize = Utils::LVMFormatSize(vgInfo.m_peCount * vgInfo.m_PESize + vgInfo.m_PESize);
+    }
+
+    DmTreeNode vgNode;
+    vgNode.m_id = "vg:" + (vgInfo.m_vgUuid.isEmpty() ? vgInfo.m_vgName : vgInfo.m_vgUuid);
+    vgNode.m_data = treeNodeData(DMDbusHandler::VOLUMEGROUP, vgInfo.m_vgName, vgSize, 0, vgInfo.m_luksFlag, vgInfo.m_vgName);
+
+    int unallocatedCount = 0;
+    for (auto lvInfo = vgInfo.m_lvlist.begin(); lvInfo != vgInfo.m_lvlist.end(); lvInfo++) {
+        QString lvName = lvInfo->m_lvName;
+        QString used = Utils::LVMFormatSize(lvInfo->m_fsUsed);
+        QString unused = Utils::LVMFormatSize(lvInfo->m_fsUnused);
+        DmTreeNode lvNode;
+        if (lvInfo->m_lvName.isEmpty() && lvInfo->m_lvUuid.isEmpty()) {
+            unused = Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize);
+            lvName = "unallocated";
+            lvNode.m_id = QString("lv:%1:unallocated:%2").arg(vgInfo.m_vgName).arg(unallocatedCount++);
         } else {
-            int index = m_treeView->getCurrentNum();
-            if (-1 != m_treeView->getCurrentGroupNum()) {
-                if (DMDbusHandler::DISK == DMDbusHandler::instance()->getCurLevel() ||
-                        DMDbusHandler::PARTITION == DMDbusHandler::instance()->getCurLevel()) {
-                    if (countMap.value(m_deviceNum) == index) {
-                        index = m_treeView->getCurrentNum() - 1;
-                    }
-
-                    if (countMap.value(m_deviceNum) < index) {
-                        index = countMap.value(m_deviceNum) - 1;
-                    }
-                } else {
-                    if (countVGMap.value(m_deviceNum) == index) {
-                        index = m_treeView->getCurrentNum() - 1;
-                    }
-
-                    if (countVGMap.value(m_deviceNum) < index) {
-                        index = countVGMap.value(m_deviceNum) - 1;
-                    }
-                }
-            }
-
-            int groupNum = m_treeView->getCurrentGroupNum();
-            int topNum = m_treeView->getCurrentTopNum();
-            // 判断是否第一次显示VG
-            if (!m_vgIsShow) {
-                groupNum = 1; // 设置组节点为1
-
-                // 判断VG显示之前是否选择的是磁盘节点
-                if (topNum == -1) {
-                    groupNum = -1; // 若之前选择的是磁盘节点，设置组节点为-1
-                    topNum = 1; // 若之前选择的是磁盘节点，设置根节点为1
-                }
-                m_vgIsShow = true;
-            }
-
-            // 当前选择的是逻辑卷时，判断父节点位置是否发生改变；当前是逻辑卷组时，判断位置是否发生改变
-            // 针对于逻辑盘插拔时，没有默认选中节点做的处理
-            if (DMDbusHandler::instance()->getCurLevel() == DMDbusHandler::LOGICALVOLUME) {
-                topNum = topNum == m_deviceNum ? topNum : m_deviceNum;
-            } else if (DMDbusHandler::instance()->getCurLevel() == DMDbusHandler::VOLUMEGROUP){
-                index = index == m_deviceNum ? index : m_deviceNum;
-            }
-
-            m_treeView->setRefreshItem(topNum, index, groupNum);
+            lvNode.m_id = "lv:" + (lvInfo->m_lvUuid.isEmpty() ? lvInfo->m_lvPath : lvInfo->m_lvUuid);
         }
 
-        m_flag += 1;
-    } else {
-        for (auto devInfo = infoMap.begin(); devInfo != infoMap.end(); devInfo++) {
-            DeviceInfo info = devInfo.value();
-
-            if (info.m_path.isEmpty() || info.m_path.contains("/dev/mapper")) {
-                continue;
-            }
-
-            QString diskSize = Utils::formatSize(info.m_length, info.m_sectorSize);
-            auto diskinfoBox = new DmDiskinfoBox(DMDbusHandler::DISK, this, info.m_path, diskSize,
-                                                 info.m_vgFlag, info.m_luksFlag, info.m_path);
-            int partitionCount = 0;
+        FSType fstype = static_cast<FSType>(lvInfo->m_lvFsType);
+        QString fstypeName = Utils::fileSystemTypeToString(fstype);
 
-            for (auto it = info.m_partition.begin(); it != info.m_partition.end(); it++) {
-                QString partitionSize = Utils::formatSize(it->m_sectorEnd - it->m_sectorStart + 1, it->m_sectorSize);
-                QString partitionPath = it->m_path;
-                if ("unallocated" != partitionPath) {
-                    partitionPath = partitionPath.remove(0, 5);
-                }
-
-                QString used = Utils::formatSize(it->m_sectorsUsed, it->m_sectorSize);
-                QString unused = Utils::formatSize(it->m_sectorsUnused, it->m_sectorSize);
-
-                FSType fstype = static_cast<FSType>(it->m_fileSystemType);
-                QString fstypeName = Utils::fileSystemTypeToString(fstype);
-                QString mountpoints;
-
-                for (int i = 0; i < it->m_mountPoints.size(); i++) {
-                    mountpoints += it->m_mountPoints[i];
-                }
-
-                QString fileSystemLabel = it->m_fileSystemLabel;
-                auto childDiskinfoBox = new DmDiskinfoBox(DMDbusHandler::PARTITION, this, it->m_devicePath, "", it->m_vgFlag, it->m_luksFlag,
-                                                          partitionPath, partitionSize, used, unused,
-                                                          it->m_sectorsUnallocated, it->m_sectorStart, it->m_sectorEnd, fstypeName,
-                                                          mountpoints, fileSystemLabel, it->m_flag);
-                diskinfoBox->m_childs.append(childDiskinfoBox);
-
-                partitionCount ++;
-            }
-
-            m_treeView->addTopItem(diskinfoBox, m_addItem);
-
-            countMap[deviceCount] = partitionCount;
-            deviceCount ++;
+        QString mountPoints;
+        for (int i = 0; i < lvInfo->m_mountPoints.size(); i++) {
+            mountPoints += lvInfo->m_mountPoints[i];
         }
-
-        QStringList deviceNameList = DMDbusHandler::instance()->getDeviceNameList();
-
-        if (deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath()) == -1) {
-            m_flag = 0;
-        } else {
-            m_deviceNum = deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath());
+        qDebug() << lvName << Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize)
+                 << Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize + lvInfo->m_LESize)
+                 << lvInfo->m_lvLECount << lvInfo->m_LESize << lvInfo->m_lvSize;
+        QString lvSize = lvInfo->m_lvSize;
+        if (lvSize.contains("1024")) {
+            lvSize = Utils::LVMFormatSize(lvInfo->m_lvLECount * lvInfo->m_LESize + lvInfo->m_LESize);
         }
 
-        m_addItem = 1;
+        lvNode.m_data = treeNodeData(DMDbusHandler::LOGICALVOLUME, lvInfo->m_vgName, "", 0, lvInfo->m_luksFlag,
+                                     lvInfo->m_lvPath, lvSize, used, unused, 0, 0, 0, fstypeName,
+                                     mountPoints, lvName, 0);
+        vgNode.m_children.append(lvNode);
+    }
 
-        // 删除全部VG后，重置标志位
-        if (m_vgIsShow && DMDbusHandler::instance()->getCurLevel() == DMDbusHandler::VOLUMEGROUP) {
-            m_flag = 0;
-        }
+    return vgNode;
+}
 
-        if (m_flag == 0) {
-            for (int i = 0; i < deviceNameList.count(); i++) {
-                if (countMap.value(i) != 0) {
-                    m_treeView->setRefreshItem(i, 0);
-                    break;
-                }
-            }
-            //        m_treeView->setDefaultdmItem();
-        } else {
-            int index = m_treeView->getCurrentNum();
-            if (countMap.value(m_deviceNum) == index) {
-                index = m_treeView->getCurrentNum() - 1;
-            }
+void DeviceListWidget::onUpdateDeviceInfo()
+{
+    //按稳定标识增量更新设备树 选中项由DmTreeview在更新后恢复
+    DeviceInfoMap infoMap = DMDbusHandler::instance()->probDeviceInfo();
+    LVMInfo lvmInfo = DMDbusHandler::instance()->probLVMInfo();
 
-            if (countMap.value(m_deviceNum) < index) {
-                index = countMap.value(m_deviceNum) - 1;
-            }
+    QVector<DmTreeNode> diskNodes;
+    for (auto devInfo = infoMap.begin(); devInfo != infoMap.end(); devInfo++) {
+        const DeviceInfo &info = devInfo.value();
+        if (info.m_path.isEmpty() || info.m_path.contains("/dev/mapper")) {
+            continue;
+        }
 
-            int topNum = m_treeView->getCurrentTopNum();
-            // 判断是否显示过VG并且当前选择的节点是磁盘节点
-            if (m_vgIsShow && m_treeView->getCurrentGroupNum() == -1) {
-                topNum = -1;
-            }
+        diskNodes.append(createDiskNode(info));
+    }
 
-            if (topNum == -1) {
-                if (deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath()) == -1) {
-                    m_treeView->setDefaultdmItem();
-                } else {
-                    m_treeView->setRefreshItem(topNum, deviceNameList.indexOf(DMDbusHandler::instance()->getCurDevicePath()));
-                }
+    if (0 == lvmInfo.m_vgInfo.count()) {
+        m_treeView->updateData(diskNodes);
+        return;
+    }
 
-            } else {
-                m_treeView->setRefreshItem(m_deviceNum, index);
-            }
+    DmTreeNode vgGroupNode;
+    vgGroupNode.m_id = "group:vg";
+    vgGroupNode.m_data = treeNodeData(DMDbusHandler::OTHER, tr("Volume Groups"));
+    for (auto vgInfo = lvmInfo.m_vgInfo.begin(); vgInfo != lvmInfo.m_vgInfo.end(); vgInfo++) {
+        if (vgInfo.value().m_vgName.isEmpty()) {
+            continue;
         }
 
-        m_vgIsShow = false;
-
-        m_flag += 1;
+        vgGroupNode.m_children.append(createVGNode(vgInfo.value()));
     }
+
+    DmTreeNode diskGroupNode;
+    diskGroupNode.m_id = "group:disk";
+    diskGroupNode.m_data = treeNodeData(DMDbusHandler::OTHER, tr("Disks"));
+    diskGroupNode.m_children = diskNodes;
+
+    m_treeView->updateData({vgGroupNode, diskGroupNode});
 }
@@ -78,6 +78,20 @@ private:
      */
     void setCurVGName(const QString &vgName);
 
+    /**
+     * @brief 生成磁盘及其分区的设备树节点
+     * @param info 磁盘信息
+     * @return 磁盘节点
+     */
+    DmTreeNode createDiskNode(const DeviceInfo &info);
+
+    /**
+     * @brief 生成逻辑卷组及其逻辑卷的设备树节点
+     * @param vgInfo 逻辑卷组信息
+     * @return 逻辑卷组节点
+     */
+    DmTreeNode createVGNode(const VGInfo &vgInfo);
+
     DmTreeview *m_treeView = nullptr;
 
 signals:
@@ -205,15 +219,9 @@ private slots:
     void onCreateFailedMessage(const QString &message);
 
 private:
-    int m_flag = 0;
-    int m_num = 0;
-    int m_addItem = 0;
-    QString m_devicePath;
-    int m_deviceNum;
     DiskInfoData m_curDiskInfoData;
     QString m_curChooseDevicePath;
     QString m_curChooseVGName;
-    bool m_vgIsShow = false;
     //    DMDbusHandler *m_handler;
     //    DmDiskinfoBox *m_box = nullptr;
     //    DmDiskinfoBox *m_childbox = nullptr;
@@ -44,6 +44,8 @@
 #include <QSettings>
 #include <QFile>
 
+static const qint64 LatencyRefreshInterval = 1000; // 获取读取耗时统计的最小间隔 单位ms
+
 DiskBadSectorsDialog::DiskBadSectorsDialog(QWidget *parent) : DDialog(parent)
 {
     initUI();
@@ -425,12 +427,11 @@ void DiskBadSectorsDialog::initConnections()
     connect(m_repairButton, &DSuggestButton::clicked, this, &DiskBadSectorsDialog::onRepairButtonClicked);
     connect(m_exitButton, &DPushButton::clicked, this, &DiskBadSectorsDialog::onExitButtonClicked);
     connect(m_doneButton, &DSuggestButton::clicked, this, &DiskBadSectorsDialog::onDoneButtonClicked);
-    connect(DMDbusHandler::instance(), &DMDbusHandler::checkBadBlocksCountInfo, this, &DiskBadSectorsDialog::onCheckBadBlocksInfo);
+    connect(DMDbusHandler::instance(), &DMDbusHandler::checkBadBlocksProgress, this, &DiskBadSectorsDialog::onCheckBadBlocksProgress);
     connect(DMDbusHandler::instance(), &DMDbusHandler::repairBadBlocksInfo, this, &DiskBadSectorsDialog::onRepairBadBlocksInfo);
 //    connect(DMDbusHandler::instance(), &DMDbusHandler::checkBadBlocksFinished,  this, &DiskBadSectorsDialog::onCheckComplete);
     connect(DMDbusHandler::instance(), &DMDbusHandler::fixBadBlocksFinished,  this, &DiskBadSectorsDialog::onRepairComplete);
     connect(&m_timer, &QTimer::timeout, this, &DiskBadSectorsDialog::onTimeOut);
-    connect(&m_checkTimer, &QTimer::timeout, this, &DiskBadSectorsDialog::onCheckTimeOut);
 }
 
 void DiskBadSectorsDialog::onVerifyChanged(int index)
@@ -606,7 +607,6 @@ void DiskBadSectorsDialog::onStartVerifyButtonClicked()
     if (file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
         QTextStream out(&file);
         out << "[SettingData]\n";
-        out << "[CheckData]\n";
         out << "[BadSectorsData]\n";
         out << "BadSectors=""\n";
         file.close();
@@ -689,7 +689,6 @@ void DiskBadSectorsDialog::onStartVerifyButtonClicked()
     }
 
     m_checkInfoLabel->show();
-    m_checkTimer.start(100);
 }
 
 void DiskBadSectorsDialog::mSecsToTime(qint64 msecs, qint64 &hour, qint64 &minute, qint64 &second)
@@ -702,16 +701,10 @@ void DiskBadSectorsDialog::mSecsToTime(qint64 msecs, qint64 &hour, qint64 &minut
 void DiskBadSectorsDialog::onCheckBadBlocksInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo)
 {
     if ((m_totalCheckNumber == 0) || (m_curType != StatusType::Check)) {
-        m_checkTimer.stop();
         return;
     }
 
-    QString LBANumber = QString::number(cylinderNumber.toLongLong() * m_deviceInfo.m_heads * m_deviceInfo.m_sectors);
-
-    m_settings->beginGroup("CheckData");
-    m_settings->setValue(cylinderNumber, QString("%1,%2,%3,%4,%5,0").arg(LBANumber).arg(cylinderNumber).arg(cylinderTimeConsuming).arg(cylinderStatus).arg(cylinderErrorInfo));
-    m_settings->endGroup();
-
+    addCheckedCylinder(cylinderNumber.toLongLong(), cylinderTimeConsuming.toLongLong() * 1000, cylinderStatus, cylinderErrorInfo);
     if (cylinderStatus == "bad") {
         QString value = m_settings->value("BadSectorsData/BadSectors").toString();
         if(value.isEmpty()) {
@@ -722,58 +715,142 @@ void DiskBadSectorsDialog::onCheckBadBlocksInfo(const QString &cylinderNumber, c
 
         m_settings->setValue("BadSectorsData/BadSectors", value);
     }
+
+    updateCheckProgress(cylinderNumber.toLongLong());
 }
 
-void DiskBadSectorsDialog::onCheckTimeOut()
+void DiskBadSectorsDialog::onCheckBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress)
 {
-    if (m_blockStart > m_blockEnd) {
-        onCheckComplete();
+    if (devicePath != m_deviceInfo.m_path) {
         return;
     }
 
-    QString value = m_settings->value(QString("CheckData/%1").arg(m_blockStart)).toString();
-    if (!value.isEmpty()) {
-        QStringList lst = value.split(",");
+    if ((m_totalCheckNumber == 0) || (m_curType != StatusType::Check)) {
+        return;
+    }
 
-        ++m_curCheckNumber;
-        qint64 cylinderTime = lst.at(2).toLongLong();
-        cylinderTime < 100 ? cylinderTime = 100 : cylinderTime;
-        m_curCheckTime += cylinderTime;
-        m_checkInfoLabel->setText(tr("Verifying cylinder: %1").arg(lst.at(1))); // 正在检测xxx柱面
+    refreshLatency();
 
-        m_settings->beginGroup("SettingData");
-        m_settings->setValue("CurCylinder",lst.at(1));
-        m_settings->endGroup();
+    qlonglong checkSize = m_settings->value("SettingData/CheckSize").toLongLong();
+    if (checkSize <= 0 || m_deviceInfo.m_sectorSize <= 0) {
+        return;
+    }
 
-        qint64 totalTime = m_curCheckTime / m_curCheckNumber * m_totalCheckNumber;
-        int value = QString::number((float)m_curCheckTime / totalTime,'f', 2).toFloat() * 100;
-        value > 99 ? value = 99 : value;
+    //整批结果直接更新进度 柱面信息只保存在柱面信息窗口中 坏柱面列表在批末尾只写入一次
+    QStringList badCylinders;
+    qlonglong lastCylinder = -1;
+    for (int i = 0; i + BAD_BLOCKS_PROGRESS_FIELDS <= progress.size(); i += BAD_BLOCKS_PROGRESS_FIELDS) {
+        qlonglong start = progress.at(i + BAD_BLOCKS_PROGRESS_START) * m_deviceInfo.m_sectorSize;
+        qlonglong length = progress.at(i + BAD_BLOCKS_PROGRESS_LENGTH) * m_deviceInfo.m_sectorSize;
+        qlonglong latency = progress.at(i + BAD_BLOCKS_PROGRESS_LATENCY);
+        int status = static_cast<int>(progress.at(i + BAD_BLOCKS_PROGRESS_STATUS));
+
+        QString cylinderStatus = "good";
+        QString cylinderErrorInfo;
+        if (status == BAD_BLOCKS_SLOW) {
+            cylinderStatus = "bad";
+            cylinderErrorInfo = "IO Device Timeout";
+        } else if (status == BAD_BLOCKS_BAD) {
+            cylinderStatus = "bad";
+            cylinderErrorInfo = "IO Read Error";
+        }
 
-        m_progressBar->setValue(value);
-        qint64 remainingTime = totalTime - m_curCheckTime;
-        remainingTime < 1000 ? remainingTime = 1000 : remainingTime;
+        //自适应检测时一项可能包含多个柱面 耗时平均到每个柱面
+        qlonglong firstCylinder = start / checkSize;
+        qlonglong cylinderCount = qMax<qlonglong>(1, length / checkSize);
+        for (qlonglong cylinder = firstCylinder; cylinder < firstCylinder + cylinderCount; cylinder++) {
+            addCheckedCylinder(cylinder, latency / cylinderCount, cylinderStatus, cylinderErrorInfo);
+            if (cylinderStatus == "bad") {
+                badCylinders << QString::number(cylinder);
+            }
+            lastCylinder = cylinder;
+        }
+    }
 
-        qint64 usedHour = 0;
-        qint64 usedMinute = 0;
-        qint64 usedSecond = 0;
-        mSecsToTime(m_curCheckTime, usedHour, usedMinute, usedSecond);
-        m_usedTimeLabel->setText(tr("Time elapsed:") + QString("%1:%2:%3").arg(usedHour, 2, 10, QLatin1Char('0')).arg(usedMinute, 2, 10, QLatin1Char('0')).arg(usedSecond, 2, 10, QLatin1Char('0'))); // 时、分、秒为一位数时，十位自动补0
+    if (!badCylinders.isEmpty()) {
+        QString value = m_settings->value("BadSectorsData/BadSectors").toString();
+        if (!value.isEmpty()) {
+            badCylinders.prepend(value);
+        }
+        m_settings->setValue("BadSectorsData/BadSectors", badCylinders.join(","));
+    }
 
-        qint64 remainingHour = 0;
-        qint64 remainingMinute = 0;
-        qint64 remainingSecond = 0;
-        mSecsToTime(remainingTime, remainingHour, remainingMinute, remainingSecond);
-        m_unusedTimeLabel->setText(tr("Time left:") + QString("%1:%2:%3").arg(remainingHour, 2, 10, QLatin1Char('0')).arg(remainingMinute, 2, 10, QLatin1Char('0')).arg(remainingSecond, 2, 10, QLatin1Char('0')));
+    if (lastCylinder >= 0) {
+        updateCheckProgress(lastCylinder);
+    }
+}
 
-        m_cylinderInfoWidget->setCurCheckBadBlocksInfo(lst.at(0), lst.at(1), lst.at(2), lst.at(3), lst.at(4));
+void DiskBadSectorsDialog::addCheckedCylinder(qlonglong cylinder, qlonglong usecs, const QString &cylinderStatus, const QString &cylinderErrorInfo)
+{
+    ++m_curCheckNumber;
+    m_curCheckTime += usecs;
 
-        m_blockStart++;
-    }  
+    QString cylinderNumber = QString::number(cylinder);
+    QString LBANumber = QString::number(cylinder * m_deviceInfo.m_heads * m_deviceInfo.m_sectors);
+    m_cylinderInfoWidget->setCurCheckBadBlocksInfo(LBANumber, cylinderNumber, QString::number(usecs / 1000), cylinderStatus, cylinderErrorInfo);
+}
+
+void DiskBadSectorsDialog::updateCheckProgress(qlonglong lastCylinder)
+{
+    m_blockStart = static_cast<int>(lastCylinder) + 1;
+    m_checkInfoLabel->setText(tr("Verifying cylinder: %1").arg(lastCylinder)); // 正在检测xxx柱面
+
+    //停止后从此柱面的下一个柱面继续检测
+    m_settings->setValue("SettingData/CurCylinder", QString::number(lastCylinder));
+
+    if (m_curCheckNumber >= m_totalCheckNumber) {
+        m_usedTimeLabel->setText(tr("Time elapsed:") + timeText(m_curCheckTime / 1000));
+        onCheckComplete();
+        return;
+    }
+
+    int value = static_cast<int>(static_cast<qint64>(m_curCheckNumber) * 100 / m_totalCheckNumber);
+    value > 99 ? value = 99 : value;
+    m_progressBar->setValue(value);
+
+    //剩余时间按已检测柱面的平均耗时估算
+    qint64 remainingTime = m_curCheckTime / 1000 / m_curCheckNumber * (m_totalCheckNumber - m_curCheckNumber);
+    remainingTime < 1000 ? remainingTime = 1000 : remainingTime;
+
+    m_usedTimeLabel->setText(tr("Time elapsed:") + timeText(m_curCheckTime / 1000));
+    m_unusedTimeLabel->setText(tr("Time left:") + timeText(remainingTime));
+}
+
+QString DiskBadSectorsDialog::timeText(qint64 msecs)
+{
+    qint64 hour = 0;
+    qint64 minute = 0;
+    qint64 second = 0;
+    mSecsToTime(msecs, hour, minute, second);
+
+    // 时、分、秒为一位数时，十位自动补0
+    return QString("%1:%2:%3").arg(hour, 2, 10, QLatin1Char('0')).arg(minute, 2, 10, QLatin1Char('0')).arg(second, 2, 10, QLatin1Char('0'));
+}
+
+void DiskBadSectorsDialog::refreshLatency()
+{
+    if (m_latencyTimer.isValid() && !m_latencyTimer.hasExpired(LatencyRefreshInterval)) {
+        return;
+    }
+    m_latencyTimer.start();
+
+    //第一行格式为 device:路径 count:N p50:Xms p99:Xms max:Xms buckets:...
+    QStringList latency = DMDbusHandler::instance()->getBadSectorsLatency();
+    if (latency.isEmpty() || !latency.first().startsWith(QString("device:%1 ").arg(m_deviceInfo.m_path))) {
+        return;
+    }
+
+    foreach (const QString &field, latency.first().split(" ")) {
+        if (field.startsWith("p50:") && field.endsWith("ms")) {
+            QString value = field.mid(4, field.length() - 6);
+            m_cylinderInfoWidget->setMedianLatency(static_cast<qint64>(value.toDouble() * 1000));
+            break;
+        }
+    }
 }
 
 void DiskBadSectorsDialog::onCheckComplete()
 {
-    m_checkTimer.stop();
     m_progressBar->setValue(100);
     m_unusedTimeLabel->setText(tr("Time left:") + "00:00:00");
     m_buttonStackedWidget->setCurrentIndex(3);
@@ -818,7 +895,6 @@ void DiskBadSectorsDialog::onStopButtonClicked()
         int checkNumber = m_settings->value("SettingData/CheckNumber").toInt();
 
         DMDbusHandler::instance()->checkBadSectors(m_deviceInfo.m_path, blockStart, blockEnd, checkNumber, checkSize, 2);
-        m_checkTimer.stop();
         break;
     }
     case StatusType::Repair:{
@@ -858,7 +934,6 @@ void DiskBadSectorsDialog::onContinueButtonClicked()
         }
 
         DMDbusHandler::instance()->checkBadSectors(m_deviceInfo.m_path, blockStart, blockEnd, checkNumber, checkSize, 3);
-        m_checkTimer.start(100);
         break;
     }
     case StatusType::StopRepair:{
@@ -901,7 +976,6 @@ void DiskBadSectorsDialog::onAgainVerifyButtonClicked()
     if (file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
         QTextStream out(&file);
         out << "[SettingData]\n";
-        out << "[CheckData]\n";
         out << "[BadSectorsData]\n";
         out << "BadSectors=""\n";
         file.close();
@@ -921,7 +995,6 @@ void DiskBadSectorsDialog::onAgainVerifyButtonClicked()
     m_cylinderInfoWidget->setChecked(true);
 
     DMDbusHandler::instance()->checkBadSectors(m_deviceInfo.m_path, m_blockStart, m_blockEnd, checkNumber, checkSize, 1);
-    m_checkTimer.start(100);
 }
 
 void DiskBadSectorsDialog::onResetButtonClicked()
@@ -1064,12 +1137,6 @@ void DiskBadSectorsDialog::onRepairBadBlocksInfo(const QString &cylinderNumber,
 
     if (cylinderStatus == "good") {
         ++m_repairedCount;
-        QString curCheckData = m_settings->value(QString("CheckData/%1").arg(cylinderNumber)).toString();
-        QStringList lstCheckData = curCheckData.split(",");
-        lstCheckData.replace(3, cylinderStatus);
-        lstCheckData.replace(5, "1");
-        m_settings->setValue(QString("CheckData/%1").arg(cylinderNumber), lstCheckData.join(","));
-
         m_cylinderInfoWidget->setCurRepairBadBlocksInfo(cylinderNumber);
     }
 }
@@ -1130,8 +1197,7 @@ void DiskBadSectorsDialog::stopCheckRepair()
     switch (m_curType) {
     case StatusType::Check: {
         m_curType = StatusType::StopCheck;
-        disconnect(DMDbusHandler::instance(), &DMDbusHandler::checkBadBlocksCountInfo, this, &DiskBadSectorsDialog::onCheckBadBlocksInfo);
-        m_checkTimer.stop();
+        disconnect(DMDbusHandler::instance(), &DMDbusHandler::checkBadBlocksProgress, this, &DiskBadSectorsDialog::onCheckBadBlocksProgress);
         DMDbusHandler::instance()->checkBadSectors("/dev/sdb", 0, 1, 2, 8225280, 2);
 
         break;
@@ -1166,7 +1232,6 @@ void DiskBadSectorsDialog::closeEvent(QCloseEvent *event)
             int checkNumber = m_settings->value("SettingData/CheckNumber").toInt();
 
             DMDbusHandler::instance()->checkBadSectors(m_deviceInfo.m_path, blockStart, blockEnd, checkNumber, checkSize, 2);
-            m_checkTimer.stop();
 
             QFile file("/tmp/CheckData.conf");
             if (file.exists()) {
@@ -40,6 +40,7 @@
 
 #include <QWidget>
 #include <QTimer>
+#include <QElapsedTimer>
 
 DWIDGET_USE_NAMESPACE
 DCORE_USE_NAMESPACE
@@ -162,6 +163,13 @@ private slots:
      */
     void onCheckBadBlocksInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
 
+    /**
+     * @brief 坏道检测批量进度 按柱面拆分后逐个记录检测信息
+     * @param devicePath 设备路径
+     * @param progress 检测结果 每项依次为起始扇区、扇区个数、耗时(us)、状态
+     */
+    void onCheckBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
+
     /**
      * @brief 检测完成响应的槽函数
      */
@@ -186,9 +194,9 @@ private slots:
     void onTimeOut();
 
     /**
-     * @brief 定时器超时信号响应的槽函数
+     * @brief 从服务端获取整个设备的读取耗时中位数 更新柱面热力图基准 间隔不足时不获取
      */
-    void onCheckTimeOut();
+    void refreshLatency();
 
 protected:
     void closeEvent(QCloseEvent *event) override;
@@ -219,6 +227,28 @@ private:
      */
     void mSecsToTime(qint64 msecs, qint64 &hour, qint64 &minute, qint64 &second);
 
+    /**
+     * @brief 毫秒转换成时:分:秒格式的文本
+     * @param msecs 毫秒
+     * @return 时:分:秒 各两位
+     */
+    QString timeText(qint64 msecs);
+
+    /**
+     * @brief 记录一个已检测的柱面 更新检测计数及耗时并显示到柱面信息窗口
+     * @param cylinder 柱面号
+     * @param usecs 柱面耗时 单位us
+     * @param cylinderStatus 柱面状态
+     * @param cylinderErrorInfo 检测错误信息
+     */
+    void addCheckedCylinder(qlonglong cylinder, qlonglong usecs, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+
+    /**
+     * @brief 收到一批检测结果后更新进度条、已用及剩余时间 全部柱面检测完成时结束检测
+     * @param lastCylinder 本批最后一个柱面号
+     */
+    void updateCheckProgress(qlonglong lastCylinder);
+
 private:
     DComboBox *m_verifyComboBox;
     DLineEdit *m_startLineEdit;
@@ -247,7 +277,7 @@ private:
     StatusType m_curType;
     int m_totalCheckNumber = 0;
     int m_curCheckNumber = 0;
-    qint64 m_curCheckTime = 0;
+    qint64 m_curCheckTime = 0; // 已检测柱面的耗时之和 单位us
     QSettings *m_settings;
     int m_totalRepairNumber = 0;
     int m_curRepairNumber = 0;
@@ -256,7 +286,7 @@ private:
     QTimer m_timer;
     qint64 m_usedTime = 0;
     qint64 m_unusedTime = 0;
-    QTimer m_checkTimer;
+    QElapsedTimer m_latencyTimer; // 上次获取读取耗时统计的时间
     int m_blockStart = 0;
     int m_blockEnd = 0;
     DeviceInfo m_deviceInfo;
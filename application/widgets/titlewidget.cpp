@@ -827,6 +827,8 @@ void TitleWidget::updateEncryptDeviceBtnStatus(const LUKS_INFO &luksInfo)
 
 void TitleWidget::onCurSelectChanged()
 {
+    //服务仍在确认缓存拓扑时禁止操作
+    setDisabled(DMDbusHandler::instance()->isTopologyStale());
     updateBtnStatus();
     qDebug() << __FUNCTION__ << "-1--1-";
 }
@@ -0,0 +1,281 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "commandexecutor.h"
+#include "probestats.h"
+#include "utils.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QDebug>
+
+static const int defaultMaxConcurrent = 8;      //默认全局最大并发数
+static const int waitSlice = 100;               //等待输出的时间片 单位ms
+static const int killWait = 3000;               //终止超时进程后等待其退出的时间 单位ms
+
+int CommandExecutor::m_maxConcurrent = defaultMaxConcurrent;
+QSemaphore CommandExecutor::m_globalSemaphore(defaultMaxConcurrent);
+QMap<QString, QSemaphore *> CommandExecutor::m_deviceSemaphores;
+QMap<QString, CommandExecutor::CommandStat> CommandExecutor::m_stats;
+QMutex CommandExecutor::m_mutex;
+
+/**
+ * @class CommandTask
+ * @brief 异步命令任务
+ */
+class CommandTask : public QRunnable
+{
+public:
+    CommandTask(const CommandRequest &request, std::function<void(const CommandResult &)> onFinished)
+        : m_request(request)
+        , m_onFinished(onFinished)
+    {
+    }
+
+    void run() override
+    {
+        CommandResult result = CommandExecutor::run(m_request);
+        if (m_onFinished) {
+            m_onFinished(result);
+        }
+    }
+
+private:
+    CommandRequest m_request;
+    std::function<void(const CommandResult &)> m_onFinished;
+};
+
+CommandResult CommandExecutor::run(const CommandRequest &request)
+{
+    CommandResult result;
+    QString statKey = Utils::getCommandStatKey(request.m_program, request.m_args);
+
+    int timeout = request.m_timeout < 0 ? defaultTimeout(request.m_program) : request.m_timeout;
+
+    //只有带超时的探测类命令按设备串行 避免坏盘上堆积smartctl等命令 长时间操作(坏道检测、格式化)不受影响
+    QString device = request.m_device;
+    if (device.isEmpty() && timeout > 0) {
+        foreach (const QString &arg, request.m_args) {
+            if (arg.startsWith("/dev/")) {
+                device = arg;
+                break;
+            }
+        }
+    }
+
+    //先获取设备再获取全局名额 避免等待设备时占用全局名额
+    QSemaphore *deviceLock = device.isEmpty() ? nullptr : deviceSemaphore(device);
+    if (deviceLock) {
+        deviceLock->acquire();
+    }
+    m_globalSemaphore.acquire();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    //超时进程可能处于D状态无法退出 此时需放弃该对象而不能在析构中等待 因此在堆上创建
+    QProcess *proc = new QProcess;
+    proc->setProgram(request.m_program);
+    proc->setArguments(request.m_args);
+    proc->start(QIODevice::ReadWrite);
+    result.m_started = proc->waitForStarted(-1);
+    bool abandoned = false;
+
+    QByteArray output;
+    QByteArray errorOutput;
+    auto readOutput = [&]() {
+        QByteArray out = proc->readAllStandardOutput();
+        if (!out.isEmpty()) {
+            output += out;
+            if (request.m_onOutput) {
+                request.m_onOutput(out);
+            }
+        }
+
+        QByteArray err = proc->readAllStandardError();
+        if (!err.isEmpty()) {
+            errorOutput += err;
+            if (request.m_onError) {
+                request.m_onError(err);
+            }
+        }
+    };
+
+    if (result.m_started) {
+        //分片等待 期间转发输出并检查超时
+        while (!proc->waitForFinished(waitSlice)) {
+            readOutput();
+            if (proc->state() == QProcess::NotRunning) {
+                break;
+            }
+
+            if (timeout > 0 && timer.elapsed() >= timeout) {
+                qDebug() << __FUNCTION__ << "kill timed out command:" << request.m_program << request.m_args << timeout << "ms";
+                proc->kill();
+                result.m_timedOut = true;
+                //D状态的进程收到SIGKILL后也不会退出 有限等待后放弃 避免一直占用信号量
+                abandoned = !proc->waitForFinished(killWait);
+                break;
+            }
+        }
+        readOutput();
+    }
+
+    result.m_nsecs = timer.nsecsElapsed();
+    result.m_output = output;
+    result.m_errorOutput = errorOutput;
+    result.m_error = proc->errorString();
+    if (result.m_started && !result.m_timedOut && proc->exitStatus() == QProcess::NormalExit) {
+        result.m_exitCode = proc->exitCode();
+    }
+
+    if (abandoned) {
+        qDebug() << __FUNCTION__ << "abandon unkillable command:" << request.m_program << request.m_args;
+        result.m_error = QString("%1 did not exit after kill").arg(request.m_program);
+        //交给主线程在进程最终退出后释放 没有事件循环时只能泄漏该对象
+        proc->disconnect();
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app != nullptr) {
+            proc->moveToThread(app->thread());
+            QObject::connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                             proc, &QObject::deleteLater);
+        }
+    } else {
+        proc->close();
+        delete proc;
+    }
+
+    m_globalSemaphore.release();
+    if (deviceLock) {
+        deviceLock->release();
+    }
+
+    ProbeStats::addSample(statKey, result.m_nsecs);
+    QMutexLocker locker(&m_mutex);
+    CommandStat &stat = m_stats[statKey];
+    stat.m_runs++;
+    if (result.m_exitCode != 0) {
+        stat.m_failed++;
+    }
+    if (result.m_timedOut) {
+        stat.m_timedOut++;
+    }
+
+    return result;
+}
+
+void CommandExecutor::runAsync(const CommandRequest &request, std::function<void(const CommandResult &)> onFinished)
+{
+    threadPool()->start(new CommandTask(request, onFinished));
+}
+
+QVector<CommandResult> CommandExecutor::runBatch(const QVector<CommandRequest> &requests)
+{
+    QVector<CommandResult> results(requests.size());
+    if (requests.size() == 1) {
+        results[0] = run(requests.at(0));
+        return results;
+    }
+
+    //每个任务只写入自己下标的位置
+    QSemaphore done(0);
+    for (int i = 0; i < requests.size(); i++) {
+        CommandResult *result = &results[i];
+        runAsync(requests.at(i), [result, &done](const CommandResult & r) {
+            *result = r;
+            done.release();
+        });
+    }
+    done.acquire(requests.size());
+
+    return results;
+}
+
+void CommandExecutor::setMaxConcurrent(int count)
+{
+    count = qMax(1, count);
+    QMutexLocker locker(&m_mutex);
+    if (count > m_maxConcurrent) {
+        m_globalSemaphore.release(count - m_maxConcurrent);
+    } else if (count < m_maxConcurrent) {
+        m_globalSemaphore.acquire(m_maxConcurrent - count);
+    }
+    m_maxConcurrent = count;
+}
+
+int CommandExecutor::defaultTimeout(const QString &program)
+{
+    static const QMap<QString, int> timeouts = {
+        {"smartctl", 30000},
+        {"hwinfo", 30000},
+        {"lshw", 30000},
+        {"hdparm", 30000},
+        {"lsblk", 10000},
+        {"udevadm", 10000},
+        {"blkid", 10000},
+        {"df", 10000},
+        {"pvs", 60000},
+        {"vgs", 60000},
+        {"lvs", 60000},
+        {"dmsetup", 10000},
+        {"modprobe", 10000},
+    };
+
+    return timeouts.value(program.section('/', -1), 0);
+}
+
+QStringList CommandExecutor::statistics()
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList list;
+    for (QMap<QString, CommandStat>::ConstIterator it = m_stats.begin(); it != m_stats.end(); ++it) {
+        list.append(QString("%1 runs:%2 failed:%3 timeout:%4")
+                    .arg(it.key()).arg(it->m_runs).arg(it->m_failed).arg(it->m_timedOut));
+    }
+
+    return list;
+}
+
+QSemaphore *CommandExecutor::deviceSemaphore(const QString &device)
+{
+    QMutexLocker locker(&m_mutex);
+    QSemaphore *&semaphore = m_deviceSemaphores[device];
+    if (semaphore == nullptr) {
+        semaphore = new QSemaphore(1);
+    }
+
+    return semaphore;
+}
+
+QThreadPool *CommandExecutor::threadPool()
+{
+    //异步任务本身会受全局并发限制 线程数只需不小于并发数
+    static QThreadPool *pool = nullptr;
+    QMutexLocker locker(&m_mutex);
+    if (pool == nullptr) {
+        pool = new QThreadPool;
+        pool->setMaxThreadCount(qMax(m_maxConcurrent, defaultMaxConcurrent) * 2);
+    }
+
+    return pool;
+}
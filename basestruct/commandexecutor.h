@@ -0,0 +1,140 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef COMMANDEXECUTOR_H
+#define COMMANDEXECUTOR_H
+
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class QThreadPool;
+
+/**
+ * @struct CommandRequest
+ * @brief 外部命令请求
+ */
+struct CommandRequest {
+    QString m_program;                                      //程序
+    QStringList m_args;                                     //参数
+    int m_timeout = -1;                                     //超时时间 单位ms -1为按程序使用默认值 0为不限制
+    QString m_device;                                       //命令操作的设备 同一设备的命令串行执行 为空且有超时时从参数中查找/dev/开头的路径
+    std::function<void(const QByteArray &)> m_onOutput;     //标准输出回调 在执行命令的线程中调用
+    std::function<void(const QByteArray &)> m_onError;      //标准错误回调 在执行命令的线程中调用
+};
+
+/**
+ * @struct CommandResult
+ * @brief 外部命令执行结果
+ */
+struct CommandResult {
+    int m_exitCode = -1;        //退出码 未启动或超时为-1
+    bool m_started = false;     //是否启动成功
+    bool m_timedOut = false;    //是否超时被终止
+    QString m_output;           //标准输出
+    QString m_errorOutput;      //标准错误
+    QString m_error;            //QProcess错误信息
+    qint64 m_nsecs = 0;         //耗时 单位ns 不包括排队时间
+};
+
+/**
+ * @class CommandExecutor
+ * @brief 外部命令执行器 支持超时终止、全局及单设备并发限制、输出流回调 记录每个程序的耗时及退出统计
+ */
+class CommandExecutor
+{
+public:
+    /**
+     * @brief 同步执行命令 超时后终止进程
+     * @param request：命令请求
+     * @return 执行结果
+     */
+    static CommandResult run(const CommandRequest &request);
+
+    /**
+     * @brief 异步执行命令
+     * @param request：命令请求
+     * @param onFinished：完成回调 在线程池线程中调用
+     */
+    static void runAsync(const CommandRequest &request, std::function<void(const CommandResult &)> onFinished);
+
+    /**
+     * @brief 并发执行多个命令 全部完成后返回
+     * @param requests：命令请求
+     * @return 与请求顺序一致的执行结果
+     */
+    static QVector<CommandResult> runBatch(const QVector<CommandRequest> &requests);
+
+    /**
+     * @brief 设置全局最大并发数
+     * @param count：并发数
+     */
+    static void setMaxConcurrent(int count);
+
+    /**
+     * @brief 获取程序默认超时时间 只对设备探测及报告类命令设置超时 其他命令(格式化、pvmove等)可能需要很长时间
+     * @param program：程序
+     * @return 超时时间 单位ms 0为不限制
+     */
+    static int defaultTimeout(const QString &program);
+
+    /**
+     * @brief 获取每个程序的执行统计
+     * @return 每个程序一行 "command:程序名 runs:N failed:N timeout:N"
+     */
+    static QStringList statistics();
+
+private:
+    /**
+     * @struct CommandStat
+     * @brief 单个程序执行统计
+     */
+    struct CommandStat {
+        int m_runs = 0;         //执行次数
+        int m_failed = 0;       //退出码非0或未启动次数
+        int m_timedOut = 0;     //超时次数
+    };
+
+    /**
+     * @brief 获取设备对应的信号量 同一设备同时只执行一个命令
+     * @param device：设备路径
+     * @return 信号量
+     */
+    static QSemaphore *deviceSemaphore(const QString &device);
+
+    /**
+     * @brief 获取异步执行线程池
+     * @return 线程池
+     */
+    static QThreadPool *threadPool();
+
+private:
+    static int m_maxConcurrent;                         //全局最大并发数
+    static QSemaphore m_globalSemaphore;                //全局并发限制
+    static QMap<QString, QSemaphore *> m_deviceSemaphores;  //单设备并发限制
+    static QMap<QString, CommandStat> m_stats;          //执行统计 key:统计项
+    static QMutex m_mutex;
+};
+
+#endif // COMMANDEXECUTOR_H
@@ -272,4 +272,26 @@ enum DevType {
     DEV_LOOP,                   //loop设备
     DEV_META_DEVICES            //元数据设备 raid 加密磁盘映射等虚拟设备
 };
+
+/**
+ * @enum BadBlocksProgressField
+ * @brief 坏道检测批量进度中单项的字段 每项由连续的BAD_BLOCKS_PROGRESS_FIELDS个qlonglong组成
+ */
+enum BadBlocksProgressField {
+    BAD_BLOCKS_PROGRESS_START = 0,  //起始逻辑扇区
+    BAD_BLOCKS_PROGRESS_LENGTH,     //扇区个数
+    BAD_BLOCKS_PROGRESS_LATENCY,    //读取耗时 单位us
+    BAD_BLOCKS_PROGRESS_STATUS,     //读取状态 BadBlocksStatus
+    BAD_BLOCKS_PROGRESS_FIELDS      //字段个数
+};
+
+/**
+ * @enum BadBlocksStatus
+ * @brief 坏道检测读取状态
+ */
+enum BadBlocksStatus {
+    BAD_BLOCKS_GOOD = 0,    //读取正常
+    BAD_BLOCKS_SLOW,        //读取超时 IO Device Timeout
+    BAD_BLOCKS_BAD          //读取失败 IO Read Error
+};
 #endif // COMMONDEF_H
@@ -0,0 +1,108 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "latencyhistogram.h"
+
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(m_bucketCount, 0)
+    , m_count(0)
+    , m_max(0)
+{
+}
+
+void LatencyHistogram::add(qint64 usecs)
+{
+    usecs = qMax<qint64>(0, usecs);
+    int bucket = 0;
+    while (bucket < m_bucketCount - 1 && (usecs >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+
+    m_buckets[bucket]++;
+    m_count++;
+    m_max = qMax(m_max, usecs);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < m_bucketCount; i++) {
+        m_buckets[i] += other.m_buckets.at(i);
+    }
+    m_count += other.m_count;
+    m_max = qMax(m_max, other.m_max);
+}
+
+void LatencyHistogram::clear()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::maxValue() const
+{
+    return m_max;
+}
+
+qint64 LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    //与ProbeStats一致 取第ceil(N*p)个样本
+    qint64 rank = qMax<qint64>(1, static_cast<qint64>(std::ceil(m_count * percent)));
+    qint64 seen = 0;
+    for (int i = 0; i < m_bucketCount; i++) {
+        seen += m_buckets.at(i);
+        if (seen >= rank) {
+            return qMin((static_cast<qint64>(1) << (i + 1)) - 1, m_max);
+        }
+    }
+
+    return m_max;
+}
+
+QVector<qint64> LatencyHistogram::buckets() const
+{
+    int size = m_bucketCount;
+    while (size > 0 && m_buckets.at(size - 1) == 0) {
+        size--;
+    }
+
+    return m_buckets.mid(0, size);
+}
+
+QString LatencyHistogram::toString() const
+{
+    auto toMs = [](qint64 usecs) {
+        return QString::number(static_cast<double>(usecs) / 1000.0, 'f', 3);
+    };
+
+    return QString("count:%1 p50:%2ms p99:%3ms max:%4ms")
+           .arg(m_count).arg(toMs(percentile(0.5))).arg(toMs(percentile(0.99))).arg(toMs(m_max));
+}
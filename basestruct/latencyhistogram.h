@@ -0,0 +1,94 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @class LatencyHistogram
+ * @brief 对数刻度耗时直方图 第i个桶统计[2^i, 2^(i+1))us的样本 第0个桶同时包括0us
+ *        内存占用固定 可按区域大量创建 百分位数精度为所在桶的上界
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    /**
+     * @brief 添加一个耗时样本
+     * @param usecs：耗时 单位us
+     */
+    void add(qint64 usecs);
+
+    /**
+     * @brief 合并另一个直方图的样本
+     * @param other：直方图
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * @brief 清空样本
+     */
+    void clear();
+
+    /**
+     * @brief 样本个数
+     * @return 样本个数
+     */
+    qint64 count() const;
+
+    /**
+     * @brief 最大耗时
+     * @return 最大耗时 单位us
+     */
+    qint64 maxValue() const;
+
+    /**
+     * @brief 百分位耗时 取样本所在桶的上界 不超过最大耗时
+     * @param percent：百分位 0到1之间
+     * @return 耗时 单位us 没有样本时返回0
+     */
+    qint64 percentile(double percent) const;
+
+    /**
+     * @brief 各桶样本个数
+     * @return 各桶样本个数 末尾为空的桶不输出
+     */
+    QVector<qint64> buckets() const;
+
+    /**
+     * @brief 格式化输出统计信息
+     * @return "count:N p50:Xms p99:Xms max:Xms"
+     */
+    QString toString() const;
+
+public:
+    static const int m_bucketCount = 40;    //桶个数 最后一个桶统计所有更大的样本
+
+private:
+    QVector<qint64> m_buckets;  //各桶样本个数
+    qint64 m_count;             //样本个数
+    qint64 m_max;               //最大耗时 单位us
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -30,7 +30,8 @@
 #include <QDBusArgument>
 
 PartitionInfo::PartitionInfo()
-    : m_insideExtended(false)
+    : m_usagePending(false)
+    , m_insideExtended(false)
     , m_busy(false)
     , m_fileSystemReadOnly(false)
 {
@@ -81,6 +82,7 @@ QDBusArgument &operator<<(QDBusArgument &argument, const PartitionInfo &info)
              << info.m_sectorsUnused
              << info.m_sectorsUnallocated
              << info.m_significantThreshold
+             << info.m_usagePending
              << info.m_freeSpaceBefore
              << info.m_sectorSize
              << info.m_fileSystemBlockSize
@@ -125,6 +127,7 @@ const QDBusArgument &operator>>(const QDBusArgument &argument, PartitionInfo &in
              >> info.m_sectorsUnused
              >> info.m_sectorsUnallocated
              >> info.m_significantThreshold
+             >> info.m_usagePending
              >> info.m_freeSpaceBefore
              >> info.m_sectorSize
              >> info.m_fileSystemBlockSize
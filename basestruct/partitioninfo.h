@@ -72,6 +72,7 @@ public:
     Sector m_sectorsUnused;
     Sector m_sectorsUnallocated; //Difference between the size of the partition and the file system
     Sector m_significantThreshold; //Threshold from intrinsic to significant unallocated sectors
+    bool m_usagePending; //已用/未用空间正在后台计算 计算完成后通过拓扑增量更新
     Sector m_freeSpaceBefore; //Free space preceding partition value
     Byte_Value m_sectorSize; //Sector size of the disk device needed for converting to/from sectors and bytes.
     Byte_Value m_fileSystemBlockSize; // Block size of of the file system, or -1 when unknown.
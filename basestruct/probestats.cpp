@@ -0,0 +1,194 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "probestats.h"
+
+#include <algorithm>
+#include <cmath>
+
+QQueue<ProbeStats::RefreshRecord> ProbeStats::m_refreshes;
+ProbeStats::SampleMap ProbeStats::m_idleSamples;
+quint64 ProbeStats::m_lastRefreshId = 0;
+QMutex ProbeStats::m_mutex;
+
+//当前线程进行中的刷新记录编号 0表示没有
+static thread_local quint64 g_threadRefreshId = 0;
+
+quint64 ProbeStats::beginRefresh()
+{
+    QMutexLocker locker(&m_mutex);
+    RefreshRecord record;
+    record.m_id = ++m_lastRefreshId;
+    record.m_active = true;
+    m_refreshes.enqueue(record);
+    while (m_refreshes.size() > m_maxRefreshCount) {
+        m_refreshes.dequeue();
+    }
+
+    return record.m_id;
+}
+
+void ProbeStats::endRefresh(quint64 id)
+{
+    QMutexLocker locker(&m_mutex);
+    RefreshRecord *record = findActiveRefresh(id);
+    if (record != nullptr) {
+        record->m_active = false;
+    }
+}
+
+quint64 ProbeStats::currentRefresh()
+{
+    return g_threadRefreshId;
+}
+
+ProbeStats::RefreshRecord *ProbeStats::findActiveRefresh(quint64 id)
+{
+    if (id == 0) {
+        return nullptr;
+    }
+
+    for (int i = m_refreshes.size() - 1; i >= 0; i--) {
+        RefreshRecord &record = m_refreshes[i];
+        if (record.m_id == id) {
+            return record.m_active ? &record : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+void ProbeStats::addSample(const QString &key, qint64 nsecs)
+{
+    QMutexLocker locker(&m_mutex);
+    //只记录到本线程进行中的刷新 其他线程(如另一个PartedCore)的刷新不受影响
+    RefreshRecord *record = findActiveRefresh(g_threadRefreshId);
+    if (record != nullptr) {
+        record->m_samples[key].append(nsecs);
+        return;
+    }
+
+    //刷新以外的操作(如分区操作调用的外部命令)单独记录 只保留最近的样本 不影响刷新记录
+    QVector<qint64> &samples = m_idleSamples[key];
+    samples.append(nsecs);
+    if (samples.size() > m_maxIdleSamples) {
+        samples.remove(0, samples.size() - m_maxIdleSamples);
+    }
+}
+
+void ProbeStats::addLap(const QString &key, QElapsedTimer &timer)
+{
+    qint64 nsecs = timer.nsecsElapsed();
+    timer.restart();
+    {
+        QMutexLocker locker(&m_mutex);
+        if (findActiveRefresh(g_threadRefreshId) == nullptr) {
+            return;
+        }
+    }
+    addSample(key, nsecs);
+}
+
+QStringList ProbeStats::statistics()
+{
+    QMap<QString, QVector<qint64>> allSamples;
+    {
+        QMutexLocker locker(&m_mutex);
+        foreach (const RefreshRecord &refresh, m_refreshes) {
+            for (SampleMap::ConstIterator it = refresh.m_samples.begin(); it != refresh.m_samples.end(); ++it) {
+                allSamples[it.key()] += it.value();
+            }
+        }
+        for (SampleMap::ConstIterator it = m_idleSamples.begin(); it != m_idleSamples.end(); ++it) {
+            allSamples[it.key()] += it.value();
+        }
+    }
+
+    auto toMs = [](qint64 nsecs) {
+        return QString::number(static_cast<double>(nsecs) / 1000000.0, 'f', 3);
+    };
+
+    QStringList list;
+    for (QMap<QString, QVector<qint64>>::iterator it = allSamples.begin(); it != allSamples.end(); ++it) {
+        QVector<qint64> &samples = it.value();
+        if (samples.isEmpty()) {
+            continue;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        int count = samples.size();
+        qint64 median = samples.at((count - 1) / 2);
+        qint64 p99 = samples.at(qMax(0, static_cast<int>(std::ceil(count * 0.99)) - 1));
+        list.append(QString("%1 count:%2 min:%3ms median:%4ms p99:%5ms max:%6ms")
+                    .arg(it.key()).arg(count).arg(toMs(samples.first())).arg(toMs(median)).arg(toMs(p99)).arg(toMs(samples.last())));
+    }
+
+    return list;
+}
+
+void ProbeStats::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_refreshes.clear();
+    m_idleSamples.clear();
+}
+
+ProbeTimer::ProbeTimer(const QString &key)
+    : m_key(key)
+{
+    m_timer.start();
+}
+
+ProbeTimer::~ProbeTimer()
+{
+    ProbeStats::addSample(m_key, m_timer.nsecsElapsed());
+}
+
+ProbeRefresh::ProbeRefresh()
+    : m_id(ProbeStats::beginRefresh())
+    , m_previousId(g_threadRefreshId)
+{
+    g_threadRefreshId = m_id;
+    m_totalTimer.start();
+    m_lapTimer.start();
+}
+
+ProbeRefresh::~ProbeRefresh()
+{
+    ProbeStats::addSample("phase:total", m_totalTimer.nsecsElapsed());
+    ProbeStats::endRefresh(m_id);
+    g_threadRefreshId = m_previousId;
+}
+
+void ProbeRefresh::lap(const QString &phase)
+{
+    ProbeStats::addLap("phase:" + phase, m_lapTimer);
+}
+
+ProbeRefreshAttach::ProbeRefreshAttach(quint64 id)
+    : m_previousId(g_threadRefreshId)
+{
+    g_threadRefreshId = id;
+}
+
+ProbeRefreshAttach::~ProbeRefreshAttach()
+{
+    g_threadRefreshId = m_previousId;
+}
@@ -0,0 +1,167 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PROBESTATS_H
+#define PROBESTATS_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @class ProbeStats
+ * @brief 刷新耗时统计 保存最近若干次刷新中各阶段、各设备及各外部命令的耗时(单调时钟 纳秒)
+ *        统计项按key汇总 输出最小值、中位数、p99及最大值
+ *        key约定: phase:阶段名 device:设备路径[:子阶段] command:程序名
+ */
+class ProbeStats
+{
+public:
+    /**
+     * @brief 开始一次新的刷新记录 超过保存上限时丢弃最早的记录
+     * @return 刷新记录编号
+     */
+    static quint64 beginRefresh();
+
+    /**
+     * @brief 结束刷新记录 之后的阶段耗时不再记录
+     * @param id：beginRefresh返回的刷新记录编号
+     */
+    static void endRefresh(quint64 id);
+
+    /**
+     * @brief 获取当前线程进行中的刷新记录编号 供线程池任务通过ProbeRefreshAttach记录到同一次刷新
+     * @return 刷新记录编号 没有时为0
+     */
+    static quint64 currentRefresh();
+
+    /**
+     * @brief 添加一个耗时样本 当前线程有进行中的刷新时记录到该刷新
+     *        否则(如分区操作调用的外部命令)记录到刷新以外的样本 每个统计项只保留最近的样本
+     * @param key：统计项
+     * @param nsecs：耗时 单位ns
+     */
+    static void addSample(const QString &key, qint64 nsecs);
+
+    /**
+     * @brief 以计时器当前耗时添加样本 并重新开始计时 用于连续的阶段 没有进行中的刷新时只重新计时
+     * @param key：统计项
+     * @param timer：计时器
+     */
+    static void addLap(const QString &key, QElapsedTimer &timer);
+
+    /**
+     * @brief 获取统计结果
+     * @return 每个统计项一行 "key count:N min:Xms median:Xms p99:Xms max:Xms"
+     */
+    static QStringList statistics();
+
+    /**
+     * @brief 清空所有记录
+     */
+    static void clear();
+
+public:
+    static const int m_maxRefreshCount = 32;    //保存的刷新次数
+    static const int m_maxIdleSamples = 256;    //刷新以外每个统计项保存的样本数
+
+private:
+    typedef QMap<QString, QVector<qint64>> SampleMap;   //key:统计项 value:该次刷新中的样本
+
+    /**
+     * @struct RefreshRecord
+     * @brief 一次刷新的记录
+     */
+    struct RefreshRecord {
+        quint64 m_id = 0;           //刷新记录编号
+        bool m_active = false;      //是否进行中
+        SampleMap m_samples;        //该次刷新中的样本
+    };
+
+    /**
+     * @brief 查找进行中的刷新记录 调用方需持有m_mutex
+     * @param id：刷新记录编号
+     * @return 刷新记录 未找到时为nullptr
+     */
+    static RefreshRecord *findActiveRefresh(quint64 id);
+
+    static QQueue<RefreshRecord> m_refreshes;   //最近的刷新记录 环形缓冲
+    static SampleMap m_idleSamples;             //刷新以外的样本 每个统计项最多m_maxIdleSamples个
+    static quint64 m_lastRefreshId;             //最近分配的刷新记录编号
+    static QMutex m_mutex;
+};
+
+/**
+ * @class ProbeTimer
+ * @brief 作用域计时 析构时把耗时添加到ProbeStats
+ */
+class ProbeTimer
+{
+public:
+    explicit ProbeTimer(const QString &key);
+    ~ProbeTimer();
+
+private:
+    QString m_key;          //统计项
+    QElapsedTimer m_timer;  //计时器
+};
+
+/**
+ * @class ProbeRefresh
+ * @brief 作用域内的一次刷新 构造时开始刷新记录 析构时记录总耗时并结束刷新
+ *        各阶段依次调用lap 耗时为距上一阶段结束的时间
+ */
+class ProbeRefresh
+{
+public:
+    ProbeRefresh();
+    ~ProbeRefresh();
+
+    /**
+     * @brief 记录一个阶段的耗时 统计项为phase:阶段名
+     * @param phase：阶段名
+     */
+    void lap(const QString &phase);
+
+private:
+    quint64 m_id;               //刷新记录编号
+    quint64 m_previousId;       //本线程外层刷新的记录编号
+    QElapsedTimer m_totalTimer; //总计时器
+    QElapsedTimer m_lapTimer;   //阶段计时器
+};
+
+/**
+ * @class ProbeRefreshAttach
+ * @brief 作用域内当前线程的样本记录到指定的刷新 用于线程池中执行的探测任务
+ */
+class ProbeRefreshAttach
+{
+public:
+    explicit ProbeRefreshAttach(quint64 id);
+    ~ProbeRefreshAttach();
+
+private:
+    quint64 m_previousId;   //本线程原来的刷新记录编号
+};
+
+#endif // PROBESTATS_H
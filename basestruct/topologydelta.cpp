@@ -0,0 +1,418 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "topologydelta.h"
+
+//内容比较 与dbus序列化的字段保持一致 PartitionInfo::operator==只比较分区标识 此处不能使用
+static bool isSame(const FS_Limits &a, const FS_Limits &b);
+static bool isSame(const CRYPT_CIPHER_Support &a, const CRYPT_CIPHER_Support &b);
+static bool isSame(const LVData &a, const LVData &b);
+static bool isSame(const VGData &a, const VGData &b);
+static bool isSame(const PartitionInfo &a, const PartitionInfo &b);
+static bool isSame(const DeviceInfo &a, const DeviceInfo &b);
+static bool isSame(const PVRanges &a, const PVRanges &b);
+static bool isSame(const PVInfo &a, const PVInfo &b);
+static bool isSame(const LVInfo &a, const LVInfo &b);
+static bool isSame(const VGInfo &a, const VGInfo &b);
+static bool isSame(const LUKS_MapperInfo &a, const LUKS_MapperInfo &b);
+static bool isSame(const LUKS_INFO &a, const LUKS_INFO &b);
+
+template<class T>
+static bool isSame(const QVector<T> &a, const QVector<T> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < a.size(); ++i) {
+        if (!isSame(a.at(i), b.at(i))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<class T>
+static bool isSame(const QMap<QString, T> &a, const QMap<QString, T> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (auto it = a.begin(), other = b.begin(); it != a.end(); ++it, ++other) {
+        if (it.key() != other.key() || !isSame(it.value(), other.value())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<class T>
+static void diffMap(const QMap<QString, T> &oldMap, const QMap<QString, T> &newMap, QMap<QString, T> &changed, QStringList &removed)
+{
+    for (auto it = newMap.begin(); it != newMap.end(); ++it) {
+        auto old = oldMap.find(it.key());
+        if (old == oldMap.end() || !isSame(old.value(), it.value())) {
+            changed.insert(it.key(), it.value());
+        }
+    }
+
+    for (auto it = oldMap.begin(); it != oldMap.end(); ++it) {
+        if (!newMap.contains(it.key())) {
+            removed << it.key();
+        }
+    }
+}
+
+template<class T>
+static void applyMap(QMap<QString, T> &target, const QMap<QString, T> &changed, const QStringList &removed)
+{
+    foreach (const QString &key, removed) {
+        target.remove(key);
+    }
+
+    for (auto it = changed.begin(); it != changed.end(); ++it) {
+        target.insert(it.key(), it.value());
+    }
+}
+
+static bool isSame(const FS_Limits &a, const FS_Limits &b)
+{
+    return a.min_size == b.min_size && a.max_size == b.max_size;
+}
+
+static bool isSame(const CRYPT_CIPHER_Support &a, const CRYPT_CIPHER_Support &b)
+{
+    return a.aes_xts_plain64 == b.aes_xts_plain64 && a.sm4_xts_plain64 == b.sm4_xts_plain64;
+}
+
+static bool isSame(const LVData &a, const LVData &b)
+{
+    return a.m_lvName == b.m_lvName
+           && a.m_lvPath == b.m_lvPath
+           && a.m_lvSize == b.m_lvSize
+           && a.m_lvByteSize == b.m_lvByteSize;
+}
+
+static bool isSame(const VGData &a, const VGData &b)
+{
+    return a.m_vgName == b.m_vgName
+           && a.m_vgSize == b.m_vgSize
+           && a.m_vgUuid == b.m_vgUuid
+           && a.m_vgByteSize == b.m_vgByteSize
+           && isSame(a.m_lvList, b.m_lvList);
+}
+
+static bool isSame(const PartitionInfo &a, const PartitionInfo &b)
+{
+    return a.m_devicePath == b.m_devicePath
+           && a.m_partitionNumber == b.m_partitionNumber
+           && a.m_type == b.m_type
+           && a.m_status == b.m_status
+           && a.m_alignment == b.m_alignment
+           && a.m_fileSystemType == b.m_fileSystemType
+           && a.m_uuid == b.m_uuid
+           && a.m_name == b.m_name
+           && a.m_sectorStart == b.m_sectorStart
+           && a.m_sectorEnd == b.m_sectorEnd
+           && a.m_sectorsUsed == b.m_sectorsUsed
+           && a.m_sectorsUnused == b.m_sectorsUnused
+           && a.m_sectorsUnallocated == b.m_sectorsUnallocated
+           && a.m_significantThreshold == b.m_significantThreshold
+           && a.m_usagePending == b.m_usagePending
+           && a.m_freeSpaceBefore == b.m_freeSpaceBefore
+           && a.m_sectorSize == b.m_sectorSize
+           && a.m_fileSystemBlockSize == b.m_fileSystemBlockSize
+           && a.m_path == b.m_path
+           && a.m_fileSystemLabel == b.m_fileSystemLabel
+           && a.m_insideExtended == b.m_insideExtended
+           && a.m_busy == b.m_busy
+           && a.m_fileSystemReadOnly == b.m_fileSystemReadOnly
+           && a.m_flag == b.m_flag
+           && a.m_mountPoints == b.m_mountPoints
+           && a.m_vgFlag == b.m_vgFlag
+           && isSame(a.m_vgData, b.m_vgData)
+           && isSame(a.m_fsLimits, b.m_fsLimits)
+           && a.m_luksFlag == b.m_luksFlag
+           && a.m_crypt == b.m_crypt
+           && a.m_tokenList == b.m_tokenList
+           && a.m_decryptStr == b.m_decryptStr
+           && a.m_dmName == b.m_dmName;
+}
+
+static bool isSame(const DeviceInfo &a, const DeviceInfo &b)
+{
+    return a.m_length == b.m_length
+           && a.m_heads == b.m_heads
+           && a.m_path == b.m_path
+           && a.m_sectors == b.m_sectors
+           && a.m_cylinders == b.m_cylinders
+           && a.m_cylsize == b.m_cylsize
+           && a.m_model == b.m_model
+           && a.m_serialNumber == b.m_serialNumber
+           && a.m_disktype == b.m_disktype
+           && a.m_sectorSize == b.m_sectorSize
+           && a.m_maxPrims == b.m_maxPrims
+           && a.m_highestBusy == b.m_highestBusy
+           && a.m_readonly == b.m_readonly
+           && a.m_maxPartitionNameLength == b.m_maxPartitionNameLength
+           && a.m_mediaType == b.m_mediaType
+           && a.m_interface == b.m_interface
+           && a.m_vgFlag == b.m_vgFlag
+           && a.m_luksFlag == b.m_luksFlag
+           && isSame(a.m_crySupport, b.m_crySupport)
+           && isSame(a.m_partition, b.m_partition)
+           && isSame(a.m_vglist, b.m_vglist);
+}
+
+static bool isSame(const PVRanges &a, const PVRanges &b)
+{
+    return a.m_lvName == b.m_lvName
+           && a.m_devPath == b.m_devPath
+           && a.m_vgName == b.m_vgName
+           && a.m_vgUuid == b.m_vgUuid
+           && a.m_start == b.m_start
+           && a.m_end == b.m_end
+           && a.m_used == b.m_used;
+}
+
+static bool isSame(const PVInfo &a, const PVInfo &b)
+{
+    return a.m_pvFmt == b.m_pvFmt
+           && a.m_vgName == b.m_vgName
+           && a.m_pvPath == b.m_pvPath
+           && a.m_pvUuid == b.m_pvUuid
+           && a.m_vgUuid == b.m_vgUuid
+           && a.m_pvMdaSize == b.m_pvMdaSize
+           && a.m_pvMdaCount == b.m_pvMdaCount
+           && a.m_pvSize == b.m_pvSize
+           && a.m_pvFree == b.m_pvFree
+           && a.m_pvUsedPE == b.m_pvUsedPE
+           && a.m_pvUnusedPE == b.m_pvUnusedPE
+           && a.m_PESize == b.m_PESize
+           && a.m_pvStatus == b.m_pvStatus
+           && a.m_pvError == b.m_pvError
+           && a.m_lvmDevType == b.m_lvmDevType
+           && a.m_pvByteTotalSize == b.m_pvByteTotalSize
+           && a.m_pvByteFreeSize == b.m_pvByteFreeSize
+           && isSame(a.m_vgRangesList, b.m_vgRangesList)
+           && isSame(a.m_lvRangesList, b.m_lvRangesList);
+}
+
+static bool isSame(const LVInfo &a, const LVInfo &b)
+{
+    return a.m_vgName == b.m_vgName
+           && a.m_lvPath == b.m_lvPath
+           && a.m_lvUuid == b.m_lvUuid
+           && a.m_lvName == b.m_lvName
+           && a.m_lvFsType == b.m_lvFsType
+           && a.m_lvSize == b.m_lvSize
+           && a.m_lvLECount == b.m_lvLECount
+           && a.m_fsUsed == b.m_fsUsed
+           && a.m_fsUnused == b.m_fsUnused
+           && a.m_LESize == b.m_LESize
+           && a.m_busy == b.m_busy
+           && a.m_mountPoints == b.m_mountPoints
+           && a.m_lvStatus == b.m_lvStatus
+           && a.m_lvError == b.m_lvError
+           && a.m_mountUuid == b.m_mountUuid
+           && isSame(a.m_fsLimits, b.m_fsLimits)
+           && a.m_luksFlag == b.m_luksFlag
+           && a.m_fileSystemLabel == b.m_fileSystemLabel
+           && a.m_dataFlag == b.m_dataFlag;
+}
+
+static bool isSame(const VGInfo &a, const VGInfo &b)
+{
+    return a.m_vgName == b.m_vgName
+           && a.m_vgUuid == b.m_vgUuid
+           && a.m_vgSize == b.m_vgSize
+           && a.m_vgUsed == b.m_vgUsed
+           && a.m_vgUnused == b.m_vgUnused
+           && a.m_pvCount == b.m_pvCount
+           && a.m_peCount == b.m_peCount
+           && a.m_peUsed == b.m_peUsed
+           && a.m_peUnused == b.m_peUnused
+           && a.m_PESize == b.m_PESize
+           && a.m_curLV == b.m_curLV
+           && a.m_vgStatus == b.m_vgStatus
+           && a.m_vgError == b.m_vgError
+           && a.m_luksFlag == b.m_luksFlag
+           && isSame(a.m_lvlist, b.m_lvlist)
+           && isSame(a.m_pvInfo, b.m_pvInfo);
+}
+
+static bool isSame(const LUKS_MapperInfo &a, const LUKS_MapperInfo &b)
+{
+    return a.m_luksFs == b.m_luksFs
+           && a.m_mountPoints == b.m_mountPoints
+           && a.m_uuid == b.m_uuid
+           && a.m_dmName == b.m_dmName
+           && a.m_dmPath == b.m_dmPath
+           && a.m_busy == b.m_busy
+           && a.m_fsUsed == b.m_fsUsed
+           && a.m_fsUnused == b.m_fsUnused
+           && a.m_Size == b.m_Size
+           && a.m_devicePath == b.m_devicePath
+           && a.m_crypt == b.m_crypt
+           && a.m_luskType == b.m_luskType
+           && a.m_mode == b.m_mode
+           && a.m_vgflag == b.m_vgflag
+           && isSame(a.m_fsLimits, b.m_fsLimits)
+           && a.m_fileSystemLabel == b.m_fileSystemLabel;
+}
+
+static bool isSame(const LUKS_INFO &a, const LUKS_INFO &b)
+{
+    return isSame(a.m_mapper, b.m_mapper)
+           && a.m_devicePath == b.m_devicePath
+           && a.m_crypt == b.m_crypt
+           && a.m_luksVersion == b.m_luksVersion
+           && a.m_cryptErr == b.m_cryptErr
+           && a.m_dmUUID == b.m_dmUUID
+           && a.m_tokenList == b.m_tokenList
+           && a.m_decryptErrCount == b.m_decryptErrCount
+           && a.m_decryptErrorLastTime == b.m_decryptErrorLastTime
+           && a.m_decryptStr == b.m_decryptStr
+           && a.isDecrypt == b.isDecrypt
+           && a.m_keySlots == b.m_keySlots
+           && a.m_Suspend == b.m_Suspend
+           && a.m_fileSystemLabel == b.m_fileSystemLabel;
+}
+
+/*********************************** TopologyDelta *********************************************/
+TopologyDelta TopologyDelta::diff(quint64 baseGeneration, quint64 generation,
+                                  const DeviceInfoMap &oldDevices, const LVMInfo &oldLVM, const LUKSMap &oldLUKS,
+                                  const DeviceInfoMap &newDevices, const LVMInfo &newLVM, const LUKSMap &newLUKS)
+{
+    TopologyDelta delta;
+    delta.m_baseGeneration = baseGeneration;
+    delta.m_generation = generation;
+    diffMap(oldDevices, newDevices, delta.m_changedDevices, delta.m_removedDevices);
+    diffMap(oldLVM.m_vgInfo, newLVM.m_vgInfo, delta.m_changedVGs, delta.m_removedVGs);
+    diffMap(oldLVM.m_pvInfo, newLVM.m_pvInfo, delta.m_changedPVs, delta.m_removedPVs);
+    diffMap(oldLUKS.m_luksMap, newLUKS.m_luksMap, delta.m_changedLUKS, delta.m_removedLUKS);
+    diffMap(oldLUKS.m_mapper, newLUKS.m_mapper, delta.m_changedMappers, delta.m_removedMappers);
+    delta.m_lvmErr = newLVM.m_lvmErr;
+    delta.m_cryErr = newLUKS.m_cryErr;
+    delta.m_cryptSupport = newLUKS.m_cryptSuuport;
+
+    return delta;
+}
+
+TopologyDelta TopologyDelta::full(quint64 generation, const DeviceInfoMap &devices, const LVMInfo &lvm, const LUKSMap &luks)
+{
+    TopologyDelta delta;
+    delta.m_baseGeneration = generation;
+    delta.m_generation = generation;
+    delta.m_fullSync = true;
+    delta.m_changedDevices = devices;
+    delta.m_changedVGs = lvm.m_vgInfo;
+    delta.m_changedPVs = lvm.m_pvInfo;
+    delta.m_lvmErr = lvm.m_lvmErr;
+    delta.m_changedLUKS = luks.m_luksMap;
+    delta.m_changedMappers = luks.m_mapper;
+    delta.m_cryErr = luks.m_cryErr;
+    delta.m_cryptSupport = luks.m_cryptSuuport;
+
+    return delta;
+}
+
+void TopologyDelta::apply(DeviceInfoMap &devices, LVMInfo &lvm, LUKSMap &luks) const
+{
+    if (m_fullSync) {
+        devices.clear();
+        lvm.m_vgInfo.clear();
+        lvm.m_pvInfo.clear();
+        luks.m_luksMap.clear();
+        luks.m_mapper.clear();
+    }
+
+    applyMap(devices, m_changedDevices, m_removedDevices);
+    applyMap(lvm.m_vgInfo, m_changedVGs, m_removedVGs);
+    applyMap(lvm.m_pvInfo, m_changedPVs, m_removedPVs);
+    applyMap(luks.m_luksMap, m_changedLUKS, m_removedLUKS);
+    applyMap(luks.m_mapper, m_changedMappers, m_removedMappers);
+    lvm.m_lvmErr = m_lvmErr;
+    luks.m_cryErr = m_cryErr;
+    luks.m_cryptSuuport = m_cryptSupport;
+}
+
+bool TopologyDelta::isEmpty() const
+{
+    return m_changedDevices.isEmpty() && m_removedDevices.isEmpty()
+           && m_changedVGs.isEmpty() && m_removedVGs.isEmpty()
+           && m_changedPVs.isEmpty() && m_removedPVs.isEmpty()
+           && m_changedLUKS.isEmpty() && m_removedLUKS.isEmpty()
+           && m_changedMappers.isEmpty() && m_removedMappers.isEmpty();
+}
+
+QDBusArgument &operator<<(QDBusArgument &argument, const TopologyDelta &data)
+{
+    argument.beginStructure();
+    argument << data.m_generation
+             << data.m_baseGeneration
+             << data.m_fullSync
+             << data.m_stale
+             << data.m_changedDevices
+             << data.m_removedDevices
+             << data.m_changedVGs
+             << data.m_removedVGs
+             << data.m_changedPVs
+             << data.m_removedPVs
+             << static_cast<int>(data.m_lvmErr)
+             << data.m_changedLUKS
+             << data.m_removedLUKS
+             << data.m_changedMappers
+             << data.m_removedMappers
+             << static_cast<int>(data.m_cryErr)
+             << data.m_cryptSupport;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, TopologyDelta &data)
+{
+    argument.beginStructure();
+    int lvmErr, cryErr;
+    argument >> data.m_generation
+             >> data.m_baseGeneration
+             >> data.m_fullSync
+             >> data.m_stale
+             >> data.m_changedDevices
+             >> data.m_removedDevices
+             >> data.m_changedVGs
+             >> data.m_removedVGs
+             >> data.m_changedPVs
+             >> data.m_removedPVs
+             >> lvmErr
+             >> data.m_changedLUKS
+             >> data.m_removedLUKS
+             >> data.m_changedMappers
+             >> data.m_removedMappers
+             >> cryErr
+             >> data.m_cryptSupport;
+    data.m_lvmErr = static_cast<LVMError>(lvmErr);
+    data.m_cryErr = static_cast<CRYPTError>(cryErr);
+    argument.endStructure();
+    return argument;
+}
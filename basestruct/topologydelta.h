@@ -0,0 +1,98 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TOPOLOGYDELTA_H
+#define TOPOLOGYDELTA_H
+#include "deviceinfo.h"
+#include "lvmstruct.h"
+#include "luksstruct.h"
+
+#include <QStringList>
+
+/**
+ * @class TopologyDelta
+ * @brief 磁盘拓扑增量 服务端每次刷新生成一个新版本号 只携带相对上一版本新增、删除或变化的磁盘、vg、pv及luks映射
+ *        磁盘的分区随所属磁盘一起下发 lv随所属vg一起下发
+ */
+class TopologyDelta
+{
+public:
+    /**
+     * @brief 比较新旧拓扑 生成增量
+     * @param baseGeneration：旧拓扑版本号
+     * @param generation：新拓扑版本号
+     * @param oldDevices：旧磁盘信息
+     * @param oldLVM：旧lvm信息
+     * @param oldLUKS：旧luks信息
+     * @param newDevices：新磁盘信息
+     * @param newLVM：新lvm信息
+     * @param newLUKS：新luks信息
+     * @return 拓扑增量
+     */
+    static TopologyDelta diff(quint64 baseGeneration, quint64 generation,
+                              const DeviceInfoMap &oldDevices, const LVMInfo &oldLVM, const LUKSMap &oldLUKS,
+                              const DeviceInfoMap &newDevices, const LVMInfo &newLVM, const LUKSMap &newLUKS);
+
+    /**
+     * @brief 生成全量拓扑 用于客户端版本号过期后重新同步
+     * @param generation：当前拓扑版本号
+     * @param devices：磁盘信息
+     * @param lvm：lvm信息
+     * @param luks：luks信息
+     * @return 拓扑增量(m_fullSync为true)
+     */
+    static TopologyDelta full(quint64 generation, const DeviceInfoMap &devices, const LVMInfo &lvm, const LUKSMap &luks);
+
+    /**
+     * @brief 将增量合并到本地拓扑 全量同步时直接替换
+     * @param devices：磁盘信息
+     * @param lvm：lvm信息
+     * @param luks：luks信息
+     */
+    void apply(DeviceInfoMap &devices, LVMInfo &lvm, LUKSMap &luks) const;
+
+    /**
+     * @brief 增量是否为空
+     * @return true为空false不为空
+     */
+    bool isEmpty() const;
+
+public:
+    quint64 m_generation{0};                            //本次拓扑版本号
+    quint64 m_baseGeneration{0};                        //增量所基于的版本号 客户端版本号与之不一致时需要全量同步
+    bool m_fullSync{false};                             //是否为全量拓扑
+    bool m_stale{false};                                //是否为服务启动时从缓存加载、尚未经过探测确认的拓扑
+    DeviceInfoMap m_changedDevices;                     //新增或变化的磁盘 key:磁盘路径
+    QStringList m_removedDevices;                       //删除的磁盘路径
+    QMap<QString, VGInfo> m_changedVGs;                 //新增或变化的vg key:vgName
+    QStringList m_removedVGs;                           //删除的vgName
+    QMap<QString, PVInfo> m_changedPVs;                 //新增或变化的pv key:pv路径
+    QStringList m_removedPVs;                           //删除的pv路径
+    LVMError m_lvmErr{LVMError::LVM_ERR_NORMAL};        //lvm错误码
+    LUKSInfoMap m_changedLUKS;                          //新增或变化的luks设备 key:原始设备路径
+    QStringList m_removedLUKS;                          //删除的luks设备路径
+    QMap<QString, LUKS_MapperInfo> m_changedMappers;    //新增或变化的映射 key:原始设备路径
+    QStringList m_removedMappers;                       //删除的映射对应的原始设备路径
+    CRYPTError m_cryErr{CRYPTError::CRYPT_ERR_NORMAL};  //crypt错误码
+    CRYPT_CIPHER_Support m_cryptSupport;                //加密算法支持情况
+};
+DBUSStructEnd(TopologyDelta)
+
+#endif // TOPOLOGYDELTA_H
@@ -0,0 +1,825 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "topologyimage.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+/**
+ * @class ImageWriter
+ * @brief 小端序写入 字段顺序与QDBusArgument序列化保持一致
+ */
+class ImageWriter
+{
+public:
+    template<typename T>
+    void writeValue(T value)
+    {
+        uchar buf[sizeof(T)];
+        qToLittleEndian<T>(value, buf);
+        m_data.append(reinterpret_cast<const char *>(buf), sizeof(T));
+    }
+
+    ImageWriter &operator<<(bool value)
+    {
+        writeValue<quint8>(value ? 1 : 0);
+        return *this;
+    }
+
+    ImageWriter &operator<<(int value)
+    {
+        writeValue<qint32>(value);
+        return *this;
+    }
+
+    ImageWriter &operator<<(unsigned int value)
+    {
+        writeValue<quint32>(value);
+        return *this;
+    }
+
+    ImageWriter &operator<<(long long value)
+    {
+        writeValue<qint64>(value);
+        return *this;
+    }
+
+    ImageWriter &operator<<(quint64 value)
+    {
+        writeValue<quint64>(value);
+        return *this;
+    }
+
+    ImageWriter &operator<<(const QString &value)
+    {
+        writeValue<quint32>(static_cast<quint32>(value.size()));
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        m_data.append(reinterpret_cast<const char *>(value.utf16()), value.size() * 2);
+#else
+        for (int i = 0; i < value.size(); i++) {
+            writeValue<quint16>(value.at(i).unicode());
+        }
+#endif
+        return *this;
+    }
+
+    template<typename T>
+    ImageWriter &operator<<(const QList<T> &list)
+    {
+        writeValue<quint32>(static_cast<quint32>(list.size()));
+        foreach (const T &item, list) {
+            *this << item;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ImageWriter &operator<<(const QVector<T> &list)
+    {
+        writeValue<quint32>(static_cast<quint32>(list.size()));
+        foreach (const T &item, list) {
+            *this << item;
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ImageWriter &operator<<(const QMap<QString, T> &map)
+    {
+        writeValue<quint32>(static_cast<quint32>(map.size()));
+        for (auto it = map.begin(); it != map.end(); it++) {
+            *this << it.key() << it.value();
+        }
+        return *this;
+    }
+
+    QByteArray m_data;  //已写入数据
+};
+
+/**
+ * @class ImageReader
+ * @brief 小端序读取 越界后置为失败并停止读取 不会访问镜像以外的内存
+ */
+class ImageReader
+{
+public:
+    ImageReader(const char *data, qint64 size)
+        : m_pos(data)
+        , m_end(data + size)
+    {
+    }
+
+    template<typename T>
+    T readValue()
+    {
+        if (m_end - m_pos < static_cast<qint64>(sizeof(T))) {
+            fail();
+            return T(0);
+        }
+
+        T value = qFromLittleEndian<T>(reinterpret_cast<const uchar *>(m_pos));
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    /**
+     * @brief 读取元素个数 每个元素至少占一个字节 超过剩余长度时视为损坏
+     */
+    int readCount()
+    {
+        quint32 count = readValue<quint32>();
+        if (count > static_cast<quint64>(m_end - m_pos)) {
+            fail();
+            return 0;
+        }
+        return static_cast<int>(count);
+    }
+
+    ImageReader &operator>>(bool &value)
+    {
+        value = readValue<quint8>() != 0;
+        return *this;
+    }
+
+    ImageReader &operator>>(int &value)
+    {
+        value = readValue<qint32>();
+        return *this;
+    }
+
+    ImageReader &operator>>(unsigned int &value)
+    {
+        value = readValue<quint32>();
+        return *this;
+    }
+
+    ImageReader &operator>>(long long &value)
+    {
+        value = readValue<qint64>();
+        return *this;
+    }
+
+    ImageReader &operator>>(quint64 &value)
+    {
+        value = readValue<quint64>();
+        return *this;
+    }
+
+    ImageReader &operator>>(QString &value)
+    {
+        quint32 size = readValue<quint32>();
+        if (static_cast<quint64>(m_end - m_pos) / 2 < size) {
+            fail();
+            value.clear();
+            return *this;
+        }
+
+        value.resize(static_cast<int>(size));
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        memcpy(value.data(), m_pos, size * 2);
+        m_pos += size * 2;
+#else
+        for (int i = 0; i < value.size(); i++) {
+            value[i] = QChar(readValue<quint16>());
+        }
+#endif
+        return *this;
+    }
+
+    template<typename T>
+    ImageReader &operator>>(QList<T> &list)
+    {
+        int count = readCount();
+        list.clear();
+        list.reserve(count);
+        for (int i = 0; i < count && m_ok; i++) {
+            T item;
+            *this >> item;
+            list.append(item);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ImageReader &operator>>(QVector<T> &list)
+    {
+        int count = readCount();
+        list.clear();
+        list.reserve(count);
+        for (int i = 0; i < count && m_ok; i++) {
+            T item;
+            *this >> item;
+            list.append(item);
+        }
+        return *this;
+    }
+
+    template<typename T>
+    ImageReader &operator>>(QMap<QString, T> &map)
+    {
+        int count = readCount();
+        map.clear();
+        for (int i = 0; i < count && m_ok; i++) {
+            QString key;
+            T value;
+            *this >> key >> value;
+            map.insert(key, value);
+        }
+        return *this;
+    }
+
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+private:
+    void fail()
+    {
+        m_ok = false;
+        m_pos = m_end;
+    }
+
+    const char *m_pos;      //当前读取位置
+    const char *m_end;      //镜像结束位置
+    bool m_ok{true};        //是否读取成功
+};
+
+} // namespace
+
+static ImageWriter &operator<<(ImageWriter &writer, const FS_Limits &data);
+static ImageWriter &operator<<(ImageWriter &writer, const CRYPT_CIPHER_Support &data);
+static ImageWriter &operator<<(ImageWriter &writer, const LVData &data);
+static ImageWriter &operator<<(ImageWriter &writer, const VGData &data);
+static ImageWriter &operator<<(ImageWriter &writer, const PartitionInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const DeviceInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const PVRanges &data);
+static ImageWriter &operator<<(ImageWriter &writer, const PVInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const LVInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const VGInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const LUKS_MapperInfo &data);
+static ImageWriter &operator<<(ImageWriter &writer, const LUKS_INFO &data);
+static ImageReader &operator>>(ImageReader &reader, FS_Limits &data);
+static ImageReader &operator>>(ImageReader &reader, CRYPT_CIPHER_Support &data);
+static ImageReader &operator>>(ImageReader &reader, LVData &data);
+static ImageReader &operator>>(ImageReader &reader, VGData &data);
+static ImageReader &operator>>(ImageReader &reader, PartitionInfo &data);
+static ImageReader &operator>>(ImageReader &reader, DeviceInfo &data);
+static ImageReader &operator>>(ImageReader &reader, PVRanges &data);
+static ImageReader &operator>>(ImageReader &reader, PVInfo &data);
+static ImageReader &operator>>(ImageReader &reader, LVInfo &data);
+static ImageReader &operator>>(ImageReader &reader, VGInfo &data);
+static ImageReader &operator>>(ImageReader &reader, LUKS_MapperInfo &data);
+static ImageReader &operator>>(ImageReader &reader, LUKS_INFO &data);
+
+QByteArray TopologyImage::encode(const TopologyDelta &delta)
+{
+    ImageWriter writer;
+    writer.m_data.reserve(64 * 1024);
+    writer.writeValue<quint32>(Magic);
+    writer.writeValue<quint32>(Version);
+    writer.writeValue<quint64>(0);
+    const int headerSize = writer.m_data.size();
+
+    writer << static_cast<quint64>(delta.m_generation)
+           << static_cast<quint64>(delta.m_baseGeneration)
+           << delta.m_fullSync
+           << delta.m_stale
+           << delta.m_changedDevices
+           << delta.m_removedDevices
+           << delta.m_changedVGs
+           << delta.m_removedVGs
+           << delta.m_changedPVs
+           << delta.m_removedPVs
+           << static_cast<int>(delta.m_lvmErr)
+           << delta.m_changedLUKS
+           << delta.m_removedLUKS
+           << delta.m_changedMappers
+           << delta.m_removedMappers
+           << static_cast<int>(delta.m_cryErr)
+           << delta.m_cryptSupport;
+
+    qToLittleEndian<quint64>(static_cast<quint64>(writer.m_data.size() - headerSize),
+                             reinterpret_cast<uchar *>(writer.m_data.data()) + headerSize - sizeof(quint64));
+    return writer.m_data;
+}
+
+bool TopologyImage::decode(const char *data, qint64 size, TopologyDelta &delta)
+{
+    ImageReader header(data, size);
+    quint32 magic = header.readValue<quint32>();
+    quint32 version = header.readValue<quint32>();
+    quint64 payloadSize = header.readValue<quint64>();
+    const qint64 headerSize = sizeof(quint32) * 2 + sizeof(quint64);
+    if (!header.ok() || magic != Magic || version != Version || payloadSize != static_cast<quint64>(size - headerSize)) {
+        return false;
+    }
+
+    ImageReader reader(data + headerSize, size - headerSize);
+    quint64 generation = 0;
+    quint64 baseGeneration = 0;
+    int lvmErr = 0;
+    int cryErr = 0;
+    reader >> generation
+           >> baseGeneration
+           >> delta.m_fullSync
+           >> delta.m_stale
+           >> delta.m_changedDevices
+           >> delta.m_removedDevices
+           >> delta.m_changedVGs
+           >> delta.m_removedVGs
+           >> delta.m_changedPVs
+           >> delta.m_removedPVs
+           >> lvmErr
+           >> delta.m_changedLUKS
+           >> delta.m_removedLUKS
+           >> delta.m_changedMappers
+           >> delta.m_removedMappers
+           >> cryErr
+           >> delta.m_cryptSupport;
+    delta.m_generation = generation;
+    delta.m_baseGeneration = baseGeneration;
+    delta.m_lvmErr = static_cast<LVMError>(lvmErr);
+    delta.m_cryErr = static_cast<CRYPTError>(cryErr);
+    return reader.ok();
+}
+
+/*********************************** 基础结构 *********************************************/
+static ImageWriter &operator<<(ImageWriter &writer, const FS_Limits &data)
+{
+    return writer << data.min_size << data.max_size;
+}
+
+static ImageReader &operator>>(ImageReader &reader, FS_Limits &data)
+{
+    return reader >> data.min_size >> data.max_size;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const CRYPT_CIPHER_Support &data)
+{
+    return writer << static_cast<int>(data.aes_xts_plain64)
+                  << static_cast<int>(data.sm4_xts_plain64);
+}
+
+static ImageReader &operator>>(ImageReader &reader, CRYPT_CIPHER_Support &data)
+{
+    int aes = 0;
+    int sm4 = 0;
+    reader >> aes >> sm4;
+    data.aes_xts_plain64 = static_cast<CRYPT_CIPHER_Support::Support>(aes);
+    data.sm4_xts_plain64 = static_cast<CRYPT_CIPHER_Support::Support>(sm4);
+    return reader;
+}
+
+/*********************************** 磁盘及分区 *********************************************/
+static ImageWriter &operator<<(ImageWriter &writer, const LVData &data)
+{
+    return writer << data.m_lvName
+                  << data.m_lvPath
+                  << data.m_lvSize
+                  << data.m_lvByteSize;
+}
+
+static ImageReader &operator>>(ImageReader &reader, LVData &data)
+{
+    return reader >> data.m_lvName
+                  >> data.m_lvPath
+                  >> data.m_lvSize
+                  >> data.m_lvByteSize;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const VGData &data)
+{
+    return writer << data.m_vgName
+                  << data.m_vgSize
+                  << data.m_vgUuid
+                  << data.m_vgByteSize
+                  << data.m_lvList;
+}
+
+static ImageReader &operator>>(ImageReader &reader, VGData &data)
+{
+    return reader >> data.m_vgName
+                  >> data.m_vgSize
+                  >> data.m_vgUuid
+                  >> data.m_vgByteSize
+                  >> data.m_lvList;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const PartitionInfo &data)
+{
+    return writer << data.m_devicePath
+                  << data.m_partitionNumber
+                  << data.m_type
+                  << data.m_status
+                  << data.m_alignment
+                  << data.m_fileSystemType
+                  << data.m_uuid
+                  << data.m_name
+                  << data.m_sectorStart
+                  << data.m_sectorEnd
+                  << data.m_sectorsUsed
+                  << data.m_sectorsUnused
+                  << data.m_sectorsUnallocated
+                  << data.m_significantThreshold
+                  << data.m_usagePending
+                  << data.m_freeSpaceBefore
+                  << data.m_sectorSize
+                  << data.m_fileSystemBlockSize
+                  << data.m_path
+                  << data.m_fileSystemLabel
+                  << data.m_insideExtended
+                  << data.m_busy
+                  << data.m_fileSystemReadOnly
+                  << data.m_flag
+                  << data.m_mountPoints
+                  << static_cast<int>(data.m_vgFlag)
+                  << data.m_vgData
+                  << data.m_fsLimits
+                  << static_cast<int>(data.m_luksFlag)
+                  << static_cast<int>(data.m_crypt)
+                  << data.m_tokenList
+                  << data.m_decryptStr
+                  << data.m_dmName;
+}
+
+static ImageReader &operator>>(ImageReader &reader, PartitionInfo &data)
+{
+    int vgFlag = 0;
+    int luksFlag = 0;
+    int crypt = 0;
+    reader >> data.m_devicePath
+           >> data.m_partitionNumber
+           >> data.m_type
+           >> data.m_status
+           >> data.m_alignment
+           >> data.m_fileSystemType
+           >> data.m_uuid
+           >> data.m_name
+           >> data.m_sectorStart
+           >> data.m_sectorEnd
+           >> data.m_sectorsUsed
+           >> data.m_sectorsUnused
+           >> data.m_sectorsUnallocated
+           >> data.m_significantThreshold
+           >> data.m_usagePending
+           >> data.m_freeSpaceBefore
+           >> data.m_sectorSize
+           >> data.m_fileSystemBlockSize
+           >> data.m_path
+           >> data.m_fileSystemLabel
+           >> data.m_insideExtended
+           >> data.m_busy
+           >> data.m_fileSystemReadOnly
+           >> data.m_flag
+           >> data.m_mountPoints
+           >> vgFlag
+           >> data.m_vgData
+           >> data.m_fsLimits
+           >> luksFlag
+           >> crypt
+           >> data.m_tokenList
+           >> data.m_decryptStr
+           >> data.m_dmName;
+    data.m_vgFlag = static_cast<LVMFlag>(vgFlag);
+    data.m_luksFlag = static_cast<LUKSFlag>(luksFlag);
+    data.m_crypt = static_cast<CRYPT_CIPHER>(crypt);
+    return reader;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const DeviceInfo &data)
+{
+    return writer << data.m_length
+                  << data.m_heads
+                  << data.m_path
+                  << data.m_sectors
+                  << data.m_cylinders
+                  << data.m_cylsize
+                  << data.m_model
+                  << data.m_serialNumber
+                  << data.m_disktype
+                  << data.m_sectorSize
+                  << data.m_maxPrims
+                  << data.m_highestBusy
+                  << data.m_readonly
+                  << data.m_maxPartitionNameLength
+                  << data.m_partition
+                  << data.m_mediaType
+                  << data.m_interface
+                  << static_cast<int>(data.m_vgFlag)
+                  << data.m_vglist
+                  << static_cast<int>(data.m_luksFlag)
+                  << data.m_crySupport;
+}
+
+static ImageReader &operator>>(ImageReader &reader, DeviceInfo &data)
+{
+    int vgFlag = 0;
+    int luksFlag = 0;
+    reader >> data.m_length
+           >> data.m_heads
+           >> data.m_path
+           >> data.m_sectors
+           >> data.m_cylinders
+           >> data.m_cylsize
+           >> data.m_model
+           >> data.m_serialNumber
+           >> data.m_disktype
+           >> data.m_sectorSize
+           >> data.m_maxPrims
+           >> data.m_highestBusy
+           >> data.m_readonly
+           >> data.m_maxPartitionNameLength
+           >> data.m_partition
+           >> data.m_mediaType
+           >> data.m_interface
+           >> vgFlag
+           >> data.m_vglist
+           >> luksFlag
+           >> data.m_crySupport;
+    data.m_vgFlag = static_cast<LVMFlag>(vgFlag);
+    data.m_luksFlag = static_cast<LUKSFlag>(luksFlag);
+    return reader;
+}
+
+/*********************************** lvm *********************************************/
+static ImageWriter &operator<<(ImageWriter &writer, const PVRanges &data)
+{
+    return writer << data.m_lvName
+                  << data.m_devPath
+                  << data.m_vgName
+                  << data.m_vgUuid
+                  << data.m_start
+                  << data.m_end
+                  << data.m_used;
+}
+
+static ImageReader &operator>>(ImageReader &reader, PVRanges &data)
+{
+    return reader >> data.m_lvName
+                  >> data.m_devPath
+                  >> data.m_vgName
+                  >> data.m_vgUuid
+                  >> data.m_start
+                  >> data.m_end
+                  >> data.m_used;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const PVInfo &data)
+{
+    return writer << data.m_pvFmt
+                  << data.m_vgName
+                  << data.m_pvPath
+                  << data.m_pvUuid
+                  << data.m_vgUuid
+                  << data.m_pvMdaSize
+                  << data.m_pvMdaCount
+                  << data.m_pvSize
+                  << data.m_pvFree
+                  << data.m_pvUsedPE
+                  << data.m_pvUnusedPE
+                  << data.m_PESize
+                  << data.m_pvStatus
+                  << static_cast<int>(data.m_pvError)
+                  << data.m_lvRangesList
+                  << data.m_vgRangesList
+                  << static_cast<int>(data.m_lvmDevType)
+                  << data.m_pvByteTotalSize
+                  << data.m_pvByteFreeSize;
+}
+
+static ImageReader &operator>>(ImageReader &reader, PVInfo &data)
+{
+    int err = 0;
+    int devType = 0;
+    reader >> data.m_pvFmt
+           >> data.m_vgName
+           >> data.m_pvPath
+           >> data.m_pvUuid
+           >> data.m_vgUuid
+           >> data.m_pvMdaSize
+           >> data.m_pvMdaCount
+           >> data.m_pvSize
+           >> data.m_pvFree
+           >> data.m_pvUsedPE
+           >> data.m_pvUnusedPE
+           >> data.m_PESize
+           >> data.m_pvStatus
+           >> err
+           >> data.m_lvRangesList
+           >> data.m_vgRangesList
+           >> devType
+           >> data.m_pvByteTotalSize
+           >> data.m_pvByteFreeSize;
+    data.m_pvError = static_cast<LVMError>(err);
+    data.m_lvmDevType = static_cast<DevType>(devType);
+    return reader;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const LVInfo &data)
+{
+    return writer << data.m_vgName
+                  << data.m_lvPath
+                  << data.m_lvUuid
+                  << data.m_lvName
+                  << static_cast<int>(data.m_lvFsType)
+                  << data.m_lvSize
+                  << data.m_lvLECount
+                  << data.m_fsUsed
+                  << data.m_fsUnused
+                  << data.m_LESize
+                  << data.m_busy
+                  << data.m_mountPoints
+                  << data.m_lvStatus
+                  << static_cast<int>(data.m_lvError)
+                  << data.m_mountUuid
+                  << data.m_fsLimits
+                  << static_cast<int>(data.m_luksFlag)
+                  << data.m_fileSystemLabel
+                  << data.m_dataFlag;
+}
+
+static ImageReader &operator>>(ImageReader &reader, LVInfo &data)
+{
+    int type = 0;
+    int err = 0;
+    int luksFlag = 0;
+    reader >> data.m_vgName
+           >> data.m_lvPath
+           >> data.m_lvUuid
+           >> data.m_lvName
+           >> type
+           >> data.m_lvSize
+           >> data.m_lvLECount
+           >> data.m_fsUsed
+           >> data.m_fsUnused
+           >> data.m_LESize
+           >> data.m_busy
+           >> data.m_mountPoints
+           >> data.m_lvStatus
+           >> err
+           >> data.m_mountUuid
+           >> data.m_fsLimits
+           >> luksFlag
+           >> data.m_fileSystemLabel
+           >> data.m_dataFlag;
+    data.m_lvFsType = static_cast<FSType>(type);
+    data.m_lvError = static_cast<LVMError>(err);
+    data.m_luksFlag = static_cast<LUKSFlag>(luksFlag);
+    return reader;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const VGInfo &data)
+{
+    return writer << data.m_vgName
+                  << data.m_vgUuid
+                  << data.m_vgSize
+                  << data.m_vgUsed
+                  << data.m_vgUnused
+                  << data.m_pvCount
+                  << data.m_peCount
+                  << data.m_peUsed
+                  << data.m_peUnused
+                  << data.m_PESize
+                  << data.m_curLV
+                  << data.m_vgStatus
+                  << static_cast<int>(data.m_vgError)
+                  << data.m_lvlist
+                  << data.m_pvInfo
+                  << static_cast<int>(data.m_luksFlag);
+}
+
+static ImageReader &operator>>(ImageReader &reader, VGInfo &data)
+{
+    int err = 0;
+    int luksFlag = 0;
+    reader >> data.m_vgName
+           >> data.m_vgUuid
+           >> data.m_vgSize
+           >> data.m_vgUsed
+           >> data.m_vgUnused
+           >> data.m_pvCount
+           >> data.m_peCount
+           >> data.m_peUsed
+           >> data.m_peUnused
+           >> data.m_PESize
+           >> data.m_curLV
+           >> data.m_vgStatus
+           >> err
+           >> data.m_lvlist
+           >> data.m_pvInfo
+           >> luksFlag;
+    data.m_vgError = static_cast<LVMError>(err);
+    data.m_luksFlag = static_cast<LUKSFlag>(luksFlag);
+    return reader;
+}
+
+/*********************************** luks *********************************************/
+static ImageWriter &operator<<(ImageWriter &writer, const LUKS_MapperInfo &data)
+{
+    return writer << static_cast<int>(data.m_luksFs)
+                  << data.m_mountPoints
+                  << data.m_uuid
+                  << data.m_dmName
+                  << data.m_dmPath
+                  << data.m_busy
+                  << data.m_fsUsed
+                  << data.m_fsUnused
+                  << data.m_Size
+                  << data.m_devicePath
+                  << static_cast<int>(data.m_crypt)
+                  << data.m_luskType
+                  << data.m_mode
+                  << static_cast<int>(data.m_vgflag)
+                  << data.m_fsLimits
+                  << data.m_fileSystemLabel;
+}
+
+static ImageReader &operator>>(ImageReader &reader, LUKS_MapperInfo &data)
+{
+    int luksFs = 0;
+    int crypt = 0;
+    int vgFlag = 0;
+    reader >> luksFs
+           >> data.m_mountPoints
+           >> data.m_uuid
+           >> data.m_dmName
+           >> data.m_dmPath
+           >> data.m_busy
+           >> data.m_fsUsed
+           >> data.m_fsUnused
+           >> data.m_Size
+           >> data.m_devicePath
+           >> crypt
+           >> data.m_luskType
+           >> data.m_mode
+           >> vgFlag
+           >> data.m_fsLimits
+           >> data.m_fileSystemLabel;
+    data.m_luksFs = static_cast<FSType>(luksFs);
+    data.m_crypt = static_cast<CRYPT_CIPHER>(crypt);
+    data.m_vgflag = static_cast<LVMFlag>(vgFlag);
+    return reader;
+}
+
+static ImageWriter &operator<<(ImageWriter &writer, const LUKS_INFO &data)
+{
+    return writer << data.m_mapper
+                  << data.m_devicePath
+                  << static_cast<int>(data.m_crypt)
+                  << data.m_luksVersion
+                  << static_cast<int>(data.m_cryptErr)
+                  << data.m_dmUUID
+                  << data.m_tokenList
+                  << data.m_decryptErrCount
+                  << data.m_decryptErrorLastTime
+                  << data.m_decryptStr
+                  << data.isDecrypt
+                  << data.m_keySlots
+                  << data.m_Suspend
+                  << data.m_fileSystemLabel;
+}
+
+static ImageReader &operator>>(ImageReader &reader, LUKS_INFO &data)
+{
+    int crypt = 0;
+    int cryptErr = 0;
+    reader >> data.m_mapper
+           >> data.m_devicePath
+           >> crypt
+           >> data.m_luksVersion
+           >> cryptErr
+           >> data.m_dmUUID
+           >> data.m_tokenList
+           >> data.m_decryptErrCount
+           >> data.m_decryptErrorLastTime
+           >> data.m_decryptStr
+           >> data.isDecrypt
+           >> data.m_keySlots
+           >> data.m_Suspend
+           >> data.m_fileSystemLabel;
+    data.m_crypt = static_cast<CRYPT_CIPHER>(crypt);
+    data.m_cryptErr = static_cast<CRYPTError>(cryptErr);
+    return reader;
+}
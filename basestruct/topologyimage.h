@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TOPOLOGYIMAGE_H
+#define TOPOLOGYIMAGE_H
+#include "topologydelta.h"
+
+#include <QByteArray>
+
+/**
+ * @class TopologyImage
+ * @brief 拓扑增量的二进制镜像 用于通过共享内存(memfd)传递拓扑 避免逐层构造QDBusArgument
+ *        格式: 魔数(4) 版本号(4) 数据长度(8) 数据 全部为小端序 字符串为UTF-16码元
+ *        版本号不一致时读取失败 客户端应退回getTopology
+ */
+class TopologyImage
+{
+public:
+    static const quint32 Magic = 0x49544d44;    //"DMTI"
+    static const quint32 Version = 2;           //格式版本号 字段变化时递增
+
+    /**
+     * @brief 将拓扑增量编码为二进制镜像
+     * @param delta：拓扑增量
+     * @return 二进制镜像
+     */
+    static QByteArray encode(const TopologyDelta &delta);
+
+    /**
+     * @brief 从二进制镜像解码拓扑增量 直接读取内存 可用于mmap映射的数据
+     * @param data：镜像起始地址
+     * @param size：镜像长度
+     * @param delta：拓扑增量
+     * @return true成功false失败(魔数、版本号或长度不符)
+     */
+    static bool decode(const char *data, qint64 size, TopologyDelta &delta);
+};
+
+#endif // TOPOLOGYIMAGE_H
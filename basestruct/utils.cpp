@@ -27,10 +27,13 @@
 
 #include "lvmstruct.h"
 #include "utils.h"
+#include "commandexecutor.h"
 
 #include <sys/statvfs.h>
 
 #include <QProcess>
+#include <QFile>
+#include <QFileInfo>
 #include <QRegularExpression>
 #include <QUuid>
 #include <QDebug>
@@ -53,30 +56,31 @@ QString Utils::findProgramInPath(const QString &proName)
     return strOut;
 }
 
+QString Utils::getCommandStatKey(const QString &strCmd, const QStringList &strArg)
+{
+    //bash -c执行的命令以脚本中的第一个程序统计
+    QString program = strCmd;
+    if (program.endsWith("bash") && strArg.size() >= 2 && strArg.at(0) == "-c") {
+        program = strArg.at(1).trimmed().section(' ', 0, 0);
+    }
+
+    return QString("command:%1").arg(program.section('/', -1));
+}
+
 int Utils::executeCmdWithArtList(const QString &strCmd, const QStringList &strArg, QString &outPut, QString &error)
 {
-    qDebug() << "Utils::executeCmdWithArtList cmd:  " << strCmd;
-    qDebug() << "Utils::executeCmdWithArtList argList:  " << strArg;
-    QProcess proc;
-    // proc.open(QIODevice::ReadWrite);
-    //proc.start(strcmd, strarg);
-    proc.setProgram(strCmd);
-    proc.setArguments(strArg);
-    proc.start(QIODevice::ReadWrite);
-
-    proc.waitForFinished(-1);
-    outPut = proc.readAllStandardOutput().data();
-    error = proc.errorString();
-    int exitcode = proc.exitCode();
-
-    proc.close();
-    return exitcode;
+    CommandRequest request;
+    request.m_program = strCmd;
+    request.m_args = strArg;
+    CommandResult result = CommandExecutor::run(request);
+
+    outPut = result.m_output;
+    error = result.m_error;
+    return result.m_exitCode;
 }
 
 int Utils::executCmd(const QString &strCmd, QString &outPut, QString &error)
 {
-    qDebug() << "Utils::executCmd*******--------" << strCmd;
-
 //    qDebug() << "Utils::executCmd*******--------" << strCmd;
 //    QProcess proc;
 //    // proc.open(QIODevice::ReadWrite);
@@ -108,29 +112,31 @@ int Utils::executCmd(const QString &strCmd, QString &outPut, QString &error)
 
 int Utils::executWithPipeCmd(const QString &strCmd, QString &outPut, QString &error)
 {
-    QStringList argList;
-    argList << "-c" << strCmd;
-
-    return executeCmdWithArtList("/bin/bash", argList, outPut, error);
+    CommandRequest request;
+    request.m_program = "/bin/bash";
+    request.m_args << "-c" << strCmd;
+    //默认超时按程序名区分 bash -c执行的命令以脚本中的第一个程序取超时时间
+    request.m_timeout = CommandExecutor::defaultTimeout(strCmd.trimmed().section(' ', 0, 0));
+    CommandResult result = CommandExecutor::run(request);
+
+    outPut = result.m_output;
+    error = result.m_error;
+    return result.m_exitCode;
 }
 
 int Utils::executWithErrorCmd(const QString &strCmd, const QStringList &strArg, QString &outPut, QString &outPutError, QString &error)
 {
     qDebug() << "Utils::executWithErrorCmd cmd:  " << strCmd;
     qDebug() << "Utils::executWithErrorCmd argList:  " << strArg;
-    QProcess proc;
-
-    proc.setProgram(strCmd);
-    proc.setArguments(strArg);
-    proc.start(QIODevice::ReadWrite);
-
-    proc.waitForFinished(-1);
-    outPut = proc.readAllStandardOutput().data();
-    outPutError = proc.readAllStandardError();
-    error = proc.errorString();
-    int exitcode = proc.exitCode();
-    proc.close();
-    return exitcode;
+    CommandRequest request;
+    request.m_program = strCmd;
+    request.m_args = strArg;
+    CommandResult result = CommandExecutor::run(request);
+
+    outPut = result.m_output;
+    outPutError = result.m_errorOutput;
+    error = result.m_error;
+    return result.m_exitCode;
 }
 
 QString Utils::regexpLabel(const QString &strText, const QString &strPatter)
@@ -665,8 +671,36 @@ CRYPT_CIPHER Utils::getCipher(QString cipher)
 
 }
 
+QString Utils::readSysfs(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
 
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
 
+QString Utils::sysBlockPath(const QString &devicePath)
+{
+    QString name = QFileInfo(QFileInfo(devicePath).canonicalFilePath()).fileName();
+    QString sysPath = "/sys/class/block/" + name;
+    if (name.isEmpty() || !QFileInfo::exists(sysPath)) {
+        return QString();
+    }
 
+    return sysPath;
+}
 
+QString Utils::sysfsSerial(const QString &sysPath)
+{
+    QString serial = readSysfs(sysPath + "/device/wwid");
+    if (serial.isEmpty()) {
+        serial = readSysfs(sysPath + "/device/serial");
+    }
+    if (serial.isEmpty()) {
+        serial = readSysfs(sysPath + "/dm/uuid");
+    }
 
+    return serial;
+}
@@ -55,6 +55,14 @@ public:
      */
     static QString findProgramInPath(const QString &proName);
 
+    /**
+     * @brief 获取外部命令的耗时统计项
+     * @param strCmd：命令
+     * @param strArg：命令列表
+     * @return 统计项 command:程序名
+     */
+    static QString getCommandStatKey(const QString &strCmd, const QStringList &strArg);
+
     /**
      * @brief 定时执行命令列表
      * @param strCmd：命令
@@ -239,6 +247,27 @@ public:
      * @return 算法枚举
      */
     static CRYPT_CIPHER getCipher(QString cipher);
+
+    /**
+     * @brief 读取sysfs属性文件 去掉末尾换行
+     * @param path：属性文件路径
+     * @return 属性值 文件不存在或无法读取时返回空
+     */
+    static QString readSysfs(const QString &path);
+
+    /**
+     * @brief 获取磁盘在/sys/class/block下的目录 dm设备等路径为符号链接 以实际设备名查找
+     * @param devicePath：磁盘路径
+     * @return sysfs目录 磁盘不存在时返回空
+     */
+    static QString sysBlockPath(const QString &devicePath);
+
+    /**
+     * @brief 获取磁盘序列号 依次取sysfs中的wwid、serial、dm uuid
+     * @param sysPath：磁盘的sysfs目录
+     * @return 序列号 都不存在时返回空
+     */
+    static QString sysfsSerial(const QString &sysPath);
 };
 
 #endif // UTILS_H
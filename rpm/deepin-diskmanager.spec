@@ -18,6 +18,9 @@ BuildRequires:  qt5-qtbase-private-devel
 BuildRequires:  parted-devel
 BuildRequires:  dde-qt-dbus-factory-devel
 BuildRequires:  polkit-qt5-1-devel
+BuildRequires:  systemd-devel
+BuildRequires:  libblkid-devel
+BuildRequires:  cryptsetup-devel
 BuildRequires:  gtest-devel
 BuildRequires:  gmock-devel
 BuildRequires:  qt5-qtsvg-devel
@@ -52,9 +55,6 @@ export PATH=%{_qt5_bindir}:$PATH
 /usr/lib/libbasestruct.a
 /usr/lib/libddmlog.a
 /usr/lib/deepin-daemon/deepin-diskmanager-service
-/lib/udev/rules.d/99-diskmanager.rules
-%{_libexecdir}/openconnect/USBadd.sh
-%{_libexecdir}/openconnect/USBremove.sh
 %{_datadir}/dbus-1/system-services/com.deepin.diskmanager.service
 %{_datadir}/dbus-1/system.d/com.deepin.diskmanager.conf
 %{_datadir}/polkit-1/actions/com.deepin.diskmanager.policy
@@ -28,28 +28,40 @@
 #include "diskmanagerservice.h"
 
 #include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
 #include <QDebug>
 
 #include <unistd.h>
 
 namespace DiskManager {
 
+static const QString DiskManagerPath = "/com/deepin/diskmanager";
+static const QString DiskManagerInterface = "com.deepin.diskmanager";
+
 DiskManagerService::DiskManagerService(QObject *parent)
     : QObject(parent)
     , m_partedcore(new PartedCore(this))
+    , m_udevMonitor(new UdevMonitor(this))
+    , m_watcher(new Watcher(this))
 {
     initConnection();
+    m_partedcore->init();
+    m_udevMonitor->start();
 }
 
 void DiskManagerService::initConnection()
 {
     connect(m_partedcore, &PartedCore::updateDeviceInfo, this, &DiskManagerService::updateDeviceInfo);
     connect(m_partedcore, &PartedCore::updateLUKSInfo, this, &DiskManagerService::updateLUKSInfo);
+    connect(m_partedcore, &PartedCore::updateTopologyDelta, this, &DiskManagerService::updateTopologyDelta);
+    connect(m_partedcore, &PartedCore::updateTopologyImage, this, &DiskManagerService::onUpdateTopologyImage);
     connect(m_partedcore, &PartedCore::deletePartitionMessage, this, &DiskManagerService::deletePartition);
     connect(m_partedcore, &PartedCore::hidePartitionInfo, this, &DiskManagerService::hidePartitionInfo);
     connect(m_partedcore, &PartedCore::showPartitionInfo, this, &DiskManagerService::showPartitionInfo);
     connect(m_partedcore, &PartedCore::usbUpdated, this, &DiskManagerService::usbUpdated);
-    connect(m_partedcore, &PartedCore::checkBadBlocksCountInfo, this, &DiskManagerService::checkBadBlocksCountInfo);
+    connect(m_partedcore, &PartedCore::checkBadBlocksProgress, this, &DiskManagerService::checkBadBlocksProgress);
+    connect(m_partedcore, &PartedCore::checkBadSectorsRange, this, &DiskManagerService::checkBadSectorsRange);
     connect(m_partedcore, &PartedCore::fixBadBlocksInfo, this, &DiskManagerService::fixBadBlocksInfo);
     connect(m_partedcore, &PartedCore::checkBadBlocksFinished, this, &DiskManagerService::checkBadBlocksFinished);
     connect(m_partedcore, &PartedCore::fixBadBlocksFinished, this, &DiskManagerService::fixBadBlocksFinished);
@@ -63,6 +75,10 @@ void DiskManagerService::initConnection()
     connect(m_partedcore, &PartedCore::deCryptMessage, this, &DiskManagerService::deCryptMessage);
     connect(m_partedcore, &PartedCore::createFailedMessage, this, &DiskManagerService::createFailedMessage);
     connect(this, &DiskManagerService::getAllDeviceInfomation, this, &DiskManagerService::onGetAllDeviceInfomation);
+    connect(m_udevMonitor, &UdevMonitor::blockDeviceChanged, m_partedcore, &PartedCore::onBlockDeviceChanged);
+    //前端启动过又退出了(可能是从dock栏强杀) 服务随之退出
+    connect(m_watcher, &Watcher::allClientsQuit, this, &DiskManagerService::Quit);
+    connect(m_watcher, &Watcher::clientQuit, this, &DiskManagerService::onClientQuit);
 }
 
 void DiskManagerService::Quit()
@@ -88,6 +104,9 @@ void DiskManagerService::Start()
 {
     QString msg = "DiskManagerService::Start called";
     Q_EMIT MessageReport(msg);
+    if (calledFromDBus()) {
+        m_watcher->addClient(message().service());
+    }
 }
 
 DeviceInfo DiskManagerService::getDeviceinfo()
@@ -213,6 +232,10 @@ bool DiskManagerService::onCheckBadBlocksTime(const QString &devicePath, int blo
 {
     return m_partedcore->checkBadBlocks(devicePath, blockStart, blockEnd, checkTime, checkSize, flag);
 }
+bool DiskManagerService::onResumeCheckBadBlocks(const QString &devicePath)
+{
+    return m_partedcore->resumeCheckBadBlocks(devicePath);
+}
 bool DiskManagerService::onFixBadBlocks(const QString &devicePath, QStringList badBlocksList, int checkSize, int flag)
 {
     return m_partedcore->fixBadBlocks(devicePath, badBlocksList, checkSize, flag);
@@ -283,4 +306,81 @@ int DiskManagerService::test()
 {
     return m_partedcore->test();
 }
+
+void DiskManagerService::setBadBlocksQueueDepth(int depth)
+{
+    m_partedcore->setBadBlocksQueueDepth(depth);
+}
+
+void DiskManagerService::setBadBlocksAdaptiveScan(bool adaptive)
+{
+    m_partedcore->setBadBlocksAdaptiveScan(adaptive);
+}
+
+QStringList DiskManagerService::getBadBlocksLatency()
+{
+    return m_partedcore->getBadBlocksLatency();
+}
+
+void DiskManagerService::setProbeThreadCount(int count)
+{
+    m_partedcore->setProbeThreadCount(count);
+}
+
+int DiskManagerService::getProbeThreadCount()
+{
+    return m_partedcore->getProbeThreadCount();
+}
+
+QStringList DiskManagerService::getProbeDeviceTime()
+{
+    return m_partedcore->getProbeDeviceTime();
+}
+
+QStringList DiskManagerService::getProbeStatistics()
+{
+    return m_partedcore->getProbeStatistics();
+}
+
+TopologyDelta DiskManagerService::getTopology()
+{
+    return m_partedcore->getTopology();
+}
+
+QDBusUnixFileDescriptor DiskManagerService::getTopologyImage()
+{
+    return m_partedcore->getTopologyImage();
+}
+
+void DiskManagerService::setTopologyImageEnabled(bool enable)
+{
+    //按调用方记录 一个客户端开启不影响其他客户端(包括不认识该信号的旧客户端)
+    if (!calledFromDBus()) {
+        return;
+    }
+
+    QString client = message().service();
+    if (enable) {
+        m_topologyImageClients.insert(client);
+    } else {
+        m_topologyImageClients.remove(client);
+    }
+    m_partedcore->setTopologyImageEnabled(!m_topologyImageClients.isEmpty());
+}
+
+void DiskManagerService::onUpdateTopologyImage(const QDBusUnixFileDescriptor &image)
+{
+    foreach (const QString &client, m_topologyImageClients) {
+        QDBusMessage signal = QDBusMessage::createTargetedSignal(client, DiskManagerPath, DiskManagerInterface, "updateTopologyImage");
+        signal << QVariant::fromValue(image);
+        QDBusConnection::systemBus().send(signal);
+    }
+}
+
+void DiskManagerService::onClientQuit(const QString &service)
+{
+    if (m_topologyImageClients.remove(service)) {
+        m_partedcore->setTopologyImageEnabled(!m_topologyImageClients.isEmpty());
+    }
+}
 } // namespace DiskManager
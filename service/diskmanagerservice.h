@@ -29,11 +29,14 @@
 #define DISKMANAGERSERVICE_H
 #include "diskoperation/partedcore.h"
 #include "diskoperation/thread.h"
+#include "diskoperation/udevmonitor.h"
+#include "watcher.h"
 //#include "PolicyKitHelper.h"
 
 #include <QObject>
 #include <QDBusContext>
 #include <QScopedPointer>
+#include <QSet>
 
 namespace DiskManager {
 
@@ -83,6 +86,19 @@ Q_SIGNALS:
      */
     Q_SCRIPTABLE void updateLUKSInfo(const LUKSMap &infomap);
 
+    /**
+     * @brief 拓扑增量信号 每次刷新后只发送相对上一版本变化的设备 客户端版本号不一致时应调用getTopology重新同步
+     * @param delta：拓扑增量
+     */
+    Q_SCRIPTABLE void updateTopologyDelta(const TopologyDelta &delta);
+
+    /**
+     * @brief 拓扑增量信号 只定向发送给调用过setTopologyImageEnabled(true)的客户端 这些客户端应忽略updateTopologyDelta
+     *        增量以二进制镜像(TopologyImage)存放于只读密封的memfd中 客户端mmap后直接解析
+     * @param image：拓扑增量镜像
+     */
+    Q_SCRIPTABLE void updateTopologyImage(const QDBusUnixFileDescriptor &image);
+
     /**
      * @brief 卸载状态信号
      * @param umountMessage:卸载信息
@@ -113,13 +129,20 @@ Q_SIGNALS:
     Q_SCRIPTABLE void usbUpdated();
 
     /**
-     * @brief 坏道检测检测信息信号
-     * @param cylinderNumber：检测柱面号
-     * @param cylinderTimeConsuming：柱面耗时
-     * @param cylinderStatus：柱面状态
-     * @param cylinderErrorInfo：柱面错误信息
+     * @brief 坏道检测批量进度信号 检测过程中最多每100ms发送一次
+     * @param devicePath：设备路径
+     * @param progress：检测结果 每项依次为起始扇区、扇区个数、耗时(us)、状态 字段见BadBlocksProgressField
+     */
+    Q_SCRIPTABLE void checkBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
+
+    /**
+     * @brief 坏道扇区范围信号(自适应检测) 从检查点继续检测时先重新发送检查点中保存的范围
+     * @param devicePath：设备路径
+     * @param startSector：起始逻辑扇区
+     * @param endSector：结束逻辑扇区 包含在范围内
+     * @param errorInfo：错误信息
      */
-    Q_SCRIPTABLE void checkBadBlocksCountInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+    Q_SCRIPTABLE void checkBadSectorsRange(const QString &devicePath, qint64 startSector, qint64 endSector, const QString &errorInfo);
 
     /**
      * @brief 坏道检测完成信号
@@ -197,7 +220,7 @@ public Q_SLOTS:
 //    */
 //    Q_SCRIPTABLE void Start(qint64 applicationPid);
     /**
-    *@brief 启动服务
+    *@brief 启动服务 记录调用方 调用过Start的前端全部退出后服务退出
     */
     Q_SCRIPTABLE void Start();
 
@@ -380,6 +403,13 @@ public Q_SLOTS:
      */
     Q_SCRIPTABLE bool onCheckBadBlocksTime(const QString &devicePath, int blockStart, int blockEnd, const QString &checkTime, int checkSize, int flag);
 
+    /**
+     * @brief 从检查点继续坏道检测 已检测的柱面不再重复检测
+     * @param devicePath：设备信息路径
+     * @return true开始检测false检查点不存在或已全部检测
+     */
+    Q_SCRIPTABLE bool onResumeCheckBadBlocks(const QString &devicePath);
+
     /**
      * @brief 坏道修复
      * @param devicePath：设备信息路径
@@ -489,6 +519,67 @@ public Q_SLOTS:
      */
     Q_SCRIPTABLE int test();
 
+    /**
+     * @brief 设置坏道检测的并发读取数 下次开始检测时生效
+     * @param depth：并发读取数 小于等于0时恢复为默认值
+     */
+    Q_SCRIPTABLE void setBadBlocksQueueDepth(int depth);
+
+    /**
+     * @brief 设置坏道检测是否使用自适应方式 下次开始检测时生效
+     * @param adaptive：true健康区域按大块读取 出错时二分定位到扇区 false逐柱面读取
+     */
+    Q_SCRIPTABLE void setBadBlocksAdaptiveScan(bool adaptive);
+
+    /**
+     * @brief 获取最近一次坏道检测的读取耗时统计 每次读取以单调时钟计时 按对数刻度统计
+     * @return 第一行为整个设备的p50、p99、最大值及各桶样本数 其后检测范围等分为256个区域 每个区域一行
+     */
+    Q_SCRIPTABLE QStringList getBadBlocksLatency();
+
+    /**
+     * @brief 设置并行探测设备的线程数
+     * @param count：线程数 小于等于0时恢复为默认值
+     */
+    Q_SCRIPTABLE void setProbeThreadCount(int count);
+
+    /**
+     * @brief 获取并行探测设备的线程数
+     * @return 线程数
+     */
+    Q_SCRIPTABLE int getProbeThreadCount();
+
+    /**
+     * @brief 获取最近一次刷新每个设备的探测耗时
+     * @return 每个设备的耗时信息
+     */
+    Q_SCRIPTABLE QStringList getProbeDeviceTime();
+
+    /**
+     * @brief 获取最近32次刷新的耗时统计 包括各阶段、各设备及各外部命令
+     * @return 每个统计项一行 包括次数、最小值、中位数、p99及最大值 外部命令另有执行次数、失败及超时次数
+     */
+    Q_SCRIPTABLE QStringList getProbeStatistics();
+
+    /**
+     * @brief 获取全量拓扑 客户端版本号过期时用于重新同步
+     *        服务启动后首次探测完成前返回上次保存的缓存拓扑 m_stale为true 探测完成后以增量更新
+     * @return 全量拓扑(带版本号)
+     */
+    Q_SCRIPTABLE TopologyDelta getTopology();
+
+    /**
+     * @brief 获取全量拓扑的二进制镜像 与getTopology内容一致 通过unix fd传递
+     * @return 只读密封的memfd
+     */
+    Q_SCRIPTABLE QDBusUnixFileDescriptor getTopologyImage();
+
+    /**
+     * @brief 设置调用方的拓扑下发方式 按调用方在总线上的唯一名称分别记录 默认使用updateTopologyDelta
+     * @param enable：true使用updateTopologyImage false使用updateTopologyDelta
+     */
+    Q_SCRIPTABLE void setTopologyImageEnabled(bool enable);
+
 
 private:
     /**
@@ -502,8 +593,23 @@ signals:
 private slots:
     void onGetAllDeviceInfomation();
 
+    /**
+     * @brief 将拓扑增量镜像定向发送给选择二进制镜像的客户端
+     * @param image：拓扑增量镜像
+     */
+    void onUpdateTopologyImage(const QDBusUnixFileDescriptor &image);
+
+    /**
+     * @brief 前端退出后不再向其发送拓扑镜像
+     * @param service：前端唯一名称
+     */
+    void onClientQuit(const QString &service);
+
 private:
     PartedCore *m_partedcore;  //磁盘操作类对象
+    UdevMonitor *m_udevMonitor; //块设备热插拔监听对象
+    Watcher *m_watcher;         //前端进程监测对象
+    QSet<QString> m_topologyImageClients;   //使用二进制镜像接收拓扑的客户端唯一名称
 };
 
 } // namespace DiskManager
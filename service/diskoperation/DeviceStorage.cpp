@@ -1,5 +1,10 @@
 #include "DeviceStorage.h"
+#include "devicequerycache.h"
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+#include <libudev.h>
 
 namespace DiskManager {
 
@@ -255,11 +260,7 @@ void DeviceStorage::setAttribute(const QMap<QString, QString> &mapInfo, const QS
 
 bool DeviceStorage::getDiskInfoFromHwinfo(const QString &devicePath)
 {
-    QString cmd = QString("hwinfo --disk --only %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString outPut = proc.readAllStandardOutput();
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::Hwinfo);
 
     QMap<QString, QString> mapInfo;
 
@@ -317,10 +318,7 @@ void DeviceStorage::getMapInfoFromInput(const QString &info, QMap<QString, QStri
 
 bool DeviceStorage::getDiskInfoFromLshw(const QString &devicePath)
 {
-    QProcess proc;
-    proc.start("sudo lshw -C disk");
-    proc.waitForFinished(-1);
-    QString outPut  = proc.readAllStandardOutput();
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::Lshw);
 
     QStringList list = outPut.split("*-disk\n");
 
@@ -387,13 +385,8 @@ void DeviceStorage::getMapInfoFromLshw(const QString &info, QMap<QString, QStrin
 
 bool DeviceStorage::getDiskInfoFromLsblk(const QString &devicePath)
 {
-    QString cmd = QString("lsblk -d -o name,rota %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-
     QMap<QString, QString> mapInfo;
-    QString outPut = proc.readAllStandardOutput();
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::Lsblk);
 
     loadLsblkInfo(outPut, mapInfo);
 
@@ -423,19 +416,7 @@ void DeviceStorage::loadLsblkInfo(const QString &info, QMap<QString, QString> &m
 
 bool DeviceStorage::getDiskInfoFromSmartCtl(const QString &devicePath)
 {
-    QString cmd = QString("smartctl --all %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString outPut  = proc.readAllStandardOutput();
-
-    if (outPut.contains("Please specify device type with the -d option")) {
-        QString cmd = QString("smartctl --all -d sat %1").arg(devicePath);
-        QProcess proc;
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        outPut = proc.readAllStandardOutput();
-    }
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::SmartAll);
 
     QMap<QString, QString> mapInfo;
 
@@ -448,19 +429,7 @@ bool DeviceStorage::getDiskInfoFromSmartCtl(const QString &devicePath)
 
 void DeviceStorage::getDiskInfoModel(const QString &devicePath, QString &model)
 {
-    QString cmd = QString("smartctl --all %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString outPut  = proc.readAllStandardOutput();
-
-    if (outPut.contains("Please specify device type with the -d option")) {
-        QString cmd = QString("smartctl --all -d sat %1").arg(devicePath);
-        QProcess proc;
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        outPut = proc.readAllStandardOutput();
-    }
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::SmartAll);
     QStringList infoList = outPut.split("\n");
     for (int i = 0; i < infoList.size(); i++) {
         if(infoList[i].contains("Device Model:")){
@@ -470,9 +439,7 @@ void DeviceStorage::getDiskInfoModel(const QString &devicePath, QString &model)
         }
     }
 
-    proc.start("sudo lshw -C disk");
-    proc.waitForFinished(-1);
-    outPut  = proc.readAllStandardOutput();
+    outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::Lshw);
 
     QStringList tempList = outPut.split("*-disk\n");
 
@@ -498,19 +465,10 @@ QString DeviceStorage::getDiskInfoMediaType(const QString &devicePath)
 {
     QStringList deviceList = devicePath.split("/");
     QString device = deviceList[deviceList.size()-1];
-    QString value;
-    QString cmd = QString("cat /sys/block/%1/queue/rotational").arg(device);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString outPut = proc.readAllStandardOutput().trimmed();
-    value = outPut;
+    QString value = readSysfsAttribute(QString("/sys/block/%1/queue/rotational").arg(device));
 
     if("1" == value){
-        cmd = QString("smartctl -i %1").arg(devicePath);
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        outPut = proc.readAllStandardOutput();
+        QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::SmartInfo);
         if(outPut.contains("Solid State Device")){
             value = "0";
         }
@@ -526,11 +484,7 @@ QString DeviceStorage::getDiskInfoMediaType(const QString &devicePath)
 
 void DeviceStorage::getDiskInfoInterface(const QString &devicePath, QString &interface, QString &model)
 {
-    QString cmd = QString("hwinfo --disk --only %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString outPut = proc.readAllStandardOutput().trimmed();
+    QString outPut = DeviceQueryCache::query(devicePath, DeviceQueryCache::Hwinfo).trimmed();
     QStringList outPutList = outPut.split("(");
     interface = outPutList[outPutList.size() - 1].split(" ")[0];
     outPutList = outPut.split("\n");
@@ -547,6 +501,161 @@ void DeviceStorage::getDiskInfoInterface(const QString &devicePath, QString &int
     return;
 }
 
+bool DeviceStorage::getDiskInfoFromSysfs(const QString &devicePath)
+{
+    QString deviceName = QFileInfo(devicePath).fileName();
+    QString sysPath = QString("/sys/class/block/%1").arg(deviceName);
+    if (deviceName.isEmpty() || !QFile::exists(sysPath)) {
+        return false;
+    }
+
+    QMap<QString, QString> mapInfo;
+    getMapInfoFromUdev(deviceName, mapInfo);
+
+    // udev中的型号为ata identify的完整型号 sysfs中scsi型号最多16个字符 优先使用udev
+    m_model = decodeUdevString(mapInfo.value("ID_MODEL_ENC"));
+    if (m_model.isEmpty()) {
+        m_model = readSysfsAttribute(sysPath + "/device/model");
+    }
+
+    m_vendor = decodeUdevString(mapInfo.value("ID_VENDOR_ENC"));
+    if (m_vendor.isEmpty()) {
+        m_vendor = readSysfsAttribute(sysPath + "/device/vendor");
+    }
+
+    m_serialNumber = mapInfo.value("ID_SERIAL_SHORT");
+    if (m_serialNumber.isEmpty()) {
+        m_serialNumber = readSysfsAttribute(sysPath + "/device/serial");
+    }
+
+    // nvme为firmware_rev scsi为rev
+    m_firmwareVersion = mapInfo.value("ID_REVISION");
+    if (m_firmwareVersion.isEmpty()) {
+        m_firmwareVersion = readSysfsAttribute(sysPath + "/device/firmware_rev");
+    }
+    if (m_firmwareVersion.isEmpty()) {
+        m_firmwareVersion = readSysfsAttribute(sysPath + "/device/rev");
+    }
+    m_version = m_firmwareVersion;
+
+    // size单位固定为512字节扇区 与smartctl一致按十进制单位显示
+    double bytes = readSysfsAttribute(sysPath + "/size").toDouble() * 512;
+    if (bytes > 0) {
+        const char *units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
+        int index = 0;
+        while (bytes >= 1000 && index < 5) {
+            bytes /= 1000;
+            ++index;
+        }
+        m_size = QString("%1 %2").arg(QString::number(bytes, 'g', 3)).arg(units[index]);
+    }
+
+    m_interface = getSysfsInterface(sysPath, mapInfo);
+
+    // 部分ssd(包括经usb转接的)上报为旋转介质 smartctl据ata identify中的转速判断是否为Solid State Device
+    // udev已读取该转速时直接使用 否则留空由调用方调用smartctl
+    QString rotational = readSysfsAttribute(sysPath + "/queue/rotational");
+    QString rotationRate = mapInfo.value("ID_ATA_ROTATION_RATE_RPM");
+    if (rotational == "0" || rotationRate == "0") {
+        m_mediaType = "SSD";
+    } else if (rotational == "1" && rotationRate.toInt() > 0) {
+        m_mediaType = "HDD";
+    }
+
+    return !m_model.isEmpty() && !m_mediaType.isEmpty() && !m_interface.isEmpty();
+}
+
+QString DeviceStorage::getDiskInfoSerialNumber(const QString &devicePath)
+{
+    QString deviceName = QFileInfo(devicePath).fileName();
+    if (deviceName.isEmpty()) {
+        return QString();
+    }
+
+    QMap<QString, QString> mapInfo;
+    getMapInfoFromUdev(deviceName, mapInfo);
+    QString serialNumber = mapInfo.value("ID_SERIAL_SHORT");
+    if (serialNumber.isEmpty()) {
+        serialNumber = readSysfsAttribute(QString("/sys/class/block/%1/device/serial").arg(deviceName));
+    }
+
+    return serialNumber;
+}
+
+QString DeviceStorage::readSysfsAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    QString value = QString::fromLocal8Bit(file.readAll()).trimmed();
+    file.close();
+    return value;
+}
+
+void DeviceStorage::getMapInfoFromUdev(const QString &deviceName, QMap<QString, QString> &mapInfo)
+{
+    struct udev *udev = udev_new();
+    if (udev == nullptr) {
+        return;
+    }
+
+    struct udev_device *dev = udev_device_new_from_subsystem_sysname(udev, "block", deviceName.toLocal8Bit().constData());
+    if (dev != nullptr) {
+        struct udev_list_entry *entry = nullptr;
+        udev_list_entry_foreach(entry, udev_device_get_properties_list_entry(dev)) {
+            mapInfo.insert(QString::fromLatin1(udev_list_entry_get_name(entry)),
+                           QString::fromLocal8Bit(udev_list_entry_get_value(entry)));
+        }
+        udev_device_unref(dev);
+    }
+
+    udev_unref(udev);
+}
+
+QString DeviceStorage::decodeUdevString(const QString &value)
+{
+    QByteArray source = value.toLatin1();
+    QByteArray decoded;
+    for (int i = 0; i < source.size(); ++i) {
+        if (source.at(i) == '\\' && i + 3 < source.size() && source.at(i + 1) == 'x') {
+            bool ok = false;
+            char ch = static_cast<char>(source.mid(i + 2, 2).toInt(&ok, 16));
+            if (ok) {
+                decoded.append(ch);
+                i += 3;
+                continue;
+            }
+        }
+        decoded.append(source.at(i));
+    }
+
+    return QString::fromUtf8(decoded).trimmed();
+}
+
+QString DeviceStorage::getSysfsInterface(const QString &sysPath, const QMap<QString, QString> &mapInfo)
+{
+    QString bus = mapInfo.value("ID_BUS");
+    QString devPath = QFileInfo(sysPath).canonicalFilePath();
+
+    if (bus == "usb" || devPath.contains("/usb")) {
+        return "USB";
+    } else if (bus == "nvme" || devPath.contains("/nvme")) {
+        return "NVMe";
+    } else if (bus == "ata") {
+        return mapInfo.value("ID_ATA_SATA") == "1" ? "SATA" : "ATA";
+    } else if (devPath.contains("/mmc")) {
+        return "MMC";
+    } else if (devPath.contains("/virtio")) {
+        return "VirtIO";
+    } else if (bus == "scsi") {
+        return "SCSI";
+    }
+
+    return QString();
+}
+
 void DeviceStorage::getMapInfoFromSmartctl(QMap<QString, QString> &mapInfo, const QString &info, const QString &ch)
 {
     QString indexName;
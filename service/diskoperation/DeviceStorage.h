@@ -30,6 +30,12 @@ public:
     /**@brief:获取当前磁盘接口信息*/
     void getDiskInfoInterface(const QString &devicePath, QString &interface, QString &model);
 
+    /**@brief:从sysfs及udev属性中读取磁盘信息 不创建子进程 型号、介质类型、接口均获取到时返回true*/
+    bool getDiskInfoFromSysfs(const QString &devicePath);
+
+    /**@brief:从udev属性ID_SERIAL_SHORT或sysfs中读取磁盘序列号 不创建子进程 读取不到时返回空*/
+    QString getDiskInfoSerialNumber(const QString &devicePath);
+
 
 private:
     void getMapInfoFromInput(const QString &info, QMap<QString, QString> &mapInfo);
@@ -65,6 +71,18 @@ private:
 
     /**@brief:将属性设置到成员变量*/
     void setAttribute(const QMap<QString, QString> &mapInfo, const QString &key, QString &variable, bool overwrite = true);
+
+    /**@brief:读取sysfs属性文件内容*/
+    QString readSysfsAttribute(const QString &path);
+
+    /**@brief:读取udev数据库中的设备属性*/
+    void getMapInfoFromUdev(const QString &deviceName, QMap<QString, QString> &mapInfo);
+
+    /**@brief:解码udev属性中\xNN形式的转义字符*/
+    QString decodeUdevString(const QString &value);
+
+    /**@brief:根据udev总线属性及sysfs设备路径获取接口类型*/
+    QString getSysfsInterface(const QString &sysPath, const QMap<QString, QString> &mapInfo);
 public:
     QString               m_model;              //<! 【型号】1
     QString               m_vendor;             //<! 【制造商】2 //有可能会没有
@@ -0,0 +1,189 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "badblockcheckpoint.h"
+#include "utils.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+
+namespace DiskManager {
+
+static const QString CheckpointDir = "/var/cache/deepin-diskmanager/badblocks";
+
+/**
+ * @brief 获取检查点文件路径 序列号中文件名不允许的字符替换为下划线
+ */
+static QString checkpointFile(const QString &serial)
+{
+    QString name = serial;
+    name.replace(QRegularExpression("[^A-Za-z0-9._-]"), "_");
+    return CheckpointDir + "/" + name + ".checkpoint";
+}
+
+QDataStream &operator<<(QDataStream &stream, const BadBlockScanner::SectorRange &range)
+{
+    return stream << range.m_start << range.m_end;
+}
+
+QDataStream &operator>>(QDataStream &stream, BadBlockScanner::SectorRange &range)
+{
+    return stream >> range.m_start >> range.m_end;
+}
+
+QString BadBlockCheckpoint::deviceSerial(const QString &devicePath)
+{
+    QString sysPath = Utils::sysBlockPath(devicePath);
+    if (sysPath.isEmpty()) {
+        return QString();
+    }
+
+    QString serial = Utils::sysfsSerial(sysPath);
+    if (serial.isEmpty()) {
+        serial = QFileInfo(sysPath).fileName() + "-" + Utils::readSysfs(sysPath + "/size");
+    }
+
+    return serial;
+}
+
+bool BadBlockCheckpoint::load(const QString &serial, BadBlockCheckpoint &checkpoint)
+{
+    if (serial.isEmpty()) {
+        return false;
+    }
+
+    QFile file(checkpointFile(serial));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != Magic || version != Version) {
+        qDebug() << __FUNCTION__ << "unknown bad blocks checkpoint format";
+        return false;
+    }
+
+    BadBlockCheckpoint result;
+    stream >> result.m_serial >> result.m_devicePath >> result.m_method >> result.m_blockStart >> result.m_blockEnd
+           >> result.m_checkCount >> result.m_checkTime >> result.m_checkSize >> result.m_adaptive >> result.m_sectorSize
+           >> result.m_covered >> result.m_bad >> result.m_slow;
+    if (stream.status() != QDataStream::Ok || result.m_serial != serial || result.m_sectorSize <= 0 || result.m_checkSize <= 0) {
+        qDebug() << __FUNCTION__ << "bad blocks checkpoint is corrupted";
+        return false;
+    }
+
+    checkpoint = result;
+    return true;
+}
+
+bool BadBlockCheckpoint::save(const BadBlockCheckpoint &checkpoint)
+{
+    if (checkpoint.m_serial.isEmpty()) {
+        return false;
+    }
+
+    if (!QDir().mkpath(CheckpointDir)) {
+        qDebug() << __FUNCTION__ << "failed to create" << CheckpointDir;
+        return false;
+    }
+
+    QSaveFile file(checkpointFile(checkpoint.m_serial));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << __FUNCTION__ << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << Magic << Version << checkpoint.m_serial << checkpoint.m_devicePath << checkpoint.m_method
+           << checkpoint.m_blockStart << checkpoint.m_blockEnd << checkpoint.m_checkCount << checkpoint.m_checkTime
+           << checkpoint.m_checkSize << checkpoint.m_adaptive << checkpoint.m_sectorSize
+           << checkpoint.m_covered << checkpoint.m_bad << checkpoint.m_slow;
+    if (!file.commit()) {
+        qDebug() << __FUNCTION__ << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool BadBlockCheckpoint::sameParameters(const BadBlockCheckpoint &other) const
+{
+    return m_serial == other.m_serial && m_method == other.m_method && m_blockEnd == other.m_blockEnd
+           && m_checkSize == other.m_checkSize && m_sectorSize == other.m_sectorSize
+           && (m_method == METHOD_COUNT ? m_checkCount == other.m_checkCount : m_checkTime == other.m_checkTime);
+}
+
+void BadBlockCheckpoint::addCoveredRegions(Sector firstRegion, int count)
+{
+    if (count <= 0 || m_checkSize <= 0 || m_sectorSize <= 0) {
+        return;
+    }
+
+    addRange(m_covered, firstRegion * m_checkSize / m_sectorSize, ((firstRegion + count) * m_checkSize - 1) / m_sectorSize);
+}
+
+void BadBlockCheckpoint::addRange(QVector<BadBlockScanner::SectorRange> &ranges, Sector start, Sector end)
+{
+    //跳过结束位置在新范围之前且不相邻的范围
+    int i = 0;
+    while (i < ranges.size() && ranges.at(i).m_end + 1 < start) {
+        i++;
+    }
+
+    BadBlockScanner::SectorRange merged;
+    merged.m_start = start;
+    merged.m_end = end;
+    while (i < ranges.size() && ranges.at(i).m_start <= end + 1) {
+        merged.m_start = qMin(merged.m_start, ranges.at(i).m_start);
+        merged.m_end = qMax(merged.m_end, ranges.at(i).m_end);
+        ranges.remove(i);
+    }
+    ranges.insert(i, merged);
+}
+
+Sector BadBlockCheckpoint::nextRegion() const
+{
+    Sector region = m_blockStart;
+    if (m_checkSize <= 0 || m_sectorSize <= 0) {
+        return region;
+    }
+
+    foreach (const BadBlockScanner::SectorRange &range, m_covered) {
+        Sector first = region * m_checkSize / m_sectorSize;
+        if (range.m_start <= first && range.m_end >= first) {
+            //下一个柱面为第一个未检测扇区所在柱面
+            region = (range.m_end + 1) * m_sectorSize / m_checkSize;
+        }
+    }
+
+    return region;
+}
+
+} // namespace DiskManager
@@ -0,0 +1,118 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BADBLOCKCHECKPOINT_H
+#define BADBLOCKCHECKPOINT_H
+#include "badblockscanner.h"
+
+#include <QString>
+#include <QVector>
+
+namespace DiskManager {
+
+/**
+ * @class BadBlockCheckpoint
+ * @brief 坏道检测检查点 按磁盘序列号保存检测参数、已检测的扇区范围及检测出的坏扇区和慢扇区范围
+ *        服务重启或界面退出后可从检查点继续检测 已检测的范围不再重复读取
+ */
+class BadBlockCheckpoint
+{
+public:
+    /**
+     * @enum Method
+     * @brief 检测方式
+     */
+    enum Method {
+        METHOD_COUNT = 0,   //检测次数方式
+        METHOD_TIME         //超时时间方式
+    };
+
+    /**
+     * @brief 获取磁盘序列号 依次取sysfs中的wwid、serial、dm uuid 都不存在时以设备名和扇区数代替
+     * @param devicePath：磁盘路径
+     * @return 磁盘序列号 磁盘不存在时返回空
+     */
+    static QString deviceSerial(const QString &devicePath);
+
+    /**
+     * @brief 读取检查点
+     * @param serial：磁盘序列号
+     * @param checkpoint：检查点
+     * @return true读取成功false不存在或已损坏
+     */
+    static bool load(const QString &serial, BadBlockCheckpoint &checkpoint);
+
+    /**
+     * @brief 保存检查点 先写临时文件再替换 避免中途断电损坏检查点
+     * @param checkpoint：检查点
+     * @return true保存成功false失败
+     */
+    static bool save(const BadBlockCheckpoint &checkpoint);
+
+    /**
+     * @brief 检测参数是否一致 一致时可在此检查点上继续检测
+     * @param other：另一个检查点
+     * @return true一致false不一致
+     */
+    bool sameParameters(const BadBlockCheckpoint &other) const;
+
+    /**
+     * @brief 添加已检测的柱面
+     * @param firstRegion：起始柱面号
+     * @param count：柱面个数
+     */
+    void addCoveredRegions(Sector firstRegion, int count);
+
+    /**
+     * @brief 添加扇区范围 与已有范围重叠或相邻时合并
+     * @param ranges：扇区范围集合 按起始扇区排序
+     * @param start：起始扇区
+     * @param end：结束扇区 包含在范围内
+     */
+    static void addRange(QVector<BadBlockScanner::SectorRange> &ranges, Sector start, Sector end);
+
+    /**
+     * @brief 获取下一个需要检测的柱面号 从开始柱面起跳过已完整检测的柱面
+     * @return 柱面号 大于结束柱面时表示已全部检测
+     */
+    Sector nextRegion() const;
+
+public:
+    QString m_serial;                                   //磁盘序列号
+    QString m_devicePath;                               //设备路径
+    int m_method = METHOD_COUNT;                        //检测方式
+    int m_blockStart = 0;                               //开始检测柱面号
+    int m_blockEnd = 0;                                 //检测结束柱面号
+    int m_checkCount = 0;                               //检测次数
+    QString m_checkTime;                                //检测超时时间
+    int m_checkSize = 0;                                //检测柱面大小 单位字节
+    bool m_adaptive = false;                            //是否自适应检测
+    int m_sectorSize = 512;                             //逻辑扇区大小
+    QVector<BadBlockScanner::SectorRange> m_covered;    //已检测的扇区范围
+    QVector<BadBlockScanner::SectorRange> m_bad;        //读取失败的扇区范围
+    QVector<BadBlockScanner::SectorRange> m_slow;       //读取超时的扇区范围
+
+private:
+    static const quint32 Magic = 0x43424d44;    //文件标识 "DMBC"
+    static const quint32 Version = 1;           //检查点格式版本号 格式变化时递增
+};
+
+} // namespace DiskManager
+#endif // BADBLOCKCHECKPOINT_H
@@ -0,0 +1,65 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "badblockprogress.h"
+
+namespace DiskManager {
+
+BadBlockProgress::BadBlockProgress(qint64 interval)
+    : m_interval(interval)
+{
+    m_timer.start();
+}
+
+void BadBlockProgress::start()
+{
+    m_progress.clear();
+    m_timer.restart();
+}
+
+void BadBlockProgress::add(qint64 startSector, qint64 sectors, qint64 latency, int status)
+{
+    m_progress.resize(m_progress.size() + BAD_BLOCKS_PROGRESS_FIELDS);
+    qlonglong *item = m_progress.end() - BAD_BLOCKS_PROGRESS_FIELDS;
+    item[BAD_BLOCKS_PROGRESS_START] = startSector;
+    item[BAD_BLOCKS_PROGRESS_LENGTH] = sectors;
+    item[BAD_BLOCKS_PROGRESS_LATENCY] = latency;
+    item[BAD_BLOCKS_PROGRESS_STATUS] = status;
+}
+
+bool BadBlockProgress::isEmpty() const
+{
+    return m_progress.isEmpty();
+}
+
+bool BadBlockProgress::isDue() const
+{
+    return !m_progress.isEmpty() && m_timer.hasExpired(m_interval);
+}
+
+QVector<qlonglong> BadBlockProgress::take()
+{
+    QVector<qlonglong> progress;
+    progress.swap(m_progress);
+    m_timer.restart();
+    return progress;
+}
+
+} // namespace DiskManager
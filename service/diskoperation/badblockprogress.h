@@ -0,0 +1,85 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BADBLOCKPROGRESS_H
+#define BADBLOCKPROGRESS_H
+#include "commondef.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+namespace DiskManager {
+
+/**
+ * @class BadBlockProgress
+ * @brief 坏道检测批量进度 每项检测结果按BadBlocksProgressField顺序编码为四个数值
+ *        累积到发送间隔后整批通过一个信号发送 避免每个柱面一个字符串信号
+ */
+class BadBlockProgress
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param interval：发送间隔 单位ms
+     */
+    explicit BadBlockProgress(qint64 interval = DefaultInterval);
+
+    /**
+     * @brief 清空未发送的进度并重新开始计时
+     */
+    void start();
+
+    /**
+     * @brief 添加一项检测结果
+     * @param startSector：起始扇区
+     * @param sectors：扇区个数
+     * @param latency：读取耗时 单位us
+     * @param status：读取状态 BadBlocksStatus
+     */
+    void add(qint64 startSector, qint64 sectors, qint64 latency, int status);
+
+    /**
+     * @brief 是否有未发送的进度
+     * @return true没有false有
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief 是否应该发送 有未发送的进度且距上次发送超过发送间隔
+     * @return true应该发送false不需要
+     */
+    bool isDue() const;
+
+    /**
+     * @brief 取出未发送的进度并重新开始计时
+     * @return 按项顺序编码的进度
+     */
+    QVector<qlonglong> take();
+
+    static const qint64 DefaultInterval = 100;    //默认发送间隔 单位ms
+
+private:
+    qint64 m_interval;              //发送间隔 单位ms
+    QVector<qlonglong> m_progress;  //尚未发送的进度
+    QElapsedTimer m_timer;          //距上次发送的时间
+};
+
+} // namespace DiskManager
+#endif // BADBLOCKPROGRESS_H
@@ -0,0 +1,327 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "badblockscanner.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRunnable>
+
+#include <algorithm>
+#include <functional>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace DiskManager {
+
+static const qint64 MaxBufferBytes = 64 * 1024 * 1024;  //全部读取缓冲区总大小上限
+static const size_t BufferAlignment = 4096;             //O_DIRECT缓冲区对齐 不小于常见逻辑扇区大小
+static const int MaxBisectReads = 256;                  //单次二分定位的最大读取次数 避免在大片坏道上逐扇区读取
+
+/**
+ * @class RegionReadTask
+ * @brief 单个读取请求任务
+ */
+class RegionReadTask : public QRunnable
+{
+public:
+    RegionReadTask(const std::function<void()> &func)
+        : m_func(func)
+    {
+    }
+
+    void run() override
+    {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+
+BadBlockScanner::BadBlockScanner(const QString &devicePath, qint64 bufferSize, int queueDepth)
+    : m_devicePath(devicePath)
+    , m_bufferSize(bufferSize)
+{
+    if (bufferSize <= 0) {
+        return;
+    }
+
+    m_fd = open(devicePath.toStdString().c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    m_direct = m_fd >= 0;
+    if (m_fd < 0 && errno == EINVAL) {
+        qDebug() << __FUNCTION__ << devicePath << "does not support O_DIRECT, fall back to buffered read";
+        m_fd = open(devicePath.toStdString().c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (m_fd < 0) {
+        qDebug() << __FUNCTION__ << "open" << devicePath << "failed:" << strerror(errno);
+        return;
+    }
+
+    quint64 deviceSize = 0;
+    if (ioctl(m_fd, BLKGETSIZE64, &deviceSize) == 0) {
+        m_deviceSize = static_cast<qint64>(deviceSize);
+    }
+
+    int sectorSize = 0;
+    if (ioctl(m_fd, BLKSSZGET, &sectorSize) == 0 && sectorSize > 0) {
+        m_sectorSize = sectorSize;
+    }
+
+    m_queueDepth = static_cast<int>(qBound<qint64>(1, queueDepth, qMax<qint64>(1, MaxBufferBytes / m_bufferSize)));
+    for (int i = 0; i < m_queueDepth; i++) {
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, BufferAlignment, static_cast<size_t>(m_bufferSize)) != 0) {
+            break;
+        }
+        m_buffers.append(static_cast<char *>(buffer));
+    }
+
+    if (m_buffers.isEmpty()) {
+        qDebug() << __FUNCTION__ << "failed to allocate read buffer";
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_queueDepth = m_buffers.size();
+    m_pool.setMaxThreadCount(m_queueDepth);
+    qDebug() << __FUNCTION__ << devicePath << "buffer size:" << m_bufferSize << "sector size:" << m_sectorSize << "queue depth:" << m_queueDepth;
+}
+
+BadBlockScanner::~BadBlockScanner()
+{
+    m_pool.waitForDone();
+    foreach (char *buffer, m_buffers) {
+        free(buffer);
+    }
+
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool BadBlockScanner::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+int BadBlockScanner::queueDepth() const
+{
+    return m_queueDepth;
+}
+
+int BadBlockScanner::sectorSize() const
+{
+    return m_sectorSize;
+}
+
+qint64 BadBlockScanner::clampLength(qint64 offset, qint64 length) const
+{
+    if (m_deviceSize <= 0 || offset >= m_deviceSize) {
+        return length;
+    }
+
+    return qMin(length, m_deviceSize - offset);
+}
+
+void BadBlockScanner::read(QVector<ReadRequest> &requests)
+{
+    Q_ASSERT(requests.size() <= m_queueDepth);
+    QElapsedTimer clock;
+    clock.start();
+    QVector<qint64> starts(requests.size(), 0);
+    QVector<qint64> ends(requests.size(), 0);
+    for (int i = 0; i < requests.size(); i++) {
+        ReadRequest &request = requests[i];
+        if (!isOpen()) {
+            request.m_error = EBADF;
+            continue;
+        }
+
+        char *buffer = m_buffers.at(i);
+        qint64 *start = &starts[i];
+        qint64 *end = &ends[i];
+        m_pool.start(new RegionReadTask([this, buffer, &request, &clock, start, end] {
+            *start = clock.nsecsElapsed();
+            readRange(buffer, request);
+            *end = clock.nsecsElapsed();
+        }));
+    }
+    m_pool.waitForDone();
+
+    //O_DIRECT的对齐或长度限制在读取时才报EINVAL 不是介质错误 改为普通读取后串行重读
+    bool retry = false;
+    for (int i = 0; i < requests.size() && !retry; i++) {
+        retry = requests.at(i).m_error == EINVAL && requests.at(i).m_offset < m_deviceSize;
+    }
+    if (retry && reopenBuffered()) {
+        for (int i = 0; i < requests.size(); i++) {
+            ReadRequest &request = requests[i];
+            if (request.m_error == EINVAL && request.m_offset < m_deviceSize) {
+                request.m_error = 0;
+                starts[i] = clock.nsecsElapsed();
+                readRange(m_buffers.at(i), request);
+                ends[i] = clock.nsecsElapsed();
+            }
+        }
+    }
+
+    //并发读取在设备队列中相互等待 按完成顺序扣除排队时间 得到每个读取的服务时间
+    QVector<int> order;
+    for (int i = 0; i < requests.size(); i++) {
+        order.append(i);
+    }
+    std::sort(order.begin(), order.end(), [&ends](int a, int b) {
+        return ends.at(a) < ends.at(b);
+    });
+    qint64 previousEnd = 0;
+    foreach (int i, order) {
+        qint64 service = ends.at(i) - qMax(starts.at(i), previousEnd);
+        previousEnd = qMax(previousEnd, ends.at(i));
+        requests[i].m_latency = qMax<qint64>(0, service) / 1000;
+        requests[i].m_elapsed = requests.at(i).m_latency / 1000;
+    }
+
+    for (int i = 0; i < requests.size(); i++) {
+        ReadRequest &request = requests[i];
+        if (request.m_error != 0) {
+            request.m_status = READ_BAD;
+        } else if (request.m_slowThreshold >= 0 && request.m_elapsed > request.m_slowThreshold) {
+            request.m_status = READ_SLOW;
+        } else {
+            request.m_status = READ_GOOD;
+        }
+    }
+}
+
+QVector<BadBlockScanner::SectorRange> BadBlockScanner::locateBadSectors(qint64 offset, qint64 length, const std::function<void()> &onRead)
+{
+    QVector<SectorRange> ranges;
+    //超出设备末尾的部分不存在扇区 不参与定位
+    if (!isOpen() || (m_deviceSize > 0 && offset >= m_deviceSize)) {
+        return ranges;
+    }
+
+    //深度优先 先处理低地址的一半 保证结果按扇区顺序排列
+    QVector<QPair<qint64, qint64>> pending;
+    pending.append(qMakePair(offset, clampLength(offset, qMin(length, m_bufferSize))));
+    int budget = MaxBisectReads;
+    while (!pending.isEmpty()) {
+        QPair<qint64, qint64> range = pending.takeLast();
+        bool bad = true;
+        if (budget > 0) {
+            budget--;
+            ReadRequest request;
+            request.m_offset = range.first;
+            request.m_length = range.second;
+            readRange(m_buffers.first(), request);
+            if (request.m_error == EINVAL && reopenBuffered()) {
+                request.m_error = 0;
+                readRange(m_buffers.first(), request);
+            }
+            if (onRead) {
+                onRead();
+            }
+            if (request.m_error == 0) {
+                continue;
+            }
+
+            //普通读取仍返回EINVAL说明请求本身无效 拆分后结果相同 不再二分
+            qint64 half = request.m_error == EINVAL ? 0 : (range.second / 2) / m_sectorSize * m_sectorSize;
+            if (half > 0) {
+                pending.append(qMakePair(range.first + half, range.second - half));
+                pending.append(qMakePair(range.first, half));
+                bad = false;
+            }
+        }
+
+        if (bad) {
+            SectorRange sectors;
+            sectors.m_start = range.first / m_sectorSize;
+            sectors.m_end = (range.first + range.second - 1) / m_sectorSize;
+            if (!ranges.isEmpty() && ranges.last().m_end + 1 == sectors.m_start) {
+                ranges.last().m_end = sectors.m_end;
+            } else {
+                ranges.append(sectors);
+            }
+        }
+    }
+
+    return ranges;
+}
+
+void BadBlockScanner::readRange(char *buffer, ReadRequest &request) const
+{
+    qint64 length = qMin(request.m_length, m_bufferSize);
+    if (m_deviceSize > 0) {
+        //超出设备末尾 与badblocks一致视为失败
+        if (request.m_offset >= m_deviceSize) {
+            request.m_error = EINVAL;
+            return;
+        }
+        length = qMin(m_deviceSize - request.m_offset, length);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 done = 0;
+    while (done < length) {
+        ssize_t ret = pread(m_fd, buffer + done, static_cast<size_t>(length - done), request.m_offset + done);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            //ret为0表示在设备大小范围内提前读到末尾 同样视为读取失败
+            request.m_error = ret < 0 ? errno : EIO;
+            break;
+        }
+        done += ret;
+    }
+    request.m_latency = timer.nsecsElapsed() / 1000;
+    request.m_elapsed = request.m_latency / 1000;
+}
+
+bool BadBlockScanner::reopenBuffered()
+{
+    if (!m_direct) {
+        return false;
+    }
+
+    int fd = open(m_devicePath.toStdString().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        qDebug() << __FUNCTION__ << "open" << m_devicePath << "failed:" << strerror(errno);
+        return false;
+    }
+
+    qDebug() << __FUNCTION__ << m_devicePath << "rejected O_DIRECT read, fall back to buffered read";
+    close(m_fd);
+    m_fd = fd;
+    m_direct = false;
+    return true;
+}
+
+} // namespace DiskManager
@@ -0,0 +1,155 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BADBLOCKSCANNER_H
+#define BADBLOCKSCANNER_H
+#include "commondef.h"
+
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+
+namespace DiskManager {
+
+/**
+ * @class BadBlockScanner
+ * @brief 坏道检测读取引擎 在进程内以O_DIRECT和对齐缓冲区读取磁盘 绕过页缓存
+ *        一批读取请求由线程池中的多个线程同时执行 并发读取数即队列深度 结果按请求顺序返回
+ *        读取失败的范围可二分定位到具体的逻辑扇区
+ */
+class BadBlockScanner
+{
+public:
+    /**
+     * @enum ReadStatus
+     * @brief 读取状态
+     */
+    enum ReadStatus {
+        READ_GOOD = 0,      //读取正常
+        READ_SLOW,          //读取正常但耗时超过阈值
+        READ_BAD            //读取失败
+    };
+
+    /**
+     * @struct ReadRequest
+     * @brief 读取请求及结果
+     */
+    struct ReadRequest {
+        qint64 m_offset = 0;            //起始偏移 单位字节
+        qint64 m_length = 0;            //长度 单位字节 不超过缓冲区大小
+        qint64 m_slowThreshold = -1;    //慢读取耗时阈值 单位ms 小于0时不判断
+        qint64 m_elapsed = 0;           //读取服务时间 单位ms 不包括在设备队列中等待同批其他读取的时间
+        qint64 m_latency = 0;           //读取服务时间 单位us 单调时钟
+        int m_error = 0;                //读取失败时的errno
+        ReadStatus m_status = READ_GOOD;
+    };
+
+    /**
+     * @struct SectorRange
+     * @brief 逻辑扇区范围 包含首尾扇区
+     */
+    struct SectorRange {
+        Sector m_start = 0;             //起始扇区
+        Sector m_end = 0;               //结束扇区
+    };
+
+    /**
+     * @brief 打开设备 O_DIRECT不可用时退回普通读取
+     * @param devicePath：设备路径
+     * @param bufferSize：单次读取最大长度 单位字节
+     * @param queueDepth：最大并发读取数 实际值受缓冲区总大小限制
+     */
+    BadBlockScanner(const QString &devicePath, qint64 bufferSize, int queueDepth);
+    ~BadBlockScanner();
+
+    /**
+     * @brief 设备是否打开成功
+     * @return true成功false失败
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief 实际使用的队列深度
+     * @return 队列深度
+     */
+    int queueDepth() const;
+
+    /**
+     * @brief 设备逻辑扇区大小
+     * @return 逻辑扇区大小 单位字节
+     */
+    int sectorSize() const;
+
+    /**
+     * @brief 将读取长度限制在设备末尾之前 起始偏移已超出设备末尾或设备大小未知时不修改
+     * @param offset：起始偏移 单位字节
+     * @param length：读取长度 单位字节
+     * @return 限制后的读取长度
+     */
+    qint64 clampLength(qint64 offset, qint64 length) const;
+
+    /**
+     * @brief 并发执行一批读取请求 请求数不超过队列深度 超出设备末尾的请求视为失败
+     *        耗时按完成顺序计算服务时间 即完成时刻减去开始时刻与前一个完成时刻中较晚者 排除排队等待
+     * @param requests：读取请求 返回时填入耗时、错误及状态
+     */
+    void read(QVector<ReadRequest> &requests);
+
+    /**
+     * @brief 二分定位读取失败的逻辑扇区 读取次数超过上限时剩余未定位的范围整体视为失败
+     * @param offset：起始偏移 单位字节 按扇区对齐
+     * @param length：长度 单位字节
+     * @param onRead：每次读取完成后调用 定位坏扇区耗时较长 调用方借此发送进度
+     * @return 读取失败的扇区范围 相邻范围已合并
+     */
+    QVector<SectorRange> locateBadSectors(qint64 offset, qint64 length, const std::function<void()> &onRead = std::function<void()>());
+
+private:
+    /**
+     * @brief 执行单个读取请求 可在线程池中并行调用
+     * @param buffer：对齐的读取缓冲区
+     * @param request：读取请求
+     */
+    void readRange(char *buffer, ReadRequest &request) const;
+
+    /**
+     * @brief O_DIRECT读取因对齐或长度不满足要求失败时 以普通读取方式重新打开设备 只能在没有并发读取时调用
+     * @return true重新打开成功false失败或已是普通读取
+     */
+    bool reopenBuffered();
+
+    BadBlockScanner(const BadBlockScanner &) = delete;
+    BadBlockScanner &operator=(const BadBlockScanner &) = delete;
+
+private:
+    QString m_devicePath;               //设备路径
+    int m_fd = -1;                      //设备文件描述符
+    bool m_direct = false;              //是否以O_DIRECT方式打开
+    qint64 m_bufferSize = 0;            //单次读取最大长度
+    qint64 m_deviceSize = 0;            //设备大小
+    int m_sectorSize = 512;             //逻辑扇区大小
+    int m_queueDepth = 1;               //队列深度
+    QVector<char *> m_buffers;          //每个并发读取一个对齐缓冲区
+    QThreadPool m_pool;                 //读取线程池
+};
+
+} // namespace DiskManager
+#endif // BADBLOCKSCANNER_H
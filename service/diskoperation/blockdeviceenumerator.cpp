@@ -0,0 +1,110 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "blockdeviceenumerator.h"
+#include "utils.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+namespace DiskManager {
+
+static const QString SysBlockDir = "/sys/class/block/";
+
+QVector<QString> BlockDeviceEnumerator::devicePaths()
+{
+    QVector<QString> paths;
+    QStringList names = QDir(SysBlockDir).entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot);
+    foreach (const QString &name, names) {
+        QString path = candidatePath(name);
+        if (!path.isEmpty()) {
+            paths.append(path);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    qDebug() << __FUNCTION__ << QString("%1 of %2 block devices are candidates").arg(paths.size()).arg(names.size()) << paths;
+    return paths;
+}
+
+bool BlockDeviceEnumerator::isCandidate(const QString &devicePath)
+{
+    //sysfs中以!代替设备路径中的/ 例如/dev/cciss/c0d0对应cciss!c0d0
+    QString canonicalPath = QFileInfo(devicePath).canonicalFilePath();
+    QString name = canonicalPath.startsWith("/dev/") ? canonicalPath.mid(5).replace('/', '!') : QFileInfo(canonicalPath).fileName();
+    return !name.isEmpty() && !candidatePath(name).isEmpty();
+}
+
+QString BlockDeviceEnumerator::candidatePath(const QString &name)
+{
+    QString sysPath = SysBlockDir + name;
+
+    //分区由所在磁盘一起探测
+    if (QFileInfo::exists(sysPath + "/partition")) {
+        return QString();
+    }
+
+    //内存盘、软驱及光驱不是可分区的磁盘
+    if (name.startsWith("ram") || name.startsWith("zram") || name.startsWith("fd") || name.startsWith("sr")) {
+        return QString();
+    }
+
+    //无介质的读卡器、光驱及未关联文件的loop设备容量为0
+    if (Utils::readSysfs(sysPath + "/size").toLongLong() <= 0) {
+        return QString();
+    }
+
+    if (name.startsWith("dm-")) {
+        //只保留lvm逻辑卷、加密映射及多路径设备 其余dm设备(kpartx分区等)不管理
+        QString uuid = Utils::readSysfs(sysPath + "/dm/uuid");
+        if (!uuid.startsWith("LVM-") && !uuid.startsWith("CRYPT-") && !uuid.startsWith("mpath-")) {
+            return QString();
+        }
+
+        QString dmName = Utils::readSysfs(sysPath + "/dm/name");
+        return dmName.isEmpty() ? QString() : "/dev/mapper/" + dmName;
+    }
+
+    if (isMultipathMember(name)) {
+        return QString();
+    }
+
+    //sysfs中以!代替设备路径中的/ 例如cciss!c0d0对应/dev/cciss/c0d0
+    QString path = name;
+    path.replace('!', '/');
+    return "/dev/" + path;
+}
+
+bool BlockDeviceEnumerator::isMultipathMember(const QString &name)
+{
+    QStringList holders = QDir(SysBlockDir + name + "/holders").entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot);
+    foreach (const QString &holder, holders) {
+        if (Utils::readSysfs(SysBlockDir + holder + "/dm/uuid").startsWith("mpath-")) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace DiskManager
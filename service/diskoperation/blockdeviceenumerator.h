@@ -0,0 +1,68 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BLOCKDEVICEENUMERATOR_H
+#define BLOCKDEVICEENUMERATOR_H
+
+#include <QString>
+#include <QVector>
+
+namespace DiskManager {
+
+/**
+ * @class BlockDeviceEnumerator
+ * @brief 块设备枚举类 只遍历一次/sys/class/block 不打开任何设备
+ *        跳过分区、容量为0的设备(无介质的光驱、读卡器及未关联的loop)、内存盘、光驱、多路径成员盘
+ *        以及lvm、加密映射和多路径以外的dm设备 剩下的设备才交给libparted
+ */
+class BlockDeviceEnumerator
+{
+public:
+    /**
+     * @brief 获取需要管理的设备路径 dm设备返回/dev/mapper/下的路径 与libparted一致
+     * @return 设备路径(已排序)
+     */
+    static QVector<QString> devicePaths();
+
+    /**
+     * @brief 判断设备是否需要管理 用于热插拔时单个设备的判断
+     * @param devicePath：设备路径
+     * @return true需要管理false不需要
+     */
+    static bool isCandidate(const QString &devicePath);
+
+private:
+    /**
+     * @brief 按sysfs信息判断设备是否需要管理
+     * @param name：/sys/class/block下的设备名
+     * @return 设备路径 不需要管理时返回空
+     */
+    static QString candidatePath(const QString &name);
+
+    /**
+     * @brief 判断磁盘是否为多路径设备的成员盘 成员盘由多路径dm设备统一管理
+     * @param name：/sys/class/block下的设备名
+     * @return true是false不是
+     */
+    static bool isMultipathMember(const QString &name);
+};
+
+} // namespace DiskManager
+#endif // BLOCKDEVICEENUMERATOR_H
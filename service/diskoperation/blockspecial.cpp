@@ -28,6 +28,7 @@
 #include "blockspecial.h"
 
 #include <QMap>
+#include <QMutex>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -49,6 +50,8 @@ typedef QMap<QString, MmNumber> MMNumberMapping;
 //     mm_number_cache["proc"]      = {0, 0}
 //     mm_number_cache["sysfs"]     = {0, 0}
 static MMNumberMapping mmNumberCache;
+// 设备并行探测时多个线程同时查询和写入缓存
+static QMutex mmNumberCacheMutex;
 
 BlockSpecial::BlockSpecial()
     : m_name("")
@@ -62,6 +65,7 @@ BlockSpecial::BlockSpecial(const QString &name)
     , m_major(0UL)
     , m_minor(0UL)
 {
+    QMutexLocker locker(&mmNumberCacheMutex);
     MMNumberMapping::const_iterator mmNumIter = mmNumberCache.find(name);
     if (mmNumIter != mmNumberCache.end()) {
         // Use already cached major, minor pair
@@ -90,6 +94,7 @@ BlockSpecial::~BlockSpecial()
 
 void BlockSpecial::clearCache()
 {
+    QMutexLocker locker(&mmNumberCacheMutex);
     mmNumberCache.clear();
 }
 
@@ -98,6 +103,7 @@ void BlockSpecial::registerBlockSpecial(const QString &name, unsigned long major
     MmNumber pair;
     pair.m_major = major;
     pair.m_minor = minor;
+    QMutexLocker locker(&mmNumberCacheMutex);
     // Add new, or update existing, cache entry for name to major, minor pair
     mmNumberCache[name] = pair;
 }
@@ -26,6 +26,7 @@
 */
 
 #include "device.h"
+#include "topologydelta.h"
 
 #include <QDebug>
 
@@ -54,6 +55,7 @@ Device::Device()
     qDBusRegisterMetaType<PVInfo>();
     qDBusRegisterMetaType<LVMInfo>();
     qDBusRegisterMetaType<QVector<QString>>();
+    qDBusRegisterMetaType<QVector<qlonglong>>();
     qDBusRegisterMetaType<QList<PVData>>();
     qDBusRegisterMetaType<QList<LVAction>>();
 
@@ -64,6 +66,7 @@ Device::Device()
     qDBusRegisterMetaType<LUKSInfoMap>();
     qDBusRegisterMetaType<LUKSMap>();
     qDBusRegisterMetaType<WipeAction>();
+    qDBusRegisterMetaType<TopologyDelta>();
 
     m_sectorSize = 0;
     m_maxPrims = 0;
@@ -91,7 +94,7 @@ bool Device::partitionNamingSupported() const
 //    return m_maxPartitionNameLength;
 //}
 
-DeviceInfo Device::getDeviceInfo()
+DeviceInfo Device::getDeviceInfo() const
 {
     DeviceInfo info;
     info.m_length = m_length;
@@ -117,4 +120,19 @@ DeviceInfo Device::getDeviceInfo()
     return info;
 }
 
+PartitionArena &Device::partitionArena()
+{
+    if (!m_partitionArena) {
+        m_partitionArena = std::make_shared<PartitionArena>();
+    }
+
+    return *m_partitionArena;
+}
+
+void Device::clearPartitions()
+{
+    m_partitions.clear();
+    m_partitionArena.reset();
+}
+
 } // namespace DiskManager
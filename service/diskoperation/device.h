@@ -29,12 +29,37 @@
 #define DEVICE_H
 #include "deviceinfo.h"
 #include "partition.h"
+#include "partitionarena.h"
 
 #include <QtDBus/QtDBus>
 #include <QVector>
 
+#include <memory>
+
 namespace DiskManager {
 
+/**
+ * @struct DeviceProbeTime
+ * @brief 单个设备探测耗时 单位ms
+ */
+struct DeviceProbeTime {
+    QString m_path;               //设备路径
+    qint64 m_diskTime = 0;        //分区表及文件系统读取耗时
+    qint64 m_mediaTypeTime = 0;   //介质类型获取耗时
+    qint64 m_modelTime = 0;       //型号获取耗时
+    qint64 m_interfaceTime = 0;   //接口获取耗时
+    qint64 m_totalTime = 0;       //总耗时
+
+    /**
+     * @brief 格式化输出耗时信息
+     * @return 耗时信息
+     */
+    QString toString() const
+    {
+        return QString("%1 disk:%2ms mediaType:%3ms model:%4ms interface:%5ms total:%6ms")
+               .arg(m_path).arg(m_diskTime).arg(m_mediaTypeTime).arg(m_modelTime).arg(m_interfaceTime).arg(m_totalTime);
+    }
+};
 
 /**
  * @class Device
@@ -68,7 +93,18 @@ public:
      * @brief 获得设备信息
      * @return 设备信息
      */
-    DeviceInfo getDeviceInfo();
+    DeviceInfo getDeviceInfo() const;
+
+    /**
+     * @brief 获得分区对象内存池 分区及逻辑分区对象都从此分配 不存在时创建
+     * @return 分区对象内存池
+     */
+    PartitionArena &partitionArena();
+
+    /**
+     * @brief 清空分区列表并换用新的内存池 原内存池在最后一个引用它的设备拷贝释放时释放
+     */
+    void clearPartitions();
 
 public:
     Sector m_length;        //长度
@@ -89,6 +125,7 @@ public:
     QVector<Partition *> m_partitions; //分区信息
 private:
     int m_maxPartitionNameLength; //最大分区命名长度
+    std::shared_ptr<PartitionArena> m_partitionArena; //分区对象内存池 设备拷贝之间共享
 };
 
 } //namespace DiskManager
@@ -0,0 +1,302 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "devicequerycache.h"
+#include "commandexecutor.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <libudev.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace DiskManager {
+
+static const char *smartHealthMarker = "SMART overall-health self-assessment test result:";
+static const char *smartAttributesHeader = "ID# ATTRIBUTE_NAME          FLAG     VALUE WORST THRESH TYPE      UPDATED  WHEN_FAILED RAW_VALUE";
+static const char *smartNvmeAttributesHeader = "SMART/Health Information";
+static const char *smartUnknownType = "Please specify device type with the -d option";
+
+//smart数据(健康状态、属性)1分钟 设备型号、接口等静态信息10分钟
+int DeviceQueryCache::m_ttl[QueryTypeCount] = {60000, 600000, 60000, 60000, 600000, 600000, 600000};
+QMap<QString, DeviceQueryCache::CacheEntry> DeviceQueryCache::m_cache;
+int DeviceQueryCache::m_hits[QueryTypeCount] = {0};
+int DeviceQueryCache::m_misses[QueryTypeCount] = {0};
+quint64 DeviceQueryCache::m_generation = 0;
+QMutex DeviceQueryCache::m_mutex;
+
+QString DeviceQueryCache::query(const QString &devicePath, QueryType type)
+{
+    //lshw一次列出所有磁盘 结果不区分设备
+    QString identity = (type == Lshw) ? QString("all") : deviceIdentity(devicePath);
+    if (identity.isEmpty()) {
+        return runQuery(devicePath, type);
+    }
+
+    QString key = QString("%1/%2").arg(identity).arg(type);
+    quint64 generation = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        QString output;
+        if (findEntry(key, m_ttl[type], output)) {
+            ++m_hits[type];
+            return output;
+        }
+
+        //磁盘信息对话框已执行过smartctl --all 健康状态及属性直接从中获取
+        QString allOutput;
+        if ((type == SmartInfo || type == SmartHealth || type == SmartAttributes)
+                && findEntry(QString("%1/%2").arg(identity).arg(SmartAll), m_ttl[type], allOutput)
+                && deriveFromSmartAll(allOutput, type, output)) {
+            ++m_hits[type];
+            return output;
+        }
+
+        ++m_misses[type];
+        generation = m_generation;
+    }
+
+    QString output = runQuery(devicePath, type);
+
+    //命令失败或超时的空结果不缓存
+    QMutexLocker locker(&m_mutex);
+    if (!output.isEmpty() && m_ttl[type] > 0 && generation == m_generation) {
+        CacheEntry &entry = m_cache[key];
+        entry.m_devicePath = devicePath;
+        entry.m_output = output;
+        entry.m_timer.start();
+    }
+
+    return output;
+}
+
+void DeviceQueryCache::setTTL(QueryType type, int msecs)
+{
+    if (type < 0 || type >= QueryTypeCount) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_ttl[type] = qMax(0, msecs);
+}
+
+int DeviceQueryCache::getTTL(QueryType type)
+{
+    if (type < 0 || type >= QueryTypeCount) {
+        return 0;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return m_ttl[type];
+}
+
+void DeviceQueryCache::invalidate(const QString &devicePath)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        if (it.key().startsWith("all/") || it->m_devicePath.startsWith(devicePath) || devicePath.startsWith(it->m_devicePath)) {
+            it = m_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DeviceQueryCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    m_cache.clear();
+}
+
+QStringList DeviceQueryCache::statistics()
+{
+    static const char *names[QueryTypeCount] = {"smartctl --all", "smartctl -i", "smartctl -H", "smartctl -A",
+                                                "hwinfo", "lshw", "lsblk"
+                                               };
+
+    QMutexLocker locker(&m_mutex);
+    QStringList list;
+    for (int i = 0; i < QueryTypeCount; ++i) {
+        list.append(QString("query:%1 hit:%2 miss:%3 ttl:%4ms").arg(names[i]).arg(m_hits[i]).arg(m_misses[i]).arg(m_ttl[i]));
+    }
+
+    return list;
+}
+
+QString DeviceQueryCache::deviceIdentity(const QString &devicePath)
+{
+    struct stat st;
+    if (stat(devicePath.toLocal8Bit().constData(), &st) != 0 || !(S_ISBLK(st.st_mode) || S_ISCHR(st.st_mode))) {
+        return QString();
+    }
+
+    //nvme的smart查询使用字符设备 块设备与字符设备的设备号可能相同
+    char devType = S_ISBLK(st.st_mode) ? 'b' : 'c';
+    QString serial;
+    struct udev *udev = udev_new();
+    if (udev != nullptr) {
+        struct udev_device *dev = udev_device_new_from_devnum(udev, devType, st.st_rdev);
+        if (dev != nullptr) {
+            const char *value = udev_device_get_property_value(dev, "ID_SERIAL");
+            if (value == nullptr) {
+                value = udev_device_get_sysattr_value(dev, "serial");
+            }
+            if (value == nullptr) {
+                value = udev_device_get_sysattr_value(dev, "device/serial");
+            }
+            serial = QString::fromLocal8Bit(value).trimmed();
+            udev_device_unref(dev);
+        }
+        udev_unref(udev);
+    }
+
+    return QString("%1%2:%3:%4").arg(devType).arg(major(st.st_rdev)).arg(minor(st.st_rdev)).arg(serial);
+}
+
+bool DeviceQueryCache::findEntry(const QString &key, int ttl, QString &output)
+{
+    auto it = m_cache.find(key);
+    if (it == m_cache.end()) {
+        return false;
+    }
+
+    if (it->m_timer.hasExpired(ttl)) {
+        m_cache.erase(it);
+        return false;
+    }
+
+    output = it->m_output;
+    return true;
+}
+
+bool DeviceQueryCache::deriveFromSmartAll(const QString &output, QueryType type, QString &result)
+{
+    switch (type) {
+    case SmartInfo:
+        //--all包含-i的全部内容
+        result = output;
+        return true;
+    case SmartHealth:
+        if (!output.contains(smartHealthMarker)) {
+            return false;
+        }
+        result = output;
+        return true;
+    case SmartAttributes: {
+        //ata属性表以表头定位 --all输出可直接解析
+        if (output.contains(smartAttributesHeader)) {
+            result = output;
+            return true;
+        }
+
+        //nvme属性按行解析所有带冒号的行 只截取SMART/Health Information段 避免混入设备信息
+        QStringList lines = output.split("\n");
+        int start = -1;
+        for (int i = 0; i < lines.size(); ++i) {
+            if (lines.at(i).startsWith(smartNvmeAttributesHeader)) {
+                start = i;
+                break;
+            }
+        }
+        if (start < 0) {
+            return false;
+        }
+
+        QStringList section;
+        for (int i = start; i < lines.size() && !lines.at(i).trimmed().isEmpty(); ++i) {
+            section.append(lines.at(i));
+        }
+        result = section.join("\n") + "\n";
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+QString DeviceQueryCache::runQuery(const QString &devicePath, QueryType type)
+{
+    CommandRequest request;
+    request.m_program = "smartctl";
+    switch (type) {
+    case SmartAll:
+        request.m_args << "--all" << devicePath;
+        break;
+    case SmartInfo:
+        request.m_args << "-i" << devicePath;
+        break;
+    case SmartHealth:
+        request.m_args << "-H" << devicePath;
+        break;
+    case SmartAttributes:
+        request.m_args << "-A" << devicePath;
+        break;
+    case Hwinfo:
+        request.m_program = "hwinfo";
+        request.m_args << "--disk" << "--only" << devicePath;
+        break;
+    case Lshw:
+        //服务以root运行 无需sudo
+        request.m_program = "lshw";
+        request.m_args << "-C" << "disk";
+        break;
+    case Lsblk:
+        request.m_program = "lsblk";
+        request.m_args << "-d" << "-o" << "name,rota" << devicePath;
+        break;
+    default:
+        return QString();
+    }
+
+    QString output = CommandExecutor::run(request).m_output;
+    if (request.m_program != "smartctl") {
+        return output;
+    }
+
+    bool retry = false;
+    switch (type) {
+    case SmartAll:
+    case SmartInfo:
+        retry = output.contains(smartUnknownType);
+        break;
+    case SmartHealth:
+        retry = !output.contains(smartHealthMarker);
+        break;
+    case SmartAttributes:
+        retry = !devicePath.contains("nvme") && !output.contains(smartAttributesHeader);
+        break;
+    default:
+        break;
+    }
+
+    //usb转接等设备需要指定sat类型
+    if (retry) {
+        request.m_args.insert(request.m_args.size() - 1, "-d");
+        request.m_args.insert(request.m_args.size() - 1, "sat");
+        output = CommandExecutor::run(request).m_output;
+    }
+
+    return output;
+}
+
+} // namespace DiskManager
@@ -0,0 +1,146 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEVICEQUERYCACHE_H
+#define DEVICEQUERYCACHE_H
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+
+namespace DiskManager {
+
+/**
+ * @class DeviceQueryCache
+ * @brief 设备查询结果缓存 缓存smartctl/hwinfo/lshw/lsblk的输出
+ *        key为设备标识(设备号+序列号)及查询类型 超过有效期或收到设备uevent后重新查询
+ */
+class DeviceQueryCache
+{
+public:
+    /**
+     * @enum QueryType
+     * @brief 查询类型
+     */
+    enum QueryType {
+        SmartAll = 0,       //smartctl --all
+        SmartInfo,          //smartctl -i
+        SmartHealth,        //smartctl -H
+        SmartAttributes,    //smartctl -A
+        Hwinfo,             //hwinfo --disk --only
+        Lshw,               //lshw -C disk 结果包含所有磁盘 不区分设备
+        Lsblk,              //lsblk -d -o name,rota
+        QueryTypeCount
+    };
+
+    /**
+     * @brief 获取查询结果 缓存有效时直接返回 smartctl -i/-H/-A可由有效的smartctl --all结果提供
+     * @param devicePath：设备路径
+     * @param type：查询类型
+     * @return 命令输出
+     */
+    static QString query(const QString &devicePath, QueryType type);
+
+    /**
+     * @brief 设置查询类型的有效期
+     * @param type：查询类型
+     * @param msecs：有效期 单位ms 0为不缓存
+     */
+    static void setTTL(QueryType type, int msecs);
+
+    /**
+     * @brief 获取查询类型的有效期
+     * @param type：查询类型
+     * @return 有效期 单位ms
+     */
+    static int getTTL(QueryType type);
+
+    /**
+     * @brief 使设备的缓存失效 设备路径与缓存路径互为前缀即失效(nvme0与nvme0n1) lshw结果总是失效
+     * @param devicePath：设备路径
+     */
+    static void invalidate(const QString &devicePath);
+
+    /**
+     * @brief 清空缓存
+     */
+    static void clear();
+
+    /**
+     * @brief 获取缓存命中统计
+     * @return 统计结果 每行一个查询类型
+     */
+    static QStringList statistics();
+
+private:
+    /**
+     * @struct CacheEntry
+     * @brief 缓存项
+     */
+    struct CacheEntry {
+        QString m_devicePath;       //设备路径
+        QString m_output;           //命令输出
+        QElapsedTimer m_timer;      //查询时间
+    };
+
+    /**
+     * @brief 获取设备标识 主次设备号加序列号 设备更换后标识变化
+     * @param devicePath：设备路径
+     * @return 设备标识 设备不存在返回空
+     */
+    static QString deviceIdentity(const QString &devicePath);
+
+    /**
+     * @brief 查找有效缓存 需持有m_mutex
+     * @param key：缓存key
+     * @param ttl：有效期 单位ms
+     * @param output：命令输出
+     * @return true命中false未命中
+     */
+    static bool findEntry(const QString &key, int ttl, QString &output);
+
+    /**
+     * @brief 从smartctl --all结果中截取与单项查询相同的内容
+     * @param output：smartctl --all输出
+     * @param type：查询类型
+     * @param result：截取结果
+     * @return true成功false失败
+     */
+    static bool deriveFromSmartAll(const QString &output, QueryType type, QString &result);
+
+    /**
+     * @brief 执行查询命令 smartctl无法识别设备类型时使用-d sat重试
+     * @param devicePath：设备路径
+     * @param type：查询类型
+     * @return 命令输出
+     */
+    static QString runQuery(const QString &devicePath, QueryType type);
+
+    static int m_ttl[QueryTypeCount];               //各查询类型有效期 单位ms
+    static QMap<QString, CacheEntry> m_cache;       //缓存 key:设备标识/查询类型
+    static int m_hits[QueryTypeCount];              //命中次数
+    static int m_misses[QueryTypeCount];            //未命中次数
+    static quint64 m_generation;                    //失效计数 查询期间缓存被失效时不保存查询结果
+    static QMutex m_mutex;
+};
+
+} // namespace DiskManager
+#endif // DEVICEQUERYCACHE_H
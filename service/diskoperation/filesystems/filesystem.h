@@ -51,6 +51,12 @@ public:
      */
     virtual FS getFilesystemSupport() = 0;
 
+    /**
+     * @brief 复制文件系统对象 对象带有成员状态 并行读取使用空间时每个任务使用一个副本
+     * @return 新对象 由调用者释放
+     */
+    virtual FileSystem *clone() const = 0;
+
     /**
      * @brief 文件系统繁忙状态
      * @param
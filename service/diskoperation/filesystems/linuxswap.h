@@ -46,6 +46,12 @@ public:
      */
     FS getFilesystemSupport();
 
+    /**
+     * @brief 复制文件系统对象
+     * @return 新对象 由调用者释放
+     */
+    FileSystem *clone() const { return new LinuxSwap(*this); }
+
     /**
      * @brief 设置已用空间
      * @param partition：分区信息
@@ -45,6 +45,12 @@ public:
      */
     FS getFilesystemSupport()override;
 
+    /**
+     * @brief 复制文件系统对象
+     * @return 新对象 由调用者释放
+     */
+    FileSystem *clone() const override { return new NTFS(*this); }
+
     /**
      * @brief 设置已用空间
      * @param partition：分区信息
@@ -27,44 +27,53 @@
 
 #include "fsinfo.h"
 #include "utils.h"
-#include "procpartitionsinfo.h"
 
 #include <QStringList>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QDebug>
+#include <QMutexLocker>
+
+#include <blkid/blkid.h>
 
 namespace DiskManager {
 
 bool FsInfo::m_fsInfoCacheInitialized = false;
-bool FsInfo::m_blkidFound = false;
-bool FsInfo::m_needBlkidVfatCacheUpdateWorkaround = false;
-QVector<fileSystemEntry> FsInfo::m_fileSystemInfoCache;
+QMap<QString, fileSystemEntry> FsInfo::m_fileSystemInfoCache;
+QMap<QString, QString> FsInfo::m_deviceSignature;
+QHash<quint64, QString> FsInfo::m_devIndex;
+QHash<QString, QString> FsInfo::m_nameIndex;
+QHash<QString, QString> FsInfo::m_uuidIndex;
+QHash<QString, QString> FsInfo::m_labelIndex;
+QMutex FsInfo::m_cacheMutex;
+
+static const QString SYS_CLASS_BLOCK = "/sys/class/block/";
+
+static quint64 devIndexKey(unsigned long major, unsigned long minor)
+{
+    return (static_cast<quint64>(major) << 32) | minor;
+}
 
 void FsInfo::loadCache()
 {
-    setCommandsFound();
+    // 探测线程替换缓存时 使用率线程池及D-Bus线程可能正在读取
+    QMutexLocker locker(&m_cacheMutex);
     loadFileSystemInfoCache();
     m_fsInfoCacheInitialized = true;
 }
 
 QString FsInfo::getFileSystemType(const QString &path)
 {
+    QMutexLocker locker(&m_cacheMutex);
     initializeIfRequired();
-    const fileSystemEntry &fsEntry = getCacheEntryByPath(path);
+    fileSystemEntry fsEntry = getCacheEntryByPath(path);
     QString fsType = fsEntry.m_type;
     QString fsSecType = fsEntry.m_secType;
 
     // If vfat, decide whether fat16 or fat32
+    // 进程内探测不经过blkid缓存 SEC_TYPE总是最新的 不再需要blkid -c /dev/null的规避方案
     if (fsType == "vfat") {
-        if (m_needBlkidVfatCacheUpdateWorkaround) {
-            // Blkid cache does not correctly add and remove SEC_TYPE when
-            // overwriting FAT16 and FAT32 file systems with each other, so
-            // prevents correct identification.  Run blkid command again,
-            // bypassing the the cache to get the correct results.
-            QString output;
-            QString error;
-            if (!Utils::executCmd("blkid -c /dev/null " + path, output, error))
-                fsSecType = Utils::regexpLabel(output, " SEC_TYPE=\"([^\"]*)\"");
-        }
         if (fsSecType == "msdos") {
             fsType = "fat16";
         }
@@ -78,203 +87,210 @@ QString FsInfo::getFileSystemType(const QString &path)
 
 QString FsInfo::getPathByUuid(const QString &uuid)
 {
+    QMutexLocker locker(&m_cacheMutex);
     initializeIfRequired();
-    for (int i = 0; i < m_fileSystemInfoCache.size(); i++) {
-        if (uuid == m_fileSystemInfoCache[i].m_uuid) {
-            return m_fileSystemInfoCache[i].m_path.m_name;
-        }
+    auto it = m_uuidIndex.find(uuid);
+    if (it == m_uuidIndex.end()) {
+        return "";
     }
 
-    return "";
+    return m_fileSystemInfoCache.value(it.value()).m_path.m_name;
 }
 
 QString FsInfo::getPathByLabel(const QString &label)
 {
+    QMutexLocker locker(&m_cacheMutex);
     initializeIfRequired();
-    updateFileSystemInfoCacheAllLabels();
-    for (int i = 0; i < m_fileSystemInfoCache.size(); i++) {
-        if (label == m_fileSystemInfoCache[i].m_label) {
-            return m_fileSystemInfoCache[i].m_path.m_name;
-        }
+    auto it = m_labelIndex.find(label);
+    if (it == m_labelIndex.end()) {
+        return "";
     }
 
-    return "";
+    return m_fileSystemInfoCache.value(it.value()).m_path.m_name;
 }
 
 QString FsInfo::getLabel(const QString &path, bool &found)
 {
+    QMutexLocker locker(&m_cacheMutex);
     initializeIfRequired();
-    BlockSpecial bs = BlockSpecial(path);
-    for (int i = 0; i < m_fileSystemInfoCache.size(); i++) {
-        if (bs == m_fileSystemInfoCache[i].m_path) {
-            if (m_fileSystemInfoCache[i].m_haveLabel || m_fileSystemInfoCache[i].m_type == "") {
-                // Already have the label or this is a blank cache entry
-                // for a whole disk device containing a partition table,
-                // so no label (as created by
-                // load_fs_info_cache_extra_for_path()).
-                found = m_fileSystemInfoCache[i].m_haveLabel;
-                return m_fileSystemInfoCache[i].m_label;
-            }
-
-            // Run blkid to get the label for this one partition, update the
-            // cache and return the found label.
-            found = runBlkidUpdateCacheOneLabel(m_fileSystemInfoCache[i]);
-            return m_fileSystemInfoCache[i].m_label;
-        }
-    }
-    found = false;
-    return "";
+    // 表在探测时已一并读取 空白条目(无文件系统的整盘等)视为未找到
+    fileSystemEntry fsEntry = getCacheEntryByPath(path);
+    found = fsEntry.m_haveLabel;
+    return fsEntry.m_label;
 }
 
 QString FsInfo::getUuid(const QString &path)
 {
+    QMutexLocker locker(&m_cacheMutex);
     initializeIfRequired();
-    const fileSystemEntry &fsEntry = getCacheEntryByPath(path);
+    fileSystemEntry fsEntry = getCacheEntryByPath(path);
     return fsEntry.m_uuid;
 }
 
+QString FsInfo::getPartUuid(const QString &path)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    initializeIfRequired();
+    fileSystemEntry fsEntry = getCacheEntryByPath(path);
+    return fsEntry.m_partUuid;
+}
+
 void FsInfo::initializeIfRequired()
 {
     if (!m_fsInfoCacheInitialized) {
-        setCommandsFound();
         loadFileSystemInfoCache();
         m_fsInfoCacheInitialized = true;
     }
 }
 
-void FsInfo::setCommandsFound()
+void FsInfo::loadFileSystemInfoCache()
 {
-    m_blkidFound = (!Utils::findProgramInPath("blkid").isEmpty());
-    if (m_blkidFound) {
-        // Blkid from util-linux before 2.23 has a cache update bug which prevents
-        // correct identification between FAT16 and FAT32 when overwriting one
-        // with the other.  Detect the need for a workaround.
-        QString output, error;
-        Utils::executCmd("blkid -v", output, error);
-        QString blkidVersion = Utils::regexpLabel(output, "blkid.* ([0-9\\.]+) ");
-        int blkidMajorVer = 0;
-        int blkidMinorVer = 0;
-        if (sscanf(blkidVersion.toStdString().c_str(), "%d.%d", &blkidMajorVer, &blkidMinorVer) == 2) {
-            m_needBlkidVfatCacheUpdateWorkaround =
-                (blkidMajorVer < 2 || (blkidMajorVer == 2 && blkidMinorVer < 23));
+    // 遍历所有块设备(包括分区、dm、loop) 设备变化标识未改变时沿用上次的探测结果
+    QMap<QString, fileSystemEntry> cache;
+    QMap<QString, QString> signatures;
+    int probedCount = 0;
+    QStringList sysNames = QDir(SYS_CLASS_BLOCK).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System);
+    foreach (const QString &sysName, sysNames) {
+        QString sysPath = SYS_CLASS_BLOCK + sysName;
+        if (Utils::readSysfs(sysPath + "/size").toLongLong() <= 0) {
+            // 未使用的loop设备及无介质的光驱等
+            continue;
         }
-    }
-}
 
-void FsInfo::loadFileSystemInfoCache()
-{
-    m_fileSystemInfoCache.clear();
-    // Run "blkid" and load entries into the cache.
-    runBlkidLoadCache();
-
-    // (#771244) Ensure the cache has entries for all whole disk devices, even if
-    // those entries are blank.  Needed so that an ISO9660 image stored on a whole
-    // disk device is detected before any embedded partitions within the image.
-    const BlockSpecial emptyBs = BlockSpecial();
-    QVector<QString> allDevices = ProcPartitionsInfo::getDevicePaths();
-    for (int i = 0; i < allDevices.size(); i++) {
-        const fileSystemEntry &fsEntry = getCacheEntryByPath(allDevices[i]);
-        if (fsEntry.m_path == emptyBs) {
-            // Run "blkid PATH" and load entry into cache for missing entries.
-            loadFileSystemInfoCacheExtraForPath(allDevices[i]);
+        QStringList devNumber = Utils::readSysfs(sysPath + "/dev").split(":");
+        if (devNumber.size() != 2) {
+            continue;
         }
-    }
-}
 
-bool FsInfo::runBlkidLoadCache(const QString &path)
-{
-    QString cmd = "blkid";
-    if (path.size())
-        cmd = cmd + " " + path; //Glib::shell_quote(path);
-    QString output;
-    QString error;
-    bool loadedEntries = false;
-    if (m_blkidFound && !Utils::executCmd(cmd, output, error)) {
-//        qDebug() << output;
-        QStringList strlist = output.split("\n");
-        for (int i = 0; i < strlist.size(); i++) {
-            fileSystemEntry fsEntry = {BlockSpecial(), "", "", "", false, ""};
-            QString entryPath = Utils::regexpLabel(strlist[i], "(?<=/).*?(?=: )");
-            if (entryPath.length() > 0) {
-                entryPath = "/" + entryPath;
-                fsEntry.m_path = BlockSpecial(entryPath);
-                fsEntry.m_type = Utils::regexpLabel(strlist[i], "(?<= TYPE=\").*?(?=\")");
-                fsEntry.m_secType = Utils::regexpLabel(strlist[i], " SEC_TYPE=\"([^\"]*)\"");
-                fsEntry.m_uuid = Utils::regexpLabel(strlist[i], "(?<=UUID=\").*?(?=\")");
-                fsEntry.m_label = Utils::regexpLabel(strlist[i], "(?<=LABEL=\").*?(?=\" )");
-
-                m_fileSystemInfoCache.push_back(fsEntry);
-                loadedEntries = true;
-//                qDebug() << fsEntry.m_path.m_name << fsEntry.m_type << fsEntry.m_secType << fsEntry.m_uuid << fsEntry.m_label;
-            }
+        QString path = "/dev/" + sysName;
+        QString dmName = Utils::readSysfs(sysPath + "/dm/name");
+        if (!dmName.isEmpty()) {
+            path = "/dev/mapper/" + dmName;
+        }
+        BlockSpecial::registerBlockSpecial(path, devNumber[0].toULong(), devNumber[1].toULong());
+
+        QString signature = getDeviceSignature(sysName);
+        signatures.insert(sysName, signature);
+        auto it = m_fileSystemInfoCache.find(sysName);
+        if (it != m_fileSystemInfoCache.end() && it.value().m_path.m_name == path
+                && m_deviceSignature.value(sysName) == signature) {
+            cache.insert(sysName, it.value());
+            continue;
         }
+
+        fileSystemEntry fsEntry = {BlockSpecial(path), "", "", "", false, "", ""};
+        probeFileSystem(fsEntry);
+        cache.insert(sysName, fsEntry);
+        probedCount++;
     }
-    return loadedEntries;
+
+    m_fileSystemInfoCache.swap(cache);
+    m_deviceSignature.swap(signatures);
+    rebuildIndex();
+    qDebug() << __FUNCTION__ << "block devices:" << m_fileSystemInfoCache.size() << "probed:" << probedCount;
 }
 
-const fileSystemEntry &FsInfo::getCacheEntryByPath(const QString &path)
+bool FsInfo::probeFileSystem(fileSystemEntry &fsEntry)
 {
-    BlockSpecial bs = BlockSpecial(path);
-    for (int i = 0; i < m_fileSystemInfoCache.size(); i++) {
-        if (bs == m_fileSystemInfoCache[i].m_path) {
-            return m_fileSystemInfoCache[i];
+    blkid_probe pr = blkid_new_probe_from_filename(fsEntry.m_path.m_name.toLocal8Bit().constData());
+    if (pr == nullptr) {
+        return false;
+    }
+
+    blkid_probe_enable_superblocks(pr, 1);
+    blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID | BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
+    blkid_probe_enable_partitions(pr, 1);
+    blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+
+    // 0:探测成功 1:未探测到 -2:存在多个冲突的签名 -1:出错
+    bool found = (blkid_do_safeprobe(pr) == 0);
+    if (found) {
+        const char *value = nullptr;
+        if (blkid_probe_lookup_value(pr, "TYPE", &value, nullptr) == 0) {
+            fsEntry.m_type = QString::fromUtf8(value);
+        }
+
+        if (blkid_probe_lookup_value(pr, "SEC_TYPE", &value, nullptr) == 0) {
+            fsEntry.m_secType = QString::fromUtf8(value);
+        }
+
+        if (blkid_probe_lookup_value(pr, "UUID", &value, nullptr) == 0) {
+            fsEntry.m_uuid = QString::fromUtf8(value);
+        }
+
+        // 低级接口返回的是未经blkid命令转义的原始表
+        if (blkid_probe_lookup_value(pr, "LABEL", &value, nullptr) == 0) {
+            fsEntry.m_label = QString::fromUtf8(value);
+        }
+
+        if (blkid_probe_lookup_value(pr, "PART_ENTRY_UUID", &value, nullptr) == 0) {
+            fsEntry.m_partUuid = QString::fromUtf8(value);
         }
     }
+    fsEntry.m_haveLabel = !fsEntry.m_type.isEmpty();
 
-    static fileSystemEntry notFound = {BlockSpecial(), "", "", "", false, ""};
-    return notFound;
+    blkid_free_probe(pr);
+    return found;
 }
 
-void FsInfo::loadFileSystemInfoCacheExtraForPath(const QString &path)
+QString FsInfo::getDeviceSignature(const QString &sysName)
 {
-    bool entryAdded = runBlkidLoadCache(path);
-    if (!entryAdded) {
-        // Ran "blkid PATH" but didn't find details suitable for loading as a
-        // cache entry so add a blank entry for PATH name here.
-        fileSystemEntry fsEntry = {BlockSpecial(path), "", "", "", false, ""};
-        m_fileSystemInfoCache.push_back(fsEntry);
-    }
+    QString sysPath = SYS_CLASS_BLOCK + sysName;
+    QString devNumber = Utils::readSysfs(sysPath + "/dev");
+
+    // stat第7列为写入扇区数 第14列为discard扇区数(4.18以上内核) 内容被改写时必然增加 读取及io_ticks等列随任意IO变化 不能参与比较
+    QStringList stat = Utils::readSysfs(sysPath + "/stat").split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    QString written = stat.size() > 6 ? stat.at(6) : QString();
+    QString discarded = stat.size() > 13 ? stat.at(13) : QString();
+
+    // 分区表重新读取等事件会由udev重写设备数据库 通过整盘写入等方式改写分区内容时以此兜底
+    QFileInfo udevData(QString("/run/udev/data/b%1").arg(devNumber));
+    QString udevTime = udevData.exists() ? QString::number(udevData.lastModified().toMSecsSinceEpoch()) : QString();
+
+    return QStringList({devNumber, Utils::readSysfs(sysPath + "/size"), written, discarded, udevTime}).join(",");
 }
 
-void FsInfo::updateFileSystemInfoCacheAllLabels()
+fileSystemEntry FsInfo::getCacheEntryByPath(const QString &path)
 {
-    if (!m_blkidFound) {
-        return;
+    fileSystemEntry notFound = {BlockSpecial(), "", "", "", false, "", ""};
+
+    BlockSpecial bs = BlockSpecial(path);
+    QString sysName;
+    if (bs.m_major > 0 || bs.m_minor > 0) {
+        sysName = m_devIndex.value(devIndexKey(bs.m_major, bs.m_minor));
+    } else {
+        sysName = m_nameIndex.value(bs.m_name);
     }
-    // For all cache entries which are file systems but don't yet have a label load it
-    // now.
-    for (int i = 0; i < m_fileSystemInfoCache.size(); i++) {
-        if (m_fileSystemInfoCache[i].m_type != "" && !m_fileSystemInfoCache[i].m_haveLabel) {
-            runBlkidUpdateCacheOneLabel(m_fileSystemInfoCache[i]);
-        }
+
+    auto it = m_fileSystemInfoCache.find(sysName);
+    if (sysName.isEmpty() || it == m_fileSystemInfoCache.end()) {
+        return notFound;
     }
+
+    return it.value();
 }
 
-bool FsInfo::runBlkidUpdateCacheOneLabel(fileSystemEntry &fsEntry)
+void FsInfo::rebuildIndex()
 {
-    if (!m_blkidFound) {
-        return false;
-    }
+    m_devIndex.clear();
+    m_nameIndex.clear();
+    m_uuidIndex.clear();
+    m_labelIndex.clear();
 
-    // (#786502) Run a separate blkid execution for a single partition to get the
-    // label without blkid's default non-reversible encoding.
-    QString output;
-    QString error;
-    bool success = !Utils::executCmd("blkid -o value -s LABEL " + fsEntry.m_path.m_name, output, error);
-    if (!success)
-        return false;
+    for (auto it = m_fileSystemInfoCache.begin(); it != m_fileSystemInfoCache.end(); ++it) {
+        const fileSystemEntry &fsEntry = it.value();
+        m_devIndex.insert(devIndexKey(fsEntry.m_path.m_major, fsEntry.m_path.m_minor), it.key());
+        m_nameIndex.insert(fsEntry.m_path.m_name, it.key());
 
-    size_t len = output.length();
-    if (len > 0 && output.back() == '\n') {
-        // Output is either the label with a terminating new line or zero bytes
-        // when the file system has no label.  Strip optional trailing new line
-        // from blkid output.
-        output.resize(len - 1);
+        // 与原线性查找一致 重复时取第一个
+        if (!fsEntry.m_uuid.isEmpty() && !m_uuidIndex.contains(fsEntry.m_uuid)) {
+            m_uuidIndex.insert(fsEntry.m_uuid, it.key());
+        }
+
+        if (!fsEntry.m_label.isEmpty() && !m_labelIndex.contains(fsEntry.m_label)) {
+            m_labelIndex.insert(fsEntry.m_label, it.key());
+        }
     }
-    // Update cache entry with the read label.
-    fsEntry.m_haveLabel = true;
-    fsEntry.m_label = output;
-    return true;
 }
 
 } // namespace DiskManager
@@ -30,13 +30,16 @@
 #include "blockspecial.h"
 
 #include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QMutex>
 
 namespace DiskManager {
 
 
 /**
  * @class FsInfo
- * @brief 文件系统信息类
+ * @brief 文件系统信息类 通过libblkid在进程内探测 只重新探测上次加载后发生变化的设备
  */
 
 
@@ -51,6 +54,7 @@ struct fileSystemEntry {
     QString m_uuid;           //UUID
     bool m_haveLabel;        //表标记位
     QString m_label;          //表
+    QString m_partUuid;       //分区UUID PARTUUID
 };
 
 class FsInfo
@@ -97,58 +101,58 @@ public:
      */
     static QString getUuid(const QString &path);
 
-private:
     /**
-     * @brief 初始化
+     * @brief 获取分区UUID
+     * @param path：路径
+     * @return PARTUUID
      */
-    static void initializeIfRequired();
+    static QString getPartUuid(const QString &path);
 
+private:
     /**
-     * @brief 设置找到的blkid命令
+     * @brief 初始化 调用方需持有m_cacheMutex
      */
-    static void setCommandsFound();
+    static void initializeIfRequired();
 
     /**
-     * @brief 加载文件系统信息缓存
+     * @brief 加载文件系统信息缓存 调用方需持有m_cacheMutex
      */
     static void loadFileSystemInfoCache();
 
     /**
-     * @brief 运行blkid加载缓存
-     * @param path：路径
-     * @return true成功false失败
+     * @brief 使用libblkid探测一个设备
+     * @param fsEntry：文件系统信息 m_path需已设置
+     * @return true探测到文件系统或分区表false未探测到
      */
-    static bool runBlkidLoadCache(const QString &path = "");
+    static bool probeFileSystem(fileSystemEntry &fsEntry);
 
     /**
-     * @brief 通过路径加载缓存入口
-     * @param path：路径
-     * @return 文件系统信息结构
+     * @brief 获取设备变化标识 由设备号、大小、写入扇区数及udev数据库修改时间组成
+     * @param sysName：sysfs中的设备名 例如sda1 dm-0
+     * @return 设备变化标识
      */
-    static const fileSystemEntry &getCacheEntryByPath(const QString &path);
+    static QString getDeviceSignature(const QString &sysName);
 
     /**
-     * @brief 通过额外路径加载文件系统信息缓存
+     * @brief 通过路径加载缓存入口
      * @param path：路径
+     * @return 文件系统信息结构 返回副本 调用方需持有m_cacheMutex
      */
-    static void loadFileSystemInfoCacheExtraForPath(const QString &path);
-
-    /**
-     * @brief 更新文件系统信息缓存所有表
-     */
-    static void updateFileSystemInfoCacheAllLabels();
+    static fileSystemEntry getCacheEntryByPath(const QString &path);
 
     /**
-     * @brief 运行blkid更新缓存一个表
-     * @param fsEntry:文件系统信息
-     * @return true成功false失败
+     * @brief 重建设备号、UUID、表索引
      */
-    static bool runBlkidUpdateCacheOneLabel(fileSystemEntry &fsEntry);
+    static void rebuildIndex();
 
     static bool m_fsInfoCacheInitialized;      //文件系统信息缓存初始化标记位
-    static bool m_blkidFound;                    //blkid命令是否支持标记位
-    static bool m_needBlkidVfatCacheUpdateWorkaround;    //需要blkid vfat缓存更新解决方案标记位
-    static QVector<fileSystemEntry> m_fileSystemInfoCache;      //文件系统信息缓存
+    static QMap<QString, fileSystemEntry> m_fileSystemInfoCache;      //文件系统信息缓存 key:sysfs设备名
+    static QMap<QString, QString> m_deviceSignature;    //上次探测时的设备变化标识 key:sysfs设备名
+    static QHash<quint64, QString> m_devIndex;          //设备号索引 key:主设备号<<32|次设备号
+    static QHash<QString, QString> m_nameIndex;         //路径索引 用于非块设备文件
+    static QHash<QString, QString> m_uuidIndex;         //UUID索引
+    static QHash<QString, QString> m_labelIndex;        //表索引
+    static QMutex m_cacheMutex;                         //缓存及索引互斥锁 探测线程与读取线程共用
 };
 
 } // namespace DiskManager
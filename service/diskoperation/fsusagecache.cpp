@@ -0,0 +1,112 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fsusagecache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStringList>
+
+namespace DiskManager {
+
+QMap<QString, FsUsageCache::CacheEntry> FsUsageCache::m_cache;
+QMutex FsUsageCache::m_mutex;
+
+bool FsUsageCache::load(Partition &partition)
+{
+    if (partition.m_uuid.isEmpty()) {
+        return false;
+    }
+
+    QString state = fsState(partition);
+    if (state.isEmpty()) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_cache.find(partition.m_uuid);
+    if (it == m_cache.end() || it->m_state != state || it->m_path != partition.getPath()) {
+        return false;
+    }
+
+    partition.m_sectorsUsed = it->m_sectorsUsed;
+    partition.m_sectorsUnused = it->m_sectorsUnused;
+    partition.m_sectorsUnallocated = it->m_sectorsUnallocated;
+    partition.m_significantThreshold = it->m_significantThreshold;
+    partition.m_fsBlockSize = it->m_fsBlockSize;
+    return true;
+}
+
+void FsUsageCache::save(const Partition &partition)
+{
+    if (partition.m_uuid.isEmpty() || !partition.sectorUsageKnown()) {
+        return;
+    }
+
+    QString state = fsState(partition);
+    if (state.isEmpty()) {
+        return;
+    }
+
+    CacheEntry entry;
+    entry.m_path = partition.getPath();
+    entry.m_state = state;
+    entry.m_sectorsUsed = partition.m_sectorsUsed;
+    entry.m_sectorsUnused = partition.m_sectorsUnused;
+    entry.m_sectorsUnallocated = partition.m_sectorsUnallocated;
+    entry.m_significantThreshold = partition.m_significantThreshold;
+    entry.m_fsBlockSize = partition.m_fsBlockSize;
+
+    QMutexLocker locker(&m_mutex);
+    m_cache.insert(partition.m_uuid, entry);
+}
+
+void FsUsageCache::invalidate(const QString &devicePath)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        if (it->m_path.startsWith(devicePath)) {
+            it = m_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QString FsUsageCache::fsState(const Partition &partition)
+{
+    //stat第7列为写入扇区数 文件系统工具只读不写 数值不变说明分区内容没有被修改
+    QString name = QFileInfo(QFileInfo(partition.getPath()).canonicalFilePath()).fileName();
+    QFile file(QString("/sys/class/block/%1/stat").arg(name));
+    if (name.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    QStringList fields = QString(file.readAll()).simplified().split(" ");
+    file.close();
+    if (fields.size() < 7) {
+        return QString();
+    }
+
+    return QString("%1:%2:%3").arg(partition.m_fstype).arg(partition.getSectorLength()).arg(fields.at(6));
+}
+
+} // namespace DiskManager
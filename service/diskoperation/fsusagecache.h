@@ -0,0 +1,84 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef FSUSAGECACHE_H
+#define FSUSAGECACHE_H
+#include "partition.h"
+
+#include <QMap>
+#include <QMutex>
+
+namespace DiskManager {
+
+/**
+ * @class FsUsageCache
+ * @brief 未挂载文件系统已用空间缓存 key为文件系统uuid
+ *        文件系统类型、分区大小或分区写入扇区数(/sys/class/block/xxx/stat)变化后缓存失效
+ */
+class FsUsageCache
+{
+public:
+    /**
+     * @brief 从缓存读取分区已用空间
+     * @param partition：分区信息
+     * @return true命中false未命中
+     */
+    static bool load(Partition &partition);
+
+    /**
+     * @brief 保存分区已用空间 使用空间未知或没有uuid时不保存
+     * @param partition：分区信息
+     */
+    static void save(const Partition &partition);
+
+    /**
+     * @brief 使设备及其分区的缓存失效
+     * @param devicePath：设备路径
+     */
+    static void invalidate(const QString &devicePath);
+
+private:
+    /**
+     * @struct CacheEntry
+     * @brief 缓存项
+     */
+    struct CacheEntry {
+        QString m_path;                     //分区路径
+        QString m_state;                    //文件系统状态
+        Sector m_sectorsUsed;               //已用空间
+        Sector m_sectorsUnused;             //未用空间
+        Sector m_sectorsUnallocated;        //文件系统外未分配空间
+        Sector m_significantThreshold;      //未分配空间阈值
+        Byte_Value m_fsBlockSize;           //文件系统块大小
+    };
+
+    /**
+     * @brief 获取文件系统状态 文件系统类型:分区扇区数:分区写入扇区数
+     * @param partition：分区信息
+     * @return 文件系统状态 读取失败返回空
+     */
+    static QString fsState(const Partition &partition);
+
+    static QMap<QString, CacheEntry> m_cache;   //缓存 key:文件系统uuid
+    static QMutex m_mutex;
+};
+
+} // namespace DiskManager
+#endif // FSUSAGECACHE_H
@@ -28,10 +28,17 @@
 #include <QProcess>
 #include <QTextStream>
 
+#include <libcryptsetup.h>
+#include <sys/utsname.h>
+#include <string.h>
+
 DeviceInfoMap *LUKSOperator::m_dev = nullptr;
 LVMInfo *LUKSOperator::m_lvmInfo = nullptr;
 CRYPTError LUKSOperator::m_cryErr = CRYPTError::CRYPT_ERR_NORMAL;
+CRYPT_CIPHER_Support LUKSOperator::m_cipherSupport;
+bool LUKSOperator::m_cipherSupportLoaded = false;
 static const QString saveKeyPath = "/root/.deepin-diskmanager-service";     //key文件保存位置
+static const int luks2TokensMax = 32;                                         //luks2头最多支持的token个数
 /***********************************************public****************************************************************/
 
 LUKSOperator::LUKSOperator()
@@ -194,83 +201,83 @@ void LUKSOperator::resetLuksMap(LUKSMap &luks)
 
 
 
-bool LUKSOperator::initMapper(LUKSMap &luks)
+/**
+ * @brief 读取sysfs属性文件
+ * @param path: 文件路径
+ * @return 文件内容 失败返回空
+ */
+static QString readSysfsFile(const QString &path)
 {
-    luks.m_mapper.clear();
-    QString cmd, strout, strerr;
-    cmd = QString("dmsetup ls --target crypt"); //获取所有解密的设备
-    if (Utils::executCmd(cmd, strout, strerr) != 0) {
-        return false;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
     }
+    return QString(file.readAll()).trimmed();
+}
 
-    foreach (QString str, strout.split("\n")) {
-        QStringList list = str.split("\t");
-        if (list.count() == 2) {
-            LUKS_MapperInfo mapper;
-            mapper.m_dmName = list[0];
-            mapper.m_dmPath = "/dev/mapper/" + mapper.m_dmName;
-
-            QString cmd2, strout2, strerr2;
-            cmd2 = QString(" cryptsetup status %1").arg(mapper.m_dmPath);
-            if (Utils::executCmd(cmd2, strout2, strerr2) != 0) {
-                return false;
-            }
-
-            foreach (QString str2, strout2.split("\n")) {
-                QStringList list2 = str2.split(":");
-                if (list2.count() == 2) {
-                    if (list2[0].contains("type")) {
-                        mapper.m_luskType = list2[1].trimmed();
-                    }
-
-                    if (list2[0].contains("cipher")) {
-                        mapper.m_crypt = Utils::getCipher(list2[1].trimmed());
-                    }
+bool LUKSOperator::initMapper(LUKSMap &luks)
+{
+    luks.m_mapper.clear();
+    //获取所有解密的设备 cryptsetup创建的映射dm uuid以CRYPT-开头
+    QDir dir("/sys/block");
+    foreach (const QString &dm, dir.entryList(QStringList() << "dm-*", QDir::Dirs | QDir::NoDotAndDotDot | QDir::System)) {
+        if (!readSysfsFile(QString("/sys/block/%1/dm/uuid").arg(dm)).startsWith("CRYPT-")) {
+            continue;
+        }
 
-                    if (list2[0].contains("device")) {
-                        mapper.m_devicePath = list2[1].trimmed();
-                    }
+        LUKS_MapperInfo mapper;
+        mapper.m_dmName = readSysfsFile(QString("/sys/block/%1/dm/name").arg(dm));
+        mapper.m_dmPath = "/dev/mapper/" + mapper.m_dmName;
 
-                    if (list2[0].contains("mode")) {
-                        mapper.m_mode = list2[1].trimmed();
-                    }
-                }
-            }
+        //从dm表及luks头获取类型 算法 原始设备
+        struct crypt_device *cd = nullptr;
+        QByteArray dmName = mapper.m_dmName.toUtf8();
+        if (crypt_init_by_name(&cd, dmName.constData()) < 0) {
+            return false;
+        }
 
-            auto it = m_dev->find(mapper.m_dmPath);
-            if (it != m_dev->end()) {
-                auto partIt =  it.value().m_partition.begin();
-                if (partIt != it.value().m_partition.end()) {
-                    PartitionInfo part = *partIt;
-                    mapper.m_busy = part.m_busy;
-                    mapper.m_mountPoints = part.m_mountPoints;
-                    mapper.m_luksFs = static_cast<FSType>(part.m_fileSystemType);
-                    mapper.m_fsUsed = part.m_sectorsUsed * it.value().m_sectorSize;
-                    mapper.m_fsUnused = part.m_sectorsUnused * it.value().m_sectorSize;
-                    mapper.m_Size = Utils::LVMFormatSize(mapper.m_fsUsed + mapper.m_fsUnused);
-                    mapper.m_uuid = part.m_uuid;
-                    mapper.m_fsLimits = part.m_fsLimits;
-                    if (FS_FAT32 == mapper.m_luksFs || FS_FAT16 == mapper.m_luksFs) {
-                        mapper.m_fsLimits = FS_Limits(-1, -1); //fat格式不支持逻辑卷的扩展缩小
-                    } else if (FS_UNALLOCATED ==   mapper.m_luksFs) { //empty fs , no limits
-                        mapper.m_fsLimits = FS_Limits(0, 0);
-                    }
+        const char *type = crypt_get_type(cd);
+        mapper.m_luskType = type ? QString(type) : QString();
+        mapper.m_crypt = Utils::getCipher(QString("%1-%2").arg(crypt_get_cipher(cd)).arg(crypt_get_cipher_mode(cd)));
+        mapper.m_devicePath = crypt_get_device_name(cd);
+        struct crypt_active_device cad;
+        bool readonly = crypt_get_active_device(cd, dmName.constData(), &cad) == 0 && (cad.flags & CRYPT_ACTIVATE_READONLY);
+        mapper.m_mode = readonly ? "readonly" : "read/write";
+        crypt_free(cd);
+
+        auto it = m_dev->find(mapper.m_dmPath);
+        if (it != m_dev->end()) {
+            auto partIt =  it.value().m_partition.begin();
+            if (partIt != it.value().m_partition.end()) {
+                PartitionInfo part = *partIt;
+                mapper.m_busy = part.m_busy;
+                mapper.m_mountPoints = part.m_mountPoints;
+                mapper.m_luksFs = static_cast<FSType>(part.m_fileSystemType);
+                mapper.m_fsUsed = part.m_sectorsUsed * it.value().m_sectorSize;
+                mapper.m_fsUnused = part.m_sectorsUnused * it.value().m_sectorSize;
+                mapper.m_Size = Utils::LVMFormatSize(mapper.m_fsUsed + mapper.m_fsUnused);
+                mapper.m_uuid = part.m_uuid;
+                mapper.m_fsLimits = part.m_fsLimits;
+                if (FS_FAT32 == mapper.m_luksFs || FS_FAT16 == mapper.m_luksFs) {
+                    mapper.m_fsLimits = FS_Limits(-1, -1); //fat格式不支持逻辑卷的扩展缩小
+                } else if (FS_UNALLOCATED ==   mapper.m_luksFs) { //empty fs , no limits
+                    mapper.m_fsLimits = FS_Limits(0, 0);
                 }
             }
+        }
 
-            bool labelFound = false;
-            QString label = DiskManager::FsInfo::getLabel(mapper.m_dmPath, labelFound);
-            if (labelFound) {
-                mapper.m_fileSystemLabel = label;
-            }
-
-            if (m_lvmInfo->pvExists(mapper.m_dmPath)) {
-                PVInfo pv = m_lvmInfo->getPV(mapper.m_dmPath);
-                mapper.m_vgflag = pv.joinVG() ? LVMFlag::LVM_FLAG_JOIN_VG : LVMFlag::LVM_FLAG_NOT_JOIN_VG;
-            }
+        bool labelFound = false;
+        QString label = DiskManager::FsInfo::getLabel(mapper.m_dmPath, labelFound);
+        if (labelFound) {
+            mapper.m_fileSystemLabel = label;
+        }
 
-            luks.m_mapper.insert(mapper.m_devicePath, mapper);
+        if (m_lvmInfo->pvExists(mapper.m_dmPath)) {
+            PVInfo pv = m_lvmInfo->getPV(mapper.m_dmPath);
+            mapper.m_vgflag = pv.joinVG() ? LVMFlag::LVM_FLAG_JOIN_VG : LVMFlag::LVM_FLAG_NOT_JOIN_VG;
         }
+
+        luks.m_mapper.insert(mapper.m_devicePath, mapper);
     }
 
     return true;
@@ -278,6 +285,12 @@ bool LUKSOperator::initMapper(LUKSMap &luks)
 
 bool LUKSOperator::getCIPHERSupport(CRYPT_CIPHER_Support &support)
 {
+    //内核模块及配置在运行期间不会变化 只获取一次
+    if (m_cipherSupportLoaded) {
+        support = m_cipherSupport;
+        return true;
+    }
+
     QString cmd, strout, strerr;
     QStringList cipherList = {"aes", "sm4"}; //后续有算法添加 在此处增加算法名称
 
@@ -304,12 +317,12 @@ bool LUKSOperator::getCIPHERSupport(CRYPT_CIPHER_Support &support)
     }
 
     //通过/boot/config-$(uname -r)获取是否支持加密
-    cmd = QString("uname -r");
-    if (Utils::executCmd(cmd, strout, strerr) != 0) {
+    struct utsname name;
+    if (uname(&name) != 0) {
         return false;
     }
 
-    QString filePath = QString(QString("/boot/config-%1").arg(strout)).replace("\n", "");
+    QString filePath = QString("/boot/config-%1").arg(name.release);
     bool dm = false, aes = false, sm4 = false;
 
     QFile file(filePath);
@@ -345,14 +358,15 @@ bool LUKSOperator::getCIPHERSupport(CRYPT_CIPHER_Support &support)
         }
 
     }
+    m_cipherSupport = support;
+    m_cipherSupportLoaded = true;
     return true;
 }
 
 bool LUKSOperator::getLUKSInfo(const LUKSMap &luks, const QString &devPath, LUKS_INFO &info)
 {
-    QString cmd, strout, strerr;
-    cmd = QString("cryptsetup luksDump %1 --debug-json").arg(devPath);
-    if (Utils::executCmd(cmd, strout, strerr) != 0) {
+    struct crypt_device *cd = nullptr;
+    if (!loadLUKSHeader(devPath, &cd)) {
         return false;
     }
     info.m_tokenList.clear();
@@ -362,16 +376,10 @@ bool LUKSOperator::getLUKSInfo(const LUKSMap &luks, const QString &devPath, LUKS
     if (info.isDecrypt) {
         info.m_mapper = luks.getMapper(devPath);
     }
-    //解析字符串 获取版本与uuid
-    foreach (QString str, strout.split("\n")) {
-        if (str.contains("Version:")) {
-            info.m_luksVersion = str.replace("Version:", "").toInt();
-        }
-
-        if (str.contains("UUID:")) {
-            info.m_dmUUID = str.replace("UUID:", "").trimmed();
-        }
-    }
+    //获取版本与uuid
+    const char *type = crypt_get_type(cd);
+    info.m_luksVersion = (type && 0 == strcmp(type, CRYPT_LUKS2)) ? 2 : 1;
+    info.m_dmUUID = crypt_get_uuid(cd);
 
     bool labelFound = false;
     QString label = DiskManager::FsInfo::getLabel(info.m_devicePath, labelFound);
@@ -379,11 +387,75 @@ bool LUKSOperator::getLUKSInfo(const LUKSMap &luks, const QString &devPath, LUKS
         info.m_fileSystemLabel = label;
     }
 
-    //解析json 获取luks数据
-    int jsonBegin = strout.indexOf("# {");
-    int jsonEnd = strout.indexOf("}\nLUKS header information"); //截取json字符串
+    //按luksDump --debug-json的结构组装tokens keyslots segments
+    QJsonObject tokens;
+    if (2 == info.m_luksVersion) {
+        for (int i = 0; i < luks2TokensMax; ++i) {
+            crypt_token_info tokenInfo = crypt_token_status(cd, i, nullptr);
+            if (CRYPT_TOKEN_INACTIVE == tokenInfo || CRYPT_TOKEN_INVALID == tokenInfo) {
+                continue;
+            }
+
+            const char *json = nullptr;
+            if (crypt_token_json_get(cd, i, &json) >= 0 && json) {
+                tokens.insert(QString::number(i), QJsonDocument::fromJson(QByteArray(json)).object());
+            }
+        }
+    }
 
-    return jsonToLUKSInfo(strout.mid(jsonBegin + 1, jsonEnd - jsonBegin + 1), info);
+    QJsonObject keyslots;
+    int keyslotMax = crypt_keyslot_max(type);
+    for (int i = 0; i < keyslotMax; ++i) {
+        crypt_keyslot_info slotInfo = crypt_keyslot_status(cd, i);
+        if (CRYPT_SLOT_ACTIVE == slotInfo || CRYPT_SLOT_ACTIVE_LAST == slotInfo) {
+            keyslots.insert(QString::number(i), QJsonObject());
+        }
+    }
+
+    QJsonObject segment;
+    segment.insert("encryption", QString("%1-%2").arg(crypt_get_cipher(cd)).arg(crypt_get_cipher_mode(cd)));
+    QJsonObject segments;
+    segments.insert("0", segment);
+    crypt_free(cd);
+
+    QJsonObject obj;
+    obj.insert("tokens", tokens);
+    obj.insert("keyslots", keyslots);
+    obj.insert("segments", segments);
+    return jsonToLUKSInfo(QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact)), info);
+}
+
+bool LUKSOperator::loadLUKSHeader(const QString &devPath, crypt_device **cd)
+{
+    QByteArray path = devPath.toUtf8();
+    if (crypt_init(cd, path.constData()) < 0) {
+        *cd = nullptr;
+        return false;
+    }
+
+    if (crypt_load(*cd, CRYPT_LUKS, nullptr) < 0) {
+        crypt_free(*cd);
+        *cd = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool LUKSOperator::activateByPassphrase(const LUKS_INFO &luks, const QString &dmName)
+{
+    struct crypt_device *cd = nullptr;
+    if (!loadLUKSHeader(luks.m_devicePath, &cd)) {
+        return false;
+    }
+
+    //dmName为空时只校验密码 不创建映射
+    QByteArray name = dmName.toUtf8();
+    QByteArray passphrase = luks.m_decryptStr.toUtf8();
+    int ret = crypt_activate_by_passphrase(cd, dmName.isEmpty() ? nullptr : name.constData(), CRYPT_ANY_SLOT,
+                                           passphrase.constData(), static_cast<size_t>(passphrase.size()), 0);
+    crypt_free(cd);
+    return ret >= 0;
 }
 
 bool LUKSOperator::jsonToLUKSInfo(QString jsonStr, LUKS_INFO &info)
@@ -477,9 +549,13 @@ bool LUKSOperator::jsonToLUKSInfo(QString jsonStr, LUKS_INFO &info)
 
 bool LUKSOperator::isLUKS(QString devPath)
 {
-    QString cmd, strout, strerr;
-    cmd = QString("cryptsetup isLuks %1").arg(devPath);
-    return  Utils::executCmd(cmd, strout, strerr) == 0;
+    struct crypt_device *cd = nullptr;
+    if (!loadLUKSHeader(devPath, &cd)) {
+        return false;
+    }
+
+    crypt_free(cd);
+    return true;
 }
 
 bool LUKSOperator::format(const LUKS_INFO &luks)
@@ -500,39 +576,30 @@ bool LUKSOperator::format(const LUKS_INFO &luks)
 
 bool LUKSOperator::open(const LUKS_INFO &luks)
 {
-    QProcess proc;
-    QStringList options;
-    options << "-c" << QString("echo -n '%1' | cryptsetup open %2 %3 -q")
-            .arg(luks.m_decryptStr)
-            .arg(luks.m_devicePath)
-            .arg(luks.m_mapper.m_dmName);
-    proc.start("/bin/bash", options);
-    proc.waitForFinished(-1);
-    proc.waitForReadyRead();//
-    proc.close();
-    return proc.exitCode() == 0;
+    return activateByPassphrase(luks, luks.m_mapper.m_dmName);
 }
 
 bool LUKSOperator::testKey(const LUKS_INFO &luks)
 {
-    QProcess proc;
-    QStringList options;
-    options << "-c" << QString("echo -n '%1' | cryptsetup open --test-passphrase  %2 %3 -q")
-            .arg(luks.m_decryptStr)
-            .arg(luks.m_devicePath)
-            .arg(luks.m_mapper.m_dmName);
-    proc.start("/bin/bash", options);
-    proc.waitForFinished(-1);
-    proc.waitForReadyRead();//
-    proc.close();
-    return proc.exitCode() == 0;
+    return activateByPassphrase(luks, QString());
 }
 
 bool LUKSOperator::close(const LUKS_INFO &luks)
 {
-    QString cmd, strout, strerr;
-    cmd = QString("cryptsetup close %1").arg(luks.m_mapper.m_dmPath);
-    return Utils::executCmd(cmd, strout, strerr) == 0;
+    QString dmName = luks.m_mapper.m_dmName;
+    if (dmName.isEmpty()) {
+        dmName = luks.m_mapper.m_dmPath.mid(QString("/dev/mapper/").length());
+    }
+
+    struct crypt_device *cd = nullptr;
+    QByteArray name = dmName.toUtf8();
+    if (crypt_init_by_name(&cd, name.constData()) < 0) {
+        return false;
+    }
+
+    int ret = crypt_deactivate(cd, name.constData());
+    crypt_free(cd);
+    return ret == 0;
 }
 
 bool LUKSOperator::addToken(const LUKS_INFO &luks, QStringList list, int number)
@@ -24,6 +24,8 @@
 #include "lvmstruct.h"
 #include "deviceinfo.h"
 
+struct crypt_device;
+
 class LUKSOperator
 {
 public:
@@ -111,6 +113,22 @@ private:
      */
     static bool getLUKSInfo(const LUKSMap &luks, const QString &devPath, LUKS_INFO &info);
 
+    /**
+     * @brief 加载luks头
+     * @param devPath: 设备路径
+     * @param cd: 返回libcryptsetup设备上下文 成功时需要调用crypt_free释放
+     * @return true 成功 false 非luks设备或读取失败
+     */
+    static bool loadLUKSHeader(const QString &devPath, crypt_device **cd);
+
+    /**
+     * @brief 通过密码打开映射
+     * @param luks: luks属性结构体
+     * @param dmName: 映射名称 为空时只校验密码
+     * @return true 成功 false 失败
+     */
+    static bool activateByPassphrase(const LUKS_INFO &luks, const QString &dmName);
+
     /**
      * @brief 通过json解析luks属性
      * @param json: luks属性json字符串
@@ -220,6 +238,8 @@ private:
     static DeviceInfoMap *m_dev;
     static LVMInfo *m_lvmInfo;
     static CRYPTError m_cryErr;
+    static CRYPT_CIPHER_Support m_cipherSupport;    //算法支持缓存
+    static bool m_cipherSupportLoaded;              //算法支持是否已获取
 };
 
 #endif // LUKSOPERATOR_H
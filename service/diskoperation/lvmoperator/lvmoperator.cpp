@@ -20,10 +20,15 @@
 */
 #include "lvmoperator.h"
 #include "utils.h"
+#include "commandexecutor.h"
 #include "mountinfo.h"
 #include "../fsinfo.h"
 
 #include <QStringList>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDir>
+#include <QFile>
 #include <QDebug>
 #include <set>
 
@@ -35,6 +40,9 @@ bool LVMOperator::m_initSupport = false;
 DeviceInfoMap LVMOperator::m_devInfo;
 SupportedFileSystems LVMOperator::m_supportFs;
 LVMError LVMOperator::m_lvmErr = LVM_ERR_NORMAL;
+QMap<QString, VGReportCache> LVMOperator::m_vgCache;
+QMap<QString, PVReportCache> LVMOperator::m_pvCache;
+QMutex LVMOperator::m_cacheMutex;
 /******************************** 初始化操作 ******************************/
 LVMOperator::LVMOperator()
 {
@@ -166,11 +174,282 @@ bool LVMOperator::updateLVMInfo(LVMInfo &lvmInfo)
 {
     initSuport();
     resetLVMInfo(lvmInfo);
+
+    //刷新线程与界面操作都会更新lvm信息 缓存的读写需要加锁
+    QMutexLocker locker(&m_cacheMutex);
+    //存在重名vg且无法更名时 与原流程一致不提供vg信息
+    if (!refreshLVMReport()) {
+        updatePVInfo(lvmInfo);
+        return setLVMErr(lvmInfo, LVMError::LVM_ERR_VG_ALREADY_EXISTS);
+    }
     updateVGInfo(lvmInfo);
     updatePVInfo(lvmInfo);
     return setLVMErr(lvmInfo, LVMError::LVM_ERR_NORMAL);
 }
 
+bool LVMOperator::refreshLVMReport()
+{
+    if (LVM_CMD_Support::NONE == m_lvmSupport.LVM_CMD_pvs) {
+        m_vgCache.clear();
+        m_pvCache.clear();
+        return true;
+    }
+
+    //轻量查询 只获取pv集合及vg元数据序号 lvm元数据每次修改vg_seqno都会递增
+    QMap<QString, QJsonObject> pvKeys;
+    QMap<QString, QString> vgSeqnos;
+    QMap<QString, QString> vgNames;
+    foreach (const QJsonObject &obj, getLVMReport("pvs --reportformat json --units b --nosuffix "
+                                                  "-o pv_name,pv_uuid,pv_size,pv_attr,vg_uuid,vg_name,vg_seqno")) {
+        QString pvPath = obj.value("pv_name").toString().trimmed();
+        if (pvPath.isEmpty()) {
+            continue;
+        }
+        pvKeys.insert(pvPath, obj);
+        QString vgUuid = obj.value("vg_uuid").toString().trimmed();
+        if (!vgUuid.isEmpty()) {
+            vgSeqnos.insert(vgUuid, obj.value("vg_seqno").toString());
+            vgNames.insert(vgUuid, obj.value("vg_name").toString().trimmed());
+        }
+    }
+
+    //lv激活/挂起不修改元数据 需要从dm状态判断
+    QMap<QString, QString> activeLVs = getActiveLVs();
+
+    QStringList changedVGs;
+    bool newVG = false;
+    for (QMap<QString, QString>::ConstIterator it = vgSeqnos.begin(); it != vgSeqnos.end(); ++it) {
+        QString active = activeLVs.value(QString(it.key()).remove('-'));
+        auto cacheIt = m_vgCache.find(it.key());
+        if (cacheIt == m_vgCache.end()) {
+            newVG = true;
+            changedVGs << it.key();
+        } else if (cacheIt->m_seqno != it.value() || cacheIt->m_activeLVs != active) {
+            changedVGs << it.key();
+        }
+    }
+
+    //查看是否有重名vg存在 如果存在 将其中一个vg更换名称 只有出现新vg时才可能重名
+    //更名失败时不更新缓存 下次刷新重新检查
+    if (newVG && !checkVG()) {
+        return false;
+    }
+
+    for (auto it = m_vgCache.begin(); it != m_vgCache.end();) {
+        it = vgSeqnos.contains(it.key()) ? it + 1 : m_vgCache.erase(it);
+    }
+
+    QStringList changedPVs;
+    for (QMap<QString, QJsonObject>::ConstIterator it = pvKeys.begin(); it != pvKeys.end(); ++it) {
+        auto cacheIt = m_pvCache.find(it.key());
+        if (cacheIt == m_pvCache.end() || cacheIt->m_keyRow != it.value()
+                || changedVGs.contains(it.value().value("vg_uuid").toString().trimmed())) {
+            changedPVs << it.key();
+        }
+    }
+
+    for (auto it = m_pvCache.begin(); it != m_pvCache.end();) {
+        it = pvKeys.contains(it.key()) ? it + 1 : m_pvCache.erase(it);
+    }
+
+    if (changedVGs.isEmpty() && changedPVs.isEmpty()) {
+        return true;
+    }
+
+    //只重新读取变化的vg及pv 各报告命令并发执行
+    QStringList cmds;
+    int vgsIndex = -1, lvsIndex = -1, pvsIndex = -1, segIndex = -1;
+    if (!changedVGs.isEmpty()) {
+        QString select = getSelection("vg_uuid", changedVGs, vgSeqnos.size());
+        foreach (const QString &vgUuid, changedVGs) {
+            VGReportCache cache;
+            cache.m_seqno = vgSeqnos.value(vgUuid);
+            cache.m_activeLVs = activeLVs.value(QString(vgUuid).remove('-'));
+            cache.m_vgRow.insert("vg_name", vgNames.value(vgUuid));
+            m_vgCache[vgUuid] = cache;
+        }
+
+        if (m_lvmSupport.LVM_CMD_vgs != LVM_CMD_Support::NONE) {
+            vgsIndex = cmds.size();
+            cmds << "vgs --reportformat json --units b --nosuffix "
+                 "-o vg_uuid,vg_name,vg_size,vg_free,pv_count,vg_extent_count,vg_free_count,"
+                 "lv_count,vg_extent_size,vg_attr" + select;
+        }
+
+        if (LVM_CMD_Support::NONE != m_lvmSupport.LVM_CMD_lvs) {
+            lvsIndex = cmds.size();
+            cmds << "lvs --reportformat json --units b --nosuffix "
+                 "-o lv_path,lv_name,lv_uuid,lv_attr,lv_size,vg_uuid" + select;
+        }
+    }
+
+    if (!changedPVs.isEmpty()) {
+        QString select = getSelection("pv_name", changedPVs, pvKeys.size());
+        foreach (const QString &pvPath, changedPVs) {
+            PVReportCache cache;
+            cache.m_keyRow = pvKeys.value(pvPath);
+            m_pvCache[pvPath] = cache;
+        }
+
+        pvsIndex = cmds.size();
+        cmds << "pvs --reportformat json --units b --nosuffix "
+             "-o pv_name,vg_name,pv_fmt,pv_size,pv_free,pv_uuid,pv_mda_count,pv_attr,"
+             "pv_pe_alloc_count,pv_pe_count,pv_mda_size,vg_extent_size,vg_uuid" + select;
+        segIndex = cmds.size();
+        cmds << "pvs --segments --reportformat json "
+             "-o pv_name,seg_type,pvseg_start,pvseg_size,lv_path,lv_name" + select;
+    }
+
+    QVector<QList<QJsonObject>> reports = getLVMReports(cmds);
+
+    foreach (const QJsonObject &obj, reports.value(vgsIndex)) {
+        auto it = m_vgCache.find(obj.value("vg_uuid").toString().trimmed());
+        if (it != m_vgCache.end()) {
+            it->m_vgRow = obj;
+        }
+    }
+
+    foreach (const QJsonObject &obj, reports.value(lvsIndex)) {
+        auto it = m_vgCache.find(obj.value("vg_uuid").toString().trimmed());
+        if (it != m_vgCache.end()) {
+            it->m_lvRows.append(obj);
+        }
+    }
+
+    foreach (const QJsonObject &obj, reports.value(pvsIndex)) {
+        auto it = m_pvCache.find(obj.value("pv_name").toString().trimmed());
+        if (it != m_pvCache.end()) {
+            it->m_pvRow = obj;
+        }
+    }
+
+    foreach (const QJsonObject &obj, reports.value(segIndex)) {
+        auto it = m_pvCache.find(obj.value("pv_name").toString().trimmed());
+        if (it != m_pvCache.end()) {
+            it->m_segRows.append(obj);
+        }
+    }
+
+    if (!changedPVs.isEmpty()) {
+        //设备类型
+        QString strout, strerror;
+        Utils::executCmd("lsblk -J -l -p -o NAME,TYPE", strout, strerror);
+        QJsonArray blockDevices = QJsonDocument::fromJson(strout.toLocal8Bit()).object().value("blockdevices").toArray();
+        foreach (const QJsonValue &value, blockDevices) {
+            auto it = m_pvCache.find(value.toObject().value("name").toString());
+            if (it != m_pvCache.end()) {
+                it->m_devType = value.toObject().value("type").toString();
+            }
+        }
+    }
+
+    //读取失败时下次刷新重新读取
+    for (auto it = m_vgCache.begin(); it != m_vgCache.end(); ++it) {
+        if (!it->m_vgRow.contains("vg_size")) {
+            it->m_seqno.clear();
+        }
+    }
+
+    for (auto it = m_pvCache.begin(); it != m_pvCache.end(); ++it) {
+        if (it->m_pvRow.isEmpty()) {
+            it->m_keyRow = QJsonObject();
+        }
+    }
+
+    return true;
+}
+
+QMap<QString, QString> LVMOperator::getActiveLVs()
+{
+    //dm uuid格式: LVM-<vg uuid(去掉'-')><lv uuid(去掉'-')>[-后缀]
+    QMap<QString, QString> activeLVs;
+    QDir dir("/sys/block");
+    foreach (const QString &name, dir.entryList(QStringList() << "dm-*", QDir::Dirs | QDir::NoDotAndDotDot | QDir::System)) {
+        QFile uuidFile(QString("/sys/block/%1/dm/uuid").arg(name));
+        if (!uuidFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QString uuid = QString(uuidFile.readAll()).trimmed();
+        if (!uuid.startsWith("LVM-") || uuid.length() < 36) {
+            continue;
+        }
+
+        QFile suspendedFile(QString("/sys/block/%1/dm/suspended").arg(name));
+        QString suspended = suspendedFile.open(QIODevice::ReadOnly) ? QString(suspendedFile.readAll()).trimmed() : QString();
+        QString &active = activeLVs[uuid.mid(4, 32)];
+        QStringList list = active.isEmpty() ? QStringList() : active.split(";");
+        list << QString("%1:%2").arg(uuid).arg(suspended);
+        list.sort();
+        active = list.join(";");
+    }
+
+    return activeLVs;
+}
+
+QString LVMOperator::getSelection(const QString &field, const QStringList &values, int total)
+{
+    //全部变化时不需要过滤
+    if (values.size() >= total) {
+        return QString();
+    }
+
+    QStringList select;
+    foreach (const QString &value, values) {
+        select << QString("%1=%2").arg(field).arg(value);
+    }
+    return QString(" -S %1").arg(select.join("||"));
+}
+
+QList<QJsonObject> LVMOperator::getLVMReport(const QString &cmd)
+{
+    QString strout, strerror;
+    Utils::executCmd(cmd, strout, strerror);
+    return parseLVMReport(cmd, strout);
+}
+
+QVector<QList<QJsonObject>> LVMOperator::getLVMReports(const QStringList &cmds)
+{
+    QVector<CommandRequest> requests;
+    foreach (const QString &cmd, cmds) {
+        CommandRequest request;
+        QStringList list = cmd.split(" ", QString::SkipEmptyParts);
+        request.m_program = list.takeFirst();
+        request.m_args = list;
+        requests.append(request);
+    }
+
+    QVector<CommandResult> results = CommandExecutor::runBatch(requests);
+    QVector<QList<QJsonObject>> reports;
+    for (int i = 0; i < results.size(); i++) {
+        reports.append(parseLVMReport(cmds.at(i), results.at(i).m_output));
+    }
+
+    return reports;
+}
+
+QList<QJsonObject> LVMOperator::parseLVMReport(const QString &cmd, const QString &output)
+{
+    //json格式: {"report": [{"pv": [{"pv_name":"/dev/sda1", ...}, ...]}]}
+    QList<QJsonObject> rows;
+    QJsonParseError jsonErr;
+    QJsonDocument json = QJsonDocument::fromJson(output.toLocal8Bit(), &jsonErr);
+    if (jsonErr.error != QJsonParseError::NoError || !json.isObject()) {
+        qDebug() << __FUNCTION__ << cmd << jsonErr.errorString();
+        return rows;
+    }
+
+    foreach (const QJsonValue &report, json.object().value("report").toArray()) {
+        QJsonObject reportObj = report.toObject();
+        for (QJsonObject::ConstIterator it = reportObj.begin(); it != reportObj.end(); ++it) {
+            foreach (const QJsonValue &row, it.value().toArray()) {
+                rows.append(row.toObject());
+            }
+        }
+    }
+
+    return rows;
+}
+
 bool LVMOperator::updatePVInfo(LVMInfo &lvmInfo)
 {
     if (Utils::findProgramInPath("lsblk").isEmpty() || LVM_CMD_Support::NONE == m_lvmSupport.LVM_CMD_pvs) {
@@ -179,76 +458,60 @@ bool LVMOperator::updatePVInfo(LVMInfo &lvmInfo)
 
     lvmInfo.m_pvInfo.clear();
 
-    QString strout, strerror;
-    Utils::executCmd("pvs --noheadings -o pv_name", strout, strerror);
-    strout = strout.trimmed();
-    foreach (QString str, strout.split("\n")) {
-        if (str.isEmpty()) {
+    foreach (const PVReportCache &cache, m_pvCache) {
+        const QJsonObject &obj = cache.m_pvRow;
+        PVInfo pv;
+        pv.m_pvPath = obj.value("pv_name").toString().trimmed();
+        if (pv.m_pvPath.isEmpty()) {
             continue;
         }
 
-        PVInfo pv;
-        pv.m_pvPath = str.trimmed();
-        QString cmd = QString("pvs %1  --units b --noheadings --separator # "
-                              "-o vg_name,pv_fmt,pv_size,pv_free,pv_uuid,pv_mda_count,pv_attr,"
-                              "pv_pe_alloc_count,pv_pe_count,pv_mda_size,vg_extent_size,vg_uuid"
-                              "").arg(pv.m_pvPath);
-        Utils::executCmd(cmd, strout, strerror);
-        QStringList pvsRes = strout.split("#");
-
         //获取基本属性
-        pv.m_vgName = getStringListItem(pvsRes, 0).trimmed();
-        pv.m_pvFmt = getStringListItem(pvsRes, 1).trimmed();
-        pv.m_pvByteTotalSize = getStringListItem(pvsRes, 2).trimmed().replace('B', "").toLongLong();
-        pv.m_pvByteFreeSize = getStringListItem(pvsRes, 3).trimmed().replace('B', "").toLongLong();
+        pv.m_vgName = obj.value("vg_name").toString().trimmed();
+        pv.m_pvFmt = obj.value("pv_fmt").toString().trimmed();
+        pv.m_pvByteTotalSize = obj.value("pv_size").toString().toLongLong();
+        pv.m_pvByteFreeSize = obj.value("pv_free").toString().toLongLong();
         pv.m_pvSize = Utils::LVMFormatSize(pv.m_pvByteTotalSize);
         pv.m_pvFree = Utils::LVMFormatSize(pv.m_pvByteFreeSize);
-        pv.m_pvUuid = getStringListItem(pvsRes, 4).trimmed();
-        pv.m_pvMdaCount = getStringListItem(pvsRes, 5).toInt();
-        pv.m_pvStatus = getStringListItem(pvsRes, 6).trimmed();
-        pv.m_pvUsedPE = getStringListItem(pvsRes, 7).toInt();
-        pv.m_pvUnusedPE = getStringListItem(pvsRes, 8).toInt() - pv.m_pvUsedPE;
-        pv.m_pvMdaSize = getStringListItem(pvsRes, 9).replace('B', "").toInt();
-        pv.m_PESize = getStringListItem(pvsRes, 10).replace('B', "").toInt();
-        pv.m_vgUuid = getStringListItem(pvsRes, 11).trimmed();
+        pv.m_pvUuid = obj.value("pv_uuid").toString().trimmed();
+        pv.m_pvMdaCount = obj.value("pv_mda_count").toString().toInt();
+        pv.m_pvStatus = obj.value("pv_attr").toString().trimmed();
+        pv.m_pvUsedPE = obj.value("pv_pe_alloc_count").toString().toInt();
+        pv.m_pvUnusedPE = obj.value("pv_pe_count").toString().toInt() - pv.m_pvUsedPE;
+        pv.m_pvMdaSize = obj.value("pv_mda_size").toString().toInt();
+        pv.m_PESize = obj.value("vg_extent_size").toString().toInt();
+        pv.m_vgUuid = obj.value("vg_uuid").toString().trimmed();
 
         //设备类型
-        cmd = QString("lsblk %1 -o type -nd").arg(pv.m_pvPath);
-        Utils::executCmd(cmd, strout, strerror);
-        if (strout.contains("part")) {
+        const QString &type = cache.m_devType;
+        if (type.contains("part")) {
             pv.m_lvmDevType = DevType::DEV_PARTITION;
-        } else if (strout.contains("disk")) {
+        } else if (type.contains("disk")) {
             pv.m_lvmDevType = DevType::DEV_DISK;
-        } else if (strout.contains("loop")) {
+        } else if (type.contains("loop")) {
             pv.m_lvmDevType = DevType::DEV_LOOP;
-        } else if (strout.contains("raid")) {
+        } else if (type.contains("raid")) {
             pv.m_lvmDevType = DevType::DEV_META_DEVICES;
-        } else if (strout.contains("crypt")) {
+        } else if (type.contains("crypt")) {
             pv.m_lvmDevType = DevType::DEV_META_DEVICES;
         } else {
             pv.m_lvmDevType = DevType::DEV_UNKNOW_DEVICES;
         }
 
         //pv上pe使用情况
-        cmd = QString("pvs %1 -o seg_type,pvseg_all,lv_path,lv_name --noheadings  --separator ### ").arg(pv.m_pvPath);
-        Utils::executCmd(cmd, strout, strerror);
-        foreach (QString str, strout.split("\n")) {
-            QStringList list = str.trimmed().split("###");
-            if (list.size() < 4) {
-                continue;
-            }
+        foreach (const QJsonObject &seg, cache.m_segRows) {
             QVector<LV_PV_Ranges>lvVec;
             VG_PV_Ranges vgRanges;
             vgRanges.m_vgName = pv.m_vgName;
             vgRanges.m_vgUuid = pv.m_vgUuid;
             vgRanges.m_used = false;
-            vgRanges.m_start = getStringListItem(list, 1).toLongLong();
-            vgRanges.m_end = getStringListItem(list, 2).toLongLong() + vgRanges.m_start - 1;
-            if (!list[0].contains("free")) {
+            vgRanges.m_start = seg.value("pvseg_start").toString().toLongLong();
+            vgRanges.m_end = seg.value("pvseg_size").toString().toLongLong() + vgRanges.m_start - 1;
+            if (!seg.value("seg_type").toString().contains("free")) {
                 vgRanges.m_used = true;
                 LV_PV_Ranges lvRanges = vgRanges;
-                lvRanges.m_devPath = getStringListItem(list, 3);
-                lvRanges.m_lvName = getStringListItem(list, 4);
+                lvRanges.m_devPath = seg.value("lv_path").toString();
+                lvRanges.m_lvName = seg.value("lv_name").toString();
                 lvVec.push_back(lvRanges);
                 pv.m_lvRangesList.insert(lvRanges.m_devPath, lvVec);
             }
@@ -268,60 +531,43 @@ bool LVMOperator::updateVGInfo(LVMInfo &lvmInfo)
     if (m_lvmSupport.LVM_CMD_vgs == LVM_CMD_Support::NONE) {
         return setLVMErr(lvmInfo, LVMError::LVM_ERR_NO_CMD_SUPPORT);
     }
-    //查看是否有重名vg存在 如果存在 将其中一个vg更换名称
-    if (!checkVG()) {
-        return setLVMErr(lvmInfo, LVMError::LVM_ERR_VG_ALREADY_EXISTS);
-    }
 
     lvmInfo.m_vgInfo.clear();
 
-    QString strout, strerror;
-    Utils::executCmd("vgs --noheadings -o vg_uuid", strout, strerror);
-    strout = strout.trimmed();
-
-    foreach (QString str, strout.split("\n")) {
-        if (str.isEmpty()) {
-            continue;
-        }
-
+    for (QMap<QString, VGReportCache>::ConstIterator it = m_vgCache.begin(); it != m_vgCache.end(); ++it) {
+        const QJsonObject &obj = it->m_vgRow;
         VGInfo vg;
-        vg.m_vgUuid = str.trimmed();
-
-        QString cmd = QString("vgs -S vg_uuid=%1 --units b --noheadings --separator # "
-                              "-o vg_name,vg_size,vg_free,pv_count,vg_extent_count,vg_free_count,lv_count,vg_extent_size,vg_attr "
-                              "").arg(vg.m_vgUuid);
-        Utils::executCmd(cmd, strout, strerror);
-        QStringList vgsRes = getStringListItem(strout.split("\n"), 0).split("#");
-        if (vgsRes.size() < 9) {
+        vg.m_vgUuid = it.key();
+
+        vg.m_vgName = obj.value("vg_name").toString().trimmed();
+        if (!obj.contains("vg_size") || !obj.contains("vg_attr")) {
             vg.m_vgError = LVMError::LVM_ERR_VG;
-            vg.m_vgName = getStringListItem(vgsRes, 0).trimmed();
             lvmInfo.m_vgInfo.insert(vg.m_vgName, vg);
             continue;
         }
 
         //获取基本属性
-        vg.m_vgName = getStringListItem(vgsRes, 0).trimmed();
-        long long Size = getStringListItem(vgsRes, 1).trimmed().replace('B', "").toLongLong();
-        long long unUsed = getStringListItem(vgsRes, 2).trimmed().replace('B', "").toLongLong();
+        long long Size = obj.value("vg_size").toString().toLongLong();
+        long long unUsed = obj.value("vg_free").toString().toLongLong();
         vg.m_vgSize = Utils::LVMFormatSize(Size);
         vg.m_vgUnused = Utils::LVMFormatSize(unUsed);
         vg.m_vgUsed = Utils::LVMFormatSize(Size - unUsed);
-        vg.m_pvCount = getStringListItem(vgsRes, 3).toInt();
-        vg.m_peCount = getStringListItem(vgsRes, 4).toInt();;
-        vg.m_peUnused  = getStringListItem(vgsRes, 5).toInt();;
+        vg.m_pvCount = obj.value("pv_count").toString().toInt();
+        vg.m_peCount = obj.value("vg_extent_count").toString().toInt();
+        vg.m_peUnused  = obj.value("vg_free_count").toString().toInt();
         vg.m_peUsed = vg.m_peCount - vg.m_peUnused;
-        vg.m_curLV  = getStringListItem(vgsRes, 6).toInt();
-        vg.m_PESize = getStringListItem(vgsRes, 7).trimmed().replace('B', "").toInt();
-        vg.m_vgStatus = getStringListItem(vgsRes, 8).trimmed();
+        vg.m_curLV  = obj.value("lv_count").toString().toInt();
+        vg.m_PESize = obj.value("vg_extent_size").toString().toInt();
+        vg.m_vgStatus = obj.value("vg_attr").toString().trimmed();
         //获取lv基本属性
-        updateLVInfo(lvmInfo, vg);
+        updateLVInfo(lvmInfo, vg, it->m_lvRows);
         lvmInfo.m_vgInfo.insert(vg.m_vgName, vg);
     }
 
     return setLVMErr(lvmInfo, LVMError::LVM_ERR_NORMAL);
 }
 
-bool LVMOperator::updateLVInfo(LVMInfo &lvmInfo, VGInfo &vg)
+bool LVMOperator::updateLVInfo(LVMInfo &lvmInfo, VGInfo &vg, const QList<QJsonObject> &lvRows)
 {
     if (LVM_CMD_Support::NONE == m_lvmSupport.LVM_CMD_lvs) {
         return setLVMErr(lvmInfo, LVMError::LVM_ERR_NO_CMD_SUPPORT);
@@ -329,35 +575,24 @@ bool LVMOperator::updateLVInfo(LVMInfo &lvmInfo, VGInfo &vg)
 
     vg.m_lvlist.clear();
 
-    QString strout, strerror;
-    QString cmd = QString("lvs -S vg_uuid=%1 --noheadings -o lv_path").arg(vg.m_vgUuid);
-    Utils::executCmd(cmd, strout, strerror);
-    strout = strout.trimmed();
-    foreach (QString str, strout.split("\n")) {
-        if (str.isEmpty()) {
-            continue;
-        }
+    QString rootFsName = MountInfo::getRootFs();
+    foreach (const QJsonObject &obj, lvRows) {
         LVInfo lv;
         //基本属性
-        lv.m_lvPath = str.trimmed(); //lv名称 lv0 lv1 ...
+        lv.m_lvPath = obj.value("lv_path").toString().trimmed(); //lv名称 lv0 lv1 ...
+        if (lv.m_lvPath.isEmpty()) {
+            continue;
+        }
         lv.m_vgName = vg.m_vgName; //vg名称
         lv.m_LESize = vg.m_PESize;  //单个pe大小 与所在vg的pe大小相同 单位byte
 
-        QString cmd = QString("lvs %1 -S vg_uuid=%2 --units b --noheadings --separator # "
-                              " -o lv_name,lv_uuid,lv_attr,lv_size"
-                              "").arg(lv.m_lvPath).arg(vg.m_vgUuid);
-        Utils::executCmd(cmd, strout, strerror);
-        QStringList lvsRes = strout.split("#");
-
-        lv.m_lvName = getStringListItem(lvsRes, 0).trimmed();
-        lv.m_lvUuid = getStringListItem(lvsRes, 1).trimmed(); //lv uuid 唯一名称
-        lv.m_lvStatus = getStringListItem(lvsRes, 2).trimmed();
-        long long Size = getStringListItem(lvsRes, 3).trimmed().replace('B', "").toLongLong();
+        lv.m_lvName = obj.value("lv_name").toString().trimmed();
+        lv.m_lvUuid = obj.value("lv_uuid").toString().trimmed(); //lv uuid 唯一名称
+        lv.m_lvStatus = obj.value("lv_attr").toString().trimmed();
+        long long Size = obj.value("lv_size").toString().toLongLong();
         lv.m_lvSize = Utils::LVMFormatSize(Size); //字符串类型 展示用
-        lv.m_lvLECount = Size / lv.m_LESize;
+        lv.m_lvLECount = lv.m_LESize > 0 ? Size / lv.m_LESize : 0;
 
-        QString rootFsName;
-        MountInfo::loadCache(rootFsName);
         QString lvPath = lv.toMapperPath();
         if (rootFsName == lvPath) {
             lv.m_dataFlag = true;
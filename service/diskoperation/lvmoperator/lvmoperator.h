@@ -25,6 +25,31 @@
 #include "deviceinfo.h"
 #include "supportedfilesystems.h"
 
+#include <QJsonObject>
+#include <QMutex>
+
+/**
+ * @struct VGReportCache
+ * @brief vg报告缓存 vg元数据序号及lv激活状态不变时直接复用
+ */
+struct VGReportCache {
+    QString m_seqno;                //vg元数据序号 vg_seqno
+    QString m_activeLVs;            //dm中该vg已激活的lv及挂起状态
+    QJsonObject m_vgRow;            //vgs报告行
+    QList<QJsonObject> m_lvRows;    //lvs报告中属于该vg的行
+};
+
+/**
+ * @struct PVReportCache
+ * @brief pv报告缓存 pv轻量查询结果不变且所属vg未变化时直接复用
+ */
+struct PVReportCache {
+    QJsonObject m_keyRow;           //轻量查询行 用于判断pv是否变化
+    QJsonObject m_pvRow;            //pvs报告行
+    QList<QJsonObject> m_segRows;   //pvs --segments报告中属于该pv的行
+    QString m_devType;              //设备类型 lsblk type
+};
+
 class LVMOperator
 {
 public:
@@ -160,9 +185,53 @@ private:
      * @brief 更新lvm LV信息
      * @param lvmInfo:lvm数据结构体
      * @param info:vg数据结构体
+     * @param lvRows:lvs报告中属于该vg的lv
      * @return true 成功 false 失败
      */
-    static bool updateLVInfo(LVMInfo &lvmInfo, VGInfo &info);
+    static bool updateLVInfo(LVMInfo &lvmInfo, VGInfo &info, const QList<QJsonObject> &lvRows);
+
+    /**
+     * @brief 刷新lvm报告缓存 先查询pv集合及vg元数据序号 只重新读取变化的vg及pv 调用者需持有m_cacheMutex
+     * @return true 成功 false 存在重名vg且更名失败
+     */
+    static bool refreshLVMReport();
+
+    /**
+     * @brief 从sysfs获取已激活的lv
+     * @return key:vg uuid(去掉'-') value:该vg已激活lv的dm uuid及挂起状态
+     */
+    static QMap<QString, QString> getActiveLVs();
+
+    /**
+     * @brief 生成lvm报告过滤条件
+     * @param field:过滤字段
+     * @param values:字段值
+     * @param total:对象总数 全部变化时不过滤
+     * @return 过滤条件 " -S field=a||field=b"
+     */
+    static QString getSelection(const QString &field, const QStringList &values, int total);
+
+    /**
+     * @brief 执行lvm报告命令(--reportformat json) 一次返回所有对象
+     * @param cmd:pvs/vgs/lvs命令
+     * @return 报告中的所有行 失败返回空
+     */
+    static QList<QJsonObject> getLVMReport(const QString &cmd);
+
+    /**
+     * @brief 并发执行多个lvm报告命令
+     * @param cmds:pvs/vgs/lvs命令
+     * @return 与命令顺序一致的报告行
+     */
+    static QVector<QList<QJsonObject>> getLVMReports(const QStringList &cmds);
+
+    /**
+     * @brief 解析lvm json报告
+     * @param cmd:命令 用于打印错误
+     * @param output:命令输出
+     * @return 报告中的所有行 失败返回空
+     */
+    static QList<QJsonObject> parseLVMReport(const QString &cmd, const QString &output);
 
     /**
      * @brief 打印设备上VG信息
@@ -319,6 +388,9 @@ public:
     static DeviceInfoMap  m_devInfo;        //磁盘属性集合
     static DiskManager::SupportedFileSystems m_supportFs; //文件系统支持集合
     static LVMError m_lvmErr;               //lvm
+    static QMap<QString, VGReportCache> m_vgCache;  //vg报告缓存 key:vg uuid
+    static QMap<QString, PVReportCache> m_pvCache;  //pv报告缓存 key:pv路径
+    static QMutex m_cacheMutex;                     //vg/pv报告缓存锁
 
 };
 
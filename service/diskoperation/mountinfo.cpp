@@ -32,47 +32,221 @@
 #include <QFile>
 #include <QTextStream>
 #include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QDebug>
 
 #include <limits.h>
 #include <mntent.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 
 namespace DiskManager {
 static MountInfo::MountMapping mountInfo;
 static MountInfo::MountMapping fstabInfo;
 
-void MountInfo::loadCache(QString &rootFs)
+static QVector<MountInfo::MountLine> mountLines;   //当前挂载行(/proc/self/mountinfo /proc/swaps)
+static QVector<MountInfo::MountLine> fstabLines;   //fstab行
+static QStringList mountNodes;                     //mountLines解析后的设备名
+static QStringList fstabNodes;                     //fstabLines解析后的设备名
+static QString rootFsName;                         //数据分区设备名
+static bool cacheLoaded = false;
+
+// 内核在挂载表变化时对已打开的/proc/self/mountinfo及/proc/swaps产生POLLPRI|POLLERR事件
+static int mountInfoFd = -1;
+static int swapsFd = -1;
+static int fstabWatchFd = -1;
+
+static QMutex mountInfoMutex;
+
+/**
+ * @brief 已打开的proc文件对应的表是否变化 poll本身会消费掉该事件
+ * @param fd：文件描述符
+ * @return true变化false未变化
+ */
+static bool procTableChanged(int fd)
+{
+    if (fd < 0) {
+        return true;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    int ret = poll(&pfd, 1, 0);
+    if (ret < 0) {
+        return true;
+    }
+
+    return ret > 0 && (pfd.revents & (POLLPRI | POLLERR));
+}
+
+/**
+ * @brief /etc/fstab是否被修改 编辑器通常以重命名方式保存 所以监视/etc目录
+ * @return true修改false未修改
+ */
+static bool fstabChanged()
+{
+    if (fstabWatchFd < 0) {
+        return true;
+    }
+
+    bool changed = false;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t len = read(fstabWatchFd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+
+        for (char *ptr = buf; ptr < buf + len;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && 0 == strcmp(event->name, "fstab"))) {
+                changed = true;
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * @brief 还原mountinfo中的八进制转义字符 如\040为空格
+ * @param str：转义后字符串
+ * @return 原始字符串
+ */
+static QString unescapeMountField(const QString &str)
 {
-    mountInfo.clear();
-    fstabInfo.clear();
+    if (!str.contains('\\')) {
+        return str;
+    }
+
+    QByteArray src = str.toUtf8();
+    QByteArray dst;
+    for (int i = 0; i < src.size(); i++) {
+        if (src[i] == '\\' && i + 3 < src.size()) {
+            bool ok = false;
+            int ch = src.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                dst.append(static_cast<char>(ch));
+                i += 3;
+                continue;
+            }
+        }
+        dst.append(src[i]);
+    }
+
+    return QString::fromUtf8(dst);
+}
+
+void MountInfo::loadCache(QString &rootfs)
+{
+    QMutexLocker locker(&mountInfoMutex);
+    // 文件系统缓存已重新加载 UUID/LABEL可能对应到新的设备
+    refreshIfChanged(true);
+    rootfs = rootFsName;
+}
+
+QString MountInfo::getRootFs()
+{
+    QMutexLocker locker(&mountInfoMutex);
+    refreshIfChanged(false);
+    return rootFsName;
+}
+
+void MountInfo::refreshIfChanged(bool resolveNodes)
+{
+    if (!cacheLoaded) {
+        mountInfoFd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+        swapsFd = open("/proc/swaps", O_RDONLY | O_CLOEXEC);
+        fstabWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fstabWatchFd >= 0 && inotify_add_watch(fstabWatchFd, "/etc", IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM
+                                                   | IN_CREATE | IN_DELETE) < 0) {
+            close(fstabWatchFd);
+            fstabWatchFd = -1;
+        }
+    }
+
+    // 两个proc文件都要poll 以便消费各自的事件
+    bool mountsChanged = procTableChanged(mountInfoFd);
+    mountsChanged = procTableChanged(swapsFd) || mountsChanged;
+    bool fstabDirty = fstabChanged();
+
+    if (!cacheLoaded || mountsChanged) {
+        mountLines.clear();
+        readMountpointsFromMountInfo(mountLines);
+        readMountpointsFromFileSwaps("/proc/swaps", mountLines);
+
+        if (!haveRootfsDev(mountLines))
+            // Old distributions only contain 'rootfs' and '/dev/root' device names
+            // for the / (root) file system in /proc/mounts with '/dev/root' being a
+            // block device rather than a symlink to the true device.  This prevents
+            // identification, and therefore busy detection, of the device containing
+            // the / (root) file system.  Used to read /etc/mtab to get the root file
+            // system device name, but this contains an out of date device name after
+            // the mounting device has been dynamically removed from a multi-device
+            // btrfs, thus identifying the wrong device as busy.  Instead fall back
+            // to reading mounted file systems from the output of the mount command,
+            // but only when required.
+            readMountpointsFromMountCommand(mountLines);
+    }
+
+    if (!cacheLoaded || fstabDirty) {
+        fstabLines.clear();
+        readMountpointsFromFile("/etc/fstab", fstabLines);
+    }
+
+    if (!cacheLoaded || mountsChanged || fstabDirty) {
+        rootFsName.clear();
+        updateRootFs(mountLines);
+        updateRootFs(fstabLines);
+    }
 
-    readMountpointsFromFile("/proc/mounts", mountInfo, rootFs);
-    readMountpointsFromFileSwaps("/proc/swaps", mountInfo);
+    bool rebuildMounts = !cacheLoaded || mountsChanged;
+    bool rebuildFstab = !cacheLoaded || fstabDirty;
+    if (resolveNodes) {
+        // 挂载表未变化时只检查UUID/LABEL解析结果是否变化
+        auto nodesChanged = [](const QVector<MountLine> &lines, const QStringList &nodes) {
+            if (lines.size() != nodes.size()) {
+                return true;
+            }
+            for (int i = 0; i < lines.size(); i++) {
+                if (resolveNode(lines[i].m_node) != nodes[i]) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        rebuildMounts = rebuildMounts || nodesChanged(mountLines, mountNodes);
+        rebuildFstab = rebuildFstab || nodesChanged(fstabLines, fstabNodes);
+    }
 
-    if (!haveRootfsDev(mountInfo))
-        // Old distributions only contain 'rootfs' and '/dev/root' device names
-        // for the / (root) file system in /proc/mounts with '/dev/root' being a
-        // block device rather than a symlink to the true device.  This prevents
-        // identification, and therefore busy detection, of the device containing
-        // the / (root) file system.  Used to read /etc/mtab to get the root file
-        // system device name, but this contains an out of date device name after
-        // the mounting device has been dynamically removed from a multi-device
-        // btrfs, thus identifying the wrong device as busy.  Instead fall back
-        // to reading mounted file systems from the output of the mount command,
-        // but only when required.
-        readMountpointsFromMountCommand(mountInfo);
+    if (rebuildMounts) {
+        mountInfo.clear();
+        buildMapping(mountLines, mountInfo, mountNodes);
 
-    readMountpointsFromFile("/etc/fstab", fstabInfo, rootFs);
+        // Sort the mount points and remove duplicates ... (no need to do this for fstab_info)
+        MountMapping::iterator iterMp;
+        for (iterMp = mountInfo.begin(); iterMp != mountInfo.end(); ++iterMp) {
+            std::sort(iterMp.value().mountpoints.begin(), iterMp.value().mountpoints.end());
 
-    // Sort the mount points and remove duplicates ... (no need to do this for fstab_info)
-    MountMapping::iterator iterMp;
-    for (iterMp = mountInfo.begin(); iterMp != mountInfo.end(); ++iterMp) {
-        std::sort(iterMp.value().mountpoints.begin(), iterMp.value().mountpoints.end());
+            iterMp.value().mountpoints.erase(
+                std::unique(iterMp.value().mountpoints.begin(), iterMp.value().mountpoints.end()),
+                iterMp.value().mountpoints.end());
+        }
+    }
 
-        iterMp.value().mountpoints.erase(
-            std::unique(iterMp.value().mountpoints.begin(), iterMp.value().mountpoints.end()),
-            iterMp.value().mountpoints.end());
+    if (rebuildFstab) {
+        fstabInfo.clear();
+        buildMapping(fstabLines, fstabInfo, fstabNodes);
     }
+
+    cacheLoaded = true;
 }
 
 bool MountInfo::isDevMounted(const QString &path)
@@ -82,6 +256,8 @@ bool MountInfo::isDevMounted(const QString &path)
 
 bool MountInfo::isDevMounted(const BlockSpecial &blockSpecial)
 {
+    QMutexLocker locker(&mountInfoMutex);
+    refreshIfChanged(false);
     MountMapping::const_iterator iterMp = mountInfo.find(blockSpecial);
     return iterMp != mountInfo.end();
 }
@@ -93,6 +269,8 @@ bool MountInfo::isDevMountedReadonly(const QString &path)
 
 bool MountInfo::isDevMountedReadonly(const BlockSpecial &blockSpecial)
 {
+    QMutexLocker locker(&mountInfoMutex);
+    refreshIfChanged(false);
     MountMapping::const_iterator iterMp = mountInfo.find(blockSpecial);
     if (iterMp == mountInfo.end()) {
         return false;
@@ -100,17 +278,54 @@ bool MountInfo::isDevMountedReadonly(const BlockSpecial &blockSpecial)
     return iterMp.value().readonly;
 }
 
-const QVector<QString> &MountInfo::getMountedMountpoints(const QString &path)
+QVector<QString> MountInfo::getMountedMountpoints(const QString &path)
 {
+    QMutexLocker locker(&mountInfoMutex);
+    refreshIfChanged(false);
     return find(mountInfo, path).mountpoints;
 }
 
-const QVector<QString> &MountInfo::getFileSystemTableMountpoints(const QString &path)
+QVector<QString> MountInfo::getFileSystemTableMountpoints(const QString &path)
 {
+    QMutexLocker locker(&mountInfoMutex);
+    refreshIfChanged(false);
     return find(fstabInfo, path).mountpoints;
 }
 
-void MountInfo::readMountpointsFromFile(const QString &fileName, MountInfo::MountMapping &map, QString &rootFs)
+void MountInfo::readMountpointsFromMountInfo(QVector<MountLine> &lines)
+{
+    QFile file("/proc/self/mountinfo");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // 没有mountinfo时退回到/proc/mounts
+        readMountpointsFromFile("/proc/mounts", lines);
+        return;
+    }
+
+    // 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+    // (1)(2)(3)   (4)   (5)      (6)      (7)   (8) (9)   (10)         (11)
+    QList<QByteArray> content = file.readAll().split('\n');
+    for (const QByteArray &rawLine : content) {
+        QList<QByteArray> fields = rawLine.split(' ');
+        int sep = fields.indexOf("-");
+        if (fields.size() < 6 || sep < 6 || fields.size() < sep + 3) {
+            continue;
+        }
+
+        QList<QByteArray> devNum = fields[2].split(':');
+        MountLine line;
+        line.m_node = unescapeMountField(QString::fromUtf8(fields[sep + 2]));
+        line.m_mountPoint = unescapeMountField(QString::fromUtf8(fields[4]));
+        line.m_readonly = parseReadonlyFlag(QString::fromUtf8(fields[5]));
+        if (fields.size() > sep + 3) {
+            line.m_readonly = line.m_readonly || parseReadonlyFlag(QString::fromUtf8(fields[sep + 3]));
+        }
+        line.m_major = devNum.size() == 2 ? devNum[0].toULong() : 0;
+        line.m_minor = devNum.size() == 2 ? devNum[1].toULong() : 0;
+        lines.append(line);
+    }
+}
+
+void MountInfo::readMountpointsFromFile(const QString &fileName, QVector<MountLine> &lines)
 {
     FILE *fp = setmntent(fileName.toStdString().c_str(), "r");
     if (fp == nullptr) {
@@ -118,46 +333,59 @@ void MountInfo::readMountpointsFromFile(const QString &fileName, MountInfo::Moun
     }
     struct mntent *p = nullptr;
     while ((p = getmntent(fp)) != nullptr) {
-        QString node = p->mnt_fsname;
-        QString mountpoint = p->mnt_dir;
-        qDebug() << __FUNCTION__ << p->mnt_dir << " FsName: " << p->mnt_fsname;
-        if (0 == rootFs.length() &&
-                (0 == strcmp(p->mnt_dir, "/root")
-                 || 0 == strcmp(p->mnt_dir, "/home")
-                 || 0 == strcmp(p->mnt_dir, "/opt")
-                 || 0 == strcmp(p->mnt_dir, "/var"))) {
-            rootFs = p->mnt_fsname;
-            qDebug() <<"Set RootFS:" << rootFs;
-        }
-
-        QString uuid = Utils::regexpLabel(node, "(?<=UUID\\=).*");
-        if (!uuid.isEmpty()) {
-            node = FsInfo::getPathByUuid(uuid);
-        }
+        MountLine line;
+        line.m_node = p->mnt_fsname;
+        line.m_mountPoint = p->mnt_dir;
+        line.m_readonly = parseReadonlyFlag(p->mnt_opts);
+        line.m_major = 0;
+        line.m_minor = 0;
+        lines.append(line);
+    }
 
-        QString label = Utils::regexpLabel(node, "(?<=UUID\\=).*");
-        if (!label.isEmpty()) {
-            node = FsInfo::getPathByLabel(label);
-        }
+    endmntent(fp);
+}
 
+void MountInfo::buildMapping(const QVector<MountLine> &lines, MountMapping &map, QStringList &nodes)
+{
+    nodes.clear();
+    for (const MountLine &line : lines) {
+        QString node = resolveNode(line.m_node);
+        nodes.append(node);
         if (!node.isEmpty()) {
-            addMountpointEntry(map, node, mountpoint, parseReadonlyFlag(p->mnt_opts));
+            addMountpointEntry(map, line, node);
         }
     }
+}
 
-    endmntent(fp);
+QString MountInfo::resolveNode(const QString &node)
+{
+    if (node.startsWith("UUID=")) {
+        return FsInfo::getPathByUuid(node.mid(5));
+    }
+
+    if (node.startsWith("LABEL=")) {
+        return FsInfo::getPathByLabel(node.mid(6));
+    }
+
+    return node;
 }
 
-void MountInfo::addMountpointEntry(MountInfo::MountMapping &map, QString &node, QString &mountPoint, bool readonly)
+void MountInfo::addMountpointEntry(MountInfo::MountMapping &map, const MountLine &line, const QString &node)
 {
-    // Only add node path if mount point exists
-    QFile file(mountPoint);
-    if (file.exists()) {
-        // Map::operator[] default constructs MountEntry for new keys (nodes).
-        MountEntry &mountentry = map[BlockSpecial(node)];
-        mountentry.readonly = mountentry.readonly || readonly;
-        mountentry.mountpoints.push_back(mountPoint);
+    // Only add node path if mount point exists (swap has no mountpoint)
+    if (!line.m_mountPoint.isEmpty() && !QFile::exists(line.m_mountPoint)) {
+        return;
+    }
+
+    // 挂载表中带有设备号 直接注册 避免再次stat设备文件
+    if (line.m_major > 0 && node.startsWith("/")) {
+        BlockSpecial::registerBlockSpecial(node, line.m_major, line.m_minor);
     }
+
+    // Map::operator[] default constructs MountEntry for new keys (nodes).
+    MountEntry &mountentry = map[BlockSpecial(node)];
+    mountentry.readonly = mountentry.readonly || line.m_readonly;
+    mountentry.mountpoints.push_back(line.m_mountPoint);
 }
 
 bool MountInfo::parseReadonlyFlag(const QString &str)
@@ -174,7 +402,7 @@ bool MountInfo::parseReadonlyFlag(const QString &str)
     return false; // Default is read-write mount
 }
 
-void MountInfo::readMountpointsFromFileSwaps(const QString &fileName, MountInfo::MountMapping &map)
+void MountInfo::readMountpointsFromFileSwaps(const QString &fileName, QVector<MountLine> &lines)
 {
     QFile file(fileName);
     if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -182,51 +410,70 @@ void MountInfo::readMountpointsFromFileSwaps(const QString &fileName, MountInfo:
         QString line = in.readLine();
         QString node;
         while (!in.atEnd() || !line.isEmpty()) {
-//            qDebug() << line;
             node = Utils::regexpLabel(line, "^(/[^ ]+)");
 
             if (node.size() > 0) {
-                map[BlockSpecial(node)].mountpoints.push_back("" /* no mountpoint for swap */);
+                MountLine swapLine;
+                swapLine.m_node = node;
+                swapLine.m_mountPoint = ""; /* no mountpoint for swap */
+                swapLine.m_readonly = false;
+                swapLine.m_major = 0;
+                swapLine.m_minor = 0;
+                lines.append(swapLine);
             }
             line = in.readLine();
         }
     }
 }
 
-bool MountInfo::haveRootfsDev(MountInfo::MountMapping &)
+bool MountInfo::haveRootfsDev(const QVector<MountLine> &lines)
 {
-    MountMapping::const_iterator iterMp;
-    for (iterMp = mountInfo.begin(); iterMp != mountInfo.end(); iterMp++) {
-        if (!iterMp.value().mountpoints.isEmpty() && iterMp.value().mountpoints[0] == "/") {
-            if (iterMp.key().m_name != "rootfs" && iterMp.key().m_name != "/dev/root") {
-                return true;
-            }
+    for (const MountLine &line : lines) {
+        if (line.m_mountPoint == "/" && line.m_node != "rootfs" && line.m_node != "/dev/root") {
+            return true;
         }
     }
     return false;
 }
 
-void MountInfo::readMountpointsFromMountCommand(MountInfo::MountMapping &map)
+void MountInfo::readMountpointsFromMountCommand(QVector<MountLine> &lines)
 {
     QString output;
     QString error;
     if (!Utils::executCmd("mount", output, error)) {
-        QStringList lines;
-        lines = output.split("\n");
-        for (int i = 0; i < lines.size(); i++) {
+        QStringList outLines;
+        outLines = output.split("\n");
+        for (int i = 0; i < outLines.size(); i++) {
             // Process line like "/dev/sda3 on / type ext4 (rw)"
-            QString node = Utils::regexpLabel(lines[i], ".*?(?= )");
-            QString mountpoint = Utils::regexpLabel(lines[i], "(?<=on ).*?(?= type)");
-            QString mntopts = Utils::regexpLabel(lines[i], "(?<=\\().*?(?=\\))");
-            // qDebug() << node << mountpoint << mntopts;
-            if (!node.isEmpty()) {
-                addMountpointEntry(map, node, mountpoint, parseReadonlyFlag(mntopts));
+            MountLine line;
+            line.m_node = Utils::regexpLabel(outLines[i], ".*?(?= )");
+            line.m_mountPoint = Utils::regexpLabel(outLines[i], "(?<=on ).*?(?= type)");
+            line.m_readonly = parseReadonlyFlag(Utils::regexpLabel(outLines[i], "(?<=\\().*?(?=\\))"));
+            line.m_major = 0;
+            line.m_minor = 0;
+            if (!line.m_node.isEmpty()) {
+                lines.append(line);
             }
         }
     }
 }
 
-const MountEntry &MountInfo::find(const MountInfo::MountMapping &map, const QString &path)
+void MountInfo::updateRootFs(const QVector<MountLine> &lines)
+{
+    for (const MountLine &line : lines) {
+        if (!rootFsName.isEmpty()) {
+            return;
+        }
+
+        if (line.m_mountPoint == "/root" || line.m_mountPoint == "/home"
+                || line.m_mountPoint == "/opt" || line.m_mountPoint == "/var") {
+            rootFsName = line.m_node;
+            qDebug() << "Set RootFS:" << rootFsName;
+        }
+    }
+}
+
+MountEntry MountInfo::find(const MountInfo::MountMapping &map, const QString &path)
 {
     MountMapping::const_iterator iterMp = map.find(BlockSpecial(path));
 
@@ -234,8 +481,7 @@ const MountEntry &MountInfo::find(const MountInfo::MountMapping &map, const QStr
         return iterMp.value();
     }
 
-    static MountEntry not_mounted = MountEntry();
-    return not_mounted;
+    return MountEntry();
 }
 
 } // namespace DiskManager
@@ -31,13 +31,14 @@
 #include "commondef.h"
 
 #include <QMap>
+#include <QVector>
 
 namespace DiskManager {
 
 
 /**
  * @class MountInfo
- * @brief 挂载点信息类
+ * @brief 挂载点信息类 常驻缓存 只有内核通知挂载表变化或fstab被修改时才重新解析
  */
 
 class MountInfo
@@ -46,10 +47,29 @@ public:
     typedef QMap<BlockSpecial, MountEntry> MountMapping; //挂载点集合
 
     /**
-     * @brief 加载缓存
+     * @struct MountLine
+     * @brief 挂载表中的一行 设备名尚未解析
+     */
+    struct MountLine {
+        QString m_node;           //设备 可能为UUID=xxx LABEL=xxx
+        QString m_mountPoint;     //挂载点
+        bool m_readonly;          //只读标志
+        unsigned long m_major;    //设备主设备号 只有mountinfo提供 0为未知
+        unsigned long m_minor;    //设备次设备号
+    };
+
+    /**
+     * @brief 加载缓存 挂载表及fstab没有变化时只重新解析UUID/LABEL对应的设备
+     * @param rootfs：返回数据分区设备名
      */
     static void loadCache(QString &rootfs);
 
+    /**
+     * @brief 获取数据分区设备名(/root /home /opt /var所在设备)
+     * @return 设备名
+     */
+    static QString getRootFs();
+
     /**
      * @brief 是否设备挂载点
      * @param path：设备路径
@@ -81,33 +101,59 @@ public:
     /**
      * @brief 获取挂载点信息
      * @param path：设备路径
-     * @return 挂载点信息
+     * @return 挂载点信息 缓存可能被其他线程更新 因此返回副本
      */
-    static const QVector<QString> &getMountedMountpoints(const QString &path);
+    static QVector<QString> getMountedMountpoints(const QString &path);
 
     /**
      * @brief 获取文件系统挂载点信息
      * @param path：设备路径
      * @return 文件系统挂载点信息
      */
-    static const QVector<QString> &getFileSystemTableMountpoints(const QString &path);
+    static QVector<QString> getFileSystemTableMountpoints(const QString &path);
 
 private:
+    /**
+     * @brief 检查挂载表、交换分区及fstab是否变化 有变化时重新读取
+     * @param resolveNodes：是否重新解析UUID/LABEL对应的设备(文件系统缓存可能已更新)
+     */
+    static void refreshIfChanged(bool resolveNodes);
+
+    /**
+     * @brief 从/proc/self/mountinfo读取挂载点信息
+     * @param lines：挂载点信息
+     */
+    static void readMountpointsFromMountInfo(QVector<MountLine> &lines);
+
     /**
      * @brief 从文件中读取挂载点信息
      * @param filename：文件名
+     * @param lines：挂载点信息
+     */
+    static void readMountpointsFromFile(const QString &fileName, QVector<MountLine> &lines);
+
+    /**
+     * @brief 由挂载行生成挂载点映射 解析UUID/LABEL
+     * @param lines：挂载行
      * @param map：挂载点信息
+     * @param nodes：返回解析后的设备名 用于判断是否需要重建
+     */
+    static void buildMapping(const QVector<MountLine> &lines, MountMapping &map, QStringList &nodes);
+
+    /**
+     * @brief 解析UUID=xxx LABEL=xxx形式的设备名
+     * @param node：设备名
+     * @return 设备路径
      */
-    static void readMountpointsFromFile(const QString &fileName, MountMapping &map, QString &rootFs);
+    static QString resolveNode(const QString &node);
 
     /**
      * @brief 添加挂载点入口
      * @param map：挂载点信息
-     * @param node：节点
-     * @param mountpoint：挂载点
-     * @param readonly：只读标志
+     * @param line：挂载行
+     * @param node：解析后的设备名
      */
-    static void addMountpointEntry(MountMapping &map, QString &node, QString &mountPoint, bool readonly);
+    static void addMountpointEntry(MountMapping &map, const MountLine &line, const QString &node);
 
     /**
      * @brief 解析只读标志
@@ -119,22 +165,28 @@ private:
     /**
      * @brief 解析挂载点信息从交换文件
      * @param fileName：文件名
-     * @param map：挂载点信息
+     * @param lines：挂载点信息
      */
-    static void readMountpointsFromFileSwaps(const QString &fileName, MountMapping &map);
+    static void readMountpointsFromFileSwaps(const QString &fileName, QVector<MountLine> &lines);
 
     /**
      * @brief 有root文件系统的设备
-     * @param map：挂载点信息
+     * @param lines：挂载点信息
      * @param true成功false失败
      */
-    static bool haveRootfsDev(MountMapping &map);
+    static bool haveRootfsDev(const QVector<MountLine> &lines);
 
     /**
      * @brief 从“mount”命令读取挂载点信息
-     * @param map：挂载点信息
+     * @param lines：挂载点信息
+     */
+    static void readMountpointsFromMountCommand(QVector<MountLine> &lines);
+
+    /**
+     * @brief 更新数据分区设备名
+     * @param lines：挂载点信息
      */
-    static void readMountpointsFromMountCommand(MountMapping &map);
+    static void updateRootFs(const QVector<MountLine> &lines);
 
     /**
      * @brief 查找挂载点入口
@@ -142,7 +194,7 @@ private:
      * @param path：设备路径
      * @return 挂载点入口
      */
-    static const MountEntry &find(const MountMapping &map, const QString &path);
+    static MountEntry find(const MountMapping &map, const QString &path);
 };
 
 } // namespace DiskManager
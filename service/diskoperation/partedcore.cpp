@@ -33,9 +33,21 @@
 #include "procpartitionsinfo.h"
 #include "filesystems/filesystem.h"
 #include "luksoperator/luksoperator.h"
+#include "probestats.h"
+#include "commandexecutor.h"
+#include "devicequerycache.h"
+#include "fsusagecache.h"
+#include "topologycache.h"
+#include "blockdeviceenumerator.h"
+#include "badblockcheckpoint.h"
 
 #include <QDebug>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <linux/hdreg.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/xattr.h>
@@ -45,8 +57,10 @@
 #include <pwd.h>
 #include <errno.h>
 #include <string.h>
+#include <memory>
 #include <set>
 #include <tuple>
+#include <vector>
 
 
 
@@ -58,6 +72,92 @@ static bool hdparmFound = false;
 const std::time_t SETTLE_DEVICE_PROBE_MAX_WAIT_SECONDS = 1;
 //const std::time_t SETTLE_DEVICE_APPLY_MAX_WAIT_SECONDS = 10;
 SupportedFileSystems *PartedCore::m_supportedFileSystems = nullptr;
+int PartedCore::m_probeThreadCount = 0;
+QMutex PartedCore::m_pedDeviceMutex;
+
+/**
+ * @brief 计算文件系统已用空间 文件系统对象带有成员状态 并行探测的任务各自使用一个副本
+ *        dumpe2fs、ntfsresize等外部工具运行期间不持锁
+ */
+static void fsObjectSetUsedSectors(const FileSystem *filesystem, Partition &partition)
+{
+    std::unique_ptr<FileSystem> copy(filesystem->clone());
+    copy->setUsedSectors(partition);
+}
+
+/**
+ * @class DeviceProbeTask
+ * @brief 单个设备探测任务 由线程池执行 结果写入调用者预先分配的位置
+ */
+class DeviceProbeTask : public QRunnable
+{
+public:
+    DeviceProbeTask(PartedCore *core, const QString &devicePath, Device &device, DeviceProbeTime &probeTime)
+        : m_core(core)
+        , m_devicePath(devicePath)
+        , m_device(device)
+        , m_probeTime(probeTime)
+        , m_refreshId(ProbeStats::currentRefresh())
+    {
+    }
+
+    void run() override
+    {
+        ProbeRefreshAttach attach(m_refreshId);
+        QElapsedTimer totalTimer;
+        QElapsedTimer timer;
+        totalTimer.start();
+        timer.start();
+        m_probeTime.m_path = m_devicePath;
+
+        //记录子阶段耗时到ProbeStats 返回毫秒
+        auto lap = [ & ](const QString & phase) -> qint64 {
+            qint64 nsecs = timer.nsecsElapsed();
+            ProbeStats::addSample(QString("device:%1:%2").arg(m_devicePath).arg(phase), nsecs);
+            timer.restart();
+            return nsecs / 1000000;
+        };
+
+        m_core->setDeviceFromDisk(m_device, m_devicePath);
+        m_probeTime.m_diskTime = lap("disk");
+
+        //优先从sysfs及udev属性读取 读取不到的项才调用smartctl/lshw/hwinfo
+        DeviceStorage storage;
+        storage.getDiskInfoFromSysfs(m_devicePath);
+        if (m_device.m_serialNumber.isEmpty()) {
+            m_device.m_serialNumber = storage.m_serialNumber;
+        }
+
+        m_device.m_mediaType = storage.m_mediaType;
+        if (m_device.m_mediaType.isEmpty()) {
+            m_device.m_mediaType = storage.getDiskInfoMediaType(m_devicePath);
+        }
+        m_probeTime.m_mediaTypeTime = lap("mediaType");
+
+        if (!storage.m_model.isEmpty()) {
+            m_device.m_model = storage.m_model;
+        } else {
+            storage.getDiskInfoModel(m_devicePath, m_device.m_model);
+        }
+        m_probeTime.m_modelTime = lap("model");
+
+        m_device.m_interface = storage.m_interface;
+        if (m_device.m_interface.isEmpty()) {
+            storage.getDiskInfoInterface(m_devicePath, m_device.m_interface, m_device.m_model);
+        }
+        m_probeTime.m_interfaceTime = lap("interface");
+
+        ProbeStats::addSample(QString("device:%1").arg(m_devicePath), totalTimer.nsecsElapsed());
+        m_probeTime.m_totalTime = totalTimer.elapsed();
+    }
+
+private:
+    PartedCore *m_core;
+    QString m_devicePath;
+    Device &m_device;
+    DeviceProbeTime &m_probeTime;
+    quint64 m_refreshId;    //创建任务时所在的刷新记录编号
+};
 
 PartedCore::PartedCore(QObject *parent)
     : QObject(parent), m_isClear(false)
@@ -86,12 +186,25 @@ PartedCore::PartedCore(QObject *parent)
     m_workerFixThread = nullptr;
     m_workerLVMThread = nullptr;
 
-    probeDeviceInfo();
-    delTempMountFile();
-
     qDebug() << __FUNCTION__ << "^^5";
 }
 
+void PartedCore::init()
+{
+    //缓存可用时先以缓存拓扑响应客户端 探测在后台线程进行 完成后下发增量
+    if (TopologyCache::load(m_inforesult, m_lvmInfo, m_LUKSInfo)) {
+        m_topologyStale = true;
+        onRefreshDeviceInfo();
+    } else {
+        probeDeviceInfo();
+        TopologyCache::save(m_inforesult, m_lvmInfo, m_LUKSInfo);
+    }
+    m_publishedDevices = m_inforesult;
+    m_publishedLVM = m_lvmInfo;
+    m_publishedLUKS = m_LUKSInfo;
+    delTempMountFile();
+}
+
 PartedCore::~PartedCore()
 {
     Utils::deletePoint(m_supportedFileSystems);
@@ -103,6 +216,10 @@ PartedCore::~PartedCore()
         m_workerThreadProbe = nullptr;
     }
 
+    //检测及修复循环不经过事件循环 先设置停止标志使其在当前批次结束后退出 否则quit后要等待整盘处理完成
+    m_checkThread.setStopFlag(2);
+    m_fixthread.setStopFlag(2);
+
     if (m_workerCheckThread) {
         m_workerCheckThread->quit();
         m_workerCheckThread->wait();
@@ -163,6 +280,8 @@ HardDiskInfo PartedCore::getDeviceHardInfo(const QString &devicepath)
     }
 
     DeviceStorage device;
+    device.getDiskInfoFromSysfs(devicepath);
+
     device.getDiskInfoFromHwinfo(devicepath);
 
     device.getDiskInfoFromLshw(devicepath);
@@ -212,12 +331,7 @@ QString PartedCore::getDeviceHardStatus(const QString &devicepath)
         devicePath = list.at(0) + "nvme" + str;
     }
 
-    QString cmd = QString("smartctl -H %1").arg(devicePath);
-    QProcess proc;
-    proc.start(cmd);
-    proc.waitForFinished(-1);
-    QString output = proc.readAllStandardOutput();
-
+    QString output = DeviceQueryCache::query(devicePath, DeviceQueryCache::SmartHealth);
     if (output.indexOf("SMART overall-health self-assessment test result:") != -1) {
         QStringList list = output.split("\n");
         for (int i = 0; i < list.size(); i++) {
@@ -228,24 +342,6 @@ QString PartedCore::getDeviceHardStatus(const QString &devicepath)
                 break;
             }
         }
-    } else {
-        QString cmd = QString("smartctl -H -d sat %1").arg(devicePath);
-        QProcess proc;
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        QString output = proc.readAllStandardOutput();
-
-        if (output.indexOf("SMART overall-health self-assessment test result:") != -1) {
-            QStringList list = output.split("\n");
-            for (int i = 0; i < list.size(); i++) {
-                if (list.at(i).indexOf("SMART overall-health self-assessment test result:") != -1) {
-                    status = list.at(i).mid(strlen("SMART overall-health self-assessment test result:"));
-                    status.remove(QRegExp("^ +\\s*"));
-//                    qDebug() << __FUNCTION__ << status;
-                    break;
-                }
-            }
-        }
     }
 
     qDebug() << __FUNCTION__ << "Get Device Hard Status End";
@@ -276,11 +372,7 @@ HardDiskStatusInfoList PartedCore::getDeviceHardStatusInfo(const QString &device
 
         devicePath = list.at(0) + "nvme" + str;
 
-        QString cmd = QString("smartctl -A %1").arg(devicePath);
-        QProcess proc;
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        QString output = proc.readAllStandardOutput();
+        QString output = DeviceQueryCache::query(devicePath, DeviceQueryCache::SmartAttributes);
 //        QString output = "smartctl 6.6 2017-11-05 r4594 [x86_64-linux-4.19.0-6-amd64] (local build)\nCopyright (C) 2002-17, Bruce Allen, Christian Franke, www.smartmontools.org\n\n=== START OF SMART DATA SECTION ===\nSMART/Health Information (NVMe Log 0x02, NSID 0xffffffff)\nCritical Warning:                   0x00\nTemperature:                        25 Celsius\nAvailable Spare:                    100%\nAvailable Spare Threshold:          5%\nPercentage Used:                    1%\nData Units Read:                    3,196,293 [1.63 TB]\nData Units Written:                 3,708,861 [1.89 TB]\nHost Read Commands:                 47,399,157\nHost Write Commands:                65,181,192\nController Busy Time:               418\nPower Cycles:                       97\nPower On Hours:                     1,362\nUnsafe Shutdowns:                   44\nMedia and Data Integrity Errors:    0\nError Information Log Entries:      171\nWarning  Comp. Temperature Time:    0\nCritical Comp. Temperature Time:    0\n\n";
         list.clear();
         list = output.split("\n");
@@ -300,11 +392,7 @@ HardDiskStatusInfoList PartedCore::getDeviceHardStatusInfo(const QString &device
         }
     } else {
 
-        QString cmd = QString("smartctl -A %1").arg(devicepath);
-        QProcess proc;
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        QString output = proc.readAllStandardOutput();
+        QString output = DeviceQueryCache::query(devicepath, DeviceQueryCache::SmartAttributes);
 
         if (output.contains("ID# ATTRIBUTE_NAME          FLAG     VALUE WORST THRESH TYPE      UPDATED  WHEN_FAILED RAW_VALUE")) {
             QStringList list = output.split("\n");
@@ -338,43 +426,6 @@ HardDiskStatusInfoList PartedCore::getDeviceHardStatusInfo(const QString &device
 
                 hdsilist.append(hdsinfo);
             }
-        } else {
-            QString cmd = QString("smartctl -A -d sat %1").arg(devicepath);
-            QProcess proc;
-            proc.start(cmd);
-            proc.waitForFinished(-1);
-            QString output = proc.readAllStandardOutput();
-            if (output.contains("ID# ATTRIBUTE_NAME          FLAG     VALUE WORST THRESH TYPE      UPDATED  WHEN_FAILED RAW_VALUE")) {
-                QStringList list = output.split("\n");
-                int n = list.indexOf("ID# ATTRIBUTE_NAME          FLAG     VALUE WORST THRESH TYPE      UPDATED  WHEN_FAILED RAW_VALUE");
-                for (int i = n + 1; i < list.size(); i++) {
-                    HardDiskStatusInfo hdsinfo;
-                    QString statusInfo = list.at(i);
-                    QStringList slist = statusInfo.split(' ');
-                    slist.removeAll("");
-
-                    if (slist.size() == 0) {
-                        break;
-                    }
-
-                    if (list.size() >= 10) {
-                        hdsinfo.m_id = slist.at(0);
-                        hdsinfo.m_attributeName = slist.at(1);
-                        hdsinfo.m_flag = slist.at(2);
-                        hdsinfo.m_value = slist.at(3);
-                        hdsinfo.m_worst = slist.at(4);
-                        hdsinfo.m_thresh = slist.at(5);
-                        hdsinfo.m_type = slist.at(6);
-                        hdsinfo.m_updated = slist.at(7);
-                        hdsinfo.m_whenFailed = slist.at(8);
-                        for (int k = 9; k < slist.size(); k++) {
-                            hdsinfo.m_rawValue += slist.at(k);
-                        }
-                    }
-
-                    hdsilist.append(hdsinfo);
-                }
-            }
         }
     }
     qDebug() << __FUNCTION__ << "Get Device Hard Status Info end";
@@ -1175,6 +1226,7 @@ bool PartedCore::checkBadBlocks(const QString &devicePath, int blockStart, int b
 
     m_checkThread.setStopFlag(flag);
     if (flag == 1 || flag == 3) {
+        m_checkThread.setContinue(flag == 3);
         m_checkThread.setCountInfo(devicePath, blockStart, blockEnd, checkConut, checkSize);
         emit checkBadBlocksRunCountStart();
     }
@@ -1192,6 +1244,7 @@ bool PartedCore::checkBadBlocks(const QString &devicePath, int blockStart, int b
 
     m_checkThread.setStopFlag(flag);
     if (flag == 1 || flag == 3) {
+        m_checkThread.setContinue(flag == 3);
         m_checkThread.setTimeInfo(devicePath, blockStart, blockEnd, checkTime, checkSize);
         emit checkBadBlocksRunTimeStart();
     }
@@ -1199,6 +1252,41 @@ bool PartedCore::checkBadBlocks(const QString &devicePath, int blockStart, int b
     return true;
 }
 
+bool PartedCore::resumeCheckBadBlocks(const QString &devicePath)
+{
+    BadBlockCheckpoint checkpoint;
+    if (!BadBlockCheckpoint::load(BadBlockCheckpoint::deviceSerial(devicePath), checkpoint)) {
+        qDebug() << __FUNCTION__ << "no bad blocks checkpoint for" << devicePath;
+        return false;
+    }
+
+    Sector region = checkpoint.nextRegion();
+    if (region > checkpoint.m_blockEnd) {
+        qDebug() << __FUNCTION__ << devicePath << "has been checked completely";
+        return false;
+    }
+
+    if (m_workerCheckThread == nullptr) {
+        m_workerCheckThread = new QThread();
+        m_workerCheckThread->start();
+        m_checkThread.moveToThread(m_workerCheckThread);
+    }
+
+    qDebug() << __FUNCTION__ << devicePath << "resume from cylinder" << region << "to" << checkpoint.m_blockEnd;
+    m_checkThread.setStopFlag(3);
+    m_checkThread.setContinue(true);
+    m_checkThread.setAdaptive(checkpoint.m_adaptive);
+    if (checkpoint.m_method == BadBlockCheckpoint::METHOD_TIME) {
+        m_checkThread.setTimeInfo(devicePath, static_cast<int>(region), checkpoint.m_blockEnd, checkpoint.m_checkTime, checkpoint.m_checkSize);
+        emit checkBadBlocksRunTimeStart();
+    } else {
+        m_checkThread.setCountInfo(devicePath, static_cast<int>(region), checkpoint.m_blockEnd, checkpoint.m_checkCount, checkpoint.m_checkSize);
+        emit checkBadBlocksRunCountStart();
+    }
+
+    return true;
+}
+
 bool PartedCore::fixBadBlocks(const QString &devicePath, QStringList badBlocksList, int checkSize, int flag)
 {
     if (m_workerFixThread == nullptr) {
@@ -1626,6 +1714,54 @@ int PartedCore::test()
     return 1;
 }
 
+void PartedCore::setBadBlocksQueueDepth(int depth)
+{
+    qDebug() << __FUNCTION__ << depth;
+    m_checkThread.setQueueDepth(depth);
+}
+
+void PartedCore::setBadBlocksAdaptiveScan(bool adaptive)
+{
+    qDebug() << __FUNCTION__ << adaptive;
+    m_checkThread.setAdaptive(adaptive);
+}
+
+QStringList PartedCore::getBadBlocksLatency()
+{
+    return m_checkThread.latencyStatistics();
+}
+
+void PartedCore::setProbeThreadCount(int count)
+{
+    m_probeThreadCount = count > 0 ? count : 0;
+    qDebug() << __FUNCTION__ << "probe thread count:" << getProbeThreadCount();
+}
+
+int PartedCore::getProbeThreadCount()
+{
+    if (m_probeThreadCount > 0) {
+        return m_probeThreadCount;
+    }
+
+    //探测耗时主要在外部命令及设备IO上 默认线程数不低于4
+    return qMax(QThread::idealThreadCount(), 4);
+}
+
+QStringList PartedCore::getProbeStatistics()
+{
+    return ProbeStats::statistics() + CommandExecutor::statistics() + DeviceQueryCache::statistics();
+}
+
+QStringList PartedCore::getProbeDeviceTime()
+{
+    QStringList list;
+    foreach (const DeviceProbeTime &time, m_probeTime) {
+        list.append(time.toString());
+    }
+
+    return list;
+}
+
 /***********************************************public****************************************************************/
 void PartedCore::setDeviceFromDisk(Device &device, const QString &devicePath)
 {
@@ -1676,7 +1812,7 @@ void PartedCore::setDeviceFromDisk(Device &device, const QString &devicePath)
 
                 // Create virtual partition covering the whole disk device
                 // with unknown contents.
-                Partition *partition_temp = new Partition();
+                Partition *partition_temp = device.partitionArena().create<Partition>();
                 partition_temp->setUnpartitioned(device.m_path,
                                                  lpDevice->path,
                                                  FS_UNKNOWN,
@@ -1691,7 +1827,7 @@ void PartedCore::setDeviceFromDisk(Device &device, const QString &devicePath)
                 device.m_diskType = "unrecognized";
                 device.m_maxPrims = 1;
 
-                Partition *partition_temp = new Partition();
+                Partition *partition_temp = device.partitionArena().create<Partition>();
                 partition_temp->setUnpartitioned(device.m_path,
                                                  "", // Overridden with "unallocated"
                                                  FS_UNALLOCATED,
@@ -1725,6 +1861,103 @@ bool PartedCore::useableDevice(const PedDevice *lpDevice)
     return success;
 }
 
+QVector<QString> PartedCore::getUseableDevicePaths()
+{
+    //先按sysfs筛选 只有需要管理的设备才交给libparted并读取第一个扇区
+    QVector<QString> devicePaths;
+    QMutexLocker locker(&m_pedDeviceMutex);
+    foreach (const QString &devicePath, BlockDeviceEnumerator::devicePaths()) {
+        /* TO TRANSLATORS: looks like   Confirming /dev/sda */
+        qDebug() << QString("Confirming %1").arg(devicePath);
+
+        //only add this device if we can read the first sector (which means it's a real device)
+        PedDevice *lpDevice = ped_device_get(devicePath.toStdString().c_str());
+        if (lpDevice && useableDevice(lpDevice))
+            devicePaths.push_back(devicePath);
+    }
+
+    return devicePaths;
+}
+
+void PartedCore::probeDevices(const QVector<QString> &devicePaths, QMap<QString, Device> &deviceMap, QVector<DeviceProbeTime> &probeTime)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    //每个任务只写入自己下标的位置 全部完成后再按路径顺序合并 保证结果与串行探测一致
+    std::vector<Device> devices(static_cast<size_t>(devicePaths.size()));
+    std::vector<DeviceProbeTime> times(static_cast<size_t>(devicePaths.size()));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(getProbeThreadCount(), devicePaths.size())));
+    for (int t = 0; t < devicePaths.size(); t++) {
+        pool.start(new DeviceProbeTask(this, devicePaths.at(t), devices[static_cast<size_t>(t)], times[static_cast<size_t>(t)]));
+    }
+    pool.waitForDone();
+
+    probeTime.clear();
+    for (int t = 0; t < devicePaths.size(); t++) {
+        deviceMap.insert(devicePaths.at(t), devices[static_cast<size_t>(t)]);
+        probeTime.append(times[static_cast<size_t>(t)]);
+        qDebug() << __FUNCTION__ << times[static_cast<size_t>(t)].toString();
+    }
+
+    qDebug() << __FUNCTION__ << QString("probe %1 devices with %2 threads in %3ms")
+             .arg(devicePaths.size()).arg(pool.maxThreadCount()).arg(timer.elapsed());
+}
+
+bool PartedCore::useableDevice(const QString &devicePath)
+{
+    if (!BlockDeviceEnumerator::isCandidate(devicePath)) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_pedDeviceMutex);
+    PedDevice *lpDevice = ped_device_get(devicePath.toStdString().c_str());
+    if (lpDevice == nullptr) {
+        return false;
+    }
+
+    return useableDevice(lpDevice);
+}
+
+DeviceInfo PartedCore::buildDeviceInfo(const Device &device, const QString &rootFsName)
+{
+    DeviceInfo devinfo = device.getDeviceInfo();
+    for (int i = 0; i < device.m_partitions.size(); i++) {
+        const Partition &pat = *(device.m_partitions.at(i)); //拷贝构造速度提升 const 引用
+        PartitionInfo partinfo = pat.getPartitionInfo();
+
+//        if(m_hiddenPartition.indexOf(partinfo.m_uuid) != -1 && !partinfo.m_uuid.isEmpty()) {
+//            partinfo.m_flag = 1;
+//        } else {
+//            partinfo.m_flag = 0;
+//        }
+
+        if (rootFsName == pat.getPath()) {
+            partinfo.m_flag = 4;
+            qDebug() << __FUNCTION__ << "Set systemfs Flags 1 !! " << pat.m_devicePath << " " << pat.m_name << " " << pat.m_uuid;
+        }
+
+        if (pat.m_type == PartitionType::TYPE_EXTENDED) {
+            devinfo.m_partition.push_back(partinfo);
+            for (int k = 0; k < pat.m_logicals.size(); k++) {
+                const Partition &plogic = *(pat.m_logicals.at(k));
+                partinfo = plogic.getPartitionInfo();
+                if (rootFsName == plogic.m_name) {
+                    partinfo.m_flag = 4;
+                    qDebug() << __FUNCTION__ << "Set systemfs Flags2 !! " << plogic.m_devicePath << " " << plogic.m_name << " " << plogic.m_uuid;
+                }
+                devinfo.m_partition.push_back(partinfo);
+            }
+        } else {
+            devinfo.m_partition.push_back(partinfo);
+        }
+    }
+
+    return devinfo;
+}
+
 bool PartedCore::delTempMountFile()
 {
     QDir dir("/media");
@@ -1764,11 +1997,14 @@ void PartedCore::initConnection()
 {
     connect(this, &PartedCore::refreshDeviceInfo, this, &PartedCore::onRefreshDeviceInfo);
     connect(this, &PartedCore::probeAllInfo, &m_probeThread, &ProbeThread::probeDeviceInfo);
+    connect(this, &PartedCore::probeDeviceChanged, &m_probeThread, &ProbeThread::probeDeviceChanged);
     connect(&m_probeThread, &ProbeThread::updateDeviceInfo, this, &PartedCore::syncDeviceInfo);
+    connect(&m_probeThread, &ProbeThread::updateUsedSectors, this, &PartedCore::onUsedSectorsUpdated);
 
     connect(this, &PartedCore::checkBadBlocksRunCountStart, &m_checkThread, &WorkThread::runCount);
     connect(this, &PartedCore::checkBadBlocksRunTimeStart, &m_checkThread, &WorkThread::runTime);
-    connect(&m_checkThread, &WorkThread::checkBadBlocksInfo, this, &PartedCore::checkBadBlocksCountInfo);
+    connect(&m_checkThread, &WorkThread::checkBadBlocksProgress, this, &PartedCore::checkBadBlocksProgress);
+    connect(&m_checkThread, &WorkThread::checkBadSectorsRange, this, &PartedCore::checkBadSectorsRange);
     connect(&m_checkThread, &WorkThread::checkBadBlocksFinished, this, &PartedCore::checkBadBlocksFinished);
 
     connect(&m_fixthread, &FixThread::fixBadBlocksInfo, this, &PartedCore::fixBadBlocksInfo);
@@ -1789,6 +2025,13 @@ void PartedCore::findSupportedCore()
 
 void PartedCore::setDeviceSerialNumber(Device &device)
 {
+    //优先读取udev及sysfs 都读取不到时才调用hdparm
+    QString serialNumber = DeviceStorage().getDiskInfoSerialNumber(device.m_path);
+    if (!serialNumber.isEmpty()) {
+        device.m_serialNumber = serialNumber;
+        return;
+    }
+
     if (!hdparmFound)
         // Serial number left blank when the hdparm command is not installed.
         return;
@@ -1809,7 +2052,7 @@ void PartedCore::setDeviceSerialNumber(Device &device)
         //     SG_IO: bad/missing sense data, sb[]:  70 00 05 00 00 00 00 0a ...
         device.m_serialNumber = "none";
     } else {
-        QString serialNumber = Utils::regexpLabel(output, "(?<=Serial Number:).*(?=\n)").trimmed();
+        serialNumber = Utils::regexpLabel(output, "(?<=Serial Number:).*(?=\n)").trimmed();
         if (!serialNumber.isEmpty())
             device.m_serialNumber = serialNumber;
     }
@@ -1949,99 +2192,42 @@ void PartedCore::autoUmount()
 //    qDebug() << __FUNCTION__ << "autoUmount end";
 }
 
-void PartedCore::probeDeviceInfo(const QString &)
+void PartedCore::loadProbeCaches(ProbeRefresh &refresh, QString &rootFsName)
 {
-    m_inforesult.clear();
-    m_deviceMap.clear();
-    QString rootFsName;
-    QVector<QString> devicePaths;
-    //qDebug() << __FUNCTION__ << "**1";
-    devicePaths.clear();
     BlockSpecial::clearCache();
-    //qDebug() << __FUNCTION__ << "**2";
+    refresh.lap("BlockSpecial::clearCache");
     ProcPartitionsInfo::loadCache();
-    //qDebug() << __FUNCTION__ << "**3";
+    refresh.lap("ProcPartitionsInfo::loadCache");
     FsInfo::loadCache();
-    //qDebug() << __FUNCTION__ << "**4";
-    //qDebug() << __FUNCTION__ << "**5";
+    refresh.lap("FsInfo::loadCache");
     MountInfo::loadCache(rootFsName);
-    //qDebug() << __FUNCTION__ << "**6";
-    ped_device_probe_all();
-    //qDebug() << __FUNCTION__ << "**7";
-    PedDevice *lpDevice = ped_device_get_next(nullptr);
-    while (lpDevice) {
-        /* TO TRANSLATORS: looks like   Confirming /dev/sda */
-        qDebug() << QString("Confirming %1").arg(lpDevice->path);
-
-        //only add this device if we can read the first sector (which means it's a real device)
-        if (useableDevice(lpDevice))
-            devicePaths.push_back(lpDevice->path);
-//        qDebug() << lpDevice->path;
-        lpDevice = ped_device_get_next(lpDevice);
-    }
-//    qDebug() << __FUNCTION__ << "devicepaths size=" << devicepaths.size();
-    std::sort(devicePaths.begin(), devicePaths.end());
-    //qDebug() << __FUNCTION__ << "**8";
-    for (int t = 0; t < devicePaths.size(); t++) {
-        /*TO TRANSLATORS: looks like Searching /dev/sda partitions */
-        Device tempDevice;
-        setDeviceFromDisk(tempDevice, devicePaths[t]);
-        DeviceStorage device;
-        tempDevice.m_mediaType = device.getDiskInfoMediaType(devicePaths[t]);
-        device.getDiskInfoModel(devicePaths[t], tempDevice.m_model);
-        device.getDiskInfoInterface(devicePaths[t], tempDevice.m_interface, tempDevice.m_model);
+    refresh.lap("MountInfo::loadCache");
+}
 
-        m_deviceMap.insert(devicePaths.at(t), tempDevice);
-    }
-    //qDebug() << __FUNCTION__ << "**9";
+void PartedCore::probeDeviceInfo(const QString &)
+{
+    ProbeRefresh refresh;
+    m_inforesult.clear();
+    m_deviceMap.clear();
+    QString rootFsName;
+    loadProbeCaches(refresh, rootFsName);
+    QVector<QString> devicePaths = getUseableDevicePaths();
+    refresh.lap("getUseableDevicePaths");
+    probeDevices(devicePaths, m_deviceMap, m_probeTime);
+    refresh.lap("probeDevices");
 //    getPartitionHiddenFlag();
     for (auto it = m_deviceMap.begin(); it != m_deviceMap.end(); it++) {
-        DeviceInfo devinfo = it.value().getDeviceInfo();
-        for (int i = 0; i < it.value().m_partitions.size(); i++) {
-            const Partition &pat = *(it.value().m_partitions.at(i)); //拷贝构造速度提升 const 引用
-            PartitionInfo partinfo = pat.getPartitionInfo();
-
-//            if(m_hiddenPartition.indexOf(partinfo.m_uuid) != -1 && !partinfo.m_uuid.isEmpty()) {
-//                partinfo.m_flag = 1;
-//            } else {
-//                partinfo.m_flag = 0;
-//            }
-
-
-            //partinfo = pat.getPartitionInfo();
-            if (rootFsName == pat.getPath()) {
-                partinfo.m_flag = 4;
-                qDebug() << __FUNCTION__ << "Set systemfs Flags 1 !! " << pat.m_devicePath << " " << pat.m_name << " " << pat.m_uuid;
-            }
-
-            qDebug() << __FUNCTION__ << " EXTEND is " << PartitionType::TYPE_EXTENDED << " and I am " << pat.m_type;
-            if (pat.m_type == PartitionType::TYPE_EXTENDED) {
-                devinfo.m_partition.push_back(partinfo);
-                for (int k = 0; k < pat.m_logicals.size(); k++) {
-                    const Partition &plogic = *(pat.m_logicals.at(k));
-                    partinfo = plogic.getPartitionInfo();
-                    if (rootFsName == plogic.m_name) {
-                        partinfo.m_flag = 4;
-                        qDebug() << __FUNCTION__ << "Set systemfs Flags2 !! " << plogic.m_devicePath << " " << plogic.m_name << " " << plogic.m_uuid;
-                    }
-                    qDebug() << __FUNCTION__ << plogic.m_devicePath << " " << plogic.m_name << " " << plogic.m_uuid;
-                    devinfo.m_partition.push_back(partinfo);
-                }
-            } else {
-                devinfo.m_partition.push_back(partinfo);
-            }
-        }
-        m_inforesult.insert(devinfo.m_path, devinfo);
+        m_inforesult.insert(it.key(), buildDeviceInfo(it.value(), rootFsName));
     }
+    refresh.lap("buildDeviceInfo");
     LVMOperator::getDeviceDataAndLVMInfo(m_inforesult, m_lvmInfo);
+    refresh.lap("LVM");
     LUKSOperator::updateLUKSInfo(m_inforesult, m_lvmInfo, m_LUKSInfo);
-//    qDebug() << __FUNCTION__ << m_inforesult.count();
-    //qDebug() << __FUNCTION__ << "**10";
+    refresh.lap("LUKS");
 }
 
-void PartedCore::onRefreshDeviceInfo(int type, bool arg1, QString arg2)
+void PartedCore::startProbeThread()
 {
-    qDebug() << " will call probeThread in thread !";
     if (m_workerThreadProbe == nullptr) {
         m_workerThreadProbe = new QThread();
         qDebug() << "onRefresh Create thread: " << QThread::currentThreadId() << " ++++++++" << m_workerThreadProbe << endl;
@@ -2049,6 +2235,100 @@ void PartedCore::onRefreshDeviceInfo(int type, bool arg1, QString arg2)
         m_probeThread.moveToThread(m_workerThreadProbe);
         m_workerThreadProbe->start();
     }
+}
+
+void PartedCore::publishTopology()
+{
+    TopologyDelta delta = TopologyDelta::diff(m_topologyGeneration, m_topologyGeneration + 1,
+                                              m_publishedDevices, m_publishedLVM, m_publishedLUKS,
+                                              m_inforesult, m_lvmInfo, m_LUKSInfo);
+    ++m_topologyGeneration;
+    m_publishedDevices = m_inforesult;
+    m_publishedLVM = m_lvmInfo;
+    m_publishedLUKS = m_LUKSInfo;
+    if (m_topologyStale || !delta.isEmpty()) {
+        m_topologyStale = false;
+        TopologyCache::save(m_publishedDevices, m_publishedLVM, m_publishedLUKS);
+    }
+    qDebug() << __FUNCTION__ << "generation:" << m_topologyGeneration << "changed devices:" << delta.m_changedDevices.keys()
+             << "removed devices:" << delta.m_removedDevices << "changed vgs:" << delta.m_changedVGs.keys() << "removed vgs:" << delta.m_removedVGs;
+
+    //增量为空时同样发送 客户端依赖该信号结束等待状态
+    emit updateTopologyDelta(delta);
+
+    //有客户端选择二进制镜像时额外生成 由服务对象只发送给这些客户端
+    if (m_topologyImageEnabled) {
+        QDBusUnixFileDescriptor image = createTopologyImage(delta);
+        if (image.isValid()) {
+            emit updateTopologyImage(image);
+        }
+    }
+}
+
+void PartedCore::onUsedSectorsUpdated(const TopologySnapshotPtr &snapshot)
+{
+    if (adoptSnapshot(snapshot)) {
+        publishTopology();
+    }
+}
+
+TopologyDelta PartedCore::getTopology()
+{
+    TopologyDelta delta = TopologyDelta::full(m_topologyGeneration, m_publishedDevices, m_publishedLVM, m_publishedLUKS);
+    delta.m_stale = m_topologyStale;
+    return delta;
+}
+
+QDBusUnixFileDescriptor PartedCore::getTopologyImage()
+{
+    return createTopologyImage(getTopology());
+}
+
+void PartedCore::setTopologyImageEnabled(bool enable)
+{
+    qDebug() << __FUNCTION__ << enable;
+    m_topologyImageEnabled = enable;
+}
+
+QDBusUnixFileDescriptor PartedCore::createTopologyImage(const TopologyDelta &delta)
+{
+    QDBusUnixFileDescriptor image;
+    QByteArray data = TopologyImage::encode(delta);
+    int fd = memfd_create("deepin-diskmanager-topology", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qDebug() << __FUNCTION__ << "memfd_create failed:" << strerror(errno);
+        return image;
+    }
+
+    qint64 written = 0;
+    while (written < data.size()) {
+        ssize_t ret = write(fd, data.constData() + written, static_cast<size_t>(data.size() - written));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            qDebug() << __FUNCTION__ << "write failed:" << strerror(errno);
+            close(fd);
+            return image;
+        }
+        written += ret;
+    }
+
+    //密封后客户端可以放心mmap 服务端无法再修改或截断 避免客户端读取时SIGBUS
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        qDebug() << __FUNCTION__ << "seal failed:" << strerror(errno);
+        close(fd);
+        return image;
+    }
+
+    image.giveFileDescriptor(fd);
+    return image;
+}
+
+void PartedCore::onRefreshDeviceInfo(int type, bool arg1, QString arg2)
+{
+    qDebug() << " will call probeThread in thread !";
+    startProbeThread();
 
     if (type == DISK_SIGNAL_USBUPDATE) {
         m_usbSig = type;
@@ -2064,18 +2344,58 @@ void PartedCore::onRefreshDeviceInfo(int type, bool arg1, QString arg2)
     qDebug() << " called probeThread in thread !";
 }
 
-void PartedCore::syncDeviceInfo(/*const QMap<QString, Device> deviceMap, */const DeviceInfoMap inforesult, const LVMInfo lvmInfo, const LUKSMap &luks)
+void PartedCore::onBlockDeviceChanged(const QString &action, const QString &devicePath)
+{
+    qDebug() << __FUNCTION__ << action << devicePath;
+    //设备插拔或介质变化后smartctl等查询结果及文件系统使用空间不再有效
+    DeviceQueryCache::invalidate(devicePath);
+    FsUsageCache::invalidate(devicePath);
+    if (action == "add") {
+        //因为永久挂载的原因需要先执行mount -a让系统文件挂载生效
+        QString output, errstr;
+        Utils::executCmd("mount -a", output, errstr);
+    }
+
+    startProbeThread();
+    m_usbSig = DISK_SIGNAL_USBUPDATE;
+    m_usbArg1 = true;
+    m_usbArg2 = devicePath;
+    m_ueventAction = action;
+    emit probeDeviceChanged(action, devicePath);
+}
+
+bool PartedCore::adoptSnapshot(const TopologySnapshotPtr &snapshot)
+{
+    if (!snapshot || (m_snapshot && snapshot->m_sequence <= m_snapshot->m_sequence)) {
+        return false;
+    }
+
+    //快照只读 以下均为隐式共享的浅拷贝
+    m_snapshot = snapshot;
+    m_deviceMap = snapshot->deviceMap();
+    m_probeTime = snapshot->m_probeTime;
+    m_inforesult = snapshot->m_inforesult;
+    m_lvmInfo = snapshot->m_lvmInfo;
+    m_LUKSInfo = snapshot->m_luksInfo;
+    return true;
+}
+
+void PartedCore::syncDeviceInfo(const TopologySnapshotPtr &snapshot)
 {
     qDebug() << "syncDeviceInfo finally!";
-    //m_deviceMap = deviceMap;
-    m_deviceMap = m_probeThread.getDeviceMap();
-    m_inforesult = inforesult;
-    m_lvmInfo = lvmInfo;
-    m_LUKSInfo = luks;
-    emit updateLUKSInfo(m_LUKSInfo);
-    emit updateDeviceInfo(m_inforesult, m_lvmInfo);
+    //过期快照已被更新的快照替代 拓扑及挂起的通知已随更新的快照发送
+    if (!adoptSnapshot(snapshot)) {
+        qDebug() << __FUNCTION__ << "ignore stale snapshot";
+        return;
+    }
+    publishTopology();
 
     if (m_usbSig == DISK_SIGNAL_USBUPDATE) {
+        if (m_ueventAction == "remove") {
+            //设备拔出后卸载已不存在设备的挂载点
+            autoUmount();
+        }
+        m_ueventAction.clear();
         emit usbUpdated();
         m_usbSig = 0;
         m_usbArg1 = false;
@@ -2205,7 +2525,9 @@ bool PartedCore::secuClear(const QString &path, const Sector &start, const Secto
 /***********************************************private gparted****************************************************************/
 bool PartedCore::getDevice(const QString &devicePath, PedDevice *&lpDevice, bool flush)
 {
+    m_pedDeviceMutex.lock();
     lpDevice = ped_device_get(devicePath.toStdString().c_str());
+    m_pedDeviceMutex.unlock();
 
 
     int fd = open(devicePath.toStdString().c_str(), O_RDONLY);
@@ -2274,8 +2596,10 @@ void PartedCore::destroyDeviceAndDisk(PedDevice *&lpDevice, PedDisk *&lpDisk)
         ped_disk_destroy(lpDisk);
     lpDisk = nullptr;
 
-    if (lpDevice)
+    if (lpDevice) {
+        QMutexLocker locker(&m_pedDeviceMutex);
         ped_device_destroy(lpDevice);
+    }
     lpDevice = nullptr;
 }
 
@@ -2368,7 +2692,7 @@ PedPartition *PartedCore::getLpPartition(const PedDisk *lpDisk, const Partition
 
 void PartedCore::setDeviceOnePartition(Device &device, PedDevice *lpDevice, FSType fstype)
 {
-    device.m_partitions.clear();
+    device.clearPartitions();
     QString path(lpDevice->path);
     bool partitionIsBusy = isBusy(fstype, path);
 
@@ -2377,7 +2701,7 @@ void PartedCore::setDeviceOnePartition(Device &device, PedDevice *lpDevice, FSTy
         partitionTemp = nullptr; //= new PartitionLUKS();
         return;
     } else
-        partitionTemp = new Partition();
+        partitionTemp = device.partitionArena().create<Partition>();
 //    if (nullptr == partitionTemp)
 //        return;
     partitionTemp->setUnpartitioned(device.m_path,
@@ -2485,8 +2809,9 @@ void PartedCore::setUsedSectors(Partition &partition, PedDisk *lpDisk)
             switch (getFileSystem(partition.m_fstype).online_read) {
             case FS::EXTERNAL:
                 pFilesystem = getFileSystemObject(partition.m_fstype);
-                if (pFilesystem)
-                    pFilesystem->setUsedSectors(partition);
+                if (pFilesystem) {
+                    fsObjectSetUsedSectors(pFilesystem, partition);
+                }
                 break;
             case FS::GPARTED:
                 mountedFileSystemSetUsedSectors(partition);
@@ -2497,9 +2822,22 @@ void PartedCore::setUsedSectors(Partition &partition, PedDisk *lpDisk)
         } else { // Not busy file system
             switch (getFileSystem(partition.m_fstype).read) {
             case FS::EXTERNAL:
+                if (FsUsageCache::load(partition)) {
+                    break;
+                }
+
+                //dumpe2fs/ntfsresize/fsck.fat等工具较慢 先下发分区布局再由后台计算
+                //lv及luks映射的使用空间在刷新时同步到lvm/luks信息中 不延后计算
+                if (m_deferUsedSectors && !QFileInfo(partition.getPath()).canonicalFilePath().startsWith("/dev/dm-")) {
+                    partition.m_usagePending = true;
+                    return;
+                }
+
                 pFilesystem = getFileSystemObject(partition.m_fstype);
-                if (pFilesystem)
-                    pFilesystem->setUsedSectors(partition);
+                if (pFilesystem) {
+                    fsObjectSetUsedSectors(pFilesystem, partition);
+                }
+                FsUsageCache::save(partition);
                 break;
 #ifdef HAVE_LIBPARTED_FS_RESIZE
             case FS::LIBPARTED:
@@ -2550,6 +2888,35 @@ void PartedCore::setUsedSectors(Partition &partition, PedDisk *lpDisk)
     }
 }
 
+void PartedCore::setDeferUsedSectors(bool defer)
+{
+    m_deferUsedSectors = defer;
+}
+
+void PartedCore::readUsedSectors(PartitionInfo &info)
+{
+    Partition partition;
+    partition.set(info.m_devicePath, info.m_path, info.m_partitionNumber, static_cast<PartitionType>(info.m_type),
+                  static_cast<FSType>(info.m_fileSystemType), info.m_sectorStart, info.m_sectorEnd,
+                  info.m_sectorSize, info.m_insideExtended, info.m_busy);
+    partition.m_uuid = info.m_uuid;
+
+    if (!FsUsageCache::load(partition)) {
+        FileSystem *pFilesystem = getFileSystemObject(partition.m_fstype);
+        if (pFilesystem) {
+            fsObjectSetUsedSectors(pFilesystem, partition);
+        }
+        FsUsageCache::save(partition);
+    }
+
+    info.m_sectorsUsed = partition.m_sectorsUsed;
+    info.m_sectorsUnused = partition.m_sectorsUnused;
+    info.m_sectorsUnallocated = partition.m_sectorsUnallocated;
+    info.m_significantThreshold = partition.m_significantThreshold;
+    info.m_fileSystemBlockSize = partition.m_fsBlockSize;
+    info.m_usagePending = false;
+}
+
 void PartedCore::mountedFileSystemSetUsedSectors(Partition &partition)
 {
     if (partition.getMountPoints().size() > 0 && MountInfo::isDevMounted(partition.getPath())) {
@@ -2564,7 +2931,7 @@ void PartedCore::mountedFileSystemSetUsedSectors(Partition &partition)
 void PartedCore::setDevicePartitions(Device &device, PedDevice *lpDevice, PedDisk *lpDisk)
 {
     int extindex = -1;
-    device.m_partitions.clear();
+    device.clearPartitions();
 
     PedPartition *lpPartition = ped_disk_next_partition(lpDisk, nullptr);
     while (lpPartition) {
@@ -2582,7 +2949,7 @@ void PartedCore::setDevicePartitions(Device &device, PedDevice *lpDevice, PedDis
             //            if (fstype == FS_LUKS)
             //                partition_temp = new PartitionLUKS();
             //            else
-            partitionTemp = new Partition();
+            partitionTemp = device.partitionArena().create<Partition>();
             partitionTemp->set(device.m_path,
                                partitionPath,
                                lpPartition->num,
@@ -2607,7 +2974,7 @@ void PartedCore::setDevicePartitions(Device &device, PedDevice *lpDevice, PedDis
         case PED_PARTITION_EXTENDED:
             partitionPath = getPartitionPath(lpPartition);
 
-            partitionTemp = new Partition();
+            partitionTemp = device.partitionArena().create<Partition>();
             partitionTemp->set(device.m_path,
                                partitionPath,
                                lpPartition->num,
@@ -2654,6 +3021,7 @@ void PartedCore::setDevicePartitions(Device &device, PedDevice *lpDevice, PedDis
 
     if (extindex > -1) {
         insertUnallocated(device.m_path,
+                          device.partitionArena(),
                           device.m_partitions.at(extindex)->m_logicals,
                           device.m_partitions.at(extindex)->m_sectorStart,
                           device.m_partitions.at(extindex)->m_sectorEnd,
@@ -2670,7 +3038,7 @@ void PartedCore::setDevicePartitions(Device &device, PedDevice *lpDevice, PedDis
         }
     }
 
-    insertUnallocated(device.m_path, device.m_partitions, 0, device.m_length - 1, device.m_sectorSize, false);
+    insertUnallocated(device.m_path, device.partitionArena(), device.m_partitions, 0, device.m_length - 1, device.m_sectorSize, false);
 }
 
 
@@ -3505,11 +3873,11 @@ bool PartedCore::createPartition(Partition &newPartition, Sector minSize)
     return newPartition.m_partitionNumber > 0;
 }
 
-void PartedCore::insertUnallocated(const QString &devicePath, QVector<Partition *> &partitions, Sector start, Sector end, Byte_Value sectorSize, bool insideExtended)
+void PartedCore::insertUnallocated(const QString &devicePath, PartitionArena &arena, QVector<Partition *> &partitions, Sector start, Sector end, Byte_Value sectorSize, bool insideExtended)
 {
     //if there are no partitions at all..
     if (partitions.empty()) {
-        Partition *partitionTemp = new Partition();
+        Partition *partitionTemp = arena.create<Partition>();
         partitionTemp->setUnallocated(devicePath, start, end, sectorSize, insideExtended);
         partitions.push_back(partitionTemp);
         return;
@@ -3518,7 +3886,7 @@ void PartedCore::insertUnallocated(const QString &devicePath, QVector<Partition
     //start <---> first partition start
     if ((partitions.front()->m_sectorStart - start) > (MEBIBYTE / sectorSize)) {
         Sector tempEnd = partitions.front()->m_sectorStart - 1;
-        Partition *partitionTemp = new Partition();
+        Partition *partitionTemp = arena.create<Partition>();
         partitionTemp->setUnallocated(devicePath, start, tempEnd, sectorSize, insideExtended);
         partitions.insert(partitions.begin(), partitionTemp);
     }
@@ -3530,7 +3898,7 @@ void PartedCore::insertUnallocated(const QString &devicePath, QVector<Partition
                     && ((partitions.at(t + 1)->m_sectorStart - partitions.at(t)->m_sectorEnd - 1) == (MEBIBYTE / sectorSize)))) {
             Sector tempStart = partitions.at(t)->m_sectorEnd + 1;
             Sector tempEnd = partitions.at(t + 1)->m_sectorStart - 1;
-            Partition *partitionTemp = new Partition();
+            Partition *partitionTemp = arena.create<Partition>();
             partitionTemp->setUnallocated(devicePath, tempStart, tempEnd,
                                           sectorSize, insideExtended);
             partitions.insert(partitions.begin() + (++t), partitionTemp);
@@ -3541,7 +3909,7 @@ void PartedCore::insertUnallocated(const QString &devicePath, QVector<Partition
     //last partition end <---> end
     if ((end - partitions.back()->m_sectorEnd) >= (MEBIBYTE / sectorSize)) {
         Sector tempStart = partitions.back()->m_sectorEnd + 1;
-        Partition *partitionTemp = new Partition();
+        Partition *partitionTemp = arena.create<Partition>();
         partitionTemp->setUnallocated(devicePath, tempStart, end, sectorSize, insideExtended);
         partitions.push_back(partitionTemp);
     }
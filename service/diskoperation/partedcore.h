@@ -34,16 +34,21 @@
 #include "thread.h"
 #include "DeviceStorage.h"
 #include "lvmoperator/lvmoperator.h"
+#include "topologydelta.h"
 
 #include <QObject>
 #include <QVector>
 #include <QMap>
 #include <QStringList>
 #include <QFile>
+#include <QMutex>
+#include <QDBusUnixFileDescriptor>
 
 #include <parted/parted.h>
 #include <parted/device.h>
 
+class ProbeRefresh;
+
 namespace DiskManager {
 
 /**
@@ -56,6 +61,12 @@ class PartedCore : public QObject
 public:
     explicit PartedCore(QObject *parent = nullptr);
     ~PartedCore();
+
+    /**
+     * @brief 服务启动时加载拓扑缓存并进行首次探测 只由服务对象调用 刷新线程内的辅助对象不调用
+     */
+    void init();
+
     //DBUS 调用
     //信息获取操作
     /**
@@ -262,6 +273,13 @@ public:
      */
     bool checkBadBlocks(const QString &devicePath, int blockStart, int blockEnd, QString checkTime, int checkSize, int flag);
 
+    /**
+     * @brief 从检查点继续坏道检测 按检查点中保存的检测方式及参数检测尚未检测的柱面
+     * @param devicePath：设备信息路径
+     * @return true开始检测false检查点不存在或已全部检测
+     */
+    bool resumeCheckBadBlocks(const QString &devicePath);
+
     /**
      * @brief 坏道修复
      * @param devicePath：设备信息路径
@@ -358,6 +376,67 @@ public:
      * @brief 个人测试
      */
     int test();
+
+    /**
+     * @brief 设置坏道检测的并发读取数 下次开始检测时生效
+     * @param depth：并发读取数 小于等于0时恢复为默认值
+     */
+    void setBadBlocksQueueDepth(int depth);
+
+    /**
+     * @brief 设置坏道检测是否使用自适应方式 下次开始检测时生效
+     * @param adaptive：true健康区域按大块读取 出错时二分定位到扇区 false逐柱面读取
+     */
+    void setBadBlocksAdaptiveScan(bool adaptive);
+
+    /**
+     * @brief 获取最近一次坏道检测的读取耗时统计
+     * @return 第一行为整个设备的p50、p99、最大值及对数刻度各桶样本数 其后每个区域一行
+     */
+    QStringList getBadBlocksLatency();
+
+    /**
+     * @brief 设置并行探测设备的线程数
+     * @param count：线程数 小于等于0时恢复为默认值
+     */
+    void setProbeThreadCount(int count);
+
+    /**
+     * @brief 获取并行探测设备的线程数
+     * @return 线程数
+     */
+    int getProbeThreadCount();
+
+    /**
+     * @brief 获取最近一次刷新每个设备的探测耗时
+     * @return 每个设备的耗时信息
+     */
+    QStringList getProbeDeviceTime();
+
+    /**
+     * @brief 获取最近32次刷新的耗时统计 包括各阶段、各设备及各外部命令
+     * @return 每个统计项一行 包括次数、最小值、中位数、p99及最大值 外部命令另有执行次数、失败及超时次数
+     */
+    QStringList getProbeStatistics();
+
+    /**
+     * @brief 获取最近一次下发的全量拓扑 客户端版本号过期时用于重新同步
+     *        服务启动后首次探测完成前返回缓存拓扑 m_stale为true
+     * @return 全量拓扑(带版本号)
+     */
+    TopologyDelta getTopology();
+
+    /**
+     * @brief 获取最近一次下发的全量拓扑的二进制镜像 客户端版本号过期时用于重新同步
+     * @return 只读密封的memfd 失败时为无效描述符
+     */
+    QDBusUnixFileDescriptor getTopologyImage();
+
+    /**
+     * @brief 设置是否生成拓扑二进制镜像 有客户端选择镜像时开启 开启后每次下发增量时额外发送updateTopologyImage
+     * @param enable：true生成二进制镜像false只发送updateTopologyDelta
+     */
+    void setTopologyImageEnabled(bool enable);
 public:
     //外部调用 非DBUS
     /**
@@ -367,6 +446,61 @@ public:
      */
     void setDeviceFromDisk(Device &device, const QString &devicePath);
 
+    /**
+     * @brief 获取所有可用设备路径(已排序) 由BlockDeviceEnumerator按sysfs筛选后再确认可读
+     * @return 设备路径集合
+     */
+    static QVector<QString> getUseableDevicePaths();
+
+    /**
+     * @brief 刷新开始时重新加载设备、分区、文件系统及挂载信息缓存 每项记录为一个阶段
+     * @param refresh：本次刷新
+     * @param rootFsName：根文件系统所在设备
+     */
+    static void loadProbeCaches(ProbeRefresh &refresh, QString &rootFsName);
+
+    /**
+     * @brief 使用线程池并行探测设备 结果按设备路径顺序合并
+     * @param devicePaths：设备路径集合
+     * @param deviceMap：设备对应信息表
+     * @param probeTime：每个设备探测耗时
+     */
+    void probeDevices(const QVector<QString> &devicePaths, QMap<QString, Device> &deviceMap, QVector<DeviceProbeTime> &probeTime);
+
+    /**
+     * @brief 确定设备路径是否是真正的设备
+     * @param devicePath：设备路径
+     * @return true确定false不确定
+     */
+    static bool useableDevice(const QString &devicePath);
+
+    /**
+     * @brief 根据设备信息生成对外发送的设备分区信息
+     * @param device：设备信息
+     * @param rootFsName：根文件系统所在设备
+     * @return 设备分区信息
+     */
+    static DeviceInfo buildDeviceInfo(const Device &device, const QString &rootFsName);
+
+    /**
+     * @brief 设置是否延后计算未挂载文件系统的已用空间 延后的分区标记为m_usagePending
+     * @param defer：true延后false同步计算
+     */
+    void setDeferUsedSectors(bool defer);
+
+    /**
+     * @brief 计算延后的分区已用空间 可在线程池中并行调用
+     * @param info：分区信息 计算完成后清除m_usagePending
+     */
+    void readUsedSectors(PartitionInfo &info);
+
+    /**
+     * @brief 块设备热插拔处理 只刷新发生变化的设备
+     * @param action：变化类型 add remove change
+     * @param devicePath：设备路径
+     */
+    void onBlockDeviceChanged(const QString &action, const QString &devicePath);
+
     /**
      * @brief 确定是否是真正的设备
      * @param lpDisk：设备信息
@@ -426,6 +560,16 @@ private:
      */
     void probeDeviceInfo(const QString &path = QString());
 
+    /**
+     * @brief 启动硬件刷新线程
+     */
+    void startProbeThread();
+
+    /**
+     * @brief 比较已下发拓扑与当前拓扑 生成新版本号并发送增量信号
+     */
+    void publishTopology();
+
     /**
      * @brief 刷新信息槽函数
      */
@@ -433,8 +577,22 @@ private:
 
     /**
       * @brief 刷新硬件信息
+      * @param snapshot：刷新线程发布的拓扑快照
       */
-    void syncDeviceInfo(const DeviceInfoMap inforesult, const LVMInfo lvmInfo, const LUKSMap &luks);
+    void syncDeviceInfo(const TopologySnapshotPtr &snapshot);
+
+    /**
+     * @brief 后台计算出分区已用空间后更新设备信息并下发拓扑增量
+     * @param snapshot：刷新线程发布的拓扑快照
+     */
+    void onUsedSectorsUpdated(const TopologySnapshotPtr &snapshot);
+
+    /**
+     * @brief 使用拓扑快照替换当前设备信息 比当前快照旧的快照被忽略
+     * @param snapshot：拓扑快照
+     * @return true已替换false已忽略
+     */
+    bool adoptSnapshot(const TopologySnapshotPtr &snapshot);
 
     /**
      * @brief 发送刷新信号并且返回bool值
@@ -757,6 +915,7 @@ private:
     /**
      * @brief 设置空闲空间
      * @param devicePath：设备路径
+     * @param arena：分区对象内存池 新建的空闲空间对象从此分配
      * @param partitions：分区信息列表
      * @param start：扇区开始
      * @param end：扇区结束
@@ -764,12 +923,20 @@ private:
      * @param insideExtended：扩展分区标志
      */
     static void insertUnallocated(const QString &devicePath,
+                                  PartitionArena &arena,
                                   QVector<Partition *> &partitions,
                                   Sector start,
                                   Sector end,
                                   Byte_Value sectorSize,
                                   bool insideExtended);
 
+    /**
+     * @brief 将拓扑增量编码后写入memfd并密封 之后该内存只能读取
+     * @param delta：拓扑增量
+     * @return memfd描述符 失败时为无效描述符
+     */
+    static QDBusUnixFileDescriptor createTopologyImage(const TopologyDelta &delta);
+
     /**
      * @brief 设置分区标志
      * @param partition：分区信息
@@ -1078,6 +1245,13 @@ signals:
      */
     void probeAllInfo();
 
+    /**
+     * @brief 刷新单个设备信息 启动刷新硬件线程
+     * @param action：变化类型 add remove change
+     * @param devicePath：设备路径
+     */
+    void probeDeviceChanged(const QString &action, const QString &devicePath);
+
     /**
      * @brief 刷新信息信号
      * @param type:信号类型 详细类型见sigtype.h
@@ -1098,6 +1272,18 @@ signals:
      */
     void updateLUKSInfo(const LUKSMap &luks);
 
+    /**
+     * @brief 拓扑增量信号 只携带相对上一版本变化的设备
+     * @param delta：拓扑增量
+     */
+    void updateTopologyDelta(const TopologyDelta &delta);
+
+    /**
+     * @brief 拓扑增量信号 增量以二进制镜像的形式存放于只读密封的memfd中
+     * @param image：拓扑增量镜像
+     */
+    void updateTopologyImage(const QDBusUnixFileDescriptor &image);
+
     //坏道检测相关信号
     /**
      * @brief 坏道检查线程启动信号(次数)
@@ -1110,13 +1296,20 @@ signals:
     void checkBadBlocksRunTimeStart();
 
     /**
-     * @brief 坏道检测检测信息信号(次数检测)
-     * @param cylinderNumber：检测柱面号
-     * @param cylinderTimeConsuming：柱面耗时
-     * @param cylinderStatus：柱面状态
-     * @param cylinderErrorInfo：柱面错误信息
+     * @brief 坏道检测批量进度信号
+     * @param devicePath：设备路径
+     * @param progress：检测结果 每项依次为起始扇区、扇区个数、耗时(us)、状态 字段见BadBlocksProgressField
+     */
+    void checkBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
+
+    /**
+     * @brief 坏道扇区范围信号(自适应检测)
+     * @param devicePath：设备路径
+     * @param startSector：起始逻辑扇区
+     * @param endSector：结束逻辑扇区 包含在范围内
+     * @param errorInfo：错误信息
      */
-    void checkBadBlocksCountInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+    void checkBadSectorsRange(const QString &devicePath, qint64 startSector, qint64 endSector, const QString &errorInfo);
 
     /**
      * @brief 坏道检测完成信号
@@ -1243,6 +1436,7 @@ signals:
     void unmountPartition(const QString &unmountMessage);
 private:
     QVector<PedPartitionFlag> m_flags;    //分区标志hidden boot efi等
+    TopologySnapshotPtr m_snapshot;       //当前使用的拓扑快照 持有m_deviceMap中的分区对象
     QMap<QString, Device> m_deviceMap;    //设备对应信息表
     DeviceInfoMap m_inforesult;           //全部设备分区信息
     Partition m_curpartition;             //当前选中分区信息
@@ -1260,6 +1454,10 @@ private:
 
     LVMInfo m_lvmInfo;                    //lvm 数据集合
     LUKSMap m_LUKSInfo;                   //luks 数据集合
+    QVector<DeviceProbeTime> m_probeTime; //最近一次刷新每个设备探测耗时
+    static int m_probeThreadCount;        //并行探测设备线程数
+    static QMutex m_pedDeviceMutex;       //libparted设备链表非线程安全 获取和销毁设备时加锁
+    bool m_deferUsedSectors{false};       //是否延后计算未挂载文件系统已用空间 只有刷新线程开启
 
     int m_type{0};                        //刷新结束后需要发送的信号类型
     bool m_arg1{false};                   //需要发送的信号bool类型参数
@@ -1268,6 +1466,14 @@ private:
     int m_usbSig{0};                      //刷新结束后需要发送的信号类型
     bool m_usbArg1{false};                //需要发送的信号bool类型参数
     QString m_usbArg2;                    //需要发送的信号QString类型参数
+    QString m_ueventAction;               //正在刷新的热插拔事件类型
+
+    quint64 m_topologyGeneration{1};      //已下发拓扑版本号 从1开始 客户端0表示尚未同步
+    DeviceInfoMap m_publishedDevices;     //已下发的磁盘信息 操作过程中m_inforesult等会被就地修改 增量以此为基准
+    LVMInfo m_publishedLVM;               //已下发的lvm信息
+    LUKSMap m_publishedLUKS;              //已下发的luks信息
+    bool m_topologyImageEnabled{false};   //是否有客户端使用二进制镜像接收拓扑
+    bool m_topologyStale{false};          //已下发拓扑是否来自启动时的缓存 后台探测完成前为true
 };
 
 } // namespace DiskManager
@@ -26,6 +26,7 @@
 */
 
 #include "partition.h"
+#include "partitionarena.h"
 #include "utils.h"
 #include "supportedfilesystems.h"
 
@@ -43,6 +44,11 @@ Partition *Partition::clone() const
     return new Partition(*this);
 }
 
+Partition *Partition::clone(PartitionArena &arena) const
+{
+    return arena.create<Partition>(*this);
+}
+
 bool Partition::sectorUsageKnown() const
 {
     return m_sectorsUsed >= 0 && m_sectorsUnused >= 0;
@@ -70,6 +76,7 @@ void Partition::reset()
     m_partitionNumber = m_sectorStart = m_sectorEnd = m_sectorsUsed = m_sectorsUnused = -1;
     m_sectorsUnallocated = 0;
     m_significantThreshold = 1;
+    m_usagePending = false;
     m_freeSpaceBefore = -1;
     m_sectorSize = 0;
     m_fsBlockSize = -1;
@@ -277,6 +284,7 @@ PartitionInfo Partition::getPartitionInfo() const
     info.m_sectorsUnused = m_sectorsUnused;
     info.m_sectorsUnallocated = m_sectorsUnallocated;
     info.m_significantThreshold = m_significantThreshold;
+    info.m_usagePending = m_usagePending;
     info.m_freeSpaceBefore = m_freeSpaceBefore;
     info.m_sectorSize = m_sectorSize;
     info.m_fileSystemBlockSize = m_fsBlockSize;
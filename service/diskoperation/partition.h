@@ -32,6 +32,8 @@
 
 namespace DiskManager {
 
+class PartitionArena;
+
 /**
  * @class Partition
  * @brief 分区信息类
@@ -48,6 +50,13 @@ public:
      */
     virtual Partition *clone() const;
 
+    /**
+     * @brief 在内存池中创建一个新对象
+     * @param arena：分区对象内存池
+     * @return 新对象 由内存池负责释放
+     */
+    virtual Partition *clone(PartitionArena &arena) const;
+
     /**
      * @brief 扇区使用率已知
      * @return true成功false失败
@@ -207,6 +216,7 @@ public:
     Sector m_sectorsUnused;      //分区未用空间
     Sector m_sectorsUnallocated; //Difference between the size of the partition and the file system
     Sector m_significantThreshold; //Threshold from intrinsic to significant unallocated sectors
+    bool m_usagePending;          //已用空间等待后台计算
     bool m_insideExtended;       //扩展标志
     bool m_busy;                  //挂载标志
     bool m_fsReadonly; // Is the file system mounted read-only?
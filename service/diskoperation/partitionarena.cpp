@@ -0,0 +1,85 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "partitionarena.h"
+#include "partition.h"
+
+namespace DiskManager {
+
+PartitionArena::PartitionArena(size_t blockSize)
+    : m_blockSize(blockSize)
+    , m_offset(0)
+    , m_allocatedBytes(0)
+{
+}
+
+PartitionArena::~PartitionArena()
+{
+    release();
+}
+
+void PartitionArena::release()
+{
+    for (int i = m_objects.size() - 1; i >= 0; i--) {
+        m_objects.at(i)->~Partition();
+    }
+    m_objects.clear();
+
+    foreach (char *block, m_blocks) {
+        ::operator delete(block);
+    }
+    m_blocks.clear();
+    m_offset = 0;
+    m_allocatedBytes = 0;
+}
+
+int PartitionArena::count() const
+{
+    return m_objects.size();
+}
+
+size_t PartitionArena::allocatedBytes() const
+{
+    return m_allocatedBytes;
+}
+
+void *PartitionArena::allocate(size_t size, size_t align)
+{
+    size_t offset = (m_offset + align - 1) & ~(align - 1);
+    if (m_blocks.isEmpty() || offset + size > m_blockSize) {
+        //超过块大小的对象单独占用一块 且不作为当前块 避免浪费当前块剩余空间
+        if (size > m_blockSize && !m_blocks.isEmpty()) {
+            char *block = static_cast<char *>(::operator new(size));
+            m_blocks.insert(m_blocks.size() - 1, block);
+            m_allocatedBytes += size;
+            return block;
+        }
+
+        size_t blockSize = qMax(size, m_blockSize);
+        m_blocks.push_back(static_cast<char *>(::operator new(blockSize)));
+        m_allocatedBytes += blockSize;
+        offset = 0;
+    }
+
+    m_offset = offset + size;
+    return m_blocks.last() + offset;
+}
+
+} // namespace DiskManager
@@ -0,0 +1,101 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PARTITIONARENA_H
+#define PARTITIONARENA_H
+
+#include <QVector>
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace DiskManager {
+
+class Partition;
+
+/**
+ * @class PartitionArena
+ * @brief 分区对象内存池 一个设备一次探测得到的分区及逻辑分区都从同一个内存池分配
+ *        对象按块连续存放 内存池析构或release时统一析构并释放 不能单独delete池中对象
+ */
+class PartitionArena
+{
+public:
+    /**
+     * @brief 构造内存池
+     * @param blockSize：单个内存块字节数
+     */
+    explicit PartitionArena(size_t blockSize = 16 * 1024);
+    ~PartitionArena();
+
+    /**
+     * @brief 在内存池中构造分区对象
+     * @param args：构造参数
+     * @return 分区对象 内存池释放前有效
+     */
+    template<typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        m_objects.push_back(object);
+        return object;
+    }
+
+    /**
+     * @brief 析构池中全部分区对象并释放内存块
+     */
+    void release();
+
+    /**
+     * @brief 获取池中分区对象个数
+     * @return 分区对象个数
+     */
+    int count() const;
+
+    /**
+     * @brief 获取已申请的内存字节数
+     * @return 内存字节数
+     */
+    size_t allocatedBytes() const;
+
+private:
+    /**
+     * @brief 从当前内存块中分配内存 不足时申请新块
+     * @param size：字节数
+     * @param align：对齐字节数
+     * @return 内存地址
+     */
+    void *allocate(size_t size, size_t align);
+
+    PartitionArena(const PartitionArena &) = delete;
+    PartitionArena &operator=(const PartitionArena &) = delete;
+
+private:
+    size_t m_blockSize;                 //单个内存块字节数
+    size_t m_offset;                    //当前内存块已使用字节数
+    size_t m_allocatedBytes;            //已申请的内存字节数
+    QVector<char *> m_blocks;           //内存块 最后一个为当前块
+    QVector<Partition *> m_objects;     //池中分区对象 按构造顺序
+};
+
+} // namespace DiskManager
+
+#endif // PARTITIONARENA_H
@@ -32,15 +32,68 @@
 #include "mountinfo.h"
 #include "partedcore.h"
 #include "luksoperator/luksoperator.h"
+#include "probestats.h"
+#include "badblockscanner.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QProcess>
 #include <QTime>
 #include <QThread>
+#include <QRunnable>
 #include <unistd.h>
 
 namespace DiskManager {
 
+/**
+ * @brief 刷新线程内使用的磁盘操作对象 只在刷新线程内创建一次
+ * @return 磁盘操作对象
+ */
+static PartedCore &probeCore()
+{
+    static PartedCore pcl;
+    return pcl;
+}
+
+/**
+ * @class UsedSectorsTask
+ * @brief 单个设备的分区已用空间计算任务 同一设备的分区串行计算 完成后将结果投递回刷新线程
+ */
+class UsedSectorsTask : public QRunnable
+{
+public:
+    UsedSectorsTask(ProbeThread *probeThread, quint64 generation, const QString &devicePath, const PartitionVec &partitions)
+        : m_probeThread(probeThread)
+        , m_generation(generation)
+        , m_devicePath(devicePath)
+        , m_partitions(partitions)
+        , m_refreshId(ProbeStats::currentRefresh())
+    {
+    }
+
+    void run() override
+    {
+        //刷新已结束时样本记录到刷新以外的样本
+        ProbeRefreshAttach attach(m_refreshId);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < m_partitions.size(); i++) {
+            probeCore().readUsedSectors(m_partitions[i]);
+        }
+        ProbeStats::addSample(QString("device:%1:usedSectors").arg(m_devicePath), timer.nsecsElapsed());
+
+        QMetaObject::invokeMethod(m_probeThread, "onUsedSectorsReady", Qt::QueuedConnection,
+                                  Q_ARG(quint64, m_generation), Q_ARG(QString, m_devicePath), Q_ARG(PartitionVec, m_partitions));
+    }
+
+private:
+    ProbeThread *m_probeThread;
+    quint64 m_generation;
+    QString m_devicePath;
+    PartitionVec m_partitions;
+    quint64 m_refreshId;    //创建任务时所在的刷新记录编号
+};
+
 WorkThread::WorkThread(QObject *parent)
 {
     Q_UNUSED(parent);
@@ -49,6 +102,12 @@ WorkThread::WorkThread(QObject *parent)
     m_blockEnd = 0;
     m_checkConut = 0;
     m_checkSize = 0;
+    m_queueDepth = DefaultQueueDepth;
+    m_adaptive = false;
+    m_continue = false;
+    m_latencyStart = 0;
+    m_regionCylinders = 1;
+    qRegisterMetaType<QVector<qlonglong>>();
 }
 
 void WorkThread::setStopFlag(int flag)
@@ -74,98 +133,289 @@ void WorkThread::setTimeInfo(const QString &devicePath, int blockStart, int bloc
     m_checkSize = checkSize;
 }
 
-void WorkThread::runCount()
+void WorkThread::setQueueDepth(int depth)
 {
-//    qDebug() << QThread::currentThreadId() << endl;
-    Sector i = m_blockStart;
-    Sector j = m_blockStart + 1;
-    QProcess proc;
-    while (j <= m_blockEnd + 1 && m_stopFlag != 2) {
-        QString cmd = QString("badblocks -sv -c %1 -b %2 %3 %4 %5").arg(m_checkConut).arg(m_checkSize).arg(m_devicePath).arg(j).arg(i);
+    m_queueDepth = DefaultQueueDepth;
+    if (depth > 0) {
+        m_queueDepth = depth;
+    }
+}
 
-        QDateTime ctime = QDateTime::currentDateTime();
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        QDateTime ctime1 = QDateTime::currentDateTime();
+void WorkThread::setAdaptive(bool adaptive)
+{
+    m_adaptive = adaptive;
+}
 
-        cmd = proc.readAllStandardError();
+void WorkThread::setContinue(bool keep)
+{
+    m_continue = keep;
+}
 
-        if (cmd.indexOf("0/0/0") != -1) {
+void WorkThread::runCount()
+{
+    //次数检测只判断读取是否出错
+    scanRegions(BadBlockCheckpoint::METHOD_COUNT, -1);
+}
 
-            QString cylinderNumber = QString("%1").arg(i);
-            QString cylinderTimeConsuming = QString("%1").arg(ctime.msecsTo(ctime1));
-            QString cylinderStatus = "good";
-            QString cylinderErrorInfo = "";
+void WorkThread::runTime()
+{
+    //超时检测读取耗时超过设定时间的柱面同样视为坏道
+    scanRegions(BadBlockCheckpoint::METHOD_TIME, m_checkTime.toInt());
+}
 
-            emit checkBadBlocksInfo(cylinderNumber, cylinderTimeConsuming, cylinderStatus, cylinderErrorInfo);
-        } else {
+void WorkThread::scanRegions(int method, qint64 timeout)
+{
+    //检测过程中只使用开始时的设置 避免主线程修改后同一次检测前后方式不一致
+    const bool adaptive = m_adaptive;
 
-            QString cylinderNumber = QString("%1").arg(i);
-            QString cylinderTimeConsuming = QString("%1").arg(ctime.msecsTo(ctime1));
-            QString cylinderStatus = "bad";
-            QString cylinderErrorInfo = "IO Read Error";
+    //自适应检测每次读取一个区段 区段至少包含一个柱面 区段大小按柱面取整
+    int extentRegions = 1;
+    if (adaptive && m_checkSize > 0) {
+        extentRegions = static_cast<int>(qMax<qint64>(1, AdaptiveExtentSize / m_checkSize));
+    }
 
-            emit checkBadBlocksInfo(cylinderNumber, cylinderTimeConsuming, cylinderStatus, cylinderErrorInfo);
+    BadBlockScanner scanner(m_devicePath, static_cast<qint64>(extentRegions) * m_checkSize, m_queueDepth);
+    beginCheckpoint(method, scanner.sectorSize(), adaptive);
+    m_progress.start();
+    if (adaptive) {
+        scanExtents(scanner, extentRegions, timeout);
+    } else {
+        Sector region = m_blockStart;
+        while (region <= m_blockEnd && m_stopFlag != 2) {
+            int count = static_cast<int>(qMin<Sector>(scanner.queueDepth(), m_blockEnd - region + 1));
+            checkRegions(scanner, region, count, timeout, false);
+            region += count;
+            pollProgress();
+            saveCheckpoint(false);
         }
-
-        i++;
-        j++;
     }
+    flushProgress();
+    saveCheckpoint(true);
 
     if (m_stopFlag != 2) {
         emit checkBadBlocksFinished(); //检测完成正常退出,发送给页面的正常结束信号
     }
 }
 
-void WorkThread::runTime()
+void WorkThread::scanExtents(BadBlockScanner &scanner, int extentRegions, qint64 timeout)
 {
+    Sector region = m_blockStart;
+    while (region <= m_blockEnd && m_stopFlag != 2) {
+        Sector first = region;
+        QVector<BadBlockScanner::ReadRequest> requests;
+        QVector<int> counts;
+        for (int i = 0; i < scanner.queueDepth() && region <= m_blockEnd; i++) {
+            int count = static_cast<int>(qMin<Sector>(extentRegions, m_blockEnd - region + 1));
+            BadBlockScanner::ReadRequest request;
+            request.m_offset = region * m_checkSize;
+            request.m_length = scanner.clampLength(request.m_offset, static_cast<qint64>(count) * m_checkSize);
+            request.m_slowThreshold = timeout < 0 ? -1 : timeout * count;
+            requests.append(request);
+            counts.append(count);
+            region += count;
+        }
 
-    Sector i = m_blockStart;
-    Sector j = m_blockStart + 1;
-    QProcess proc;
-    while (j <= m_blockEnd + 1 && m_stopFlag != 2) {
-        QString cmd = QString("badblocks -sv -b %1 %2 %3 %4").arg(m_checkSize).arg(m_devicePath).arg(j).arg(i);
+        scanner.read(requests);
+        for (int i = 0; i < requests.size() && m_stopFlag != 2; i++) {
+            const BadBlockScanner::ReadRequest &request = requests.at(i);
+            if (request.m_status == BadBlockScanner::READ_GOOD) {
+                //区段正常 整个区段作为一项进度
+                addProgress(request, scanner.sectorSize(), BAD_BLOCKS_GOOD);
+                m_checkpoint.addCoveredRegions(first, counts.at(i));
+                //区段耗时平均到每个柱面 与逐柱面读取的样本保持同一量纲
+                qint64 latency = request.m_latency / counts.at(i);
+                for (int j = 0; j < counts.at(i); j++) {
+                    addLatency(first + j, latency);
+                }
+            } else {
+                //区段出错或超时 逐柱面重读找出有问题的柱面
+                for (int j = 0; j < counts.at(i) && m_stopFlag != 2; j += scanner.queueDepth()) {
+                    checkRegions(scanner, first + j, qMin(scanner.queueDepth(), counts.at(i) - j), timeout, true);
+                }
+            }
+            first += counts.at(i);
+        }
+        pollProgress();
+        saveCheckpoint(false);
+    }
+}
 
-        QDateTime ctime = QDateTime::currentDateTime();
-        proc.start(cmd);
-        proc.waitForFinished(-1);
-        QDateTime ctime1 = QDateTime::currentDateTime();
+void WorkThread::checkRegions(BadBlockScanner &scanner, Sector firstRegion, int count, qint64 timeout, bool adaptive)
+{
+    QVector<BadBlockScanner::ReadRequest> requests;
+    for (int i = 0; i < count; i++) {
+        BadBlockScanner::ReadRequest request;
+        request.m_offset = (firstRegion + i) * m_checkSize;
+        request.m_length = scanner.clampLength(request.m_offset, m_checkSize);
+        request.m_slowThreshold = timeout;
+        requests.append(request);
+    }
+    scanner.read(requests);
+
+    for (int i = 0; i < requests.size(); i++) {
+        const BadBlockScanner::ReadRequest &request = requests.at(i);
+        Sector startSector = request.m_offset / scanner.sectorSize();
+        Sector endSector = (request.m_offset + request.m_length - 1) / scanner.sectorSize();
+        switch (request.m_status) {
+        case BadBlockScanner::READ_GOOD:
+            addProgress(request, scanner.sectorSize(), BAD_BLOCKS_GOOD);
+            break;
+        case BadBlockScanner::READ_SLOW:
+            addProgress(request, scanner.sectorSize(), BAD_BLOCKS_SLOW);
+            //超时无法定位到扇区 整个柱面作为慢扇区范围
+            BadBlockCheckpoint::addRange(m_checkpoint.m_slow, startSector, endSector);
+            if (adaptive) {
+                flushProgress();
+                emit checkBadSectorsRange(m_devicePath, startSector, endSector, "IO Device Timeout");
+            }
+            break;
+        case BadBlockScanner::READ_BAD:
+            addProgress(request, scanner.sectorSize(), BAD_BLOCKS_BAD);
+            if (adaptive) {
+                flushProgress();
+                QVector<BadBlockScanner::SectorRange> ranges = scanner.locateBadSectors(request.m_offset, request.m_length, [this] {
+                    pollProgress();
+                });
+                foreach (const BadBlockScanner::SectorRange &range, ranges) {
+                    BadBlockCheckpoint::addRange(m_checkpoint.m_bad, range.m_start, range.m_end);
+                    emit checkBadSectorsRange(m_devicePath, range.m_start, range.m_end, "IO Read Error");
+                }
+            } else {
+                BadBlockCheckpoint::addRange(m_checkpoint.m_bad, startSector, endSector);
+            }
+            break;
+        }
+        m_checkpoint.addCoveredRegions(firstRegion + i, 1);
+        addLatency(firstRegion + i, request.m_latency);
+    }
+}
 
-        cmd = proc.readAllStandardError();
+void WorkThread::beginCheckpoint(int method, int sectorSize, bool adaptive)
+{
+    BadBlockCheckpoint checkpoint;
+    checkpoint.m_serial = BadBlockCheckpoint::deviceSerial(m_devicePath);
+    checkpoint.m_devicePath = m_devicePath;
+    checkpoint.m_method = method;
+    checkpoint.m_blockStart = m_blockStart;
+    checkpoint.m_blockEnd = m_blockEnd;
+    checkpoint.m_checkCount = m_checkConut;
+    checkpoint.m_checkTime = m_checkTime;
+    checkpoint.m_checkSize = m_checkSize;
+    checkpoint.m_adaptive = adaptive;
+    checkpoint.m_sectorSize = sectorSize;
+
+    //继续检测时沿用原检查点的开始柱面、已检测范围及检测结果 设备路径可能在重启后变化
+    BadBlockCheckpoint saved;
+    bool keep = false;
+    if (m_continue && BadBlockCheckpoint::load(checkpoint.m_serial, saved)
+            && saved.sameParameters(checkpoint) && m_blockStart >= saved.m_blockStart) {
+        saved.m_devicePath = m_devicePath;
+        saved.m_adaptive = adaptive;
+        checkpoint = saved;
+        keep = true;
+    }
 
-        if (ctime.msecsTo(ctime1) > m_checkTime.toInt()) {
-            QString cylinderNumber = QString("%1").arg(i);
-            QString cylinderTimeConsuming = QString("%1").arg(ctime.msecsTo(ctime1));
-            QString cylinderStatus = "bad";
-            QString cylinderErrorInfo = "IO Device Timeout";
+    m_checkpoint = checkpoint;
+    m_continue = false;
+    m_checkpointTimer.start();
+    resetLatency(keep);
 
-            emit checkBadBlocksInfo(cylinderNumber, cylinderTimeConsuming, cylinderStatus, cylinderErrorInfo);
-        } else {
-            if (cmd.indexOf("0/0/0") != -1) {
-                QString cylinderNumber = QString("%1").arg(i);
-                QString cylinderTimeConsuming = QString("%1").arg(ctime.msecsTo(ctime1));
-                QString cylinderStatus = "good";
-                QString cylinderErrorInfo = "";
+    //继续检测时先发送上次检测出的坏扇区和慢扇区范围 界面不必依赖本地保存的结果
+    if (keep) {
+        foreach (const BadBlockScanner::SectorRange &range, m_checkpoint.m_bad) {
+            emit checkBadSectorsRange(m_devicePath, range.m_start, range.m_end, "IO Read Error");
+        }
+        foreach (const BadBlockScanner::SectorRange &range, m_checkpoint.m_slow) {
+            emit checkBadSectorsRange(m_devicePath, range.m_start, range.m_end, "IO Device Timeout");
+        }
+    }
+}
 
-                emit checkBadBlocksInfo(cylinderNumber, cylinderTimeConsuming, cylinderStatus, cylinderErrorInfo);
-            } else {
-                QString cylinderNumber = QString("%1").arg(i);
-                QString cylinderTimeConsuming = QString("%1").arg(ctime.msecsTo(ctime1));
-                QString cylinderStatus = "bad";
-                QString cylinderErrorInfo = "IO Read Error";
+void WorkThread::saveCheckpoint(bool force)
+{
+    if (!force && !m_checkpointTimer.hasExpired(CheckpointInterval)) {
+        return;
+    }
 
-                emit checkBadBlocksInfo(cylinderNumber, cylinderTimeConsuming, cylinderStatus, cylinderErrorInfo);
-            }
-        }
-        i++;
-        j++;
+    BadBlockCheckpoint::save(m_checkpoint);
+    m_checkpointTimer.restart();
+}
+
+void WorkThread::resetLatency(bool keep)
+{
+    Sector cylinders = qMax<Sector>(1, m_checkpoint.m_blockEnd - m_checkpoint.m_blockStart + 1);
+    Sector regionCylinders = (cylinders + LatencyRegionCount - 1) / LatencyRegionCount;
+
+    QMutexLocker locker(&m_latencyMutex);
+    if (keep && m_latencyDevice == m_devicePath && m_latencyStart == m_checkpoint.m_blockStart
+            && m_regionCylinders == regionCylinders) {
+        return;
     }
 
-    if (m_stopFlag != 2) {
-        emit checkBadBlocksFinished();
+    m_latencyDevice = m_devicePath;
+    m_latencyStart = m_checkpoint.m_blockStart;
+    m_regionCylinders = regionCylinders;
+    m_deviceLatency.clear();
+    m_regionLatency = QVector<LatencyHistogram>(LatencyRegionCount);
+}
+
+void WorkThread::addLatency(Sector region, qint64 usecs)
+{
+    QMutexLocker locker(&m_latencyMutex);
+    m_deviceLatency.add(usecs);
+    Sector index = (region - m_latencyStart) / m_regionCylinders;
+    if (index >= 0 && index < m_regionLatency.size()) {
+        m_regionLatency[static_cast<int>(index)].add(usecs);
+    }
+}
+
+void WorkThread::addProgress(const BadBlockScanner::ReadRequest &request, int sectorSize, int status)
+{
+    m_progress.add(request.m_offset / sectorSize, request.m_length / sectorSize, request.m_latency, status);
+    pollProgress();
+}
+
+void WorkThread::flushProgress()
+{
+    if (!m_progress.isEmpty()) {
+        emit checkBadBlocksProgress(m_devicePath, m_progress.take());
     }
 }
 
+void WorkThread::pollProgress()
+{
+    if (m_progress.isDue()) {
+        flushProgress();
+    }
+}
+
+QStringList WorkThread::latencyStatistics() const
+{
+    QMutexLocker locker(&m_latencyMutex);
+    QStringList list;
+    if (m_deviceLatency.count() == 0) {
+        return list;
+    }
+
+    QStringList buckets;
+    foreach (qint64 count, m_deviceLatency.buckets()) {
+        buckets << QString::number(count);
+    }
+    list.append(QString("device:%1 %2 buckets:%3").arg(m_latencyDevice).arg(m_deviceLatency.toString()).arg(buckets.join(",")));
+
+    for (int i = 0; i < m_regionLatency.size(); i++) {
+        const LatencyHistogram &histogram = m_regionLatency.at(i);
+        if (histogram.count() == 0) {
+            continue;
+        }
+
+        Sector first = m_latencyStart + i * m_regionCylinders;
+        list.append(QString("region:%1 cylinder:%2-%3 %4").arg(i).arg(first).arg(first + m_regionCylinders - 1).arg(histogram.toString()));
+    }
+
+    return list;
+}
+
 FixThread::FixThread(QObject *parent)
 {
     Q_UNUSED(parent);
@@ -228,103 +478,169 @@ void FixThread::setFixBadBlocksInfo(const QString &devicePath, QStringList list,
 ProbeThread::ProbeThread(QObject *parent)
 {
     Q_UNUSED(parent);
+    qRegisterMetaType<PartitionVec>();
+    qRegisterMetaType<TopologySnapshotPtr>();
+    m_usagePool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
 }
 
 void ProbeThread::probeDeviceInfo()
 {
     qDebug() << __FILE__ << ":" << __FUNCTION__ << "Someone call me in thread!";
+    ProbeRefresh refresh;
     QString rootFsName;
-    m_inforesult.clear();
-    m_deviceMap.clear();
-    QVector<QString> devicePaths;
-    devicePaths.clear();
-    BlockSpecial::clearCache();
-    ProcPartitionsInfo::loadCache();
-    FsInfo::loadCache();
-    MountInfo::loadCache(rootFsName);
-    ped_device_probe_all();
-    PedDevice *lpDevice = ped_device_get_next(nullptr);
-    while (lpDevice) {
-        /* TO TRANSLATORS: looks like   Confirming /dev/sda */
-        qDebug() << QString("Confirming %1").arg(lpDevice->path);
-
-        //only add this device if we can read the first sector (which means it's a real device)
-
-        if (PartedCore::useableDevice(lpDevice))
-            devicePaths.push_back(lpDevice->path);
-//        qDebug() << lpDevice->path;
-        lpDevice = ped_device_get_next(lpDevice);
-    }
-//    qDebug() << __FUNCTION__ << "devicepaths size=" << devicepaths.size();
-    std::sort(devicePaths.begin(), devicePaths.end());
-//    qDebug() << __FUNCTION__ << "**8";
-    static PartedCore pcl;
-    for (int t = 0; t < devicePaths.size(); t++) {
-        /*TO TRANSLATORS: looks like Searching /dev/sda partitions */
-        Device tempDevice;
-        //PartedCore pcl;
-        pcl.setDeviceFromDisk(tempDevice, devicePaths[t]);
-        DeviceStorage device;
-        tempDevice.m_mediaType = device.getDiskInfoMediaType(devicePaths[t]);
-        device.getDiskInfoModel(devicePaths[t], tempDevice.m_model);
-        device.getDiskInfoInterface(devicePaths[t], tempDevice.m_interface, tempDevice.m_model);
-        m_deviceMap.insert(devicePaths.at(t), tempDevice);
-    }
-//    qDebug() << __FUNCTION__ << "**9";
+    std::shared_ptr<TopologySnapshot> snapshot = std::make_shared<TopologySnapshot>();
+    PartedCore::loadProbeCaches(refresh, rootFsName);
+    QVector<QString> devicePaths = PartedCore::getUseableDevicePaths();
+    refresh.lap("getUseableDevicePaths");
+    QMap<QString, Device> deviceMap;
+    probeCore().setDeferUsedSectors(true);
+    probeCore().probeDevices(devicePaths, deviceMap, snapshot->m_probeTime);
+    refresh.lap("probeDevices");
     //这里的代码有可能会恢复，与文管对移动设备的处理相关
 //    getPartitionHiddenFlag();
-    for (auto it = m_deviceMap.begin(); it != m_deviceMap.end(); it++) {
-        DeviceInfo devinfo = it.value().getDeviceInfo();
-        for (int i = 0; i < it.value().m_partitions.size(); i++) {
-            const Partition &pat = *(it.value().m_partitions.at(i)); //拷贝构造速度提升 const 引用
-            PartitionInfo partinfo = pat.getPartitionInfo();
-            //这里的代码有可能会恢复，与文管对移动设备的处理相关
-//            if(m_hiddenPartition.indexOf(partinfo.m_uuid) != -1 && !partinfo.m_uuid.isEmpty()) {
-//                partinfo.m_flag = 1;
-//            } else {
-//                partinfo.m_flag = 0;
-//            }
-
-            //partinfo = pat.getPartitionInfo();
-            if (rootFsName == pat.getPath()) {
-                partinfo.m_flag = 4;
-                qDebug() << __FUNCTION__ << "Set systemfs Flags3 !! " << pat.m_devicePath << " " << pat.m_name << " " << pat.m_uuid;
-            }
-
-            if (pat.m_type == PartitionType::TYPE_EXTENDED) {
-                devinfo.m_partition.push_back(partinfo);
-                for (int k = 0; k < pat.m_logicals.size(); k++) {
-                    const Partition &plogic = *(pat.m_logicals.at(k));
-                    partinfo = plogic.getPartitionInfo();
-                    if (rootFsName == plogic.m_name) {
-                        partinfo.m_flag = 4;
-                        qDebug() << __FUNCTION__ << "Set systemfs Flags4 !! " << plogic.m_devicePath << " " << plogic.m_name << " " << plogic.m_uuid;
-                    }
-                    qDebug() << __FUNCTION__ << plogic.m_devicePath << " " << plogic.m_name << " " << plogic.m_uuid;
-                    devinfo.m_partition.push_back(partinfo);
-                }
-            } else {
-                devinfo.m_partition.push_back(partinfo);
-            }
-        }
-        m_inforesult.insert(devinfo.m_path, devinfo);
+    for (auto it = deviceMap.begin(); it != deviceMap.end(); it++) {
+        snapshot->setDevice(it.key(), it.value());
+        snapshot->m_inforesult.insert(it.key(), PartedCore::buildDeviceInfo(it.value(), rootFsName));
     }
-//    qDebug() << __FUNCTION__ << m_inforesult.count();
-//    qDebug() << __FUNCTION__ << "**10";
+    refresh.lap("buildDeviceInfo");
 
     //todo 2022.1.26 获取m_lvminfo
-    LVMOperator::getDeviceDataAndLVMInfo(m_inforesult, m_lvmInfo);
-    LUKSOperator::updateLUKSInfo(m_inforesult,m_lvmInfo,m_luksInfo);
+    LVMOperator::getDeviceDataAndLVMInfo(snapshot->m_inforesult, snapshot->m_lvmInfo);
+    refresh.lap("LVM");
+    LUKSOperator::updateLUKSInfo(snapshot->m_inforesult, snapshot->m_lvmInfo, snapshot->m_luksInfo);
+    refresh.lap("LUKS");
 
-    emit updateDeviceInfo(/*m_deviceMap,*/ m_inforesult, m_lvmInfo,m_luksInfo);
+    publishSnapshot(snapshot);
+    emit updateDeviceInfo(snapshot);
+    startUsedSectorsStage();
 
     qDebug() << __FILE__ << ":" << __FUNCTION__ << "Someone call me in thread，working done!";
     qDebug() << __FILE__ << "Now I am working on thread:" << QThread::currentThreadId();
 }
 
-QMap<QString, Device> ProbeThread::getDeviceMap()
+void ProbeThread::probeDeviceChanged(const QString &action, const QString &devicePath)
+{
+    //还没有完整刷新过 没有可以合并的数据
+    TopologySnapshotPtr current = getSnapshot();
+    if (!current || current->m_inforesult.isEmpty()) {
+        probeDeviceInfo();
+        return;
+    }
+
+    qDebug() << __FUNCTION__ << action << devicePath;
+    ProbeRefresh refresh;
+    QString rootFsName;
+    PartedCore::loadProbeCaches(refresh, rootFsName);
+
+    //未变化的设备与当前快照共享
+    std::shared_ptr<TopologySnapshot> snapshot = std::make_shared<TopologySnapshot>(*current);
+    snapshot->removeDevice(devicePath);
+
+    if (action != "remove" && PartedCore::useableDevice(devicePath)) {
+        QMap<QString, Device> deviceMap;
+        QVector<DeviceProbeTime> probeTime;
+        probeCore().setDeferUsedSectors(true);
+        probeCore().probeDevices(QVector<QString>() << devicePath, deviceMap, probeTime);
+        for (auto it = deviceMap.begin(); it != deviceMap.end(); it++) {
+            snapshot->setDevice(it.key(), it.value());
+            snapshot->m_inforesult.insert(it.key(), PartedCore::buildDeviceInfo(it.value(), rootFsName));
+        }
+        snapshot->m_probeTime += probeTime;
+    }
+    refresh.lap("probeDevices");
+
+    //设备上可能存在pv或加密分区 lvm与luks信息需要整体更新
+    LVMOperator::getDeviceDataAndLVMInfo(snapshot->m_inforesult, snapshot->m_lvmInfo);
+    refresh.lap("LVM");
+    LUKSOperator::updateLUKSInfo(snapshot->m_inforesult, snapshot->m_lvmInfo, snapshot->m_luksInfo);
+    refresh.lap("LUKS");
+
+    publishSnapshot(snapshot);
+    emit updateDeviceInfo(snapshot);
+    startUsedSectorsStage();
+}
+
+TopologySnapshotPtr ProbeThread::getSnapshot() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+void ProbeThread::publishSnapshot(const std::shared_ptr<TopologySnapshot> &snapshot)
 {
-    return m_deviceMap;
+    snapshot->m_sequence = TopologySnapshot::nextSequence();
+    std::atomic_store(&m_snapshot, TopologySnapshotPtr(snapshot));
+}
+
+void ProbeThread::startUsedSectorsStage()
+{
+    //上一次刷新尚未开始的任务直接丢弃 正在执行的任务结果按序号丢弃 但会写入缓存供本次使用
+    m_usagePool.clear();
+    ++m_usageGeneration;
+
+    TopologySnapshotPtr snapshot = getSnapshot();
+    for (auto it = snapshot->m_inforesult.begin(); it != snapshot->m_inforesult.end(); ++it) {
+        PartitionVec pending;
+        foreach (const PartitionInfo &info, it.value().m_partition) {
+            if (info.m_usagePending) {
+                pending.append(info);
+            }
+        }
+
+        if (!pending.isEmpty()) {
+            m_usagePool.start(new UsedSectorsTask(this, m_usageGeneration, it.key(), pending));
+        }
+    }
+}
+
+void ProbeThread::onUsedSectorsReady(quint64 generation, const QString &devicePath, const PartitionVec &partitions)
+{
+    TopologySnapshotPtr current = getSnapshot();
+    if (generation != m_usageGeneration || !current || !current->m_inforesult.contains(devicePath)) {
+        return;
+    }
+
+    //已发布的快照不能修改 拷贝出新快照 只深拷贝本设备的分区对象
+    std::shared_ptr<TopologySnapshot> snapshot = std::make_shared<TopologySnapshot>(*current);
+    DeviceInfo &devInfo = snapshot->m_inforesult[devicePath];
+    for (int i = 0; i < devInfo.m_partition.size(); i++) {
+        PartitionInfo &info = devInfo.m_partition[i];
+        foreach (const PartitionInfo &result, partitions) {
+            if (result.m_path == info.m_path) {
+                info.m_sectorsUsed = result.m_sectorsUsed;
+                info.m_sectorsUnused = result.m_sectorsUnused;
+                info.m_sectorsUnallocated = result.m_sectorsUnallocated;
+                info.m_significantThreshold = result.m_significantThreshold;
+                info.m_fileSystemBlockSize = result.m_fileSystemBlockSize;
+                info.m_usagePending = false;
+                break;
+            }
+        }
+    }
+
+    //同步到分区对象 分区操作依赖其中的已用空间
+    Device device = snapshot->cloneDevice(devicePath);
+    QVector<Partition *> partitionList = device.m_partitions;
+    for (int i = 0; i < device.m_partitions.size(); i++) {
+        partitionList += device.m_partitions.at(i)->m_logicals;
+    }
+
+    foreach (Partition *partition, partitionList) {
+        foreach (const PartitionInfo &result, partitions) {
+            if (result.m_path == partition->getPath()) {
+                partition->m_sectorsUsed = result.m_sectorsUsed;
+                partition->m_sectorsUnused = result.m_sectorsUnused;
+                partition->m_sectorsUnallocated = result.m_sectorsUnallocated;
+                partition->m_significantThreshold = result.m_significantThreshold;
+                partition->m_fsBlockSize = result.m_fileSystemBlockSize;
+                partition->m_usagePending = false;
+                break;
+            }
+        }
+    }
+    snapshot->setDevice(devicePath, device);
+
+    publishSnapshot(snapshot);
+    emit updateUsedSectors(snapshot);
 }
 
 
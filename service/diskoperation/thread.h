@@ -30,7 +30,15 @@
 #include "sigtype.h"
 #include "device.h"
 #include "deviceinfo.h"
+#include "topologysnapshot.h"
+#include "badblockcheckpoint.h"
+#include "badblockprogress.h"
+#include "latencyhistogram.h"
 #include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
 #include <parted/parted.h>
 #include <parted/device.h>
 
@@ -54,21 +62,56 @@ public slots:
     void probeDeviceInfo();
 
     /**
-     * @brief 返回硬件信息
+     * @brief 只刷新发生变化的设备 并合并到已有硬件信息中
+     * @param action：变化类型 add remove change
+     * @param devicePath：设备路径
+     */
+    void probeDeviceChanged(const QString &action, const QString &devicePath);
+
+public:
+    /**
+     * @brief 获取最近发布的拓扑快照 可在任意线程调用 不会等待正在进行的刷新
+     * @return 拓扑快照 尚未刷新过时为空
      */
-    QMap<QString, Device> getDeviceMap();
+    TopologySnapshotPtr getSnapshot() const;
+
 signals:
     /**
      * @brief 更新硬件信息信号
-     * @param 要同步的硬件信息
+     * @param snapshot：本次刷新发布的拓扑快照
+     */
+    void updateDeviceInfo(const TopologySnapshotPtr &snapshot);
+
+    /**
+     * @brief 后台计算出设备分区已用空间信号
+     * @param snapshot：合并已用空间后发布的拓扑快照
      */
-    void updateDeviceInfo(/*const QMap<QString, Device> m_deviceMap, */const DeviceInfoMap infomap, const LVMInfo lvmInfo, const LUKSMap &luks);
+    void updateUsedSectors(const TopologySnapshotPtr &snapshot);
+
+private slots:
+    /**
+     * @brief 合并后台计算的分区已用空间 结果所属的刷新已过期时丢弃
+     * @param generation：计算任务所属刷新序号
+     * @param devicePath：设备路径
+     * @param partitions：计算完成的分区信息
+     */
+    void onUsedSectorsReady(quint64 generation, const QString &devicePath, const PartitionVec &partitions);
 
 private:
-    QMap<QString, Device> m_deviceMap; //设备对应信息表
-    DeviceInfoMap m_inforesult;        //全部设备分区信息
-    LVMInfo m_lvmInfo;                 //lvm 属性信息
-    LUKSMap m_luksInfo;                //luks 属性信息
+    /**
+     * @brief 为标记为m_usagePending的分区启动后台计算 每个设备一个任务 取消上一次刷新尚未开始的任务
+     */
+    void startUsedSectorsStage();
+
+    /**
+     * @brief 分配快照序号并以原子操作替换当前快照 发布后快照不再修改
+     * @param snapshot：拓扑快照
+     */
+    void publishSnapshot(const std::shared_ptr<TopologySnapshot> &snapshot);
+
+    TopologySnapshotPtr m_snapshot;    //当前拓扑快照 只通过std::atomic_load/atomic_store访问
+    QThreadPool m_usagePool;           //分区已用空间计算线程池
+    quint64 m_usageGeneration{0};      //分区已用空间计算序号 每次刷新后递增
 };
 
 /**
@@ -115,6 +158,30 @@ public:
      */
     void setStopFlag(int flag);
 
+    /**
+     * @brief 设置坏道检测并发读取数
+     * @param depth：并发读取数 小于等于0时使用默认值
+     */
+    void setQueueDepth(int depth);
+
+    /**
+     * @brief 设置是否使用自适应检测
+     * @param adaptive：true健康区域按大块读取 出错或超时时逐柱面重读并二分定位到扇区 false逐柱面读取
+     */
+    void setAdaptive(bool adaptive);
+
+    /**
+     * @brief 设置下次开始检测时是否继续上次检测
+     * @param keep：true检查点参数与本次一致时保留已检测范围及检测结果 false重新建立检查点
+     */
+    void setContinue(bool keep);
+
+    /**
+     * @brief 获取最近一次坏道检测的读取耗时统计 可在任意线程调用
+     * @return 第一行为整个设备的统计及对数刻度各桶样本数 其后每个区域一行 包括柱面范围、p50、p99及最大值
+     */
+    QStringList latencyStatistics() const;
+
 public slots:
 
     /**
@@ -130,13 +197,20 @@ public slots:
 signals:
 
     /**
-     * @brief 坏道检测检测信息信号(次数检测)
-     * @param cylinderNumber：检测柱面号
-     * @param cylinderTimeConsuming：柱面耗时
-     * @param cylinderStatus：柱面状态
-     * @param cylinderErrorInfo：柱面错误信息
+     * @brief 坏道检测批量进度信号 每个进度间隔最多发送一次
+     * @param devicePath：设备路径
+     * @param progress：检测结果 每项依次为起始扇区、扇区个数、耗时(us)、状态 字段见BadBlocksProgressField
      */
-    void checkBadBlocksInfo(const QString &cylinderNumber, const QString &cylinderTimeConsuming, const QString &cylinderStatus, const QString &cylinderErrorInfo);
+    void checkBadBlocksProgress(const QString &devicePath, const QVector<qlonglong> &progress);
+
+    /**
+     * @brief 坏道扇区范围信号(自适应检测) 从检查点继续检测时先重新发送检查点中保存的范围
+     * @param devicePath：设备路径
+     * @param startSector：起始逻辑扇区
+     * @param endSector：结束逻辑扇区 包含在范围内
+     * @param errorInfo：错误信息
+     */
+    void checkBadSectorsRange(const QString &devicePath, qint64 startSector, qint64 endSector, const QString &errorInfo);
 
     /**
      * @brief 坏道检测完成信号
@@ -144,13 +218,100 @@ signals:
     void checkBadBlocksFinished();
 
 private:
+    /**
+     * @brief 按柱面读取检测 每批读取队列深度个柱面 按柱面顺序发送检测信息 检测进度定期保存到检查点
+     * @param method：检测方式 BadBlockCheckpoint::Method
+     * @param timeout：超时时间 单位ms 小于0时不判断超时
+     */
+    void scanRegions(int method, qint64 timeout);
+
+    /**
+     * @brief 自适应读取检测 每次读取多个柱面组成的区段 区段读取失败或超时时再逐柱面检测
+     * @param scanner：读取引擎 缓冲区大小为一个区段
+     * @param extentRegions：区段包含的柱面个数
+     * @param timeout：单个柱面超时时间 单位ms 小于0时不判断超时
+     */
+    void scanExtents(BadBlockScanner &scanner, int extentRegions, qint64 timeout);
+
+    /**
+     * @brief 逐柱面检测 读取失败的柱面二分定位坏扇区 超时的柱面整体作为坏扇区范围
+     * @param scanner：读取引擎
+     * @param firstRegion：起始柱面号
+     * @param count：柱面个数
+     * @param timeout：单个柱面超时时间 单位ms 小于0时不判断超时
+     * @param adaptive：是否自适应检测 检测开始时确定 检测过程中不变
+     */
+    void checkRegions(BadBlockScanner &scanner, Sector firstRegion, int count, qint64 timeout, bool adaptive);
+
+    /**
+     * @brief 建立本次检测的检查点 继续检测且参数一致时沿用已保存的检查点 并重新发送其中的坏扇区和慢扇区范围
+     * @param method：检测方式 BadBlockCheckpoint::Method
+     * @param sectorSize：逻辑扇区大小
+     * @param adaptive：是否自适应检测
+     */
+    void beginCheckpoint(int method, int sectorSize, bool adaptive);
+
+    /**
+     * @brief 保存检查点
+     * @param force：true立即保存 false距上次保存超过保存间隔时才保存
+     */
+    void saveCheckpoint(bool force);
+
+    /**
+     * @brief 按检查点的柱面范围重新划分耗时统计区域 并清空统计
+     * @param keep：true继续检测且区域划分不变时保留已有统计
+     */
+    void resetLatency(bool keep);
+
+    /**
+     * @brief 添加一次读取的耗时 同时计入整个设备及读取起始柱面所在区域
+     * @param region：读取起始柱面号
+     * @param usecs：耗时 单位us
+     */
+    void addLatency(Sector region, qint64 usecs);
+
+    /**
+     * @brief 添加一项检测结果到批量进度 距上次发送超过进度间隔时发送
+     * @param request：读取请求 扇区范围按请求的偏移和长度计算
+     * @param sectorSize：逻辑扇区大小
+     * @param status：读取状态 BadBlocksStatus
+     */
+    void addProgress(const BadBlockScanner::ReadRequest &request, int sectorSize, int status);
+
+    /**
+     * @brief 发送尚未发送的批量进度 发送坏扇区范围前调用 保证界面先收到对应柱面的进度
+     */
+    void flushProgress();
+
+    /**
+     * @brief 距上次发送超过进度间隔时发送批量进度 在检测循环及二分定位的每次读取后调用
+     */
+    void pollProgress();
+
+    static const int DefaultQueueDepth = 8;    //默认并发读取数
+    static const qint64 AdaptiveExtentSize = 8 * 1024 * 1024;    //自适应检测区段大小 单位字节
+    static const qint64 CheckpointInterval = 5000;    //检查点保存间隔 单位ms
+    static const int LatencyRegionCount = 256;    //耗时统计区域个数 检测范围等分
+
     QString m_devicePath;   //设备路径
     int m_blockStart;       //开始检测柱面号
     int m_blockEnd;         //检测结束柱面号
     int m_checkConut;       //检测次数
     int m_checkSize;        //检测柱面大小
     QString m_checkTime;    //检测超时时间
-    int m_stopFlag;         //暂停状态
+    std::atomic<int> m_stopFlag;    //暂停状态 由主线程设置 检测循环在每批读取之间检查
+    int m_queueDepth;       //并发读取数
+    std::atomic<bool> m_adaptive;   //是否自适应检测 由主线程设置 检测线程在开始时读取
+    bool m_continue;        //是否继续上次检测
+    BadBlockCheckpoint m_checkpoint;    //本次检测的检查点
+    QElapsedTimer m_checkpointTimer;    //距上次保存检查点的时间
+    QString m_latencyDevice;            //耗时统计所属设备路径
+    Sector m_latencyStart;              //耗时统计第一个区域的开始柱面号
+    Sector m_regionCylinders;           //每个耗时统计区域的柱面个数
+    LatencyHistogram m_deviceLatency;   //整个设备的读取耗时分布
+    QVector<LatencyHistogram> m_regionLatency;  //各区域的读取耗时分布
+    mutable QMutex m_latencyMutex;      //保护耗时统计 检测线程写入 服务线程读取
+    BadBlockProgress m_progress;        //尚未发送的批量进度
 };
 
 /**
@@ -200,7 +361,7 @@ signals:
 
 private:
     QString m_devicePath;   //设备路径
-    int m_stopFlag;         //暂停状态
+    std::atomic<int> m_stopFlag;    //暂停状态 由主线程设置 修复循环在每个柱面之间检查
     QStringList m_list;     //需要修复柱面集合
     int m_checkSize;        //检测柱面大小
 };
@@ -0,0 +1,130 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "topologycache.h"
+#include "topologydelta.h"
+#include "topologyimage.h"
+#include "utils.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace DiskManager {
+
+static const QString CacheDir = "/var/cache/deepin-diskmanager";
+static const QString CacheFile = CacheDir + "/topology.cache";
+
+bool TopologyCache::load(DeviceInfoMap &devices, LVMInfo &lvm, LUKSMap &luks)
+{
+    QFile file(CacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QMap<QString, QString> identities;
+    QByteArray image;
+    stream >> magic >> version;
+    if (magic != Magic || version != Version) {
+        qDebug() << __FUNCTION__ << "unknown topology cache format";
+        return false;
+    }
+
+    stream >> identities >> image;
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << __FUNCTION__ << "topology cache is corrupted";
+        return false;
+    }
+
+    for (auto it = identities.begin(); it != identities.end(); it++) {
+        if (deviceIdentity(it.key()) != it.value()) {
+            qDebug() << __FUNCTION__ << it.key() << "changed since the topology cache was written";
+            return false;
+        }
+    }
+
+    TopologyDelta delta;
+    if (!TopologyImage::decode(image.constData(), image.size(), delta) || !delta.m_fullSync) {
+        qDebug() << __FUNCTION__ << "invalid topology image in cache";
+        return false;
+    }
+
+    delta.apply(devices, lvm, luks);
+    qDebug() << __FUNCTION__ << "loaded" << devices.count() << "devices from topology cache";
+    return true;
+}
+
+void TopologyCache::save(const DeviceInfoMap &devices, const LVMInfo &lvm, const LUKSMap &luks)
+{
+    QMap<QString, QString> identities;
+    for (auto it = devices.begin(); it != devices.end(); it++) {
+        QString identity = deviceIdentity(it.key());
+        if (identity.isEmpty()) {
+            //磁盘在探测后已被拔出 缓存下次必然失效 不必保存
+            return;
+        }
+        identities.insert(it.key(), identity);
+    }
+
+    if (!QDir().mkpath(CacheDir)) {
+        qDebug() << __FUNCTION__ << "failed to create" << CacheDir;
+        return;
+    }
+
+    QSaveFile file(CacheFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << __FUNCTION__ << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << Magic << Version << identities << TopologyImage::encode(TopologyDelta::full(0, devices, lvm, luks));
+    if (!file.commit()) {
+        qDebug() << __FUNCTION__ << file.errorString();
+    }
+}
+
+QString TopologyCache::deviceIdentity(const QString &devicePath)
+{
+    QString sysPath = Utils::sysBlockPath(devicePath);
+    if (sysPath.isEmpty()) {
+        return QString();
+    }
+
+    QString name = QFileInfo(sysPath).fileName();
+    QStringList identity;
+    identity << Utils::readSysfs(sysPath + "/dev") << Utils::readSysfs(sysPath + "/size") << Utils::sysfsSerial(sysPath);
+    QStringList partitions = QDir(sysPath).entryList(QStringList() << name + "*", QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    foreach (const QString &partition, partitions) {
+        identity << partition + "=" + Utils::readSysfs(sysPath + "/" + partition + "/size");
+    }
+
+    return identity.join(":");
+}
+
+} // namespace DiskManager
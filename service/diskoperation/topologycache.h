@@ -0,0 +1,70 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TOPOLOGYCACHE_H
+#define TOPOLOGYCACHE_H
+#include "deviceinfo.h"
+#include "lvmstruct.h"
+#include "luksstruct.h"
+
+#include <QMap>
+
+namespace DiskManager {
+
+/**
+ * @class TopologyCache
+ * @brief 上次探测得到的磁盘拓扑的磁盘缓存 服务启动时先以缓存响应客户端 后台探测完成后再下发增量
+ *        缓存内容为全量拓扑的二进制镜像(TopologyImage) 同时记录每个磁盘在sysfs中的标识
+ *        任一磁盘标识与当前sysfs不一致时整个缓存作废
+ */
+class TopologyCache
+{
+public:
+    /**
+     * @brief 读取缓存拓扑
+     * @param devices：磁盘信息
+     * @param lvm：lvm信息
+     * @param luks：luks信息
+     * @return true读取成功false缓存不存在、损坏或磁盘标识已变化
+     */
+    static bool load(DeviceInfoMap &devices, LVMInfo &lvm, LUKSMap &luks);
+
+    /**
+     * @brief 保存拓扑到缓存 先写临时文件再替换 避免中途断电损坏缓存
+     * @param devices：磁盘信息
+     * @param lvm：lvm信息
+     * @param luks：luks信息
+     */
+    static void save(const DeviceInfoMap &devices, const LVMInfo &lvm, const LUKSMap &luks);
+
+private:
+    /**
+     * @brief 获取磁盘在sysfs中的标识 设备号:扇区数:wwid或序列号:各分区名称及扇区数
+     * @param devicePath：磁盘路径
+     * @return 磁盘标识 磁盘不存在时返回空
+     */
+    static QString deviceIdentity(const QString &devicePath);
+
+    static const quint32 Magic = 0x43544d44;    //文件标识 "DMTC"
+    static const quint32 Version = 1;           //缓存格式版本号 格式变化时递增
+};
+
+} // namespace DiskManager
+#endif // TOPOLOGYCACHE_H
@@ -0,0 +1,71 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "topologysnapshot.h"
+
+#include <atomic>
+
+namespace DiskManager {
+
+quint64 TopologySnapshot::nextSequence()
+{
+    static std::atomic<quint64> sequence(0);
+    return ++sequence;
+}
+
+void TopologySnapshot::setDevice(const QString &devicePath, const Device &device)
+{
+    m_deviceMap.insert(devicePath, device);
+}
+
+void TopologySnapshot::removeDevice(const QString &devicePath)
+{
+    m_deviceMap.remove(devicePath);
+    m_inforesult.remove(devicePath);
+    for (int i = m_probeTime.size() - 1; i >= 0; i--) {
+        if (m_probeTime.at(i).m_path == devicePath) {
+            m_probeTime.remove(i);
+        }
+    }
+}
+
+Device TopologySnapshot::cloneDevice(const QString &devicePath) const
+{
+    const Device source = m_deviceMap.value(devicePath);
+    Device device = source;
+    device.clearPartitions();
+    PartitionArena &arena = device.partitionArena();
+    foreach (const Partition *partition, source.m_partitions) {
+        Partition *copy = partition->clone(arena);
+        for (int k = 0; k < copy->m_logicals.size(); k++) {
+            copy->m_logicals[k] = copy->m_logicals.at(k)->clone(arena);
+        }
+        device.m_partitions.push_back(copy);
+    }
+
+    return device;
+}
+
+const QMap<QString, Device> &TopologySnapshot::deviceMap() const
+{
+    return m_deviceMap;
+}
+
+} // namespace DiskManager
@@ -0,0 +1,93 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TOPOLOGYSNAPSHOT_H
+#define TOPOLOGYSNAPSHOT_H
+#include "device.h"
+#include "deviceinfo.h"
+#include "lvmstruct.h"
+#include "luksstruct.h"
+
+#include <QMap>
+#include <QMetaType>
+
+#include <memory>
+
+namespace DiskManager {
+
+/**
+ * @class TopologySnapshot
+ * @brief 一次刷新得到的完整磁盘拓扑 发布后只读 通过引用计数在线程间共享
+ *        分区对象位于所属设备的内存池中 以已有快照拷贝出的新快照共享未变化设备的内存池
+ *        需要修改某个设备时先cloneDevice再setDevice 不能修改已发布快照中的分区对象
+ */
+class TopologySnapshot
+{
+public:
+    /**
+     * @brief 获取全局递增的快照序号 序号大的快照更新
+     * @return 快照序号
+     */
+    static quint64 nextSequence();
+
+    /**
+     * @brief 添加或替换设备 快照持有设备分区对象内存池的引用
+     * @param devicePath：设备路径
+     * @param device：设备信息
+     */
+    void setDevice(const QString &devicePath, const Device &device);
+
+    /**
+     * @brief 移除设备及其分区信息
+     * @param devicePath：设备路径
+     */
+    void removeDevice(const QString &devicePath);
+
+    /**
+     * @brief 深拷贝设备 包括分区及逻辑分区对象 拷贝结果位于新的内存池 由调用者通过setDevice交给新快照
+     * @param devicePath：设备路径
+     * @return 设备信息
+     */
+    Device cloneDevice(const QString &devicePath) const;
+
+    /**
+     * @brief 获取设备对应信息表 其中的分区对象在快照释放前有效
+     * @return 设备对应信息表
+     */
+    const QMap<QString, Device> &deviceMap() const;
+
+public:
+    quint64 m_sequence{0};                  //快照序号
+    DeviceInfoMap m_inforesult;             //全部设备分区信息
+    LVMInfo m_lvmInfo;                      //lvm 属性信息
+    LUKSMap m_luksInfo;                     //luks 属性信息
+    QVector<DeviceProbeTime> m_probeTime;   //每个设备探测耗时
+
+private:
+    QMap<QString, Device> m_deviceMap;      //设备对应信息表
+};
+
+typedef std::shared_ptr<const TopologySnapshot> TopologySnapshotPtr;
+
+} // namespace DiskManager
+
+Q_DECLARE_METATYPE(DiskManager::TopologySnapshotPtr)
+
+#endif // TOPOLOGYSNAPSHOT_H
@@ -0,0 +1,139 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "udevmonitor.h"
+
+#include <QSocketNotifier>
+#include <QDebug>
+
+#include <libudev.h>
+
+namespace DiskManager {
+
+//同一设备的uevent往往成串到达(例如插入时先add后change) 合并后再上报
+const int UEVENT_DISPATCH_DELAY_MS = 300;
+
+UdevMonitor::UdevMonitor(QObject *parent)
+    : QObject(parent)
+    , m_udev(nullptr)
+    , m_monitor(nullptr)
+    , m_notifier(nullptr)
+{
+    m_dispatchTimer.setSingleShot(true);
+    m_dispatchTimer.setInterval(UEVENT_DISPATCH_DELAY_MS);
+    connect(&m_dispatchTimer, &QTimer::timeout, this, &UdevMonitor::onDispatchEvents);
+}
+
+UdevMonitor::~UdevMonitor()
+{
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        delete m_notifier;
+        m_notifier = nullptr;
+    }
+
+    if (m_monitor) {
+        udev_monitor_unref(m_monitor);
+        m_monitor = nullptr;
+    }
+
+    if (m_udev) {
+        udev_unref(m_udev);
+        m_udev = nullptr;
+    }
+}
+
+bool UdevMonitor::start()
+{
+    if (m_notifier) {
+        return true;
+    }
+
+    m_udev = udev_new();
+    if (m_udev == nullptr) {
+        qDebug() << __FUNCTION__ << "udev_new failed";
+        return false;
+    }
+
+    //使用"udev"源而不是"kernel"源 保证收到事件时udev规则已执行完毕 设备节点已经创建
+    m_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    if (m_monitor == nullptr) {
+        qDebug() << __FUNCTION__ << "udev_monitor_new_from_netlink failed";
+        return false;
+    }
+
+    udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "block", "disk");
+    if (udev_monitor_enable_receiving(m_monitor) < 0) {
+        qDebug() << __FUNCTION__ << "udev_monitor_enable_receiving failed";
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(udev_monitor_get_fd(m_monitor), QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &UdevMonitor::onUeventReady);
+    qDebug() << __FUNCTION__ << "block device uevent monitor started";
+
+    return true;
+}
+
+void UdevMonitor::onUeventReady()
+{
+    struct udev_device *dev = udev_monitor_receive_device(m_monitor);
+    if (dev == nullptr) {
+        return;
+    }
+
+    QString action = QString::fromLatin1(udev_device_get_action(dev));
+    QString devicePath = QString::fromLocal8Bit(udev_device_get_devnode(dev));
+    QString bus = QString::fromLatin1(udev_device_get_property_value(dev, "ID_BUS"));
+    QString mediaChange = QString::fromLatin1(udev_device_get_property_value(dev, "DISK_MEDIA_CHANGE"));
+    udev_device_unref(dev);
+
+    //与原udev规则保持一致 只关心带总线信息的物理磁盘 dm/loop等由本服务自身操作产生的设备不在此处理
+    if (devicePath.isEmpty() || bus.isEmpty()) {
+        return;
+    }
+
+    //磁盘change事件在分区表写入后也会产生 这类刷新由操作本身触发 这里只处理介质变化(读卡器插拔卡等)
+    if (action == "change" && mediaChange != "1") {
+        return;
+    }
+
+    if (action != "add" && action != "remove" && action != "change") {
+        return;
+    }
+
+    qDebug() << __FUNCTION__ << action << devicePath;
+    QString &pending = m_pendingEvents[devicePath];
+    if (!(pending == "add" && action == "change")) {
+        pending = action;
+    }
+    m_dispatchTimer.start();
+}
+
+void UdevMonitor::onDispatchEvents()
+{
+    QMap<QString, QString> events;
+    events.swap(m_pendingEvents);
+    for (auto it = events.begin(); it != events.end(); ++it) {
+        emit blockDeviceChanged(it.value(), it.key());
+    }
+}
+
+} // namespace DiskManager
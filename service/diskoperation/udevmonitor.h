@@ -0,0 +1,79 @@
+/*
+* Copyright (C) 2022 ~ 2022 Deepin Technology Co., Ltd.
+*
+* Author:     liuwenhao <liuwenhao@uniontech.com>
+*
+* Maintainer: liuwenhao <liuwenhao@uniontech.com>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef UDEVMONITOR_H
+#define UDEVMONITOR_H
+
+#include <QObject>
+#include <QMap>
+#include <QTimer>
+
+class QSocketNotifier;
+struct udev;
+struct udev_monitor;
+
+namespace DiskManager {
+
+/**
+ * @class UdevMonitor
+ * @brief 块设备热插拔监听类 通过libudev监听内核uevent 只上报整盘设备的变化
+ */
+class UdevMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UdevMonitor(QObject *parent = nullptr);
+    ~UdevMonitor();
+
+    /**
+     * @brief 开始监听
+     * @return true成功false失败
+     */
+    bool start();
+
+signals:
+    /**
+     * @brief 块设备变化信号
+     * @param action：变化类型 add remove change
+     * @param devicePath：整盘设备路径 例如/dev/sdb
+     */
+    void blockDeviceChanged(const QString &action, const QString &devicePath);
+
+private slots:
+    /**
+     * @brief 读取uevent
+     */
+    void onUeventReady();
+
+    /**
+     * @brief 合并短时间内的uevent后统一上报
+     */
+    void onDispatchEvents();
+
+private:
+    struct udev *m_udev;                  //udev上下文
+    struct udev_monitor *m_monitor;       //uevent监听对象
+    QSocketNotifier *m_notifier;          //netlink socket可读通知
+    QTimer m_dispatchTimer;               //事件合并定时器
+    QMap<QString, QString> m_pendingEvents; //待上报事件 key:设备路径 value:变化类型
+};
+
+} // namespace DiskManager
+#endif // UDEVMONITOR_H
@@ -25,59 +25,50 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 #include "watcher.h"
-#include <sys/types.h>
-#include <signal.h>
-#include <unistd.h>
-#include <QDebug>
-#include <QTime>
-#include <QThread>
-#include <QProcess>
-#include <QString>
-#include <QCoreApplication>
 
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusServiceWatcher>
+#include <QDebug>
 
 namespace DiskManager {
 
-/**
- * @brief 执行外部命令
- * @param strCmd:外部命令字符串
- * @param outPut:命令控制台输出
- * @param error:错误信息
- * @return exitcode:退出码
- */
-void Watcher::executCmd(const QString &strCmd, QString &outPut, QString &error)
+Watcher::Watcher(QObject *parent)
+    : QObject(parent)
+    , m_serviceWatcher(new QDBusServiceWatcher(this))
 {
-    QProcess proc;
-    proc.start("bash", QStringList() << "-c" << strCmd);
-    proc.waitForFinished(-1);
-    outPut = proc.readAllStandardOutput();
+    m_serviceWatcher->setConnection(QDBusConnection::systemBus());
+    m_serviceWatcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(m_serviceWatcher, &QDBusServiceWatcher::serviceUnregistered, this, &Watcher::onServiceUnregistered);
 }
 
-void Watcher::run()
+void Watcher::addClient(const QString &service)
 {
-    bool isrun = false;
-    QString cmd, outPut, error;
-    //先判断后台服务进程是否存在,如果存在可能是强制退出导致,应先退出后台程序再重新启动磁盘管理器
-    cmd = QString("ps -eo pid,cmd |awk '{print $2}' |grep -w deepin-diskmanager$");
+    if (service.isEmpty() || m_serviceWatcher->watchedServices().contains(service)) {
+        return;
+    }
+
+    qDebug() << __FUNCTION__ << service;
+    m_serviceWatcher->addWatchedService(service);
+
+    //开始监测前前端可能已经退出 此时不会再收到注销信号
+    if (!QDBusConnection::systemBus().interface()->isServiceRegistered(service)) {
+        onServiceUnregistered(service);
+    }
+}
+
+void Watcher::onServiceUnregistered(const QString &service)
+{
+    if (!m_serviceWatcher->removeWatchedService(service)) {
+        return;
+    }
 
-    while (1) {
-        QThread::msleep(500);  //0.5 second
-        executCmd(cmd, outPut, error);
-        int ret = 0;
-        ret = outPut.length();
-        if (ret) {
-            //这里表示前端在运行当中
-           // qDebug() << "Set to true!!!!!";
-            isrun = true;
-        } else {
-            //这里表示，前端启动过，但是现在已经关闭了
-            if (isrun) {
-                qDebug() << "Need to quit now";
-                _exit(0);
-            }
-        }
-    // qDebug() << "Sleep !!!  == " << ret << " " << outPut << " " << outPut.length() << " "<< error;
+    qDebug() << __FUNCTION__ << service;
+    emit clientQuit(service);
+    if (m_serviceWatcher->watchedServices().isEmpty()) {
+        qDebug() << "Need to quit now";
+        emit allClientsQuit();
     }
 }
 
-} //endof namespace
+} // namespace DiskManager
@@ -28,25 +28,50 @@
 #define WATCHER_H
 
 #include <QObject>
-#include <QThread>
+
+class QDBusServiceWatcher;
 
 namespace DiskManager {
 
 /**
- * @class ProbeThread
- * @brief 硬件信息刷新类
+ * @class Watcher
+ * @brief 前端进程监测类 通过系统总线的NameOwnerChanged信号跟踪调用过Start的前端
+ *        前端启动过又全部退出后(包括被强杀)通知服务退出 不轮询进程表
  */
-class Watcher :public QThread
+class Watcher : public QObject
 {
     Q_OBJECT
 public:
+    explicit Watcher(QObject *parent = nullptr);
+
+    /**
+     * @brief 开始跟踪前端
+     * @param service：前端在系统总线上的唯一名称
+     */
+    void addClient(const QString &service);
 
+signals:
     /**
-     * @brief 监测是前端是否启动又退出
+     * @brief 所有前端均已退出
      */
-    void run();
+    void allClientsQuit();
 
-    void executCmd(const QString &strCmd, QString &outPut, QString &error);
+    /**
+     * @brief 单个前端已退出
+     * @param service：前端唯一名称
+     */
+    void clientQuit(const QString &service);
+
+private slots:
+    /**
+     * @brief 前端在系统总线上的名称注销的槽函数
+     * @param service：前端唯一名称
+     */
+    void onServiceUnregistered(const QString &service);
+
+private:
+    QDBusServiceWatcher *m_serviceWatcher; //系统总线名称监测对象
 };
-}
+
+} // namespace DiskManager
 #endif // WATCHER_H
@@ -0,0 +1,72 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "../../service/diskoperation/badblockcheckpoint.h"
+
+using namespace DiskManager;
+
+class ut_badblockcheckpoint : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        m_checkpoint.m_blockStart = 10;
+        m_checkpoint.m_blockEnd = 99;
+        m_checkpoint.m_checkSize = 4096;
+        m_checkpoint.m_sectorSize = 512;
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    BadBlockCheckpoint m_checkpoint;
+};
+
+TEST_F(ut_badblockcheckpoint, addRange)
+{
+    QVector<BadBlockScanner::SectorRange> ranges;
+    BadBlockCheckpoint::addRange(ranges, 100, 199);
+    BadBlockCheckpoint::addRange(ranges, 0, 9);
+    BadBlockCheckpoint::addRange(ranges, 300, 399);
+    EXPECT_EQ(ranges.size(), 3);
+    EXPECT_EQ(ranges.first().m_start, 0);
+
+    //相邻范围合并
+    BadBlockCheckpoint::addRange(ranges, 200, 249);
+    EXPECT_EQ(ranges.size(), 3);
+    EXPECT_EQ(ranges.at(1).m_end, 249);
+
+    //跨越多个范围时全部合并
+    BadBlockCheckpoint::addRange(ranges, 5, 350);
+    EXPECT_EQ(ranges.size(), 1);
+    EXPECT_EQ(ranges.first().m_start, 0);
+    EXPECT_EQ(ranges.first().m_end, 399);
+}
+
+TEST_F(ut_badblockcheckpoint, nextRegion)
+{
+    EXPECT_EQ(m_checkpoint.nextRegion(), 10);
+
+    m_checkpoint.addCoveredRegions(10, 5);
+    EXPECT_EQ(m_checkpoint.nextRegion(), 15);
+
+    //未连续检测的柱面不影响继续位置
+    m_checkpoint.addCoveredRegions(20, 5);
+    EXPECT_EQ(m_checkpoint.nextRegion(), 15);
+
+    m_checkpoint.addCoveredRegions(15, 5);
+    EXPECT_EQ(m_checkpoint.m_covered.size(), 1);
+    EXPECT_EQ(m_checkpoint.nextRegion(), 25);
+}
+
+TEST_F(ut_badblockcheckpoint, sameParameters)
+{
+    BadBlockCheckpoint other = m_checkpoint;
+    other.m_checkCount = 3;
+    EXPECT_FALSE(m_checkpoint.sameParameters(other));
+
+    other.m_method = BadBlockCheckpoint::METHOD_TIME;
+    m_checkpoint.m_method = BadBlockCheckpoint::METHOD_TIME;
+    EXPECT_TRUE(m_checkpoint.sameParameters(other));
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "../../service/diskoperation/badblockprogress.h"
+
+#include <QThread>
+
+using namespace DiskManager;
+
+class ut_badblockprogress : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(ut_badblockprogress, encoding)
+{
+    BadBlockProgress progress;
+    progress.add(2048, 16065, 1500, BAD_BLOCKS_GOOD);
+    progress.add(18113, 8, 250000, BAD_BLOCKS_BAD);
+
+    QVector<qlonglong> values = progress.take();
+    ASSERT_EQ(values.size(), 2 * static_cast<int>(BAD_BLOCKS_PROGRESS_FIELDS));
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_START), 2048);
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_LENGTH), 16065);
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_LATENCY), 1500);
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_STATUS), static_cast<qlonglong>(BAD_BLOCKS_GOOD));
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_FIELDS + BAD_BLOCKS_PROGRESS_START), 18113);
+    EXPECT_EQ(values.at(BAD_BLOCKS_PROGRESS_FIELDS + BAD_BLOCKS_PROGRESS_STATUS), static_cast<qlonglong>(BAD_BLOCKS_BAD));
+
+    //取出后清空
+    EXPECT_TRUE(progress.isEmpty());
+}
+
+TEST_F(ut_badblockprogress, rateLimit)
+{
+    BadBlockProgress progress(20);
+    EXPECT_FALSE(progress.isDue());
+
+    //间隔内不发送
+    progress.add(0, 8, 100, BAD_BLOCKS_GOOD);
+    EXPECT_FALSE(progress.isDue());
+
+    QThread::msleep(30);
+    EXPECT_TRUE(progress.isDue());
+
+    //取出后重新计时
+    progress.take();
+    progress.add(8, 8, 100, BAD_BLOCKS_GOOD);
+    EXPECT_FALSE(progress.isDue());
+
+    //没有进度时不发送
+    progress.start();
+    QThread::msleep(30);
+    EXPECT_FALSE(progress.isDue());
+}
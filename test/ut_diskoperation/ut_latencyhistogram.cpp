@@ -0,0 +1,57 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "../../basestruct/latencyhistogram.h"
+
+class ut_latencyhistogram : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(ut_latencyhistogram, percentile)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), 0);
+
+    //99个10ms左右的样本和1个500ms的慢读取
+    for (int i = 0; i < 99; i++) {
+        histogram.add(10000 + i);
+    }
+    histogram.add(500000);
+
+    EXPECT_EQ(histogram.count(), 100);
+    EXPECT_EQ(histogram.maxValue(), 500000);
+    EXPECT_GE(histogram.percentile(0.5), 10000);
+    EXPECT_LT(histogram.percentile(0.5), 20000);
+    EXPECT_LT(histogram.percentile(0.99), 20000);
+    EXPECT_EQ(histogram.percentile(1.0), 500000);
+}
+
+TEST_F(ut_latencyhistogram, buckets)
+{
+    LatencyHistogram histogram;
+    histogram.add(0);
+    histogram.add(1);
+    histogram.add(2);
+    histogram.add(3);
+    histogram.add(4);
+
+    QVector<qint64> buckets = histogram.buckets();
+    EXPECT_EQ(buckets.size(), 3);
+    EXPECT_EQ(buckets.at(0), 2);
+    EXPECT_EQ(buckets.at(1), 2);
+    EXPECT_EQ(buckets.at(2), 1);
+
+    LatencyHistogram other;
+    other.add(1LL << 50);
+    histogram.merge(other);
+    EXPECT_EQ(histogram.count(), 6);
+    EXPECT_EQ(histogram.buckets().size(), static_cast<int>(LatencyHistogram::m_bucketCount));
+}
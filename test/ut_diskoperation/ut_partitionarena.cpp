@@ -0,0 +1,169 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "../../service/diskoperation/partitionarena.h"
+#include "../../service/diskoperation/topologysnapshot.h"
+
+using namespace DiskManager;
+
+namespace {
+
+int g_liveCount = 0;
+
+class CountedPartition : public Partition
+{
+public:
+    CountedPartition()
+    {
+        g_liveCount++;
+    }
+
+    CountedPartition(const CountedPartition &other)
+        : Partition(other)
+    {
+        g_liveCount++;
+    }
+
+    ~CountedPartition() override
+    {
+        g_liveCount--;
+    }
+
+    Partition *clone() const override
+    {
+        return new CountedPartition(*this);
+    }
+
+    Partition *clone(PartitionArena &arena) const override
+    {
+        return arena.create<CountedPartition>(*this);
+    }
+};
+
+//快照中所有设备的分区内存池已申请的字节数
+size_t arenaBytes(const std::shared_ptr<TopologySnapshot> &snapshot)
+{
+    size_t bytes = 0;
+    foreach (Device device, snapshot->deviceMap()) {
+        bytes += device.partitionArena().allocatedBytes();
+    }
+    return bytes;
+}
+
+//模拟一次设备探测 8个主分区 1个扩展分区含8个逻辑分区
+Device probeDevice()
+{
+    Device device;
+    device.m_path = "/dev/sdz";
+    PartitionArena &arena = device.partitionArena();
+    for (int i = 0; i < 8; i++) {
+        Partition *partition = arena.create<CountedPartition>();
+        partition->setUnallocated(device.m_path, i * 2048, i * 2048 + 2047, 512, false);
+        device.m_partitions.push_back(partition);
+    }
+
+    Partition *extended = arena.create<CountedPartition>();
+    extended->setUnallocated(device.m_path, 16384, 32767, 512, false);
+    for (int i = 0; i < 8; i++) {
+        Partition *logical = arena.create<CountedPartition>();
+        logical->setUnallocated(device.m_path, 16384 + i * 2048, 16384 + i * 2048 + 2047, 512, true);
+        extended->m_logicals.push_back(logical);
+    }
+    device.m_partitions.push_back(extended);
+
+    return device;
+}
+
+}
+
+class ut_partitionarena : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        g_liveCount = 0;
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(ut_partitionarena, release)
+{
+    PartitionArena arena(256);
+    for (int i = 0; i < 100; i++) {
+        arena.create<CountedPartition>();
+    }
+
+    EXPECT_EQ(arena.count(), 100);
+    EXPECT_EQ(g_liveCount, 100);
+    EXPECT_GT(arena.allocatedBytes(), 0u);
+
+    arena.release();
+    EXPECT_EQ(arena.count(), 0);
+    EXPECT_EQ(g_liveCount, 0);
+    EXPECT_EQ(arena.allocatedBytes(), 0u);
+}
+
+TEST_F(ut_partitionarena, clone)
+{
+    PartitionArena arena;
+    CountedPartition source;
+    source.setUnallocated("/dev/sdz", 2048, 4095, 512, false);
+
+    Partition *copy = source.clone(arena);
+    EXPECT_NE(dynamic_cast<CountedPartition *>(copy), nullptr);
+    EXPECT_EQ(copy->m_sectorStart, 2048);
+    EXPECT_EQ(copy->m_sectorEnd, 4095);
+    EXPECT_EQ(arena.count(), 1);
+
+    Partition *heapCopy = source.clone();
+    EXPECT_NE(dynamic_cast<CountedPartition *>(heapCopy), nullptr);
+    delete heapCopy;
+}
+
+TEST_F(ut_partitionarena, deviceOwnership)
+{
+    {
+        Device device = probeDevice();
+        EXPECT_EQ(g_liveCount, 17);
+
+        Device copy = device;
+        device.clearPartitions();
+        EXPECT_EQ(g_liveCount, 17);
+        EXPECT_EQ(copy.m_partitions.last()->m_logicals.size(), 8);
+    }
+
+    EXPECT_EQ(g_liveCount, 0);
+}
+
+TEST_F(ut_partitionarena, refreshCycles)
+{
+    std::shared_ptr<TopologySnapshot> previous;
+    auto refresh = [&]() {
+        std::shared_ptr<TopologySnapshot> snapshot = std::make_shared<TopologySnapshot>();
+        snapshot->setDevice("/dev/sdz", probeDevice());
+        if (previous) {
+            snapshot->setDevice("/dev/sdy", previous->cloneDevice("/dev/sdz"));
+        }
+        previous = snapshot;
+    };
+
+    for (int i = 0; i < 2; i++) {
+        refresh();
+    }
+    size_t before = arenaBytes(previous);
+    ASSERT_GT(before, 0u);
+
+    //每次刷新只保留当前快照 旧快照的内存池随之释放 不随刷新次数增长
+    for (int i = 0; i < 5000; i++) {
+        refresh();
+    }
+
+    EXPECT_EQ(g_liveCount, 34);
+    EXPECT_EQ(arenaBytes(previous), before);
+
+    previous.reset();
+    EXPECT_EQ(g_liveCount, 0);
+}
@@ -0,0 +1,177 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "topologydelta.h"
+
+class ut_topologydelta : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        //旧拓扑: 磁盘sda、sdb sda1为vg0的pv vg1在sdb1上 sdc1为加密分区
+        m_oldDevices.insert("/dev/sda", makeDevice("/dev/sda", "DISK A"));
+        m_oldDevices.insert("/dev/sdb", makeDevice("/dev/sdb", "DISK B"));
+        m_oldLVM.m_vgInfo.insert("vg0", makeVG("vg0", "lv0"));
+        m_oldLVM.m_vgInfo.insert("vg1", makeVG("vg1", "lv1"));
+        m_oldLVM.m_pvInfo.insert("/dev/sda1", makePV("/dev/sda1", "vg0"));
+        m_oldLVM.m_pvInfo.insert("/dev/sdb1", makePV("/dev/sdb1", "vg1"));
+        addLUKS(m_oldLUKS, "/dev/sdc1", "sdc1_aesE");
+        addLUKS(m_oldLUKS, "/dev/sdd1", "sdd1_aesE");
+
+        //新拓扑: sda分区变化 sdb拔出 新增sde vg0新增lv vg1随sdb删除 新增vg2
+        //sdc1映射名变化 sdd1删除 新增sde1
+        m_newDevices = m_oldDevices;
+        m_newDevices["/dev/sda"].m_partition[0].m_fileSystemLabel = "数据";
+        m_newDevices.remove("/dev/sdb");
+        m_newDevices.insert("/dev/sde", makeDevice("/dev/sde", "DISK E"));
+
+        m_newLVM = m_oldLVM;
+        LVInfo lv;
+        lv.m_vgName = "vg0";
+        lv.m_lvName = "lv2";
+        lv.m_lvPath = "/dev/vg0/lv2";
+        m_newLVM.m_vgInfo["vg0"].m_lvlist.append(lv);
+        m_newLVM.m_vgInfo.remove("vg1");
+        m_newLVM.m_vgInfo.insert("vg2", makeVG("vg2", "lv3"));
+        m_newLVM.m_pvInfo["/dev/sda1"].m_pvUsedPE = 200;
+        m_newLVM.m_pvInfo.remove("/dev/sdb1");
+        m_newLVM.m_pvInfo.insert("/dev/sde2", makePV("/dev/sde2", "vg2"));
+
+        m_newLUKS = m_oldLUKS;
+        m_newLUKS.m_luksMap["/dev/sdc1"].m_mapper.m_dmName = "sdc1_sm4";
+        m_newLUKS.m_mapper["/dev/sdc1"].m_dmName = "sdc1_sm4";
+        m_newLUKS.m_luksMap.remove("/dev/sdd1");
+        m_newLUKS.m_mapper.remove("/dev/sdd1");
+        addLUKS(m_newLUKS, "/dev/sde1", "sde1_aesE");
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static DeviceInfo makeDevice(const QString &path, const QString &model)
+    {
+        PartitionInfo part;
+        part.m_devicePath = path;
+        part.m_path = path + "1";
+        part.m_partitionNumber = 1;
+        part.m_sectorStart = 2048;
+        part.m_sectorEnd = 206847;
+        part.m_fileSystemLabel = "系统";
+
+        DeviceInfo device;
+        device.m_path = path;
+        device.m_model = model;
+        device.m_length = 1953525168;
+        device.m_sectorSize = 512;
+        device.m_partition.append(part);
+        return device;
+    }
+
+    static VGInfo makeVG(const QString &vgName, const QString &lvName)
+    {
+        LVInfo lv;
+        lv.m_vgName = vgName;
+        lv.m_lvName = lvName;
+        lv.m_lvPath = QString("/dev/%1/%2").arg(vgName).arg(lvName);
+
+        VGInfo vg;
+        vg.m_vgName = vgName;
+        vg.m_vgUuid = vgName + "-uuid";
+        vg.m_pvCount = 1;
+        vg.m_lvlist.append(lv);
+        return vg;
+    }
+
+    static PVInfo makePV(const QString &pvPath, const QString &vgName)
+    {
+        PVInfo pv;
+        pv.m_pvPath = pvPath;
+        pv.m_vgName = vgName;
+        pv.m_pvUsedPE = 100;
+        return pv;
+    }
+
+    static void addLUKS(LUKSMap &luksMap, const QString &devicePath, const QString &dmName)
+    {
+        LUKS_INFO luks;
+        luks.m_devicePath = devicePath;
+        luks.m_luksVersion = 2;
+        luks.m_mapper.m_dmName = dmName;
+        luks.m_mapper.m_dmPath = "/dev/mapper/" + dmName;
+        luksMap.m_luksMap.insert(devicePath, luks);
+        luksMap.m_mapper.insert(devicePath, luks.m_mapper);
+    }
+
+    DeviceInfoMap m_oldDevices;
+    LVMInfo m_oldLVM;
+    LUKSMap m_oldLUKS;
+    DeviceInfoMap m_newDevices;
+    LVMInfo m_newLVM;
+    LUKSMap m_newLUKS;
+};
+
+TEST_F(ut_topologydelta, same)
+{
+    TopologyDelta delta = TopologyDelta::diff(1, 2, m_oldDevices, m_oldLVM, m_oldLUKS, m_oldDevices, m_oldLVM, m_oldLUKS);
+    EXPECT_TRUE(delta.isEmpty());
+    EXPECT_EQ(delta.m_baseGeneration, 1u);
+    EXPECT_EQ(delta.m_generation, 2u);
+}
+
+TEST_F(ut_topologydelta, diff)
+{
+    TopologyDelta delta = TopologyDelta::diff(1, 2, m_oldDevices, m_oldLVM, m_oldLUKS, m_newDevices, m_newLVM, m_newLUKS);
+    EXPECT_FALSE(delta.m_fullSync);
+    EXPECT_FALSE(delta.isEmpty());
+
+    //未变化的项不下发
+    EXPECT_EQ(delta.m_changedDevices.keys(), QStringList({"/dev/sda", "/dev/sde"}));
+    EXPECT_EQ(delta.m_removedDevices, QStringList({"/dev/sdb"}));
+    EXPECT_EQ(delta.m_changedVGs.keys(), QStringList({"vg0", "vg2"}));
+    EXPECT_EQ(delta.m_removedVGs, QStringList({"vg1"}));
+    EXPECT_EQ(delta.m_changedPVs.keys(), QStringList({"/dev/sda1", "/dev/sde2"}));
+    EXPECT_EQ(delta.m_removedPVs, QStringList({"/dev/sdb1"}));
+    EXPECT_EQ(delta.m_changedLUKS.keys(), QStringList({"/dev/sdc1", "/dev/sde1"}));
+    EXPECT_EQ(delta.m_removedLUKS, QStringList({"/dev/sdd1"}));
+    EXPECT_EQ(delta.m_changedMappers.keys(), QStringList({"/dev/sdc1", "/dev/sde1"}));
+    EXPECT_EQ(delta.m_removedMappers, QStringList({"/dev/sdd1"}));
+}
+
+TEST_F(ut_topologydelta, apply)
+{
+    TopologyDelta delta = TopologyDelta::diff(1, 2, m_oldDevices, m_oldLVM, m_oldLUKS, m_newDevices, m_newLVM, m_newLUKS);
+
+    //合并到旧拓扑后与新拓扑没有差异
+    DeviceInfoMap devices = m_oldDevices;
+    LVMInfo lvm = m_oldLVM;
+    LUKSMap luks = m_oldLUKS;
+    delta.apply(devices, lvm, luks);
+    EXPECT_TRUE(TopologyDelta::diff(2, 3, m_newDevices, m_newLVM, m_newLUKS, devices, lvm, luks).isEmpty());
+
+    EXPECT_FALSE(devices.contains("/dev/sdb"));
+    EXPECT_EQ(devices.value("/dev/sda").m_partition.at(0).m_fileSystemLabel, QString("数据"));
+    EXPECT_EQ(lvm.m_vgInfo.value("vg0").m_lvlist.size(), 2);
+    EXPECT_FALSE(lvm.m_vgInfo.contains("vg1"));
+    EXPECT_EQ(lvm.m_pvInfo.value("/dev/sda1").m_pvUsedPE, 200);
+    EXPECT_FALSE(luks.m_luksMap.contains("/dev/sdd1"));
+    EXPECT_EQ(luks.m_mapper.value("/dev/sdc1").m_dmName, QString("sdc1_sm4"));
+    EXPECT_TRUE(luks.m_mapper.contains("/dev/sde1"));
+}
+
+TEST_F(ut_topologydelta, applyFullSync)
+{
+    //全量同步时替换本地拓扑 本地多余的项被清除
+    DeviceInfoMap devices = m_oldDevices;
+    LVMInfo lvm = m_oldLVM;
+    LUKSMap luks = m_oldLUKS;
+    TopologyDelta::full(5, m_newDevices, m_newLVM, m_newLUKS).apply(devices, lvm, luks);
+    EXPECT_TRUE(TopologyDelta::diff(5, 6, m_newDevices, m_newLVM, m_newLUKS, devices, lvm, luks).isEmpty());
+
+    //从空拓扑开始同样可以得到完整拓扑
+    DeviceInfoMap emptyDevices;
+    LVMInfo emptyLVM;
+    LUKSMap emptyLUKS;
+    TopologyDelta::full(5, m_newDevices, m_newLVM, m_newLUKS).apply(emptyDevices, emptyLVM, emptyLUKS);
+    EXPECT_TRUE(TopologyDelta::diff(5, 6, m_newDevices, m_newLVM, m_newLUKS, emptyDevices, emptyLVM, emptyLUKS).isEmpty());
+}
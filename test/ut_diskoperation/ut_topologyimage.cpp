@@ -0,0 +1,156 @@
+#include <iostream>
+#include "gtest/gtest.h"
+
+#include "topologyimage.h"
+
+#include <QtEndian>
+
+class ut_topologyimage : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        PartitionInfo part;
+        part.m_devicePath = "/dev/sda";
+        part.m_path = "/dev/sda1";
+        part.m_partitionNumber = 1;
+        part.m_sectorStart = 2048;
+        part.m_sectorEnd = 206847;
+        part.m_uuid = "1b2c-3d4e";
+        part.m_fileSystemLabel = "系统";
+
+        DeviceInfo device;
+        device.m_path = "/dev/sda";
+        device.m_model = "TEST DISK";
+        device.m_serialNumber = "SN0001";
+        device.m_length = 1953525168;
+        device.m_sectorSize = 512;
+        device.m_partition.append(part);
+        m_devices.insert(device.m_path, device);
+
+        VGInfo vg;
+        vg.m_vgName = "vg0";
+        vg.m_vgUuid = "vg-uuid";
+        vg.m_pvCount = 1;
+        m_lvm.m_vgInfo.insert(vg.m_vgName, vg);
+
+        PVInfo pv;
+        pv.m_pvPath = "/dev/sda1";
+        pv.m_vgName = "vg0";
+        pv.m_pvUsedPE = 100;
+        m_lvm.m_pvInfo.insert(pv.m_pvPath, pv);
+
+        LUKS_INFO luks;
+        luks.m_devicePath = "/dev/sdb1";
+        luks.m_luksVersion = 2;
+        luks.m_tokenList << "hint";
+        luks.m_mapper.m_dmName = "sdb1_aesE";
+        luks.m_mapper.m_dmPath = "/dev/mapper/sdb1_aesE";
+        m_luks.m_luksMap.insert(luks.m_devicePath, luks);
+        m_luks.m_mapper.insert(luks.m_devicePath, luks.m_mapper);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    DeviceInfoMap m_devices;
+    LVMInfo m_lvm;
+    LUKSMap m_luks;
+};
+
+TEST_F(ut_topologyimage, roundTrip)
+{
+    TopologyDelta delta = TopologyDelta::full(7, m_devices, m_lvm, m_luks);
+    delta.m_stale = true;
+    delta.m_lvmErr = LVMError::LVM_ERR_PV_CREATE_FAILED;
+
+    QByteArray image = TopologyImage::encode(delta);
+    TopologyDelta decoded;
+    ASSERT_TRUE(TopologyImage::decode(image.constData(), image.size(), decoded));
+    EXPECT_EQ(decoded.m_generation, 7u);
+    EXPECT_EQ(decoded.m_baseGeneration, 7u);
+    EXPECT_TRUE(decoded.m_fullSync);
+    EXPECT_TRUE(decoded.m_stale);
+    EXPECT_EQ(decoded.m_lvmErr, LVMError::LVM_ERR_PV_CREATE_FAILED);
+
+    //解码结果合并后与原拓扑没有差异
+    DeviceInfoMap devices;
+    LVMInfo lvm;
+    LUKSMap luks;
+    decoded.apply(devices, lvm, luks);
+    EXPECT_TRUE(TopologyDelta::diff(0, 1, m_devices, m_lvm, m_luks, devices, lvm, luks).isEmpty());
+    EXPECT_EQ(devices.value("/dev/sda").m_partition.at(0).m_fileSystemLabel, QString("系统"));
+}
+
+TEST_F(ut_topologyimage, roundTripRemoved)
+{
+    TopologyDelta delta = TopologyDelta::diff(3, 4, m_devices, m_lvm, m_luks, DeviceInfoMap(), LVMInfo(), LUKSMap());
+
+    QByteArray image = TopologyImage::encode(delta);
+    TopologyDelta decoded;
+    ASSERT_TRUE(TopologyImage::decode(image.constData(), image.size(), decoded));
+    EXPECT_FALSE(decoded.m_fullSync);
+    EXPECT_EQ(decoded.m_baseGeneration, 3u);
+    EXPECT_EQ(decoded.m_removedDevices, QStringList({"/dev/sda"}));
+    EXPECT_EQ(decoded.m_removedVGs, QStringList({"vg0"}));
+    EXPECT_EQ(decoded.m_removedPVs, QStringList({"/dev/sda1"}));
+    EXPECT_EQ(decoded.m_removedLUKS, QStringList({"/dev/sdb1"}));
+    EXPECT_EQ(decoded.m_removedMappers, QStringList({"/dev/sdb1"}));
+    EXPECT_TRUE(decoded.m_changedDevices.isEmpty());
+}
+
+TEST_F(ut_topologyimage, truncated)
+{
+    QByteArray image = TopologyImage::encode(TopologyDelta::full(1, m_devices, m_lvm, m_luks));
+    const int headerSize = 16;
+
+    //任意位置截断都不能解码成功 也不能越界读取
+    QList<int> sizes = {0, 3, headerSize - 1, headerSize, headerSize + 5, image.size() / 2, image.size() - 1};
+    foreach (int size, sizes) {
+        TopologyDelta decoded;
+        EXPECT_FALSE(TopologyImage::decode(image.constData(), size, decoded)) << "size:" << size;
+    }
+
+    //头部记录的长度与截断后一致时 在读取数据时发现不足
+    QByteArray cut = image.left(image.size() - 1);
+    qToLittleEndian<quint64>(static_cast<quint64>(cut.size() - headerSize), reinterpret_cast<uchar *>(cut.data()) + 8);
+    TopologyDelta decoded;
+    EXPECT_FALSE(TopologyImage::decode(cut.constData(), cut.size(), decoded));
+}
+
+TEST_F(ut_topologyimage, oversized)
+{
+    QByteArray image = TopologyImage::encode(TopologyDelta::full(1, m_devices, m_lvm, m_luks));
+    const int headerSize = 16;
+
+    //数据后有多余内容
+    QByteArray padded = image + QByteArray(32, '\0');
+    TopologyDelta decoded;
+    EXPECT_FALSE(TopologyImage::decode(padded.constData(), padded.size(), decoded));
+
+    //元素个数超过剩余长度 不能按该个数分配内存
+    QByteArray huge = image;
+    const int devicesCountOffset = headerSize + 8 + 8 + 1 + 1;
+    qToLittleEndian<quint32>(0xffffffff, reinterpret_cast<uchar *>(huge.data()) + devicesCountOffset);
+    EXPECT_FALSE(TopologyImage::decode(huge.constData(), huge.size(), decoded));
+
+    //字符串长度超过剩余长度
+    QByteArray longString = image;
+    qToLittleEndian<quint32>(0x7fffffff, reinterpret_cast<uchar *>(longString.data()) + devicesCountOffset + 4);
+    EXPECT_FALSE(TopologyImage::decode(longString.constData(), longString.size(), decoded));
+}
+
+TEST_F(ut_topologyimage, header)
+{
+    QByteArray image = TopologyImage::encode(TopologyDelta::full(1, m_devices, m_lvm, m_luks));
+    TopologyDelta decoded;
+
+    QByteArray badMagic = image;
+    badMagic[0] = static_cast<char>(badMagic.at(0) ^ 0xff);
+    EXPECT_FALSE(TopologyImage::decode(badMagic.constData(), badMagic.size(), decoded));
+
+    QByteArray badVersion = image;
+    qToLittleEndian<quint32>(TopologyImage::Version + 1, reinterpret_cast<uchar *>(badVersion.data()) + 4);
+    EXPECT_FALSE(TopologyImage::decode(badVersion.constData(), badVersion.size(), decoded));
+}
@@ -110,7 +110,7 @@ TEST_F(ut_application, hideSuccess)
     MainSplitter *mainSplitter = centerWidget->findChild<MainSplitter *>();
     DeviceListWidget *deviceListWidget = mainSplitter->findChild<DeviceListWidget *>();
 
-    deviceListWidget->m_curDiskInfoData = deviceListWidget->m_treeView->getCurItem()->data().value<DiskInfoData>();
+    deviceListWidget->m_curDiskInfoData = deviceListWidget->m_treeView->currentIndex().data(DmTreeModel::DataRole).value<DiskInfoData>();
     deviceListWidget->onHidePartitionClicked();
 
     DMDbusHandler::instance()->onHidePartition("1");
@@ -131,7 +131,7 @@ TEST_F(ut_application, hideFailed)
     MainSplitter *mainSplitter = centerWidget->findChild<MainSplitter *>();
     DeviceListWidget *deviceListWidget = mainSplitter->findChild<DeviceListWidget *>();
 
-    deviceListWidget->m_curDiskInfoData = deviceListWidget->m_treeView->getCurItem()->data().value<DiskInfoData>();
+    deviceListWidget->m_curDiskInfoData = deviceListWidget->m_treeView->currentIndex().data(DmTreeModel::DataRole).value<DiskInfoData>();
     deviceListWidget->onHidePartitionClicked();
 
     DMDbusHandler::instance()->onHidePartition("0");